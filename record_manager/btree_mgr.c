@@ -0,0 +1,797 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include "btree_mgr.h"
+#include "buffer_mgr.h"
+#include "storage_mgr.h"
+
+/*
+ * Index file layout:
+ *	page 0	header (key type, key length, unique flag, keys per node, root, #nodes, #entries, #pages)
+ *	page 1+	nodes: [isLeaf][numKeys][next] followed by the entries
+ * Leaf entries are (key, rid), ordered by key and then rid, so equal keys are
+ * distinct entries; next is the right sibling leaf. Inner entries are
+ * (key, rid, child) where child holds the entries >= (key, rid), and next is
+ * the child left of the first entry. Deleted entries are removed from their
+ * leaf right away, but nodes are never merged.
+ */
+
+#define BT_HEADER_PAGE 0
+#define BT_NODE_HEADER (3 * (int) sizeof(int))
+#define BT_MAX_DEPTH 32
+#define BT_NO_PAGE -1
+#define BT_POOL_PAGES 16
+
+#define NODE_IS_LEAF(node) (((int *) (node))[0])
+#define NODE_NUM_KEYS(node) (((int *) (node))[1])
+#define NODE_NEXT(node) (((int *) (node))[2])
+
+// Structure to manage an open index and its buffer pool
+typedef struct BTreeMgmtData {
+	BM_BufferPool bufferPool;	// Buffer pool for the index pages
+	int keyLength;	// Size of an encoded key in bytes
+	bool unique;	// TRUE if a key may occur only once
+	int maxKeys;	// Entries per node before it is split
+	int root;	// Page of the root node
+	int numNodes;	// Number of nodes in the tree
+	int numEntries;	// Number of (key, rid) entries
+	int numPages;	// Pages in use, new nodes are appended
+} BTreeMgmtData;
+
+// Scan position and upper bound of a tree scan
+typedef struct BTScanMgmtData {
+	int leaf;	// current leaf, BT_NO_PAGE once the scan is done
+	int pos;	// next entry in the leaf
+	char *high;	// encoded upper bound, NULL if none
+} BTScanMgmtData;
+
+static const RID minRid = { INT_MIN, INT_MIN };
+
+/************************************************************
+ *                    keys and entries                      *
+ ************************************************************/
+
+static int entrySize(BTreeMgmtData *mgmt, bool leaf) {
+	return mgmt->keyLength + 2 * sizeof(int) + (leaf ? 0 : sizeof(int));
+}
+
+static char *entryAt(BTreeMgmtData *mgmt, char *node, int i) {
+	return node + BT_NODE_HEADER + i * entrySize(mgmt, NODE_IS_LEAF(node));
+}
+
+static RID entryRid(BTreeMgmtData *mgmt, const char *entry) {
+	RID rid;
+	rid.page = readIntAttr(entry + mgmt->keyLength);
+	rid.slot = readIntAttr(entry + mgmt->keyLength + sizeof(int));
+	return rid;
+}
+
+static int entryChild(BTreeMgmtData *mgmt, const char *entry) {
+	return readIntAttr(entry + mgmt->keyLength + 2 * sizeof(int));
+}
+
+static void writeEntry(BTreeMgmtData *mgmt, char *entry, const char *key, RID rid, int child, bool leaf) {
+	memcpy(entry, key, mgmt->keyLength);
+	writeIntAttr(entry + mgmt->keyLength, rid.page);
+	writeIntAttr(entry + mgmt->keyLength + sizeof(int), rid.slot);
+	if (!leaf)
+		writeIntAttr(entry + mgmt->keyLength + 2 * sizeof(int), child);
+}
+
+/* Encoded size of a key of the given type */
+static int keySize(DataType keyType, int keyLength) {
+	switch (keyType) {
+		case DT_INT:
+			return sizeof(int);
+		case DT_FLOAT:
+			return sizeof(float);
+		case DT_BOOL:
+			return sizeof(bool);
+		case DT_STRING:
+			return keyLength;
+	}
+	return -1;
+}
+
+/* Stores a key value in the fixed-size form kept in the nodes */
+static RC encodeKey(BTreeHandle *tree, Value *key, char *buf) {
+	BTreeMgmtData *mgmt = (BTreeMgmtData *) tree->mgmtData;
+
+	if (key->dt != tree->keyType)
+		return RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE;
+
+	switch (key->dt) {
+		case DT_INT:
+			writeIntAttr(buf, key->v.intV);
+		break;
+		case DT_FLOAT:
+			writeFloatAttr(buf, key->v.floatV);
+		break;
+		case DT_BOOL:
+			writeBoolAttr(buf, key->v.boolV);
+		break;
+		case DT_STRING:
+			memset(buf, 0, mgmt->keyLength);
+			strncpy(buf, key->v.stringV, mgmt->keyLength);
+		break;
+	}
+	return RC_OK;
+}
+
+/* Orders two encoded keys; NaN floats sort after all other values */
+static int compareKeys(BTreeHandle *tree, const char *a, const char *b) {
+	BTreeMgmtData *mgmt = (BTreeMgmtData *) tree->mgmtData;
+
+	switch (tree->keyType) {
+		case DT_INT: {
+			int x = readIntAttr(a), y = readIntAttr(b);
+			return (x > y) - (x < y);
+		}
+		case DT_FLOAT: {
+			float x = readFloatAttr(a), y = readFloatAttr(b);
+			if (isnan(x) || isnan(y))
+				return isnan(x) - isnan(y);
+			return (x > y) - (x < y);
+		}
+		case DT_BOOL:
+			return (int) readBoolAttr(a) - (int) readBoolAttr(b);
+		case DT_STRING:
+			return strncmp(a, b, mgmt->keyLength);
+	}
+	return 0;
+}
+
+/* Orders an entry against (key, rid) */
+static int compareEntry(BTreeHandle *tree, const char *entry, const char *key, RID rid) {
+	BTreeMgmtData *mgmt = (BTreeMgmtData *) tree->mgmtData;
+	int cmp = compareKeys(tree, entry, key);
+	RID other;
+
+	if (cmp != 0)
+		return cmp;
+	other = entryRid(mgmt, entry);
+	if (other.page != rid.page)
+		return (other.page > rid.page) ? 1 : -1;
+	return (other.slot > rid.slot) - (other.slot < rid.slot);
+}
+
+/* Position of the first entry of a node that is >= (key, rid) */
+static int lowerBound(BTreeHandle *tree, char *node, const char *key, RID rid) {
+	BTreeMgmtData *mgmt = (BTreeMgmtData *) tree->mgmtData;
+	int lo = 0, hi = NODE_NUM_KEYS(node);
+
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (compareEntry(tree, entryAt(mgmt, node, mid), key, rid) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/* Child of an inner node whose subtree holds (key, rid) */
+static int childFor(BTreeHandle *tree, char *node, const char *key, RID rid) {
+	BTreeMgmtData *mgmt = (BTreeMgmtData *) tree->mgmtData;
+	int lo = 0, hi = NODE_NUM_KEYS(node);
+
+	// find the number of entries <= (key, rid)
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (compareEntry(tree, entryAt(mgmt, node, mid), key, rid) <= 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return (lo == 0) ? NODE_NEXT(node) : entryChild(mgmt, entryAt(mgmt, node, lo - 1));
+}
+
+/************************************************************
+ *                    nodes                                 *
+ ************************************************************/
+
+/**
+ * Function: findLeaf
+ * -----------------
+ * Descends from the root to the leaf that holds (or would hold) (key, rid).
+ *
+ * @param tree      Index
+ * @param key       Encoded key
+ * @param rid       Record id, minRid to find the first entry of key
+ * @param path      Filled with the inner nodes on the way down (may be NULL)
+ * @param depth     Set to the number of pages in path
+ * @param leaf      Set to the leaf page
+ * @return
+ *  -   RC_OK if the leaf was found
+ */
+static RC findLeaf(BTreeHandle *tree, const char *key, RID rid, int *path, int *depth, int *leaf) {
+	BTreeMgmtData *mgmt = (BTreeMgmtData *) tree->mgmtData;
+	BM_PageHandle page;
+	int pageNum = mgmt->root, d = 0;
+	RC rc;
+
+	while (TRUE) {
+		if ((rc = pinPage(&mgmt->bufferPool, &page, pageNum)) != RC_OK)
+			return rc;
+		if (NODE_IS_LEAF(page.data) || d == BT_MAX_DEPTH)
+			break;
+		if (path != NULL)
+			path[d] = pageNum;
+		d++;
+		int child = childFor(tree, page.data, key, rid);
+		unpinPage(&mgmt->bufferPool, &page);
+		pageNum = child;
+	}
+	unpinPage(&mgmt->bufferPool, &page);
+
+	if (depth != NULL)
+		*depth = d;
+	*leaf = pageNum;
+	return RC_OK;
+}
+
+/* Appends a new, empty node to the index file and pins it */
+static RC newNode(BTreeMgmtData *mgmt, BM_PageHandle *page, bool leaf) {
+	RC rc;
+
+	if ((rc = pinPage(&mgmt->bufferPool, page, mgmt->numPages)) != RC_OK)
+		return rc;
+	mgmt->numPages++;
+	mgmt->numNodes++;
+
+	NODE_IS_LEAF(page->data) = leaf;
+	NODE_NUM_KEYS(page->data) = 0;
+	NODE_NEXT(page->data) = BT_NO_PAGE;
+	return markDirty(&mgmt->bufferPool, page);
+}
+
+/**
+ * Function: insertIntoNode
+ * -----------------------
+ * Inserts an entry into a pinned node. If the node is full, its entries and
+ * the new one are split between the node and a new right sibling, and the
+ * entry that separates them is returned in carry for the parent: the first
+ * entry of a new leaf, or the middle entry of an inner node (which moves up
+ * and leaves the node).
+ *
+ * @param tree      Index
+ * @param page      Pinned node
+ * @param entry     Entry to insert (with child for inner nodes)
+ * @param carry     Set to the separator if the node was split
+ * @param split     Set to TRUE if the node was split
+ * @return
+ *  -   RC_OK if the entry was inserted
+ */
+static RC insertIntoNode(BTreeHandle *tree, BM_PageHandle *page, const char *entry, char *carry, bool *split) {
+	BTreeMgmtData *mgmt = (BTreeMgmtData *) tree->mgmtData;
+	char *node = page->data;
+	bool leaf = NODE_IS_LEAF(node);
+	int es = entrySize(mgmt, leaf);
+	int n = NODE_NUM_KEYS(node);
+	int pos = lowerBound(tree, node, entry, entryRid(mgmt, entry));
+	char *entries = node + BT_NODE_HEADER;
+	BM_PageHandle right;
+	RC rc;
+
+	*split = FALSE;
+	if (n < mgmt->maxKeys) {
+		memmove(entries + (pos + 1) * es, entries + pos * es, (n - pos) * es);
+		memcpy(entries + pos * es, entry, es);
+		NODE_NUM_KEYS(node) = n + 1;
+		return markDirty(&mgmt->bufferPool, page);
+	}
+
+	// Lay out all n + 1 entries in order, then split them
+	char *all = (char *) malloc((n + 1) * es);
+	memcpy(all, entries, pos * es);
+	memcpy(all + pos * es, entry, es);
+	memcpy(all + (pos + 1) * es, entries + pos * es, (n - pos) * es);
+
+	if ((rc = newNode(mgmt, &right, leaf)) != RC_OK) {
+		free(all);
+		return rc;
+	}
+
+	int left = (n + 1) / 2;
+	if (leaf) {
+		// leaves keep all entries and are chained; the separator is copied up
+		memcpy(entries, all, left * es);
+		memcpy(right.data + BT_NODE_HEADER, all + left * es, (n + 1 - left) * es);
+		NODE_NUM_KEYS(right.data) = n + 1 - left;
+		NODE_NEXT(right.data) = NODE_NEXT(node);
+		NODE_NEXT(node) = right.pageNum;
+		writeEntry(mgmt, carry, all + left * es, entryRid(mgmt, all + left * es), right.pageNum, FALSE);
+	} else {
+		// the middle entry moves up, its child becomes the leftmost child of the new node
+		char *middle = all + left * es;
+		memcpy(entries, all, left * es);
+		memcpy(right.data + BT_NODE_HEADER, middle + es, (n - left) * es);
+		NODE_NUM_KEYS(right.data) = n - left;
+		NODE_NEXT(right.data) = entryChild(mgmt, middle);
+		writeEntry(mgmt, carry, middle, entryRid(mgmt, middle), right.pageNum, FALSE);
+	}
+	NODE_NUM_KEYS(node) = left;
+	*split = TRUE;
+	free(all);
+
+	markDirty(&mgmt->bufferPool, page);
+	return unpinPage(&mgmt->bufferPool, &right);
+}
+
+/************************************************************
+ *                    index manager                         *
+ ************************************************************/
+
+/**
+ * Function: initIndexManager
+ * -------------------------
+ * Initializes the index manager. Nothing more.
+ * @param mgmtData
+ * @return
+ *	-	RC_OK
+ */
+RC initIndexManager(void *mgmtData) {
+	return RC_OK;
+}
+
+/**
+ * Function: shutdownIndexManager
+ * -----------------------------
+ * Shuts down the index manager.
+ * @return
+ *	-	RC_OK
+ */
+RC shutdownIndexManager() {
+	return RC_OK;
+}
+
+/**
+ * Function: createBtree
+ * --------------------
+ * Creates a new, empty B+-tree index in its own page file.
+ * Page 0 holds the index header, page 1 the root, which starts out as an
+ * empty leaf.
+ *
+ * @param idxId     Name of the index (used as the page file name)
+ * @param keyType   Data type of the keys
+ * @param keyLength Length of string keys (ignored for other types)
+ * @param n         Maximum number of keys per node, 0 for as many as fit a page
+ * @param unique    TRUE if every key may be inserted only once
+ * @return
+ *	-	RC_OK if the index was created
+ *	-	RC_INVALID_PARAM if the key type, key length or n is not valid
+ */
+RC createBtree(char *idxId, DataType keyType, int keyLength, int n, bool unique) {
+	int size = keySize(keyType, keyLength);
+	int fit, maxKeys;
+	SM_FileHandle fHandle;
+	char data[PAGE_SIZE];
+	RC rc;
+
+	if (size <= 0)
+		return RC_INVALID_PARAM;
+	fit = (PAGE_SIZE - BT_NODE_HEADER) / (size + 3 * (int) sizeof(int));
+	maxKeys = (n > 0 && n < fit) ? n : fit;
+	if (maxKeys < 2 || n == 1)
+		return RC_INVALID_PARAM;
+
+	if ((rc = createPageFile(idxId)) != RC_OK)
+		return rc;
+	if ((rc = openPageFile(idxId, &fHandle)) != RC_OK)
+		return rc;
+
+	// Header page
+	memset(data, 0, PAGE_SIZE);
+	int *header = (int *) data;
+	header[0] = keyType;
+	header[1] = size;
+	header[2] = unique;
+	header[3] = maxKeys;
+	header[4] = 1;	// root
+	header[5] = 1;	// nodes
+	header[6] = 0;	// entries
+	header[7] = 2;	// pages
+	if ((rc = writeBlock(BT_HEADER_PAGE, &fHandle, data)) != RC_OK)
+		return rc;
+
+	// Empty root leaf
+	memset(data, 0, PAGE_SIZE);
+	NODE_IS_LEAF(data) = TRUE;
+	NODE_NUM_KEYS(data) = 0;
+	NODE_NEXT(data) = BT_NO_PAGE;
+	if ((rc = writeBlock(1, &fHandle, data)) != RC_OK)
+		return rc;
+
+	return closePageFile(&fHandle);
+}
+
+/**
+ * Function: openBtree
+ * ------------------
+ * Opens an index, setting up a buffer pool for its pages and reading the header.
+ *
+ * @param tree      Set to the new index handle
+ * @param idxId     Name of the index
+ * @return
+ *	-	RC_OK if the index was opened
+ *	-	Errors of the buffer manager if the index file cannot be read
+ */
+RC openBtree(BTreeHandle **tree, char *idxId) {
+	BTreeHandle *handle = (BTreeHandle *) malloc(sizeof(BTreeHandle));
+	BTreeMgmtData *mgmt = (BTreeMgmtData *) malloc(sizeof(BTreeMgmtData));
+	BM_PageHandle page;
+	RC rc;
+
+	if ((rc = initBufferPool(&mgmt->bufferPool, idxId, BT_POOL_PAGES, RS_LRU, NULL)) != RC_OK) {
+		free(mgmt);
+		free(handle);
+		return rc;
+	}
+	if ((rc = pinPage(&mgmt->bufferPool, &page, BT_HEADER_PAGE)) != RC_OK) {
+		shutdownBufferPool(&mgmt->bufferPool);
+		free(mgmt);
+		free(handle);
+		return rc;
+	}
+
+	int *header = (int *) page.data;
+	handle->keyType = (DataType) header[0];
+	mgmt->keyLength = header[1];
+	mgmt->unique = header[2];
+	mgmt->maxKeys = header[3];
+	mgmt->root = header[4];
+	mgmt->numNodes = header[5];
+	mgmt->numEntries = header[6];
+	mgmt->numPages = header[7];
+	unpinPage(&mgmt->bufferPool, &page);
+
+	handle->idxId = strdup(idxId);
+	handle->mgmtData = mgmt;
+	*tree = handle;
+	return RC_OK;
+}
+
+/**
+ * Function: closeBtree
+ * -------------------
+ * Closes an index, writing back its header and all dirty pages.
+ *
+ * @param tree      Index to close
+ * @return
+ *	-	RC_OK if the index was closed
+ */
+RC closeBtree(BTreeHandle *tree) {
+	BTreeMgmtData *mgmt = (BTreeMgmtData *) tree->mgmtData;
+	BM_PageHandle page;
+	RC rc;
+
+	if ((rc = pinPage(&mgmt->bufferPool, &page, BT_HEADER_PAGE)) != RC_OK)
+		return rc;
+	int *header = (int *) page.data;
+	header[4] = mgmt->root;
+	header[5] = mgmt->numNodes;
+	header[6] = mgmt->numEntries;
+	header[7] = mgmt->numPages;
+	markDirty(&mgmt->bufferPool, &page);
+	unpinPage(&mgmt->bufferPool, &page);
+
+	if ((rc = shutdownBufferPool(&mgmt->bufferPool)) != RC_OK)
+		return rc;
+
+	free(tree->idxId);
+	free(mgmt);
+	free(tree);
+	return RC_OK;
+}
+
+/**
+ * Function: deleteBtree
+ * --------------------
+ * Deletes the page file of a (closed) index.
+ *
+ * @param idxId     Name of the index
+ * @return
+ *	-	RC_OK if the index was deleted
+ *	-	RC_FILE_NOT_FOUND if it does not exist
+ */
+RC deleteBtree(char *idxId) {
+	return destroyPageFile(idxId);
+}
+
+RC getNumNodes(BTreeHandle *tree, int *result) {
+	*result = ((BTreeMgmtData *) tree->mgmtData)->numNodes;
+	return RC_OK;
+}
+
+RC getNumEntries(BTreeHandle *tree, int *result) {
+	*result = ((BTreeMgmtData *) tree->mgmtData)->numEntries;
+	return RC_OK;
+}
+
+RC getKeyType(BTreeHandle *tree, DataType *result) {
+	*result = tree->keyType;
+	return RC_OK;
+}
+
+/**
+ * Function: findKey
+ * ----------------
+ * Looks up the first entry with the given key.
+ *
+ * @param tree      Index
+ * @param key       Key to look up
+ * @param result    Set to the rid of the entry
+ * @return
+ *	-	RC_OK if the key was found
+ *	-	RC_IM_KEY_NOT_FOUND if no entry has the key
+ */
+RC findKey(BTreeHandle *tree, Value *key, RID *result) {
+	BT_ScanHandle *scan;
+	RC rc;
+
+	if ((rc = openTreeRangeScan(tree, key, key, &scan)) != RC_OK)
+		return rc;
+	rc = nextEntry(scan, result);
+	closeTreeScan(scan);
+	return (rc == RC_IM_NO_MORE_ENTRIES) ? RC_IM_KEY_NOT_FOUND : rc;
+}
+
+/**
+ * Function: insertKey
+ * ------------------
+ * Inserts a (key, rid) entry. Full nodes are split on the way back up from
+ * the leaf; when the root splits the tree grows by a new root.
+ *
+ * @param tree      Index
+ * @param key       Key of the entry
+ * @param rid       Record the key belongs to
+ * @return
+ *	-	RC_OK if the entry was inserted
+ *	-	RC_IM_KEY_ALREADY_EXISTS if the tree is unique and has the key, or has the same entry
+ */
+RC insertKey(BTreeHandle *tree, Value *key, RID rid) {
+	BTreeMgmtData *mgmt = (BTreeMgmtData *) tree->mgmtData;
+	int path[BT_MAX_DEPTH], depth, leaf;
+	char *encoded = (char *) malloc(mgmt->keyLength);
+	char *entry = (char *) malloc(entrySize(mgmt, FALSE));
+	char *carry = (char *) malloc(entrySize(mgmt, FALSE));
+	BM_PageHandle page;
+	bool split;
+	RID found;
+	RC rc;
+
+	if ((rc = encodeKey(tree, key, encoded)) != RC_OK)
+		goto done;
+	if (mgmt->unique && (rc = findKey(tree, key, &found)) != RC_IM_KEY_NOT_FOUND) {
+		if (rc == RC_OK)
+			rc = RC_IM_KEY_ALREADY_EXISTS;
+		goto done;
+	}
+	writeEntry(mgmt, entry, encoded, rid, BT_NO_PAGE, TRUE);
+
+	if ((rc = findLeaf(tree, entry, rid, path, &depth, &leaf)) != RC_OK)
+		goto done;
+	if ((rc = pinPage(&mgmt->bufferPool, &page, leaf)) != RC_OK)
+		goto done;
+
+	// The same (key, rid) pair cannot be indexed twice
+	int pos = lowerBound(tree, page.data, entry, rid);
+	if (pos < NODE_NUM_KEYS(page.data) && compareEntry(tree, entryAt(mgmt, page.data, pos), entry, rid) == 0) {
+		unpinPage(&mgmt->bufferPool, &page);
+		rc = RC_IM_KEY_ALREADY_EXISTS;
+		goto done;
+	}
+
+	rc = insertIntoNode(tree, &page, entry, carry, &split);
+	unpinPage(&mgmt->bufferPool, &page);
+
+	// Insert separators into the parents as long as nodes split
+	while (rc == RC_OK && split) {
+		memcpy(entry, carry, entrySize(mgmt, FALSE));
+		if (depth == 0) {
+			// the root split: a new root points to both halves
+			int oldRoot = mgmt->root;
+			if ((rc = newNode(mgmt, &page, FALSE)) != RC_OK)
+				break;
+			NODE_NEXT(page.data) = oldRoot;
+			memcpy(entryAt(mgmt, page.data, 0), entry, entrySize(mgmt, FALSE));
+			NODE_NUM_KEYS(page.data) = 1;
+			mgmt->root = page.pageNum;
+			unpinPage(&mgmt->bufferPool, &page);
+			break;
+		}
+		if ((rc = pinPage(&mgmt->bufferPool, &page, path[--depth])) != RC_OK)
+			break;
+		rc = insertIntoNode(tree, &page, entry, carry, &split);
+		unpinPage(&mgmt->bufferPool, &page);
+	}
+
+	if (rc == RC_OK)
+		mgmt->numEntries++;
+done:
+	free(encoded);
+	free(entry);
+	free(carry);
+	return rc;
+}
+
+/**
+ * Function: deleteKey
+ * ------------------
+ * Removes a (key, rid) entry from its leaf. Underfull nodes are not merged;
+ * scans step over empty leaves.
+ *
+ * @param tree      Index
+ * @param key       Key of the entry
+ * @param rid       Record the key belongs to
+ * @return
+ *	-	RC_OK if the entry was removed
+ *	-	RC_IM_KEY_NOT_FOUND if there is no such entry
+ */
+RC deleteKey(BTreeHandle *tree, Value *key, RID rid) {
+	BTreeMgmtData *mgmt = (BTreeMgmtData *) tree->mgmtData;
+	char *encoded = (char *) malloc(mgmt->keyLength);
+	BM_PageHandle page;
+	int leaf;
+	RC rc;
+
+	if ((rc = encodeKey(tree, key, encoded)) != RC_OK || (rc = findLeaf(tree, encoded, rid, NULL, NULL, &leaf)) != RC_OK
+			|| (rc = pinPage(&mgmt->bufferPool, &page, leaf)) != RC_OK) {
+		free(encoded);
+		return rc;
+	}
+
+	char *node = page.data;
+	int n = NODE_NUM_KEYS(node);
+	int pos = lowerBound(tree, node, encoded, rid);
+	if (pos < n && compareEntry(tree, entryAt(mgmt, node, pos), encoded, rid) == 0) {
+		int es = entrySize(mgmt, TRUE);
+		memmove(entryAt(mgmt, node, pos), entryAt(mgmt, node, pos + 1), (n - pos - 1) * es);
+		NODE_NUM_KEYS(node) = n - 1;
+		markDirty(&mgmt->bufferPool, &page);
+		mgmt->numEntries--;
+	} else {
+		rc = RC_IM_KEY_NOT_FOUND;
+	}
+
+	unpinPage(&mgmt->bufferPool, &page);
+	free(encoded);
+	return rc;
+}
+
+/**
+ * Function: openTreeScan
+ * ---------------------
+ * Starts a scan over all entries of an index in key order.
+ *
+ * @param tree      Index
+ * @param handle    Set to the new scan handle
+ * @return
+ *	-	RC_OK if the scan was started
+ */
+RC openTreeScan(BTreeHandle *tree, BT_ScanHandle **handle) {
+	return openTreeRangeScan(tree, NULL, NULL, handle);
+}
+
+/**
+ * Function: openTreeRangeScan
+ * --------------------------
+ * Starts a scan over the entries whose key lies between low and high
+ * (both inclusive), in key order.
+ *
+ * @param tree      Index
+ * @param low       Smallest key to return, NULL to start at the first entry
+ * @param high      Largest key to return, NULL to run to the last entry
+ * @param handle    Set to the new scan handle
+ * @return
+ *	-	RC_OK if the scan was started
+ *	-	RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE if a bound does not have the key type
+ */
+RC openTreeRangeScan(BTreeHandle *tree, Value *low, Value *high, BT_ScanHandle **handle) {
+	BTreeMgmtData *mgmt = (BTreeMgmtData *) tree->mgmtData;
+	BTScanMgmtData *scan = (BTScanMgmtData *) malloc(sizeof(BTScanMgmtData));
+	char *lowKey = (char *) malloc(mgmt->keyLength);
+	BM_PageHandle page;
+	RC rc = RC_OK;
+
+	scan->high = NULL;
+	scan->pos = 0;
+	if (high != NULL) {
+		scan->high = (char *) malloc(mgmt->keyLength);
+		rc = encodeKey(tree, high, scan->high);
+	}
+
+	if (rc == RC_OK && low != NULL) {
+		// Position at the first entry >= low
+		if ((rc = encodeKey(tree, low, lowKey)) == RC_OK
+				&& (rc = findLeaf(tree, lowKey, minRid, NULL, NULL, &scan->leaf)) == RC_OK
+				&& (rc = pinPage(&mgmt->bufferPool, &page, scan->leaf)) == RC_OK) {
+			scan->pos = lowerBound(tree, page.data, lowKey, minRid);
+			unpinPage(&mgmt->bufferPool, &page);
+		}
+	} else if (rc == RC_OK) {
+		// Walk down the leftmost children to the first leaf
+		scan->leaf = mgmt->root;
+		while ((rc = pinPage(&mgmt->bufferPool, &page, scan->leaf)) == RC_OK) {
+			bool leaf = NODE_IS_LEAF(page.data);
+			int child = NODE_NEXT(page.data);
+			unpinPage(&mgmt->bufferPool, &page);
+			if (leaf)
+				break;
+			scan->leaf = child;
+		}
+	}
+	free(lowKey);
+
+	if (rc != RC_OK) {
+		free(scan->high);
+		free(scan);
+		return rc;
+	}
+
+	*handle = (BT_ScanHandle *) malloc(sizeof(BT_ScanHandle));
+	(*handle)->tree = tree;
+	(*handle)->mgmtData = scan;
+	return RC_OK;
+}
+
+/**
+ * Function: nextEntry
+ * ------------------
+ * Returns the rid of the next entry of a tree scan, following the leaf chain.
+ *
+ * @param handle    Scan handle
+ * @param result    Set to the rid of the entry
+ * @return
+ *	-	RC_OK if an entry was returned
+ *	-	RC_IM_NO_MORE_ENTRIES if the scan is done
+ */
+RC nextEntry(BT_ScanHandle *handle, RID *result) {
+	BTScanMgmtData *scan = (BTScanMgmtData *) handle->mgmtData;
+	BTreeMgmtData *mgmt = (BTreeMgmtData *) handle->tree->mgmtData;
+	BM_PageHandle page;
+	RC rc;
+
+	while (scan->leaf != BT_NO_PAGE) {
+		if ((rc = pinPage(&mgmt->bufferPool, &page, scan->leaf)) != RC_OK)
+			return rc;
+
+		if (scan->pos < NODE_NUM_KEYS(page.data)) {
+			char *entry = entryAt(mgmt, page.data, scan->pos);
+			if (scan->high != NULL && compareKeys(handle->tree, entry, scan->high) > 0) {
+				unpinPage(&mgmt->bufferPool, &page);
+				scan->leaf = BT_NO_PAGE;
+				break;
+			}
+			*result = entryRid(mgmt, entry);
+			scan->pos++;
+			return unpinPage(&mgmt->bufferPool, &page);
+		}
+
+		// Continue with the next leaf (which may be empty after deletes)
+		scan->leaf = NODE_NEXT(page.data);
+		scan->pos = 0;
+		unpinPage(&mgmt->bufferPool, &page);
+	}
+	return RC_IM_NO_MORE_ENTRIES;
+}
+
+/**
+ * Function: closeTreeScan
+ * ----------------------
+ * Frees a tree scan. Scans do not keep pages pinned between calls.
+ *
+ * @param handle    Scan handle
+ * @return
+ *	-	RC_OK
+ */
+RC closeTreeScan(BT_ScanHandle *handle) {
+	BTScanMgmtData *scan = (BTScanMgmtData *) handle->mgmtData;
+
+	free(scan->high);
+	free(scan);
+	free(handle);
+	return RC_OK;
+}
@@ -0,0 +1,46 @@
+#ifndef BTREE_MGR_H
+#define BTREE_MGR_H
+
+#include "dberror.h"
+#include "tables.h"
+
+// structure for accessing btrees
+typedef struct BTreeHandle {
+	DataType keyType;
+	char *idxId;
+	void *mgmtData;
+} BTreeHandle;
+
+typedef struct BT_ScanHandle {
+	BTreeHandle *tree;
+	void *mgmtData;
+} BT_ScanHandle;
+
+// init and shutdown index manager
+extern RC initIndexManager (void *mgmtData);
+extern RC shutdownIndexManager ();
+
+// create, destroy, open, and close an btree index
+// keyLength is the size of string keys, n the maximum number of keys per node (0: as many as fit a page)
+extern RC createBtree (char *idxId, DataType keyType, int keyLength, int n, bool unique);
+extern RC openBtree (BTreeHandle **tree, char *idxId);
+extern RC closeBtree (BTreeHandle *tree);
+extern RC deleteBtree (char *idxId);
+
+// access information about a b-tree
+extern RC getNumNodes (BTreeHandle *tree, int *result);
+extern RC getNumEntries (BTreeHandle *tree, int *result);
+extern RC getKeyType (BTreeHandle *tree, DataType *result);
+
+// index access; entries are (key, rid) pairs, a key may occur with several rids unless the tree is unique
+extern RC findKey (BTreeHandle *tree, Value *key, RID *result);
+extern RC insertKey (BTreeHandle *tree, Value *key, RID rid);
+extern RC deleteKey (BTreeHandle *tree, Value *key, RID rid);
+
+// scans in key order; low and high are inclusive bounds, NULL for none
+extern RC openTreeScan (BTreeHandle *tree, BT_ScanHandle **handle);
+extern RC openTreeRangeScan (BTreeHandle *tree, Value *low, Value *high, BT_ScanHandle **handle);
+extern RC nextEntry (BT_ScanHandle *handle, RID *result);
+extern RC closeTreeScan (BT_ScanHandle *handle);
+
+#endif // BTREE_MGR_H
@@ -3,6 +3,7 @@
 #include "dberror.h"
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
 
 // Define a new error code for pinned pages
 #define RC_PINNED_PAGES 100
@@ -18,6 +19,7 @@ typedef struct BP_MgmtData {
     int *fixCounts;                // Array to count the number of clients (pins) per page frame
     bool *dirtyFlags;              // Array to indicate if a page frame has been modified
     void *strategyData;            // Extra parameters for the replacement strategy
+    ReplacementStrategy strategy;  // How victim frames are chosen
     int numPages;                  // Number of pages in the buffer pool
 
     // Additional fields for tracking IO and loaded page numbers
@@ -27,6 +29,17 @@ typedef struct BP_MgmtData {
 
     int *lastUsed;                 // LRU: store "last used clock" for each frame
     int lruClock;                  // Increments on each page pin to track recency
+    int *loadedAt;                 // FIFO: clock when the page of each frame was read
+    int *useCounts;                // LFU: pins of the page of each frame since it was read
+    bool *refBits;                 // CLOCK: set on each pin, cleared as the hand passes
+    int clockHand;                 // CLOCK: next frame the hand looks at
+    int lruK;                      // LRU-K: number of pins remembered per frame (1 for other strategies)
+    int *history;                  // LRU-K: clocks of the last lruK pins of each frame, newest first
+
+    pthread_mutex_t latch;         // Serializes page access calls from concurrent scans
+
+    BM_WriteHook writeHook;        // Called before a dirty page is written, NULL if none
+    void *writeHookContext;
 } BP_MgmtData;
 
 
@@ -55,16 +68,103 @@ static int findPageInPool(BP_MgmtData *mgmtData, PageNumber pageNum) {
 }
 
 /**
- * Helper function to select a frame for replacement using LRU strategy.
+ * Helper function to write a dirty frame back to the page file.
+ *
+ * The write hook runs first, so that a write-ahead log can be forced up to
+ * the changes of the page before the page reaches the disk.
+ *
+ * Parameters:
+ *   mgmtData - Pointer to the buffer pool management data
+ *   frame    - Index of the frame to write
+ *
+ * Returns:
+ *   RC_OK on success, or the error of the hook or of the write.
+ */
+static RC writeFrame(BP_MgmtData *mgmtData, int frame) {
+    RC rc = RC_OK;
+
+    if (mgmtData->writeHook != NULL) {
+        rc = mgmtData->writeHook(mgmtData->pageFrames[frame], mgmtData->writeHookContext);
+    }
+    if (rc == RC_OK) {
+        rc = writeBlock(mgmtData->pageFrames[frame]->pageNum, &mgmtData->fileHandle,
+                        mgmtData->pageFrames[frame]->data);
+    }
+    if (rc == RC_OK) {
+        mgmtData->writeIO++;
+        mgmtData->dirtyFlags[frame] = false;
+    }
+    return rc;
+}
+
+/**
+ * Helper function to record a pin of a frame for the replacement strategies.
+ *
+ * Parameters:
+ *   mgmtData - Pointer to the buffer pool management data
+ *   frame    - Index of the pinned frame
+ *   loaded   - TRUE if the page was just read into the frame
+ */
+static void touchFrame(BP_MgmtData *mgmtData, int frame, bool loaded) {
+    int now = mgmtData->lruClock++;
+    int *history = &mgmtData->history[frame * mgmtData->lruK];
+
+    if (loaded) {
+        mgmtData->loadedAt[frame] = now;
+        mgmtData->useCounts[frame] = 0;
+        memset(history, 0, mgmtData->lruK * sizeof(int));
+    }
+    mgmtData->lastUsed[frame] = now;
+    mgmtData->useCounts[frame]++;
+    mgmtData->refBits[frame] = true;
+    memmove(history + 1, history, (mgmtData->lruK - 1) * sizeof(int));
+    history[0] = now;
+}
+
+/**
+ * Helper function that compares two unpinned frames as victims.
+ *
+ * FIFO replaces the page read first, LRU the page pinned least recently and
+ * LFU the page pinned least often since it was read. LRU-K replaces the page
+ * whose K-th most recent pin is oldest, pages pinned fewer than K times
+ * first. Ties go to the least recently used frame.
+ *
+ * Returns:
+ *   TRUE if frame a should be replaced before frame b.
+ */
+static bool replacesBefore(BP_MgmtData *mgmtData, int a, int b) {
+    int keyA = 0, keyB = 0;
+
+    switch (mgmtData->strategy) {
+    case RS_FIFO:
+        return mgmtData->loadedAt[a] < mgmtData->loadedAt[b];
+    case RS_LFU:
+        keyA = mgmtData->useCounts[a];
+        keyB = mgmtData->useCounts[b];
+        break;
+    case RS_LRU_K:
+        keyA = mgmtData->history[a * mgmtData->lruK + mgmtData->lruK - 1];
+        keyB = mgmtData->history[b * mgmtData->lruK + mgmtData->lruK - 1];
+        break;
+    default:
+        break;
+    }
+    if (keyA != keyB) {
+        return keyA < keyB;
+    }
+    return mgmtData->lastUsed[a] < mgmtData->lastUsed[b];
+}
+
+/**
+ * Helper function to select a frame for replacement.
  *
  * This function implements the page replacement policy by:
  * 1. First looking for any empty frame
- * 2. If no empty frames, selecting an unpinned frame with the oldest "last used" timestamp
+ * 2. If no empty frames, selecting an unpinned frame by the pool's strategy:
+ *    CLOCK moves its hand past the frames, giving those pinned since it last
+ *    passed a second chance; the others compare frames with replacesBefore
  * 3. If the selected frame is dirty, writing it back to disk before replacement
  *
- * The LRU (Least Recently Used) strategy ensures that pages that haven't been
- * accessed for the longest time are replaced first.
- *
  * Parameters:
  *   mgmtData - Pointer to the buffer pool management data
  *
@@ -79,13 +179,24 @@ static int getFrameToReplace(BP_MgmtData *mgmtData) {
         }
     }
 
-    // 2) If none empty, pick the unpinned frame with the oldest (lowest) lastUsed.
+    // 2) If none empty, pick an unpinned frame; two turns of the clock clear every reference bit
     int victimIndex = -1;
-    int oldestTime = __INT_MAX__; // or some sentinel large value
-    for (int i = 0; i < mgmtData->numPages; i++) {
-        if (mgmtData->fixCounts[i] == 0) {
-            if (mgmtData->lastUsed[i] < oldestTime) {
-                oldestTime = mgmtData->lastUsed[i];
+    if (mgmtData->strategy == RS_CLOCK) {
+        for (int n = 0; n < 2 * mgmtData->numPages && victimIndex == -1; n++) {
+            int i = mgmtData->clockHand;
+            mgmtData->clockHand = (i + 1) % mgmtData->numPages;
+            if (mgmtData->fixCounts[i] > 0) {
+                continue;
+            }
+            if (mgmtData->refBits[i]) {
+                mgmtData->refBits[i] = false;
+            } else {
+                victimIndex = i;
+            }
+        }
+    } else {
+        for (int i = 0; i < mgmtData->numPages; i++) {
+            if (mgmtData->fixCounts[i] == 0 && (victimIndex == -1 || replacesBefore(mgmtData, i, victimIndex))) {
                 victimIndex = i;
             }
         }
@@ -98,18 +209,27 @@ static int getFrameToReplace(BP_MgmtData *mgmtData) {
 
     // If it's dirty, write it out before replacement
     if (mgmtData->dirtyFlags[victimIndex]) {
-        writeBlock(
-            mgmtData->pageFrames[victimIndex]->pageNum,
-            &mgmtData->fileHandle,
-            mgmtData->pageFrames[victimIndex]->data
-        );
-        mgmtData->writeIO++;
-        mgmtData->dirtyFlags[victimIndex] = false;
+        writeFrame(mgmtData, victimIndex);
     }
     return victimIndex;
 }
 
 
+/**
+ * Helper function that frees the per-frame arrays of a pool.
+ */
+static void freeFrameInfo(BP_MgmtData *mgmtData) {
+    free(mgmtData->pageFrames);
+    free(mgmtData->fixCounts);
+    free(mgmtData->dirtyFlags);
+    free(mgmtData->framePageNumbers);
+    free(mgmtData->lastUsed);
+    free(mgmtData->loadedAt);
+    free(mgmtData->useCounts);
+    free(mgmtData->refBits);
+    free(mgmtData->history);
+}
+
 /**
  * Function: initBufferPool
  * ------------------------
@@ -129,7 +249,8 @@ static int getFrameToReplace(BP_MgmtData *mgmtData) {
  *   pageFileName - Name of the page file to be managed.
  *   numPages     - Number of page frames in the buffer pool.
  *   strategy     - Page replacement strategy to be used (e.g., RS_FIFO, RS_LRU, etc.).
- *   stratData    - Extra parameter(s) for the replacement strategy (for instance, k for RS_LRU_K).
+ *   stratData    - Extra parameter(s) for the replacement strategy: for RS_LRU_K a
+ *                  pointer to k, NULL for 2. The other strategies take none.
  *
  * Returns:
  *   RC_INVALID_PARAM             - If any of the input parameters are invalid.
@@ -138,7 +259,8 @@ static int getFrameToReplace(BP_MgmtData *mgmtData) {
  */
 RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName,
                   const int numPages, ReplacementStrategy strategy, void *stratData) {
-    if (bm == NULL || pageFileName == NULL || numPages <= 0) {
+    if (bm == NULL || pageFileName == NULL || numPages <= 0 || strategy < RS_FIFO || strategy > RS_LRU_K
+        || (strategy == RS_LRU_K && stratData != NULL && *(int*) stratData <= 0)) {
         return RC_INVALID_PARAM;
     }
 
@@ -156,8 +278,15 @@ RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName,
     mgmtData->fileHandle = fileHandle;
     mgmtData->numPages = numPages;
     mgmtData->strategyData = stratData;
+    mgmtData->strategy = strategy;
+    mgmtData->lruK = 1;
+    if (strategy == RS_LRU_K) {
+        mgmtData->lruK = (stratData != NULL) ? *(int*) stratData : 2;
+    }
     mgmtData->readIO = 0;
     mgmtData->writeIO = 0;
+    mgmtData->writeHook = NULL;
+    mgmtData->writeHookContext = NULL;
 
     mgmtData->pageFrames = (BM_PageHandle**) calloc(numPages, sizeof(BM_PageHandle*));
     mgmtData->fixCounts  = (int*) calloc(numPages, sizeof(int));
@@ -165,15 +294,17 @@ RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName,
     mgmtData->framePageNumbers = (PageNumber*) calloc(numPages, sizeof(PageNumber));
     mgmtData->lastUsed   = (int*) calloc(numPages, sizeof(int)); // LRU array
     mgmtData->lruClock   = 1; // start clock at 1, or 0, your choice
+    mgmtData->loadedAt   = (int*) calloc(numPages, sizeof(int));
+    mgmtData->useCounts  = (int*) calloc(numPages, sizeof(int));
+    mgmtData->refBits    = (bool*) calloc(numPages, sizeof(bool));
+    mgmtData->clockHand  = 0;
+    mgmtData->history    = (int*) calloc(numPages * mgmtData->lruK, sizeof(int));
 
     if (!mgmtData->pageFrames || !mgmtData->fixCounts || !mgmtData->dirtyFlags
-        || !mgmtData->framePageNumbers || !mgmtData->lastUsed) {
+        || !mgmtData->framePageNumbers || !mgmtData->lastUsed || !mgmtData->loadedAt
+        || !mgmtData->useCounts || !mgmtData->refBits || !mgmtData->history) {
         // free everything allocated so far
-        free(mgmtData->pageFrames);
-        free(mgmtData->fixCounts);
-        free(mgmtData->dirtyFlags);
-        free(mgmtData->framePageNumbers);
-        free(mgmtData->lastUsed);
+        freeFrameInfo(mgmtData);
         free(mgmtData);
         return RC_MEMORY_ALLOCATION_ERROR;
     }
@@ -188,15 +319,13 @@ RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName,
 
     bm->pageFile = strdup(pageFileName);
     if (bm->pageFile == NULL) {
-        free(mgmtData->pageFrames);
-        free(mgmtData->fixCounts);
-        free(mgmtData->dirtyFlags);
-        free(mgmtData->framePageNumbers);
-        free(mgmtData->lastUsed);
+        freeFrameInfo(mgmtData);
         free(mgmtData);
         return RC_MEMORY_ALLOCATION_ERROR;
     }
 
+    pthread_mutex_init(&mgmtData->latch, NULL);
+
     bm->numPages = numPages;
     bm->strategy = strategy;
     bm->mgmtData = mgmtData;
@@ -233,28 +362,129 @@ RC forceFlushPool(BM_BufferPool *const bm) {
     }
 
     BP_MgmtData *mgmtData = (BP_MgmtData*) bm->mgmtData;
+    RC rc = RC_OK;
     int i;
 
-    for (i = 0; i < bm->numPages; i++) {
+    pthread_mutex_lock(&mgmtData->latch);
+    for (i = 0; i < bm->numPages && rc == RC_OK; i++) {
         // Check if the page frame is loaded
         if (mgmtData->pageFrames[i] != NULL) {
             // If the page is dirty and not pinned, write it back to disk
             if (mgmtData->dirtyFlags[i] && mgmtData->fixCounts[i] == 0) {
-                RC rc = writeBlock(mgmtData->pageFrames[i]->pageNum,
-                                  &mgmtData->fileHandle,
-                                  mgmtData->pageFrames[i]->data);
-                if (rc != RC_OK) {
-                    return rc;
-                }
-                mgmtData->writeIO++;
-                mgmtData->dirtyFlags[i] = FALSE;
+                rc = writeFrame(mgmtData, i);
             }
         }
     }
+    pthread_mutex_unlock(&mgmtData->latch);
+
+    return rc;
+}
+
+/**
+ * Function: syncBufferPool
+ * ------------------------
+ * Writes all dirty, unpinned pages (like forceFlushPool) and then waits until
+ * the page file is on disk.
+ *
+ * Parameters:
+ *   bm - Pointer to the buffer pool structure.
+ *
+ * Returns:
+ *   RC_OK on success, or an appropriate error code if writing a page fails.
+ */
+RC syncBufferPool(BM_BufferPool *const bm) {
+    RC rc = forceFlushPool(bm);
+    if (rc != RC_OK) {
+        return rc;
+    }
+
+    BP_MgmtData *mgmtData = (BP_MgmtData*) bm->mgmtData;
+    pthread_mutex_lock(&mgmtData->latch);
+    rc = syncPageFile(&mgmtData->fileHandle);
+    pthread_mutex_unlock(&mgmtData->latch);
+    return rc;
+}
 
+/**
+ * Function: setWriteHook
+ * ----------------------
+ * Installs a function that is called before any dirty page of the pool is
+ * written back, with the page and the given context. If the hook fails, the
+ * page is not written.
+ *
+ * Parameters:
+ *   bm      - Pointer to the buffer pool structure.
+ *   hook    - Function to call, NULL to remove the hook.
+ *   context - Passed to the hook.
+ *
+ * Returns:
+ *   RC_OK on success
+ *   RC_INVALID_PARAM for a NULL pool
+ */
+RC setWriteHook(BM_BufferPool *const bm, BM_WriteHook hook, void *context) {
+    if (bm == NULL || bm->mgmtData == NULL) {
+        return RC_INVALID_PARAM;
+    }
+
+    BP_MgmtData *mgmtData = (BP_MgmtData*) bm->mgmtData;
+    pthread_mutex_lock(&mgmtData->latch);
+    mgmtData->writeHook = hook;
+    mgmtData->writeHookContext = context;
+    pthread_mutex_unlock(&mgmtData->latch);
     return RC_OK;
 }
 
+/**
+ * Function: truncateBufferPool
+ * ----------------------------
+ * Removes the pages numPages and beyond from the pool and from the page file.
+ *
+ * Frames holding such pages are emptied without writing them back, even if
+ * they are dirty, since their contents are discarded; then the page file is
+ * truncated to numPages pages.
+ *
+ * Parameters:
+ *   bm       - Pointer to the buffer pool structure.
+ *   numPages - Number of pages of the file to keep.
+ *
+ * Returns:
+ *   RC_OK on success
+ *   RC_PINNED_PAGES if one of the removed pages is pinned
+ *   Other error codes if the file cannot be truncated
+ */
+RC truncateBufferPool(BM_BufferPool *const bm, const int numPages) {
+    if (bm == NULL || bm->mgmtData == NULL || numPages < 0) {
+        return RC_INVALID_PARAM;
+    }
+
+    BP_MgmtData *mgmtData = (BP_MgmtData*) bm->mgmtData;
+    RC rc;
+    int i;
+
+    pthread_mutex_lock(&mgmtData->latch);
+    for (i = 0; i < bm->numPages; i++) {
+        if (mgmtData->pageFrames[i] != NULL && mgmtData->pageFrames[i]->pageNum >= numPages
+                && mgmtData->fixCounts[i] > 0) {
+            pthread_mutex_unlock(&mgmtData->latch);
+            return RC_PINNED_PAGES;
+        }
+    }
+
+    for (i = 0; i < bm->numPages; i++) {
+        if (mgmtData->pageFrames[i] != NULL && mgmtData->pageFrames[i]->pageNum >= numPages) {
+            free(mgmtData->pageFrames[i]->data);
+            free(mgmtData->pageFrames[i]);
+            mgmtData->pageFrames[i] = NULL;
+            mgmtData->framePageNumbers[i] = NO_PAGE;
+            mgmtData->dirtyFlags[i] = false;
+        }
+    }
+
+    rc = truncatePageFile(numPages, &mgmtData->fileHandle);
+    pthread_mutex_unlock(&mgmtData->latch);
+    return rc;
+}
+
 /**
  * Function: shutdownBufferPool
  * ----------------------------
@@ -315,11 +545,8 @@ RC shutdownBufferPool(BM_BufferPool *const bm) {
     }
 
     // Free the arrays and management data structure
-    free(mgmtData->framePageNumbers);
-    free(mgmtData->dirtyFlags);
-    free(mgmtData->fixCounts);
-    free(mgmtData->pageFrames);
-    free(mgmtData->lastUsed);
+    freeFrameInfo(mgmtData);
+    pthread_mutex_destroy(&mgmtData->latch);
     free(mgmtData);
     bm->mgmtData = NULL;
 
@@ -355,13 +582,16 @@ RC markDirty(BM_BufferPool *const bm, BM_PageHandle *const page) {
     }
 
     BP_MgmtData *mgmtData = (BP_MgmtData*) bm->mgmtData;
+    pthread_mutex_lock(&mgmtData->latch);
     int frameIndex = findPageInPool(mgmtData, page->pageNum);
     if (frameIndex == -1) {
         // Page not found in pool
+        pthread_mutex_unlock(&mgmtData->latch);
         return RC_PAGE_NOT_FOUND;
     }
 
     mgmtData->dirtyFlags[frameIndex] = TRUE;
+    pthread_mutex_unlock(&mgmtData->latch);
     return RC_OK;
 }
 
@@ -393,15 +623,18 @@ RC unpinPage(BM_BufferPool *const bm, BM_PageHandle *const page) {
     }
 
     BP_MgmtData *mgmtData = (BP_MgmtData*) bm->mgmtData;
+    pthread_mutex_lock(&mgmtData->latch);
     int frameIndex = findPageInPool(mgmtData, page->pageNum);
     if (frameIndex == -1) {
         // Page not found
+        pthread_mutex_unlock(&mgmtData->latch);
         return RC_PAGE_NOT_FOUND;
     }
 
     if (mgmtData->fixCounts[frameIndex] > 0) {
         mgmtData->fixCounts[frameIndex]--;
     }
+    pthread_mutex_unlock(&mgmtData->latch);
     return RC_OK;
 }
 
@@ -434,59 +667,41 @@ RC forcePage(BM_BufferPool *const bm, BM_PageHandle *const page) {
     }
 
     BP_MgmtData *mgmtData = (BP_MgmtData*) bm->mgmtData;
+    RC rc = RC_OK;
+    pthread_mutex_lock(&mgmtData->latch);
     int frameIndex = findPageInPool(mgmtData, page->pageNum);
     if (frameIndex == -1) {
+        pthread_mutex_unlock(&mgmtData->latch);
         return RC_PAGE_NOT_FOUND;
     }
 
     if (mgmtData->dirtyFlags[frameIndex]) {
-        RC rc = writeBlock(page->pageNum, &mgmtData->fileHandle, mgmtData->pageFrames[frameIndex]->data);
-        if (rc != RC_OK) {
-            return rc;
-        }
-        mgmtData->writeIO++;
-        mgmtData->dirtyFlags[frameIndex] = FALSE;
+        rc = writeFrame(mgmtData, frameIndex);
     }
-    return RC_OK;
+    pthread_mutex_unlock(&mgmtData->latch);
+    return rc;
 }
 
 /**
- * Function: pinPage
- * -----------------
- * Loads a page into the buffer pool and pins it for client use.
- *
- * This is the primary function for clients to access pages. It:
- * 1. Checks if the requested page is already in memory
- *    - If yes, increments its fix count and updates LRU information
- * 2. If not in memory:
- *    - Finds a frame to use (empty or victim for replacement)
- *    - Loads the page from disk into the selected frame
- *    - Sets up tracking information (fix count, dirty flag, etc.)
+ * Helper function that pins a page while the caller holds the pool latch.
  *
- * The page replacement strategy (LRU in this implementation) is used when
- * selecting a victim frame. Only unpinned pages can be selected as victims.
+ * Loading a page touches the frame table, the replacement information and the
+ * page file, so the whole lookup-or-load step runs under the latch.
  *
  * Parameters:
- *   bm      - The buffer pool.
- *   page    - The page handle to be populated with the pinned page.
- *   pageNum - The page number to pin.
+ *   mgmtData - Pointer to the buffer pool management data
+ *   page     - The page handle to be populated with the pinned page
+ *   pageNum  - The page number to pin
  *
  * Returns:
- *   RC_OK if successful
- *   RC_PAGE_NOT_FOUND if no free frame can be found (all pages pinned)
- *   Other error codes for memory allocation or disk read failures
+ *   Same as pinPage.
  */
-RC pinPage(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum) {
-    if (bm == NULL || bm->mgmtData == NULL || pageNum < 0) {
-        return RC_INVALID_PARAM;
-    }
-
-    BP_MgmtData *mgmtData = (BP_MgmtData*) bm->mgmtData;
+static RC pinPageLatched(BP_MgmtData *mgmtData, BM_PageHandle *const page, const PageNumber pageNum) {
     int frameIndex = findPageInPool(mgmtData, pageNum);
     if (frameIndex != -1) {
         // already in memory - just update fix count and LRU information
         mgmtData->fixCounts[frameIndex]++;
-        mgmtData->lastUsed[frameIndex] = mgmtData->lruClock++; // LRU update
+        touchFrame(mgmtData, frameIndex, false); // replacement information update
         page->pageNum = pageNum;
         page->data = mgmtData->pageFrames[frameIndex]->data;
         return RC_OK;
@@ -542,8 +757,8 @@ RC pinPage(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber
         mgmtData->fixCounts[victimFrame]  = 1;
         mgmtData->dirtyFlags[victimFrame] = false;
         mgmtData->framePageNumbers[victimFrame] = pageNum;
-        // LRU update - mark this as most recently used
-        mgmtData->lastUsed[victimFrame] = mgmtData->lruClock++;
+        // replacement information update - the page is new to the frame
+        touchFrame(mgmtData, victimFrame, true);
 
         // populate the client's page handle
         page->pageNum = pageNum;
@@ -552,6 +767,78 @@ RC pinPage(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber
     }
 }
 
+/**
+ * Function: pinPage
+ * -----------------
+ * Loads a page into the buffer pool and pins it for client use.
+ *
+ * This is the primary function for clients to access pages. It:
+ * 1. Checks if the requested page is already in memory
+ *    - If yes, increments its fix count and updates the replacement information
+ * 2. If not in memory:
+ *    - Finds a frame to use (empty or victim for replacement)
+ *    - Loads the page from disk into the selected frame
+ *    - Sets up tracking information (fix count, dirty flag, etc.)
+ *
+ * The pool's page replacement strategy (FIFO, LRU, CLOCK, LFU or LRU-K) is
+ * used when selecting a victim frame. Only unpinned pages can be selected as victims.
+ *
+ * Page access calls hold the pool latch, so several threads may pin and unpin
+ * pages of the same pool concurrently (e.g. the workers of a parallel scan).
+ *
+ * Parameters:
+ *   bm      - The buffer pool.
+ *   page    - The page handle to be populated with the pinned page.
+ *   pageNum - The page number to pin.
+ *
+ * Returns:
+ *   RC_OK if successful
+ *   RC_PAGE_NOT_FOUND if no free frame can be found (all pages pinned)
+ *   Other error codes for memory allocation or disk read failures
+ */
+RC pinPage(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum) {
+    if (bm == NULL || bm->mgmtData == NULL || pageNum < 0) {
+        return RC_INVALID_PARAM;
+    }
+
+    BP_MgmtData *mgmtData = (BP_MgmtData*) bm->mgmtData;
+    pthread_mutex_lock(&mgmtData->latch);
+    RC rc = pinPageLatched(mgmtData, page, pageNum);
+    pthread_mutex_unlock(&mgmtData->latch);
+    return rc;
+}
+
+/**
+ * Function: prefetchPage
+ * ----------------------
+ * Announces that a page will be pinned soon. A page that is not in the pool
+ * is prefetched by the storage manager, so that the operating system can
+ * read it while the caller works on other pages; the pool itself and its
+ * replacement information are not changed.
+ *
+ * Parameters:
+ *   bm      - The buffer pool.
+ *   pageNum - The page number that will be pinned.
+ *
+ * Returns:
+ *   RC_OK on success
+ *   RC_INVALID_PARAM for a NULL pool or a negative page number
+ */
+RC prefetchPage(BM_BufferPool *const bm, const PageNumber pageNum) {
+    if (bm == NULL || bm->mgmtData == NULL || pageNum < 0) {
+        return RC_INVALID_PARAM;
+    }
+
+    BP_MgmtData *mgmtData = (BP_MgmtData*) bm->mgmtData;
+    RC rc = RC_OK;
+    pthread_mutex_lock(&mgmtData->latch);
+    if (findPageInPool(mgmtData, pageNum) == -1) {
+        rc = prefetchBlocks(pageNum, 1, &mgmtData->fileHandle);
+    }
+    pthread_mutex_unlock(&mgmtData->latch);
+    return rc;
+}
+
 /**
  * Function: getFrameContents
  * --------------------------
@@ -40,12 +40,18 @@ typedef struct BM_PageHandle {
 #define MAKE_PAGE_HANDLE()				\
 		((BM_PageHandle *) malloc (sizeof(BM_PageHandle)))
 
+// called before a dirty page is written back, e.g. to force a log up to the page's changes
+typedef RC (*BM_WriteHook) (BM_PageHandle *const page, void *context);
+
 // Buffer Manager Interface Pool Handling
 RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName, 
 		const int numPages, ReplacementStrategy strategy,
 		void *stratData);
 RC shutdownBufferPool(BM_BufferPool *const bm);
 RC forceFlushPool(BM_BufferPool *const bm);
+RC truncateBufferPool(BM_BufferPool *const bm, const int numPages);
+RC syncBufferPool(BM_BufferPool *const bm);
+RC setWriteHook(BM_BufferPool *const bm, BM_WriteHook hook, void *context);
 
 // Buffer Manager Interface Access Pages
 RC markDirty (BM_BufferPool *const bm, BM_PageHandle *const page);
@@ -53,6 +59,7 @@ RC unpinPage (BM_BufferPool *const bm, BM_PageHandle *const page);
 RC forcePage (BM_BufferPool *const bm, BM_PageHandle *const page);
 RC pinPage (BM_BufferPool *const bm, BM_PageHandle *const page, 
 		const PageNumber pageNum);
+RC prefetchPage (BM_BufferPool *const bm, const PageNumber pageNum);
 
 // Statistics Interface
 PageNumber *getFrameContents (BM_BufferPool *const bm);
@@ -34,6 +34,13 @@ typedef int RC;
 #define RC_RM_NO_PRINT_FOR_DATATYPE 204
 #define RC_RM_UNKOWN_DATATYPE 205
 #define RC_RM_RECORD_NOT_FOUND 206
+#define RC_RM_EXPR_TOO_COMPLEX 207
+#define RC_RM_TABLE_IN_USE 208
+#define RC_RM_WRITE_CONFLICT 209
+#define RC_RM_DEADLOCK 210
+#define RC_RM_LOCK_TIMEOUT 211
+#define RC_RM_UNKNOWN_TABLE 212
+#define RC_RM_WRONG_DATATYPE 213
 
 
 #define RC_IM_KEY_NOT_FOUND 300
@@ -50,6 +50,7 @@ valueSmaller (Value *left, Value *right, Value *result)
 		break;
 	case DT_BOOL:
 		result->v.boolV = (left->v.boolV < right->v.boolV);
+		break;
 	case DT_STRING:
 		result->v.boolV = (strcmp(left->v.stringV, right->v.stringV) < 0);
 		break;
@@ -74,6 +75,7 @@ boolAnd (Value *left, Value *right, Value *result)
 {
 	if (left->dt != DT_BOOL || right->dt != DT_BOOL)
 		THROW(RC_RM_BOOLEAN_EXPR_ARG_IS_NOT_BOOLEAN, "boolean AND requires boolean inputs");
+	result->dt = DT_BOOL;
 	result->v.boolV = (left->v.boolV && right->v.boolV);
 
 	return RC_OK;
@@ -84,6 +86,7 @@ boolOr (Value *left, Value *right, Value *result)
 {
 	if (left->dt != DT_BOOL || right->dt != DT_BOOL)
 		THROW(RC_RM_BOOLEAN_EXPR_ARG_IS_NOT_BOOLEAN, "boolean OR requires boolean inputs");
+	result->dt = DT_BOOL;
 	result->v.boolV = (left->v.boolV || right->v.boolV);
 
 	return RC_OK;
@@ -91,10 +94,37 @@ boolOr (Value *left, Value *right, Value *result)
 
 RC
 evalExpr (Record *record, Schema *schema, Expr *expr, Value **result)
+{
+	return evalExprIn(NULL, record, schema, expr, result);
+}
+
+// result values come from the arena if there is one; its values are not freed one by one
+static Value *
+newValue (RM_Arena *arena)
+{
+	Value *val = (arena != NULL) ? (Value *) arenaAlloc(arena, sizeof(Value)) : (Value *) malloc(sizeof(Value));
+
+	val->dt = DT_INT;
+	val->v.intV = -1;
+	return val;
+}
+
+static void
+releaseVal (RM_Arena *arena, Value *val)
+{
+	if (arena == NULL)
+		freeVal(val);
+}
+
+/*
+ * evalExpr with the result and all intermediate values allocated from an
+ * arena, which releases them at its next reset; NULL for malloc
+ */
+RC
+evalExprIn (RM_Arena *arena, Record *record, Schema *schema, Expr *expr, Value **result)
 {
 	Value *lIn;
 	Value *rIn;
-	MAKE_VALUE(*result, DT_INT, -1);
 
 	switch(expr->type)
 	{
@@ -102,12 +132,11 @@ evalExpr (Record *record, Schema *schema, Expr *expr, Value **result)
 	{
 		Operator *op = expr->expr.op;
 		bool twoArgs = (op->type != OP_BOOL_NOT);
-		//      lIn = (Value *) malloc(sizeof(Value));
-		//    rIn = (Value *) malloc(sizeof(Value));
 
-		CHECK(evalExpr(record, schema, op->args[0], &lIn));
+		CHECK(evalExprIn(arena, record, schema, op->args[0], &lIn));
 		if (twoArgs)
-			CHECK(evalExpr(record, schema, op->args[1], &rIn));
+			CHECK(evalExprIn(arena, record, schema, op->args[1], &rIn));
+		*result = newValue(arena);
 
 		switch(op->type)
 		{
@@ -131,17 +160,22 @@ evalExpr (Record *record, Schema *schema, Expr *expr, Value **result)
 		}
 
 		// cleanup
-		freeVal(lIn);
+		releaseVal(arena, lIn);
 		if (twoArgs)
-			freeVal(rIn);
+			releaseVal(arena, rIn);
 	}
 	break;
 	case EXPR_CONST:
-		CPVAL(*result,expr->expr.cons);
+		*result = newValue(arena);
+		if (arena != NULL && expr->expr.cons->dt == DT_STRING) {
+			(*result)->dt = DT_STRING;
+			(*result)->v.stringV = arenaStrndup(arena, expr->expr.cons->v.stringV, strlen(expr->expr.cons->v.stringV));
+		} else {
+			CPVAL(*result,expr->expr.cons);
+		}
 		break;
 	case EXPR_ATTRREF:
-		free(*result);
-		CHECK(getAttr(record, schema, expr->expr.attrRef, result));
+		CHECK(getAttrIn(arena, record, schema, expr->expr.attrRef, result));
 		break;
 	}
 
@@ -188,3 +222,284 @@ freeVal (Value *val)
 	free(val);
 }
 
+
+// compare two fixed-length strings the way strcmp compares their NUL-terminated prefixes
+static int
+compareBounded (const char *left, int leftLen, const char *right, int rightLen)
+{
+	int l = strnlen(left, leftLen);
+	int r = strnlen(right, rightLen);
+	int cmp = memcmp(left, right, (l < r) ? l : r);
+
+	if (cmp != 0)
+		return cmp;
+	return l - r;
+}
+
+static RC
+newRegister (CompiledExpr *prog, int *reg)
+{
+	if (prog->numRegs >= EXPR_MAX_REGISTERS)
+		THROW(RC_RM_EXPR_TOO_COMPLEX, "expression needs more registers than a compiled program has");
+	*reg = prog->numRegs++;
+	return RC_OK;
+}
+
+static RC
+emit (CompiledExpr *prog, ExprOpCode code, int dst, int a, int b)
+{
+	ExprInstr *in;
+
+	if (prog->numInstr >= EXPR_MAX_REGISTERS)
+		THROW(RC_RM_EXPR_TOO_COMPLEX, "expression has more nodes than a compiled program can hold");
+	in = &prog->code[prog->numInstr++];
+	in->code = code;
+	in->dst = dst;
+	in->a = a;
+	in->b = b;
+	return RC_OK;
+}
+
+// compile the subtree into prog; returns the register holding its value and the value's type
+static RC
+compileNode (Expr *expr, Schema *schema, CompiledExpr *prog, int *reg, DataType *type)
+{
+	RC rc;
+
+	switch(expr->type)
+	{
+	case EXPR_CONST:
+	{
+		Value *cons = expr->expr.cons;
+		ExprRegister *r;
+
+		if ((rc = newRegister(prog, reg)) != RC_OK)
+			return rc;
+		r = &prog->regs[*reg];
+		switch(cons->dt)
+		{
+		case DT_INT:
+			r->v.intV = cons->v.intV;
+			break;
+		case DT_FLOAT:
+			r->v.floatV = cons->v.floatV;
+			break;
+		case DT_BOOL:
+			r->v.boolV = cons->v.boolV;
+			break;
+		case DT_STRING:
+			r->str = cons->v.stringV;
+			r->len = strlen(cons->v.stringV);
+			break;
+		}
+		*type = cons->dt;
+	}
+	break;
+	case EXPR_ATTRREF:
+	{
+		int attrNum = expr->expr.attrRef;
+		int offset;
+		ExprOpCode load = BC_LOAD_INT;
+
+		if (schema == NULL || attrNum < 0 || attrNum >= schema->numAttr)
+			THROW(RC_INVALID_PARAM, "attribute reference outside of the schema");
+		if ((rc = newRegister(prog, reg)) != RC_OK)
+			return rc;
+		determineAttributeOffsetInRecord(schema, attrNum, &offset);
+		*type = schema->dataTypes[attrNum];
+		switch(*type)
+		{
+		case DT_INT:
+			load = BC_LOAD_INT;
+			break;
+		case DT_FLOAT:
+			load = BC_LOAD_FLOAT;
+			break;
+		case DT_BOOL:
+			load = BC_LOAD_BOOL;
+			break;
+		case DT_STRING:
+			load = BC_LOAD_STRING;
+			break;
+		}
+		return emit(prog, load, *reg, offset, schema->typeLength[attrNum]);
+	}
+	case EXPR_OP:
+	{
+		Operator *op = expr->expr.op;
+		int lReg, rReg = -1;
+		DataType lType, rType = DT_BOOL;
+		ExprOpCode code = BC_NOT;
+
+		if ((rc = compileNode(op->args[0], schema, prog, &lReg, &lType)) != RC_OK)
+			return rc;
+		if (op->type != OP_BOOL_NOT
+				&& (rc = compileNode(op->args[1], schema, prog, &rReg, &rType)) != RC_OK)
+			return rc;
+
+		switch(op->type)
+		{
+		case OP_BOOL_NOT:
+		case OP_BOOL_AND:
+		case OP_BOOL_OR:
+			if (lType != DT_BOOL || rType != DT_BOOL)
+				THROW(RC_RM_BOOLEAN_EXPR_ARG_IS_NOT_BOOLEAN, "boolean operators require boolean inputs");
+			code = (op->type == OP_BOOL_NOT) ? BC_NOT : (op->type == OP_BOOL_AND) ? BC_AND : BC_OR;
+			break;
+		case OP_COMP_EQUAL:
+		case OP_COMP_SMALLER:
+			if (lType != rType)
+				THROW(RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE, "comparison only supported for values of the same datatype");
+			switch(lType)
+			{
+			case DT_INT:
+				code = (op->type == OP_COMP_EQUAL) ? BC_EQ_INT : BC_LT_INT;
+				break;
+			case DT_FLOAT:
+				code = (op->type == OP_COMP_EQUAL) ? BC_EQ_FLOAT : BC_LT_FLOAT;
+				break;
+			case DT_BOOL:
+				code = (op->type == OP_COMP_EQUAL) ? BC_EQ_BOOL : BC_LT_BOOL;
+				break;
+			case DT_STRING:
+				code = (op->type == OP_COMP_EQUAL) ? BC_EQ_STRING : BC_LT_STRING;
+				break;
+			}
+			break;
+		}
+
+		if ((rc = newRegister(prog, reg)) != RC_OK)
+			return rc;
+		*type = DT_BOOL;
+		return emit(prog, code, *reg, lReg, rReg);
+	}
+	}
+
+	return RC_OK;
+}
+
+/**
+ * Function: compileExpr
+ * ---------------------
+ * Translates an expression tree into a flat register program.
+ * Attribute offsets and operand types are resolved once here, so that
+ * evalCompiledExpr does no type dispatch on values and no allocation.
+ * Constants are preloaded into registers; string constants are referenced,
+ * not copied, so the expression must outlive the program.
+ *
+ * @param expr      Expression to compile
+ * @param schema    Schema used to resolve attribute references (may be NULL without attributes)
+ * @param result    Pointer to store the compiled program
+ * @return
+ *  -   RC_OK if compilation is successful
+ *  -   RC_RM_EXPR_TOO_COMPLEX if the expression does not fit the register file
+ *  -   RC_RM_EXPR_RESULT_IS_NOT_BOOLEAN if the expression is not a predicate
+ *  -   Type errors of the operators otherwise
+ */
+RC
+compileExpr (Expr *expr, Schema *schema, CompiledExpr **result)
+{
+	CompiledExpr *prog = (CompiledExpr *) calloc(1, sizeof(CompiledExpr));
+	DataType type;
+	RC rc;
+
+	if (prog == NULL)
+		return RC_MEMORY_ALLOCATION_ERROR;
+
+	if ((rc = compileNode(expr, schema, prog, &prog->resultReg, &type)) != RC_OK)
+	{
+		free(prog);
+		return rc;
+	}
+	if (type != DT_BOOL)
+	{
+		free(prog);
+		THROW(RC_RM_EXPR_RESULT_IS_NOT_BOOLEAN, "scan condition has to evaluate to a boolean");
+	}
+
+	*result = prog;
+	return RC_OK;
+}
+
+/**
+ * Function: evalCompiledExpr
+ * --------------------------
+ * Runs a compiled predicate against the raw data of one record.
+ * The program's own register file is used as scratch space, so a program
+ * must not be evaluated by two threads at the same time.
+ *
+ * @param prog  Program produced by compileExpr
+ * @param data  Record data (as stored in Record->data)
+ * @return
+ *  -   The boolean result of the predicate
+ */
+bool
+evalCompiledExpr (CompiledExpr *prog, char *data)
+{
+	ExprRegister *r = prog->regs;
+	int i;
+
+	for (i = 0; i < prog->numInstr; i++)
+	{
+		ExprInstr *in = &prog->code[i];
+
+		switch(in->code)
+		{
+		case BC_LOAD_INT:
+			r[in->dst].v.intV = readIntAttr(data + in->a);
+			break;
+		case BC_LOAD_FLOAT:
+			r[in->dst].v.floatV = readFloatAttr(data + in->a);
+			break;
+		case BC_LOAD_BOOL:
+			r[in->dst].v.boolV = readBoolAttr(data + in->a);
+			break;
+		case BC_LOAD_STRING:
+			r[in->dst].str = data + in->a;
+			r[in->dst].len = in->b;
+			break;
+		case BC_EQ_INT:
+			r[in->dst].v.boolV = (r[in->a].v.intV == r[in->b].v.intV);
+			break;
+		case BC_EQ_FLOAT:
+			r[in->dst].v.boolV = (r[in->a].v.floatV == r[in->b].v.floatV);
+			break;
+		case BC_EQ_BOOL:
+			r[in->dst].v.boolV = (r[in->a].v.boolV == r[in->b].v.boolV);
+			break;
+		case BC_EQ_STRING:
+			r[in->dst].v.boolV = (compareBounded(r[in->a].str, r[in->a].len, r[in->b].str, r[in->b].len) == 0);
+			break;
+		case BC_LT_INT:
+			r[in->dst].v.boolV = (r[in->a].v.intV < r[in->b].v.intV);
+			break;
+		case BC_LT_FLOAT:
+			r[in->dst].v.boolV = (r[in->a].v.floatV < r[in->b].v.floatV);
+			break;
+		case BC_LT_BOOL:
+			r[in->dst].v.boolV = (r[in->a].v.boolV < r[in->b].v.boolV);
+			break;
+		case BC_LT_STRING:
+			r[in->dst].v.boolV = (compareBounded(r[in->a].str, r[in->a].len, r[in->b].str, r[in->b].len) < 0);
+			break;
+		case BC_NOT:
+			r[in->dst].v.boolV = !r[in->a].v.boolV;
+			break;
+		case BC_AND:
+			r[in->dst].v.boolV = (r[in->a].v.boolV && r[in->b].v.boolV);
+			break;
+		case BC_OR:
+			r[in->dst].v.boolV = (r[in->a].v.boolV || r[in->b].v.boolV);
+			break;
+		}
+	}
+
+	return r[prog->resultReg].v.boolV;
+}
+
+RC
+freeCompiledExpr (CompiledExpr *prog)
+{
+	free(prog);
+	return RC_OK;
+}
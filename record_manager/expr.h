@@ -3,6 +3,7 @@
 
 #include "dberror.h"
 #include "tables.h"
+#include "rm_arena.h"
 
 // datatype for arguments of expressions used in conditions
 typedef enum ExprType {
@@ -41,9 +42,62 @@ extern RC boolNot (Value *input, Value *result);
 extern RC boolAnd (Value *left, Value *right, Value *result);
 extern RC boolOr (Value *left, Value *right, Value *result);
 extern RC evalExpr (Record *record, Schema *schema, Expr *expr, Value **result);
+extern RC evalExprIn (RM_Arena *arena, Record *record, Schema *schema, Expr *expr, Value **result);
 extern RC freeExpr (Expr *expr);
 extern void freeVal(Value *val);
 
+// compiled (bytecode) form of an expression, evaluated without allocation
+#define EXPR_MAX_REGISTERS 64
+
+typedef enum ExprOpCode {
+  BC_LOAD_INT,
+  BC_LOAD_FLOAT,
+  BC_LOAD_BOOL,
+  BC_LOAD_STRING,
+  BC_EQ_INT,
+  BC_EQ_FLOAT,
+  BC_EQ_BOOL,
+  BC_EQ_STRING,
+  BC_LT_INT,
+  BC_LT_FLOAT,
+  BC_LT_BOOL,
+  BC_LT_STRING,
+  BC_NOT,
+  BC_AND,
+  BC_OR
+} ExprOpCode;
+
+// one instruction: dst = code(a, b); loads read the attribute at offset a (length b)
+typedef struct ExprInstr {
+  ExprOpCode code;
+  int dst;
+  int a;
+  int b;
+} ExprInstr;
+
+// a typed register; strings point into the record or the constant and are not copied
+typedef struct ExprRegister {
+  union reg {
+    int intV;
+    float floatV;
+    bool boolV;
+  } v;
+  const char *str;
+  int len;
+} ExprRegister;
+
+typedef struct CompiledExpr {
+  int numInstr;
+  int numRegs;
+  int resultReg;
+  ExprInstr code[EXPR_MAX_REGISTERS];
+  ExprRegister regs[EXPR_MAX_REGISTERS];
+} CompiledExpr;
+
+extern RC compileExpr (Expr *expr, Schema *schema, CompiledExpr **result);
+extern bool evalCompiledExpr (CompiledExpr *prog, char *data);
+extern RC freeCompiledExpr (CompiledExpr *prog);
+
 
 #define CPVAL(_result,_input)						\
   do {									\
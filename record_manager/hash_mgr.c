@@ -0,0 +1,709 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hash_mgr.h"
+#include "buffer_mgr.h"
+#include "storage_mgr.h"
+
+/*
+ * Index file layout (linear hashing):
+ *	page 0	header (key length, unique flag, entries per page, level, split pointer,
+ *		#buckets, #entries, #pages, free list, #directory pages), followed by
+ *		the page numbers of the directory pages
+ *	pages	directory pages map bucket numbers to the first page of each bucket;
+ *		bucket pages are [numEntries][overflow] followed by (key, rid) entries
+ * A key hashes to bucket h mod (N << level), or h mod (N << (level + 1)) if
+ * that bucket has already been split in the current round. Full buckets grow
+ * overflow chains; whenever the buckets are more than HT_MAX_LOAD percent full
+ * on average, the bucket at the split pointer (not necessarily the full one)
+ * is split, so the table grows by one bucket at a time. Overflow pages that
+ * become empty go to a free list and are reused.
+ */
+
+#define HT_HEADER_PAGE 0
+#define HT_HEADER_INTS 16
+#define HT_DIR_ENTRIES (PAGE_SIZE / (int) sizeof(int))
+#define HT_MAX_DIR_PAGES (HT_DIR_ENTRIES - HT_HEADER_INTS)
+#define HT_MAX_BUCKETS (HT_MAX_DIR_PAGES * HT_DIR_ENTRIES)
+#define HT_INITIAL_BUCKETS 4
+#define HT_MAX_LOAD 75
+#define HT_BUCKET_HEADER (2 * (int) sizeof(int))
+#define HT_NO_PAGE -1
+#define HT_POOL_PAGES 16
+
+#define BUCKET_NUM_ENTRIES(page) (((int *) (page))[0])
+#define BUCKET_OVERFLOW(page) (((int *) (page))[1])
+
+// Structure to manage an open index and its buffer pool
+typedef struct HashMgmtData {
+	BM_BufferPool bufferPool;	// Buffer pool for the index pages
+	int keyLength;	// Size of a key in bytes
+	bool unique;	// TRUE if a key may occur only once
+	int capacity;	// Entries per bucket page
+	int level;	// Number of completed doubling rounds
+	int next;	// Next bucket to split in this round
+	int numBuckets;	// Number of buckets
+	int numEntries;	// Number of (key, rid) entries
+	int numPages;	// Pages in use, new pages are appended
+	int freeList;	// First free overflow page, HT_NO_PAGE if none
+	int *buckets;	// First page of every bucket, written to the directory pages on close
+	int maxBuckets;	// Allocated size of buckets
+	int numDirPages;	// Number of directory pages
+	int dirPages[HT_MAX_DIR_PAGES];	// Directory page numbers
+} HashMgmtData;
+
+// Position of a scan over the entries of one key
+typedef struct HTScanMgmtData {
+	char *key;	// key to look for
+	int page;	// current page of the bucket chain, HT_NO_PAGE once the scan is done
+	int pos;	// next entry in the page
+} HTScanMgmtData;
+
+/************************************************************
+ *                    keys and entries                      *
+ ************************************************************/
+
+static int entrySize(HashMgmtData *mgmt) {
+	return mgmt->keyLength + 2 * sizeof(int);
+}
+
+static char *entryAt(HashMgmtData *mgmt, char *page, int i) {
+	return page + HT_BUCKET_HEADER + i * entrySize(mgmt);
+}
+
+static RID entryRid(HashMgmtData *mgmt, const char *entry) {
+	RID rid;
+	rid.page = readIntAttr(entry + mgmt->keyLength);
+	rid.slot = readIntAttr(entry + mgmt->keyLength + sizeof(int));
+	return rid;
+}
+
+static void writeEntry(HashMgmtData *mgmt, char *entry, const char *key, RID rid) {
+	memcpy(entry, key, mgmt->keyLength);
+	writeIntAttr(entry + mgmt->keyLength, rid.page);
+	writeIntAttr(entry + mgmt->keyLength + sizeof(int), rid.slot);
+}
+
+/* FNV-1a with a final mix, so that the low bits depend on all key bytes */
+static unsigned int hashKey(const char *key, int length) {
+	unsigned int h = 2166136261u;
+
+	for (int i = 0; i < length; i++) {
+		h ^= (unsigned char) key[i];
+		h *= 16777619u;
+	}
+	h ^= h >> 16;
+	h *= 0x85ebca6bu;
+	h ^= h >> 13;
+	return h;
+}
+
+/* Bucket of a key under the current level and split pointer */
+static int bucketFor(HashMgmtData *mgmt, const char *key) {
+	unsigned int h = hashKey(key, mgmt->keyLength);
+	unsigned int size = HT_INITIAL_BUCKETS << mgmt->level;
+	unsigned int bucket = h & (size - 1);
+
+	if (bucket < (unsigned int) mgmt->next)
+		bucket = h & (2 * size - 1);
+	return bucket;
+}
+
+/************************************************************
+ *                    pages                                 *
+ ************************************************************/
+
+/* Pins an empty page, taken from the free list or appended to the file */
+static RC newPage(HashMgmtData *mgmt, BM_PageHandle *page) {
+	int pageNum = (mgmt->freeList != HT_NO_PAGE) ? mgmt->freeList : mgmt->numPages;
+	RC rc;
+
+	if ((rc = pinPage(&mgmt->bufferPool, page, pageNum)) != RC_OK)
+		return rc;
+	if (pageNum == mgmt->freeList)
+		mgmt->freeList = BUCKET_OVERFLOW(page->data);
+	else
+		mgmt->numPages++;
+
+	BUCKET_NUM_ENTRIES(page->data) = 0;
+	BUCKET_OVERFLOW(page->data) = HT_NO_PAGE;
+	return markDirty(&mgmt->bufferPool, page);
+}
+
+/* Puts a pinned overflow page on the free list; the caller unpins it */
+static void freePage(HashMgmtData *mgmt, BM_PageHandle *page) {
+	BUCKET_NUM_ENTRIES(page->data) = 0;
+	BUCKET_OVERFLOW(page->data) = mgmt->freeList;
+	mgmt->freeList = page->pageNum;
+	markDirty(&mgmt->bufferPool, page);
+}
+
+/**
+ * Function: findEntry
+ * ------------------
+ * Walks the chain of a bucket looking for an entry with the given key (and
+ * rid, unless rid is NULL).
+ *
+ * @param mgmt      Index
+ * @param bucket    Bucket of the key
+ * @param key       Key to look for
+ * @param rid       Record id to look for, NULL for any
+ * @param pageNum   Set to the page of the entry
+ * @param pos       Set to the position of the entry in the page
+ * @return
+ *  -   RC_OK if the entry was found
+ *  -   RC_IM_KEY_NOT_FOUND if the bucket has no such entry
+ */
+static RC findEntry(HashMgmtData *mgmt, int bucket, const char *key, const RID *rid, int *pageNum, int *pos) {
+	BM_PageHandle page;
+	int current = mgmt->buckets[bucket];
+	RC rc;
+
+	while (current != HT_NO_PAGE) {
+		if ((rc = pinPage(&mgmt->bufferPool, &page, current)) != RC_OK)
+			return rc;
+		for (int i = 0; i < BUCKET_NUM_ENTRIES(page.data); i++) {
+			char *entry = entryAt(mgmt, page.data, i);
+			if (memcmp(entry, key, mgmt->keyLength) != 0)
+				continue;
+			if (rid != NULL) {
+				RID other = entryRid(mgmt, entry);
+				if (other.page != rid->page || other.slot != rid->slot)
+					continue;
+			}
+			*pageNum = current;
+			*pos = i;
+			return unpinPage(&mgmt->bufferPool, &page);
+		}
+		int next = BUCKET_OVERFLOW(page.data);
+		unpinPage(&mgmt->bufferPool, &page);
+		current = next;
+	}
+	return RC_IM_KEY_NOT_FOUND;
+}
+
+/* Adds an entry to the last page of a bucket's chain, extending the chain if that page is full */
+static RC appendEntry(HashMgmtData *mgmt, int bucket, const char *key, RID rid) {
+	BM_PageHandle page, overflow;
+	int current = mgmt->buckets[bucket];
+	RC rc;
+
+	while (TRUE) {
+		if ((rc = pinPage(&mgmt->bufferPool, &page, current)) != RC_OK)
+			return rc;
+		if (BUCKET_OVERFLOW(page.data) == HT_NO_PAGE)
+			break;
+		current = BUCKET_OVERFLOW(page.data);
+		unpinPage(&mgmt->bufferPool, &page);
+	}
+
+	if (BUCKET_NUM_ENTRIES(page.data) == mgmt->capacity) {
+		if ((rc = newPage(mgmt, &overflow)) != RC_OK) {
+			unpinPage(&mgmt->bufferPool, &page);
+			return rc;
+		}
+		BUCKET_OVERFLOW(page.data) = overflow.pageNum;
+		markDirty(&mgmt->bufferPool, &page);
+		unpinPage(&mgmt->bufferPool, &page);
+		page = overflow;
+	}
+
+	int n = BUCKET_NUM_ENTRIES(page.data);
+	writeEntry(mgmt, entryAt(mgmt, page.data, n), key, rid);
+	BUCKET_NUM_ENTRIES(page.data) = n + 1;
+	markDirty(&mgmt->bufferPool, &page);
+	return unpinPage(&mgmt->bufferPool, &page);
+}
+
+/**
+ * Function: splitBucket
+ * --------------------
+ * Splits the bucket at the split pointer: a new bucket is added at the end,
+ * the split pointer advances (starting the next round once every bucket of
+ * this round has been split), and the entries of the old bucket are
+ * distributed between the two by one more bit of their hash.
+ *
+ * @param mgmt      Index
+ * @return
+ *  -   RC_OK if the bucket was split
+ */
+static RC splitBucket(HashMgmtData *mgmt) {
+	int es = entrySize(mgmt);
+	int count = 0, size = mgmt->capacity;
+	int head = mgmt->buckets[mgmt->next], current = head;
+	char *entries = (char *) malloc(size * es);
+	BM_PageHandle page;
+	RC rc = RC_OK;
+
+	// Take all entries out of the old bucket, returning its overflow pages
+	while (current != HT_NO_PAGE && rc == RC_OK) {
+		if ((rc = pinPage(&mgmt->bufferPool, &page, current)) != RC_OK)
+			break;
+		int n = BUCKET_NUM_ENTRIES(page.data);
+		if (count + n > size) {
+			size = 2 * (count + n);
+			entries = (char *) realloc(entries, size * es);
+		}
+		memcpy(entries + count * es, entryAt(mgmt, page.data, 0), n * es);
+		count += n;
+
+		current = BUCKET_OVERFLOW(page.data);
+		if (page.pageNum == head) {
+			BUCKET_NUM_ENTRIES(page.data) = 0;
+			BUCKET_OVERFLOW(page.data) = HT_NO_PAGE;
+			markDirty(&mgmt->bufferPool, &page);
+		} else {
+			freePage(mgmt, &page);
+		}
+		rc = unpinPage(&mgmt->bufferPool, &page);
+	}
+
+	// Add the new bucket and advance the split pointer
+	if (rc == RC_OK && (rc = newPage(mgmt, &page)) == RC_OK) {
+		if (mgmt->numBuckets == mgmt->maxBuckets) {
+			mgmt->maxBuckets *= 2;
+			mgmt->buckets = (int *) realloc(mgmt->buckets, sizeof(int) * mgmt->maxBuckets);
+		}
+		mgmt->buckets[mgmt->numBuckets++] = page.pageNum;
+		unpinPage(&mgmt->bufferPool, &page);
+		if (++mgmt->next == (HT_INITIAL_BUCKETS << mgmt->level)) {
+			mgmt->level++;
+			mgmt->next = 0;
+		}
+	}
+
+	for (int i = 0; i < count && rc == RC_OK; i++) {
+		char *entry = entries + i * es;
+		rc = appendEntry(mgmt, bucketFor(mgmt, entry), entry, entryRid(mgmt, entry));
+	}
+	free(entries);
+	return rc;
+}
+
+/* Stores the bucket table in the directory pages, adding pages as needed */
+static RC writeDirectory(HashMgmtData *mgmt) {
+	BM_PageHandle page;
+	RC rc;
+
+	for (int d = 0; d * HT_DIR_ENTRIES < mgmt->numBuckets; d++) {
+		if (d == mgmt->numDirPages) {
+			if ((rc = newPage(mgmt, &page)) != RC_OK)
+				return rc;
+			mgmt->dirPages[mgmt->numDirPages++] = page.pageNum;
+		} else if ((rc = pinPage(&mgmt->bufferPool, &page, mgmt->dirPages[d])) != RC_OK) {
+			return rc;
+		}
+
+		int n = mgmt->numBuckets - d * HT_DIR_ENTRIES;
+		if (n > HT_DIR_ENTRIES)
+			n = HT_DIR_ENTRIES;
+		memcpy(page.data, mgmt->buckets + d * HT_DIR_ENTRIES, n * sizeof(int));
+		markDirty(&mgmt->bufferPool, &page);
+		unpinPage(&mgmt->bufferPool, &page);
+	}
+	return RC_OK;
+}
+
+/************************************************************
+ *                    index manager                         *
+ ************************************************************/
+
+/**
+ * Function: createHashIndex
+ * ------------------------
+ * Creates a new, empty hash index in its own page file.
+ * Page 0 holds the index header, page 1 the directory, and the initial
+ * buckets follow as empty pages.
+ *
+ * @param idxId     Name of the index (used as the page file name)
+ * @param keyLength Size of the keys in bytes
+ * @param unique    TRUE if every key may be inserted only once
+ * @return
+ *	-	RC_OK if the index was created
+ *	-	RC_INVALID_PARAM if no entry of the key length fits a page
+ */
+RC createHashIndex(char *idxId, int keyLength, bool unique) {
+	int capacity = (PAGE_SIZE - HT_BUCKET_HEADER) / (keyLength + 2 * (int) sizeof(int));
+	SM_FileHandle fHandle;
+	char data[PAGE_SIZE];
+	RC rc;
+
+	if (keyLength <= 0 || capacity < 1)
+		return RC_INVALID_PARAM;
+
+	if ((rc = createPageFile(idxId)) != RC_OK)
+		return rc;
+	if ((rc = openPageFile(idxId, &fHandle)) != RC_OK)
+		return rc;
+
+	// Header page
+	memset(data, 0, PAGE_SIZE);
+	int *header = (int *) data;
+	header[0] = keyLength;
+	header[1] = unique;
+	header[2] = capacity;
+	header[3] = 0;	// level
+	header[4] = 0;	// split pointer
+	header[5] = HT_INITIAL_BUCKETS;
+	header[6] = 0;	// entries
+	header[7] = 2 + HT_INITIAL_BUCKETS;	// pages
+	header[8] = HT_NO_PAGE;	// free list
+	header[9] = 1;	// directory pages
+	header[HT_HEADER_INTS] = 1;
+	if ((rc = writeBlock(HT_HEADER_PAGE, &fHandle, data)) != RC_OK)
+		return rc;
+
+	// Directory
+	memset(data, 0, PAGE_SIZE);
+	for (int i = 0; i < HT_INITIAL_BUCKETS; i++)
+		((int *) data)[i] = 2 + i;
+	if ((rc = writeBlock(1, &fHandle, data)) != RC_OK)
+		return rc;
+
+	// Empty buckets
+	memset(data, 0, PAGE_SIZE);
+	BUCKET_NUM_ENTRIES(data) = 0;
+	BUCKET_OVERFLOW(data) = HT_NO_PAGE;
+	for (int i = 0; i < HT_INITIAL_BUCKETS; i++) {
+		if ((rc = writeBlock(2 + i, &fHandle, data)) != RC_OK)
+			return rc;
+	}
+
+	return closePageFile(&fHandle);
+}
+
+/**
+ * Function: openHashIndex
+ * ----------------------
+ * Opens an index, setting up a buffer pool for its pages and reading the
+ * header and the bucket directory, which stays in memory while the index is
+ * open.
+ *
+ * @param index     Set to the new index handle
+ * @param idxId     Name of the index
+ * @return
+ *	-	RC_OK if the index was opened
+ *	-	Errors of the buffer manager if the index file cannot be read
+ */
+RC openHashIndex(HashHandle **index, char *idxId) {
+	HashHandle *handle = (HashHandle *) malloc(sizeof(HashHandle));
+	HashMgmtData *mgmt = (HashMgmtData *) malloc(sizeof(HashMgmtData));
+	BM_PageHandle page;
+	RC rc;
+
+	if ((rc = initBufferPool(&mgmt->bufferPool, idxId, HT_POOL_PAGES, RS_LRU, NULL)) != RC_OK) {
+		free(mgmt);
+		free(handle);
+		return rc;
+	}
+	if ((rc = pinPage(&mgmt->bufferPool, &page, HT_HEADER_PAGE)) != RC_OK) {
+		shutdownBufferPool(&mgmt->bufferPool);
+		free(mgmt);
+		free(handle);
+		return rc;
+	}
+
+	int *header = (int *) page.data;
+	mgmt->keyLength = header[0];
+	mgmt->unique = header[1];
+	mgmt->capacity = header[2];
+	mgmt->level = header[3];
+	mgmt->next = header[4];
+	mgmt->numBuckets = header[5];
+	mgmt->numEntries = header[6];
+	mgmt->numPages = header[7];
+	mgmt->freeList = header[8];
+	mgmt->numDirPages = header[9];
+	memcpy(mgmt->dirPages, header + HT_HEADER_INTS, mgmt->numDirPages * sizeof(int));
+	unpinPage(&mgmt->bufferPool, &page);
+
+	// Load the bucket directory
+	mgmt->maxBuckets = 2 * mgmt->numBuckets;
+	mgmt->buckets = (int *) malloc(sizeof(int) * mgmt->maxBuckets);
+	for (int d = 0; d * HT_DIR_ENTRIES < mgmt->numBuckets; d++) {
+		if ((rc = pinPage(&mgmt->bufferPool, &page, mgmt->dirPages[d])) != RC_OK) {
+			shutdownBufferPool(&mgmt->bufferPool);
+			free(mgmt->buckets);
+			free(mgmt);
+			free(handle);
+			return rc;
+		}
+		int n = mgmt->numBuckets - d * HT_DIR_ENTRIES;
+		memcpy(mgmt->buckets + d * HT_DIR_ENTRIES, page.data, ((n < HT_DIR_ENTRIES) ? n : HT_DIR_ENTRIES) * sizeof(int));
+		unpinPage(&mgmt->bufferPool, &page);
+	}
+
+	handle->idxId = strdup(idxId);
+	handle->mgmtData = mgmt;
+	*index = handle;
+	return RC_OK;
+}
+
+/**
+ * Function: closeHashIndex
+ * -----------------------
+ * Closes an index, writing back its directory, header and all dirty pages.
+ *
+ * @param index     Index to close
+ * @return
+ *	-	RC_OK if the index was closed
+ */
+RC closeHashIndex(HashHandle *index) {
+	HashMgmtData *mgmt = (HashMgmtData *) index->mgmtData;
+	BM_PageHandle page;
+	RC rc;
+
+	if ((rc = writeDirectory(mgmt)) != RC_OK)
+		return rc;
+	if ((rc = pinPage(&mgmt->bufferPool, &page, HT_HEADER_PAGE)) != RC_OK)
+		return rc;
+	int *header = (int *) page.data;
+	header[3] = mgmt->level;
+	header[4] = mgmt->next;
+	header[5] = mgmt->numBuckets;
+	header[6] = mgmt->numEntries;
+	header[7] = mgmt->numPages;
+	header[8] = mgmt->freeList;
+	header[9] = mgmt->numDirPages;
+	memcpy(header + HT_HEADER_INTS, mgmt->dirPages, mgmt->numDirPages * sizeof(int));
+	markDirty(&mgmt->bufferPool, &page);
+	unpinPage(&mgmt->bufferPool, &page);
+
+	if ((rc = shutdownBufferPool(&mgmt->bufferPool)) != RC_OK)
+		return rc;
+
+	free(mgmt->buckets);
+	free(index->idxId);
+	free(mgmt);
+	free(index);
+	return RC_OK;
+}
+
+/**
+ * Function: deleteHashIndex
+ * ------------------------
+ * Deletes the page file of a (closed) index.
+ *
+ * @param idxId     Name of the index
+ * @return
+ *	-	RC_OK if the index was deleted
+ *	-	RC_FILE_NOT_FOUND if it does not exist
+ */
+RC deleteHashIndex(char *idxId) {
+	return destroyPageFile(idxId);
+}
+
+RC getHashNumBuckets(HashHandle *index, int *result) {
+	*result = ((HashMgmtData *) index->mgmtData)->numBuckets;
+	return RC_OK;
+}
+
+RC getHashNumEntries(HashHandle *index, int *result) {
+	*result = ((HashMgmtData *) index->mgmtData)->numEntries;
+	return RC_OK;
+}
+
+RC getHashNumPages(HashHandle *index, int *result) {
+	*result = ((HashMgmtData *) index->mgmtData)->numPages;
+	return RC_OK;
+}
+
+/**
+ * Function: hashFindKey
+ * --------------------
+ * Looks up an entry with the given key. Unless the bucket has overflowed,
+ * this reads a single page.
+ *
+ * @param index     Index
+ * @param key       Key to look up
+ * @param result    Set to the rid of the entry
+ * @return
+ *	-	RC_OK if the key was found
+ *	-	RC_IM_KEY_NOT_FOUND if no entry has the key
+ */
+RC hashFindKey(HashHandle *index, const char *key, RID *result) {
+	HT_ScanHandle *scan;
+	RC rc;
+
+	if ((rc = openHashScan(index, key, &scan)) != RC_OK)
+		return rc;
+	rc = nextHashEntry(scan, result);
+	closeHashScan(scan);
+	return (rc == RC_IM_NO_MORE_ENTRIES) ? RC_IM_KEY_NOT_FOUND : rc;
+}
+
+/**
+ * Function: hashInsertKey
+ * ----------------------
+ * Inserts a (key, rid) entry at the end of its bucket's chain, then splits
+ * one bucket if the index has become too full.
+ *
+ * @param index     Index
+ * @param key       Key of the entry
+ * @param rid       Record the key belongs to
+ * @return
+ *	-	RC_OK if the entry was inserted
+ *	-	RC_IM_KEY_ALREADY_EXISTS if the index is unique and has the key, or has the same entry
+ */
+RC hashInsertKey(HashHandle *index, const char *key, RID rid) {
+	HashMgmtData *mgmt = (HashMgmtData *) index->mgmtData;
+	int bucket = bucketFor(mgmt, key);
+	int pageNum, pos;
+	RC rc;
+
+	rc = findEntry(mgmt, bucket, key, mgmt->unique ? NULL : &rid, &pageNum, &pos);
+	if (rc != RC_IM_KEY_NOT_FOUND)
+		return (rc == RC_OK) ? RC_IM_KEY_ALREADY_EXISTS : rc;
+
+	if ((rc = appendEntry(mgmt, bucket, key, rid)) != RC_OK)
+		return rc;
+	mgmt->numEntries++;
+
+	if ((long) mgmt->numEntries * 100 > (long) mgmt->numBuckets * mgmt->capacity * HT_MAX_LOAD
+			&& mgmt->numBuckets < HT_MAX_BUCKETS)
+		return splitBucket(mgmt);
+	return RC_OK;
+}
+
+/**
+ * Function: hashDeleteKey
+ * ----------------------
+ * Removes a (key, rid) entry. The last entry of the bucket's chain takes its
+ * place, and the last overflow page is freed once it is empty.
+ *
+ * @param index     Index
+ * @param key       Key of the entry
+ * @param rid       Record the key belongs to
+ * @return
+ *	-	RC_OK if the entry was removed
+ *	-	RC_IM_KEY_NOT_FOUND if there is no such entry
+ */
+RC hashDeleteKey(HashHandle *index, const char *key, RID rid) {
+	HashMgmtData *mgmt = (HashMgmtData *) index->mgmtData;
+	int bucket = bucketFor(mgmt, key);
+	int pageNum, pos, last = mgmt->buckets[bucket], prev = HT_NO_PAGE;
+	BM_PageHandle page, tail;
+	RC rc;
+
+	if ((rc = findEntry(mgmt, bucket, key, &rid, &pageNum, &pos)) != RC_OK)
+		return rc;
+
+	// Find the last page of the chain and the page before it
+	while (TRUE) {
+		if ((rc = pinPage(&mgmt->bufferPool, &tail, last)) != RC_OK)
+			return rc;
+		if (BUCKET_OVERFLOW(tail.data) == HT_NO_PAGE)
+			break;
+		prev = last;
+		last = BUCKET_OVERFLOW(tail.data);
+		unpinPage(&mgmt->bufferPool, &tail);
+	}
+
+	// Move the last entry into the hole
+	int n = BUCKET_NUM_ENTRIES(tail.data) - 1;
+	if (pageNum == last) {
+		memmove(entryAt(mgmt, tail.data, pos), entryAt(mgmt, tail.data, n), entrySize(mgmt));
+	} else {
+		if ((rc = pinPage(&mgmt->bufferPool, &page, pageNum)) != RC_OK) {
+			unpinPage(&mgmt->bufferPool, &tail);
+			return rc;
+		}
+		memcpy(entryAt(mgmt, page.data, pos), entryAt(mgmt, tail.data, n), entrySize(mgmt));
+		markDirty(&mgmt->bufferPool, &page);
+		unpinPage(&mgmt->bufferPool, &page);
+	}
+	BUCKET_NUM_ENTRIES(tail.data) = n;
+	markDirty(&mgmt->bufferPool, &tail);
+	mgmt->numEntries--;
+
+	// Unlink an empty overflow page
+	if (n == 0 && prev != HT_NO_PAGE) {
+		if ((rc = pinPage(&mgmt->bufferPool, &page, prev)) != RC_OK) {
+			unpinPage(&mgmt->bufferPool, &tail);
+			return rc;
+		}
+		BUCKET_OVERFLOW(page.data) = HT_NO_PAGE;
+		markDirty(&mgmt->bufferPool, &page);
+		unpinPage(&mgmt->bufferPool, &page);
+		freePage(mgmt, &tail);
+	}
+	return unpinPage(&mgmt->bufferPool, &tail);
+}
+
+/**
+ * Function: openHashScan
+ * ---------------------
+ * Starts a scan over the entries with the given key.
+ *
+ * @param index     Index
+ * @param key       Key to look for
+ * @param handle    Set to the new scan handle
+ * @return
+ *	-	RC_OK if the scan was started
+ */
+RC openHashScan(HashHandle *index, const char *key, HT_ScanHandle **handle) {
+	HashMgmtData *mgmt = (HashMgmtData *) index->mgmtData;
+	HTScanMgmtData *scan = (HTScanMgmtData *) malloc(sizeof(HTScanMgmtData));
+
+	scan->key = (char *) malloc(mgmt->keyLength);
+	memcpy(scan->key, key, mgmt->keyLength);
+	scan->page = mgmt->buckets[bucketFor(mgmt, key)];
+	scan->pos = 0;
+
+	*handle = (HT_ScanHandle *) malloc(sizeof(HT_ScanHandle));
+	(*handle)->index = index;
+	(*handle)->mgmtData = scan;
+	return RC_OK;
+}
+
+/**
+ * Function: nextHashEntry
+ * ----------------------
+ * Returns the rid of the next entry with the scan's key.
+ *
+ * @param handle    Scan handle
+ * @param result    Set to the rid of the entry
+ * @return
+ *	-	RC_OK if an entry was returned
+ *	-	RC_IM_NO_MORE_ENTRIES if the bucket has no further entries with the key
+ */
+RC nextHashEntry(HT_ScanHandle *handle, RID *result) {
+	HashMgmtData *mgmt = (HashMgmtData *) handle->index->mgmtData;
+	HTScanMgmtData *scan = (HTScanMgmtData *) handle->mgmtData;
+	BM_PageHandle page;
+	RC rc;
+
+	while (scan->page != HT_NO_PAGE) {
+		if ((rc = pinPage(&mgmt->bufferPool, &page, scan->page)) != RC_OK)
+			return rc;
+		while (scan->pos < BUCKET_NUM_ENTRIES(page.data)) {
+			char *entry = entryAt(mgmt, page.data, scan->pos++);
+			if (memcmp(entry, scan->key, mgmt->keyLength) == 0) {
+				*result = entryRid(mgmt, entry);
+				return unpinPage(&mgmt->bufferPool, &page);
+			}
+		}
+		scan->page = BUCKET_OVERFLOW(page.data);
+		scan->pos = 0;
+		unpinPage(&mgmt->bufferPool, &page);
+	}
+	return RC_IM_NO_MORE_ENTRIES;
+}
+
+/**
+ * Function: closeHashScan
+ * ----------------------
+ * Frees a scan handle.
+ *
+ * @param handle    Scan handle
+ * @return
+ *	-	RC_OK
+ */
+RC closeHashScan(HT_ScanHandle *handle) {
+	HTScanMgmtData *scan = (HTScanMgmtData *) handle->mgmtData;
+
+	free(scan->key);
+	free(scan);
+	free(handle);
+	return RC_OK;
+}
@@ -0,0 +1,39 @@
+#ifndef HASH_MGR_H
+#define HASH_MGR_H
+
+#include "dberror.h"
+#include "tables.h"
+
+// structure for accessing hash indexes; keys are fixed-size byte strings
+typedef struct HashHandle {
+	char *idxId;
+	void *mgmtData;
+} HashHandle;
+
+typedef struct HT_ScanHandle {
+	HashHandle *index;
+	void *mgmtData;
+} HT_ScanHandle;
+
+// create, destroy, open, and close a linear hash index
+extern RC createHashIndex (char *idxId, int keyLength, bool unique);
+extern RC openHashIndex (HashHandle **index, char *idxId);
+extern RC closeHashIndex (HashHandle *index);
+extern RC deleteHashIndex (char *idxId);
+
+// access information about a hash index
+extern RC getHashNumBuckets (HashHandle *index, int *result);
+extern RC getHashNumEntries (HashHandle *index, int *result);
+extern RC getHashNumPages (HashHandle *index, int *result);
+
+// index access; entries are (key, rid) pairs, a key may occur with several rids unless the index is unique
+extern RC hashFindKey (HashHandle *index, const char *key, RID *result);
+extern RC hashInsertKey (HashHandle *index, const char *key, RID rid);
+extern RC hashDeleteKey (HashHandle *index, const char *key, RID rid);
+
+// scans over the entries of one key, in no particular order
+extern RC openHashScan (HashHandle *index, const char *key, HT_ScanHandle **handle);
+extern RC nextHashEntry (HT_ScanHandle *handle, RID *result);
+extern RC closeHashScan (HT_ScanHandle *handle);
+
+#endif // HASH_MGR_H
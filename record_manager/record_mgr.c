@@ -2,10 +2,49 @@
 #include <string.h>
 #include <stdlib.h>
 #include <tgmath.h>
+#include <pthread.h>
+#include <time.h>
 #include "record_mgr.h"
 #include "buffer_mgr.h"
 #include "storage_mgr.h"
+#include "rm_kernels.h"
+#include "rm_zonemap.h"
+#include "btree_mgr.h"
+#include "hash_mgr.h"
+#include "rm_wal.h"
+#include "rm_mvcc.h"
+#include "rm_lock.h"
+#include "rm_catalog.h"
+#include "rm_aggregate.h"
 
+#define RM_MAX_INDEXES 8
+
+// cost of reading a page for an index match, relative to a page of a sequential scan
+#define RM_RANDOM_PAGE_COST 4
+
+// log bytes after which a change to a logged table takes a checkpoint
+#define RM_CHECKPOINT_INTERVAL (WAL_SEGMENT_SIZE / 2)
+
+// threads applying the log records of a recovery, each to its own pages
+#define RM_REDO_THREADS 4
+
+// dirty page table entry of a page that is not dirty
+#define RM_CLEAN_PAGE ((WalLsn) -1)
+
+// frames of an RM_POOL_DEFAULT buffer pool
+#define RM_DEFAULT_POOL_PAGES 10
+
+// An index on one attribute of a table
+typedef struct RMIndex {
+	int attrNum;	// Indexed attribute, RM_PRIMARY_KEY for the schema's key attributes
+	RM_IndexType type;	// Index structure
+	bool unique;	// TRUE if no two records may share a key
+	BTreeHandle *btree;	// Open index if type is RM_INDEX_BTREE
+	HashHandle *hash;	// Open index if type is RM_INDEX_HASH
+} RMIndex;
+
+
+struct RMVacuumDaemon;
 
 // Structure to manage table metadata and buffer pool
 typedef struct RMTableMgmtData {
@@ -13,20 +52,446 @@ typedef struct RMTableMgmtData {
 	int numTuples;	// Number of tuples (records) in the table
 	int firstFreePageNumber;	// First free page number for inserting new records
 	int recordSize;	// Size of each record in bytes
+	RM_PageLayout layout;	// Row-wise slots or PAX minipages
+	ZoneMap *zoneMap;	// Per-page min/max of the live records, kept in memory only
+	int numIndexes;	// Number of indexes on the table
+	RMIndex indexes[RM_MAX_INDEXES];	// Indexes, kept up to date by insert, delete and update
+	RM_AccessPath accessPath;	// How new scans choose between pages and indexes, not stored
+	pthread_rwlock_t latch;	// Held exclusively by record operations and vacuumTable, shared by scans reading pages
+	int activeScans;	// Open scans, which vacuumTable must not move records under
+	struct RMVacuumDaemon *vacuumDaemon;	// Background vacuum thread, NULL if not running
+	WalLog *wal;	// Write-ahead log of the record changes, NULL if the table is not logged
+	WalLsn infoLsn;	// numTuples and firstFreePageNumber include the log records up to this LSN
+	WalLsn *recLsn;	// Dirty page table: position of the first log record changing each page since it was written
+	int numRecLsn;	// Pages covered by recLsn
+	pthread_mutex_t dirtyLock;	// Protects recLsn, which the buffer pool's write hook clears
+	WalLsn checkpointPos;	// Position of the last checkpoint record, or of the log start
+	int numRecovered;	// Log records read by the recovery in openTable
+	VersionStore *versions;	// Earlier versions of changed records that open snapshots may see, kept in memory
 	BM_PageHandle pageHandle;	// Buffer manager page handle for metadata operations
 	BM_BufferPool bufferPool;	// Buffer pool for managing table pages
+	RM_PoolOptions pool;	// Frames and strategy of bufferPool as chosen by openTable
 } RMTableMgmtData;
 
+/* An index scan answering one predicate of a scan condition */
+typedef struct RMIndexScan {
+	RMIndex *index;	// NULL if the scan reads the data pages
+	ZonePredicate pred;	// Predicate answered by the index
+	BT_ScanHandle *treeScan;	// Open scan of a B+-tree
+	HT_ScanHandle *hashScan;	// Open scan of a hash index
+	RID *pending;	// Records returned whose uncommitted key has an entry too, so the scan meets them twice
+	int numPending;
+} RMIndexScan;
+
 /* RMScanMgmtData stores scan details and condition */
 typedef struct RMScanMgmtData {
 
-	BM_PageHandle pHandle;
 	RID rid; // current row that is being scanned
+	int lastPage; // last page to scan, -1 for all pages in use
 	int count; // no. of tuples scanned till now
 	Expr *condition; // expression to be checked
+	CompiledExpr *program; // compiled form of condition, NULL if it could not be compiled
+	bool useKernel; // TRUE if kernel can filter whole pages
+	ScanKernel kernel; // vectorized (pre)filter extracted from condition
+	int maskPage; // page that mask belongs to, -1 if none
+	uint64_t mask[KERNEL_MASK_WORDS]; // matching slots of maskPage
+	char *row; // scratch record for evaluating conditions on PAX pages
+	int numZonePreds; // conjuncts of condition checked against the zone map
+	ZonePredicate zonePreds[ZONE_MAX_PREDICATES];
+	int pagesSkipped; // pages the zone map ruled out
+	RMIndexScan indexScan; // index used instead of the data pages, if any
+	RM_Transaction *tx; // transaction whose snapshot the scan reads, NULL for the last committed state
+	MvccTs snapshot; // commits a scan outside a transaction sees, taken when a pass over the table starts
+	char *page; // tuples of the matching slots of maskPage as the scan sees them, slot s at s * tuple size
+	RM_Arena *arena; // temporaries of the scan and of getScanArena's callers, NULL until needed; freed by closeScan
+	int numProjected; // attributes next() copies out, 0 for whole records
+	int *projected; // their attribute numbers, in tuple order
+	Schema *projSchema; // layout of the projected tuples, NULL for whole records
+	bool endPending; // nextBatch returned the last tuples; its next call reports the end
 
 } RMScanMgmtData;
 
+/* A record written by a transaction, whose newest version is not committed */
+typedef struct RMTxWrite {
+	RM_TableData *rel;
+	RID rid;
+} RMTxWrite;
+
+struct RM_Transaction {
+	MvccTs snapshot;	// Changes committed up to this timestamp are visible
+	RMTxWrite *writes;	// Records written, first write first
+	int numWrites;
+	int capacity;
+	RM_TableData **tables;	// Tables read or written, whose versions may be collected at the end
+	int numTables;
+	LockOwner locks;	// Locks of the records written, held until the end
+};
+
+// RID of the lock on a whole table
+static const RID tableLockId = {LOCK_TABLE_SLOT, LOCK_TABLE_SLOT};
+
+/* Adds a table to those a transaction used */
+static void useTable(RM_Transaction *tx, RM_TableData *rel) {
+	for (int i = 0; i < tx->numTables; i++) {
+		if (tx->tables[i] == rel)
+			return;
+	}
+	tx->tables = (RM_TableData **) realloc(tx->tables, (tx->numTables + 1) * sizeof(RM_TableData *));
+	tx->tables[tx->numTables++] = rel;
+}
+
+typedef enum RMWriteOp {
+	RM_WRITE_INSERT,
+	RM_WRITE_UPDATE,
+	RM_WRITE_DELETE
+} RMWriteOp;
+
+/*
+ * Data page layouts. Both store the same number of slots per page, one marker
+ * byte ('#' used, '$' deleted) plus the record bytes each:
+ *	ROW	[marker|record][marker|record]...
+ *	PAX	[marker marker ...][attr 0 of all slots][attr 1 of all slots]...
+ * so in PAX attribute i of slot s lives at slots * (1 + offset(i)) + s * size(i).
+ */
+
+/* Number of record slots on a data page; pages of logged tables end with the LSN of their last change */
+static int slotsPerPage(RMTableMgmtData *tableMgmtData) {
+	int usable = PAGE_SIZE - ((tableMgmtData->wal != NULL) ? sizeof(WalLsn) : 0);
+	return usable / (tableMgmtData->recordSize + 1);
+}
+
+/* LSN of the last change to a data page of a logged table */
+static WalLsn *pageLsn(char *page) {
+	return (WalLsn *) (page + PAGE_SIZE - sizeof(WalLsn));
+}
+
+/* Address of the marker byte of a slot */
+static char *slotMarker(RMTableMgmtData *tableMgmtData, char *page, int slot) {
+	if (tableMgmtData->layout == RM_LAYOUT_PAX)
+		return page + slot;
+	return page + slot * (tableMgmtData->recordSize + 1);
+}
+
+/* Distance between the marker bytes of consecutive slots */
+static int markerStride(RMTableMgmtData *tableMgmtData) {
+	return (tableMgmtData->layout == RM_LAYOUT_PAX) ? 1 : tableMgmtData->recordSize + 1;
+}
+
+/* Address of an attribute of slot 0; the attribute of slot s is s * attrStride bytes further */
+static char *attrBase(RM_TableData *rel, char *page, int attrNum) {
+	RMTableMgmtData *tableMgmtData = rel->mgmtData;
+	int offset = rel->schema->attrOffsets[attrNum];
+
+	if (tableMgmtData->layout == RM_LAYOUT_PAX)
+		return page + slotsPerPage(tableMgmtData) * (1 + offset);
+	return page + 1 + offset;
+}
+
+static int attrStride(RM_TableData *rel, int attrNum) {
+	RMTableMgmtData *tableMgmtData = rel->mgmtData;
+	int *offsets = rel->schema->attrOffsets;
+
+	if (tableMgmtData->layout == RM_LAYOUT_PAX)
+		return offsets[attrNum + 1] - offsets[attrNum];
+	return tableMgmtData->recordSize + 1;
+}
+
+/* Copies the record stored in a slot into contiguous record data */
+static void readSlot(RM_TableData *rel, char *page, int slot, char *record) {
+	RMTableMgmtData *tableMgmtData = rel->mgmtData;
+
+	if (tableMgmtData->layout == RM_LAYOUT_ROW) {
+		memcpy(record, page + slot * (tableMgmtData->recordSize + 1) + 1, tableMgmtData->recordSize);
+		return;
+	}
+	for (int i = 0; i < rel->schema->numAttr; i++) {
+		int size = attrStride(rel, i);
+		memcpy(record + rel->schema->attrOffsets[i], attrBase(rel, page, i) + slot * size, size);
+	}
+}
+
+/* Stores contiguous record data into a slot (the marker is left untouched) */
+static void writeSlot(RM_TableData *rel, char *page, int slot, char *record) {
+	RMTableMgmtData *tableMgmtData = rel->mgmtData;
+
+	if (tableMgmtData->layout == RM_LAYOUT_ROW) {
+		memcpy(page + slot * (tableMgmtData->recordSize + 1) + 1, record, tableMgmtData->recordSize);
+		return;
+	}
+	for (int i = 0; i < rel->schema->numAttr; i++) {
+		int size = attrStride(rel, i);
+		memcpy(attrBase(rel, page, i) + slot * size, record + rel->schema->attrOffsets[i], size);
+	}
+}
+
+/* The metadata page (page 1) holds the counts that change with the records; the schema, options and indexes are in the catalog */
+typedef struct RMMetaPage {
+	int numTuples;
+	int firstFreePageNumber;
+	WalLsn infoLsn;	// The counts include the log records up to this LSN
+} RMMetaPage;
+
+/* Name of the write-ahead log of a table */
+static char *logFileName(char *tableName) {
+	char *fileName = (char *) malloc(strlen(tableName) + 5);
+	sprintf(fileName, "%s.wal", tableName);
+	return fileName;
+}
+
+/* Page file name of the index on an attribute (or the primary key) of a table */
+static char *indexFileName(char *tableName, int attrNum) {
+	char *fileName = (char *) malloc(strlen(tableName) + 16);
+	if (attrNum == RM_PRIMARY_KEY)
+		sprintf(fileName, "%s.idxpk", tableName);
+	else
+		sprintf(fileName, "%s.idx%d", tableName, attrNum);
+	return fileName;
+}
+
+/* Attributes that make up the key of an index */
+static int indexAttrs(Schema *schema, RMIndex *index, int **attrs) {
+	if (index->attrNum == RM_PRIMARY_KEY) {
+		*attrs = schema->keyAttrs;
+		return schema->keySize;
+	}
+	*attrs = &index->attrNum;
+	return 1;
+}
+
+/* Size of the byte string a hash index keeps as key: the key attributes as stored in the record */
+static int hashKeyLength(Schema *schema, RMIndex *index) {
+	int *attrs, n = indexAttrs(schema, index, &attrs), length = 0;
+
+	for (int i = 0; i < n; i++)
+		length += schema->attrOffsets[attrs[i] + 1] - schema->attrOffsets[attrs[i]];
+	return length;
+}
+
+/* Copies the key attributes of record data into a hash key */
+static void hashKeyOf(Schema *schema, RMIndex *index, char *data, char *key) {
+	int *attrs, n = indexAttrs(schema, index, &attrs);
+
+	for (int i = 0; i < n; i++) {
+		int size = schema->attrOffsets[attrs[i] + 1] - schema->attrOffsets[attrs[i]];
+		memcpy(key, data + schema->attrOffsets[attrs[i]], size);
+		key += size;
+	}
+}
+
+/* TRUE if two versions of a record differ in the key of an index */
+static bool keyChanged(Schema *schema, RMIndex *index, char *data, char *other) {
+	int *attrs, n = indexAttrs(schema, index, &attrs);
+
+	for (int i = 0; i < n; i++) {
+		int offset = schema->attrOffsets[attrs[i]];
+		if (memcmp(data + offset, other + offset, schema->attrOffsets[attrs[i] + 1] - offset) != 0)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+// Operations on the entry of a record in an index
+typedef enum RMIndexOp {
+	INDEX_FIND,
+	INDEX_INSERT,
+	INDEX_DELETE
+} RMIndexOp;
+
+/**
+ * Function: indexEntry
+ * -------------------
+ * Finds, inserts or deletes the entry for the key of record data in an index,
+ * whatever its structure.
+ *
+ * @param rel	Table data structure
+ * @param index	Index of the table
+ * @param op	Operation
+ * @param data	Record data holding the key
+ * @param rid	Record id to insert or delete, set to the record found for INDEX_FIND
+ * @return
+ *	-	RC_OK if the operation succeeded
+ *	-	Errors of the index manager otherwise
+ */
+static RC indexEntry(RM_TableData *rel, RMIndex *index, RMIndexOp op, char *data, RID *rid) {
+	RC rc = RC_OK;
+
+	if (index->type == RM_INDEX_HASH) {
+		char *key = (char *) malloc(hashKeyLength(rel->schema, index));
+		hashKeyOf(rel->schema, index, data, key);
+		switch (op) {
+			case INDEX_FIND:
+				rc = hashFindKey(index->hash, key, rid);
+			break;
+			case INDEX_INSERT:
+				rc = hashInsertKey(index->hash, key, *rid);
+			break;
+			case INDEX_DELETE:
+				rc = hashDeleteKey(index->hash, key, *rid);
+			break;
+		}
+		free(key);
+	} else {
+		// The key is decoded on the stack; a string attribute is shorter than a page
+		Record record;
+		Value key;
+		char strBuf[PAGE_SIZE];
+		record.data = data;
+		getAttrInto(&record, rel->schema, index->attrNum, &key, strBuf);
+		switch (op) {
+			case INDEX_FIND:
+				rc = findKey(index->btree, &key, rid);
+			break;
+			case INDEX_INSERT:
+				rc = insertKey(index->btree, &key, *rid);
+			break;
+			case INDEX_DELETE:
+				rc = deleteKey(index->btree, &key, *rid);
+			break;
+		}
+	}
+	return rc;
+}
+
+/* Opens the page file of an index */
+static RC openIndex(char *tableName, RMIndex *index) {
+	char *fileName = indexFileName(tableName, index->attrNum);
+	RC rc;
+
+	if (index->type == RM_INDEX_HASH)
+		rc = openHashIndex(&index->hash, fileName);
+	else
+		rc = openBtree(&index->btree, fileName);
+	free(fileName);
+	return rc;
+}
+
+static RC closeIndex(RMIndex *index) {
+	return (index->type == RM_INDEX_HASH) ? closeHashIndex(index->hash) : closeBtree(index->btree);
+}
+
+/* Deletes the page file of a (closed) index */
+static RC deleteIndexFile(char *tableName, int attrNum, RM_IndexType type) {
+	char *fileName = indexFileName(tableName, attrNum);
+	RC rc = (type == RM_INDEX_HASH) ? deleteHashIndex(fileName) : deleteBtree(fileName);
+
+	free(fileName);
+	return rc;
+}
+
+/* Checks that record data would not duplicate a key of a unique index (ignoring the record at self) */
+static RC checkUniqueKeys(RM_TableData *rel, char *data, RID *self) {
+	RMTableMgmtData *tableMgmtData = rel->mgmtData;
+	RC rc = RC_OK;
+
+	for (int i = 0; i < tableMgmtData->numIndexes && rc == RC_OK; i++) {
+		RMIndex *index = &tableMgmtData->indexes[i];
+		RID found;
+
+		if (!index->unique)
+			continue;
+		rc = indexEntry(rel, index, INDEX_FIND, data, &found);
+		if (rc == RC_OK)
+			rc = (self != NULL && found.page == self->page && found.slot == self->slot) ? RC_OK : RC_IM_KEY_ALREADY_EXISTS;
+		else if (rc == RC_IM_KEY_NOT_FOUND)
+			rc = RC_OK;
+	}
+	return rc;
+}
+
+/*
+ * Adds (or with add FALSE removes) the entries of a record to (from) the indexes whose key differs from
+ * other; all or nothing, as the entries already added (removed) are taken out (put back) when an index fails
+ */
+static RC updateIndexes(RM_TableData *rel, char *data, RID rid, bool add, char *other) {
+	RMTableMgmtData *tableMgmtData = rel->mgmtData;
+	RC rc = RC_OK;
+	int i;
+
+	for (i = 0; i < tableMgmtData->numIndexes && rc == RC_OK; i++) {
+		RMIndex *index = &tableMgmtData->indexes[i];
+
+		if (other != NULL && !keyChanged(rel->schema, index, data, other))
+			continue;
+		rc = indexEntry(rel, index, add ? INDEX_INSERT : INDEX_DELETE, data, &rid);
+	}
+	if (rc != RC_OK) {
+		for (int j = 0; j < i - 1; j++) {
+			if (other == NULL || keyChanged(rel->schema, &tableMgmtData->indexes[j], data, other))
+				indexEntry(rel, &tableMgmtData->indexes[j], add ? INDEX_DELETE : INDEX_INSERT, data, &rid);
+		}
+	}
+	return rc;
+}
+
+/*
+ * Moves the index entries of a record from the keys of from to those of to (either NULL for none).
+ * The entries of kept, the last committed version of a record a transaction is changing, are left
+ * for commitTransaction to remove.
+ */
+static RC moveIndexEntries(RM_TableData *rel, RID rid, char *from, char *to, char *kept) {
+	RMTableMgmtData *tableMgmtData = rel->mgmtData;
+	RC rc = RC_OK;
+
+	for (int i = 0; i < tableMgmtData->numIndexes && rc == RC_OK; i++) {
+		RMIndex *index = &tableMgmtData->indexes[i];
+
+		if (from != NULL && (to == NULL || keyChanged(rel->schema, index, from, to))
+				&& (kept == NULL || keyChanged(rel->schema, index, from, kept)))
+			rc = indexEntry(rel, index, INDEX_DELETE, from, &rid);
+		if (rc == RC_OK && to != NULL && (from == NULL || keyChanged(rel->schema, index, to, from))
+				&& (kept == NULL || keyChanged(rel->schema, index, to, kept)))
+			rc = indexEntry(rel, index, INDEX_INSERT, to, &rid);
+	}
+	return rc;
+}
+
+/* Stores the index list in the catalog, which writes it through (a redo rebuilds the indexes it names) */
+static RC writeIndexList(RM_TableData *rel) {
+	RMTableMgmtData *tableMgmtData = rel->mgmtData;
+	RM_IndexInfo indexes[RM_MAX_INDEXES];
+
+	for (int i = 0; i < tableMgmtData->numIndexes; i++) {
+		indexes[i].attrNum = tableMgmtData->indexes[i].attrNum;
+		indexes[i].type = tableMgmtData->indexes[i].type;
+		indexes[i].unique = tableMgmtData->indexes[i].unique;
+	}
+	return catalogSetIndexes(rel->name, indexes, tableMgmtData->numIndexes);
+}
+
+/**
+ * Function: computeAttrOffsets
+ * ----------------------------
+ * Builds the offset table cached in the schema, so attribute access does not
+ * have to sum up the sizes of all preceding attributes on every call.
+ * @param schema	Schema whose attribute types and lengths are set
+ * @return
+ *	-	Array of numAttr + 1 offsets, the last one being the record size
+ */
+static int *computeAttrOffsets(Schema *schema) {
+	int *offsets = (int *) malloc(sizeof(int) * (schema->numAttr + 1));
+	int offset = 0;
+
+	for (int i = 0; i < schema->numAttr; i++) {
+		offsets[i] = offset;
+		switch (schema->dataTypes[i]) {
+			case DT_STRING:
+				offset += schema->typeLength[i];
+			break;
+			case DT_INT:
+				offset += sizeof(int);
+			break;
+			case DT_FLOAT:
+				offset += sizeof(float);
+			break;
+			case DT_BOOL:
+				offset += sizeof(bool);
+			break;
+		}
+	}
+	offsets[schema->numAttr] = offset;
+	return offsets;
+}
+
 /**
  * Function: initRecordManager
  * ---------------------------
@@ -45,28 +510,126 @@ RC initRecordManager(void * mgmtData) {
  * ------------------------------
  * Shuts down the record manager
  * This function is called when the record manager is no longer needed.
+ * The handle cache is turned off and the catalog cache is emptied.
  * @return
  *	-	RC_OK if shutdown is successful
  */
 
 RC shutdownRecordManager() {
+	setTableCache(0, 0);
+	catalogShutdown();
+	return RC_OK;
+}
+
+/*
+ * Buffer memory: the frames of the pools of all open tables count against a
+ * budget, of which RM_POOL_AUTO pools take what is left.
+ */
+static pthread_mutex_t bufferMemoryLock = PTHREAD_MUTEX_INITIALIZER;
+static int bufferMemory = RM_BUFFER_MEMORY;	// Budget of frames
+static int framesInUse = 0;	// Frames of the pools of the open tables
+
+/* TRUE if buffer pool options can be used */
+static bool validPoolOptions(RM_PoolOptions *pool) {
+	return pool->numPages >= RM_POOL_AUTO && pool->strategy >= RS_FIFO && pool->strategy <= RS_LRU_K
+			&& pool->strategyParam >= 0;
+}
+
+/**
+ * Function: reservePool
+ * --------------------
+ * Chooses the frames and strategy of the buffer pool of a table being opened
+ * and counts the frames against the buffer memory.
+ * @param pool	Options of the pool
+ * @param tablePages	Pages of the table, as of its last close
+ * @return
+ *	-	The options with the number of frames and the parameter of the strategy filled in
+ */
+static RM_PoolOptions reservePool(RM_PoolOptions *pool, int tablePages) {
+	RM_PoolOptions chosen = *pool;
+
+	pthread_mutex_lock(&bufferMemoryLock);
+	if (pool->numPages == RM_POOL_DEFAULT) {
+		chosen.numPages = RM_DEFAULT_POOL_PAGES;
+		chosen.strategy = RS_LRU;
+		chosen.strategyParam = 0;
+	} else if (pool->numPages == RM_POOL_AUTO) {
+		int left = bufferMemory - framesInUse;
+		chosen.numPages = (tablePages < left) ? tablePages : left;
+		if (chosen.numPages < RM_POOL_MIN_PAGES)
+			chosen.numPages = RM_POOL_MIN_PAGES;
+	}
+	if (chosen.strategy == RS_LRU_K && chosen.strategyParam == 0)
+		chosen.strategyParam = 2;
+	framesInUse += chosen.numPages;
+	pthread_mutex_unlock(&bufferMemoryLock);
+	return chosen;
+}
+
+static void releasePool(RM_PoolOptions *pool) {
+	pthread_mutex_lock(&bufferMemoryLock);
+	framesInUse -= pool->numPages;
+	pthread_mutex_unlock(&bufferMemoryLock);
+}
+
+/**
+ * Function: setBufferMemory
+ * ------------------------
+ * Sets the budget of frames for the buffer pools of all open tables. Pools
+ * of open tables keep their size; RM_POOL_AUTO pools opened later get at
+ * most what is left, but never fewer than RM_POOL_MIN_PAGES frames.
+ * @param numPages	Frames of the budget
+ * @return
+ *	-	RC_OK
+ *	-	RC_INVALID_PARAM if numPages is not positive
+ */
+RC setBufferMemory(int numPages) {
+	if (numPages <= 0)
+		return RC_INVALID_PARAM;
+	pthread_mutex_lock(&bufferMemoryLock);
+	bufferMemory = numPages;
+	pthread_mutex_unlock(&bufferMemoryLock);
 	return RC_OK;
 }
 
 /**
  * Function: createTable
  * --------------------
- * Creates a new table with the given name and schema.
- * This function creates a new page file to store the table data and initializes
- * the first page with table metadata including the schema.
+ * Creates a new table with the given name and schema, using the default
+ * (row-wise) page layout.
  * @param name		Name of the table to create (used as the page file name)
  * @param schema	Schema of the table to create
  * @return
  *	-	RC_OK if table creation is successful
  */
 RC createTable(char *name, Schema *schema) {
+	return createTableWithOptions(name, schema, NULL);
+}
+
+/**
+ * Function: createTableWithOptions
+ * -------------------------------
+ * Creates a new table with the given name, schema and physical options.
+ * This function creates a new page file to store the table data, initializes
+ * its metadata page with the counts of an empty table and enters the schema
+ * and the options in the catalog.
+ * @param name		Name of the table to create (used as the page file name)
+ * @param schema	Schema of the table to create
+ * @param options	Table options, NULL for the defaults
+ * @return
+ *	-	RC_OK if table creation is successful
+ *	-	RC_INVALID_PARAM if the options are not valid
+ *	-	Errors of the storage manager writing the page file or the catalog otherwise
+ */
+RC createTableWithOptions(char *name, Schema *schema, RM_TableOptions *options) {
 	SM_FileHandle fHandle;
 	RC rc = 0;
+	RM_TableOptions defaults = { RM_LAYOUT_ROW, FALSE, { RM_POOL_DEFAULT, RS_LRU, 0 } };
+
+	if (options == NULL)
+		options = &defaults;
+	if ((options->layout != RM_LAYOUT_ROW && options->layout != RM_LAYOUT_PAX) || !validPoolOptions(&options->pool))
+		return RC_INVALID_PARAM;
 
 	// Create a new page file for the table
 	if ((rc = createPageFile(name)) != RC_OK)
@@ -76,47 +639,11 @@ RC createTable(char *name, Schema *schema) {
 	if ((rc = openPageFile(name, &fHandle)) != RC_OK)
 		return rc;
 
-	// Buffer to hold metadata to be written to the first page
+	// The metadata page starts with no records and the first data page free
 	char data[PAGE_SIZE];
-	char *metaData = data;
-	memset(metaData, 0, PAGE_SIZE);
-
-	// Write number of tuples (initially 0)
-	*(int *) metaData = 0;
-	metaData += sizeof(int);
-
-	// Write first free page number (page 2, since page 0 is metadata, page 1 is for schema/metadata)
-	*(int *) metaData = 2;
-	metaData += sizeof(int);
-
-	// Write record size (computed from schema)
-	*(int *) metaData = getRecordSize(schema);
-	metaData += sizeof(int);
-
-	// Write number of attributes in the schema
-	*(int *) metaData = schema->numAttr;
-	metaData += sizeof(int);
-
-	// Write schema attribute information for each attribute
-	for (int i = 0; i < schema->numAttr; i++) {
-		// Assuming max field name is 20
-		strncpy(metaData, schema->attrNames[i], 20);
-		metaData += 20;
-
-		// Write attribute data type (as integer)
-		*(int *) metaData = (int) schema->dataTypes[i];
-		metaData += sizeof(int);
-
-		// Write attribute type length (for strings, etc.)
-		*(int *) metaData = (int) schema->typeLength[i];
-		metaData += sizeof(int);
-	}
-
-	// Write key attribute indices (for primary key)
-	for (int i = 0; i < schema->keySize; i++) {
-		*(int *) metaData = schema->keyAttrs[i];
-		metaData += sizeof(int);
-	}
+	RMMetaPage meta = { 0, 2, 0 };
+	memset(data, 0, PAGE_SIZE);
+	memcpy(data, &meta, sizeof(RMMetaPage));
 
 	// Write the metadata buffer to page 1 of the file
 	if ((rc = writeBlock(1, &fHandle, data)) != RC_OK)
@@ -125,565 +652,3845 @@ RC createTable(char *name, Schema *schema) {
 	if ((rc = closePageFile(&fHandle)) != RC_OK)
 		return rc;
 
-	return RC_OK;
+	// The schema and the options go to the catalog
+	return catalogAddTable(name, schema, options);
 }
 
-/**
- * Function: openTable
- * ------------------
- * Opens an existing table for operations.
- * This function initializes the buffer pool for the table and loads the table
- * metadata into memory.
- * @param rel	Table data structure to be initialized
- * @param name	Name of the table to open
- * @return
- *	-	RC_OK if table opening is successful
- *	-	Other error codes if buffer pool initialization fails
- */
-RC openTable(RM_TableData *rel, char *name) {
-	RC rc = 0;
+/* Index on an attribute, NULL if there is none */
+static RMIndex *findIndex(RMTableMgmtData *tableMgmtData, int attrNum) {
+	for (int i = 0; i < tableMgmtData->numIndexes; i++) {
+		if (tableMgmtData->indexes[i].attrNum == attrNum)
+			return &tableMgmtData->indexes[i];
+	}
+	return NULL;
+}
 
-	// Allocate memory for schema and table management data
-	Schema *schema = (Schema *) malloc(sizeof(Schema));
-	RMTableMgmtData *tableMgmtData = (RMTableMgmtData *) malloc(sizeof(RMTableMgmtData));
-	rel->mgmtData = tableMgmtData;
-	rel->name = name;
+/* Adds the entries of all records of the table to a new index */
+static RC buildIndex(RM_TableData *rel, RMIndex *index) {
+	RM_ScanHandle scan;
+	Record *record;
+	RC rc;
 
-	// Initialize buffer pool for the table (using LRU replacement strategy, 10 pages)
-	if ((rc = initBufferPool(&tableMgmtData->bufferPool, name, 10, RS_LRU, NULL)) != RC_OK) {
+	if ((rc = createRecord(&record, rel->schema)) != RC_OK)
 		return rc;
-	}
-	// Pin the metadata page (page 1) to read table metadata
-	if ((rc = pinPage(&tableMgmtData->bufferPool, &tableMgmtData->pageHandle, 1)) != RC_OK) {
-		// pinning the 0th page which has metadata
+	if ((rc = startScan(rel, &scan, NULL)) != RC_OK) {
+		freeRecord(record);
 		return rc;
 	}
-	SM_PageHandle metaData = (char *) tableMgmtData->pageHandle.data;
-
-	/**
-	 * Read
-	 *	number of tuples
-	 *	first free page number
-	 *	record size
-	 *	number of attributes
-	 * from metadata
-	 */
-	tableMgmtData->numTuples = *(int *) metaData;
-	metaData += sizeof(int);
-	tableMgmtData->firstFreePageNumber = *(int *) metaData;
-	metaData += sizeof(int);
-	tableMgmtData->recordSize = *(int *) metaData;
-	metaData += sizeof(int);
-	schema->numAttr = *(int *) metaData;
-	metaData += sizeof(int);
-
-	// Allocate memory for schema attribute arrays
-	schema->attrNames = (char **) malloc(sizeof(char *) * schema->numAttr);
-	schema->dataTypes = (DataType *) malloc(sizeof(DataType) * schema->numAttr);
-	schema->typeLength = (int *) malloc(sizeof(int) * schema->numAttr);
 
-	// Read attribute information for each attribute
-	for (int i = 0; i < schema->numAttr; i++) {
-		// (max 20 bytes + null terminator)
-		schema->attrNames[i] = (char *) malloc(21);
-		strncpy(schema->attrNames[i], metaData, 20);
-		schema->attrNames[i][20] = '\0';	// -> null termination
-		metaData += 20;
-
-		schema->dataTypes[i] = *(int *) metaData;
-		metaData += sizeof(int);
-
-		schema->typeLength[i] = *(int *) metaData;
-		metaData += sizeof(int);
+	while ((rc = next(&scan, record)) == RC_OK) {
+		if ((rc = indexEntry(rel, index, INDEX_INSERT, record->data, &record->id)) != RC_OK)
+			break;
 	}
-	schema->keySize = *(int *) metaData;
-	metaData += sizeof(int);
+	if (rc == RC_RM_NO_MORE_TUPLES)
+		rc = RC_OK;
 
-	// Allocate memory for key attributes (primary key)
-	schema->keyAttrs = (int *) malloc(sizeof(int) * schema->keySize);
-	for (int i = 0; i < schema->keySize; i++) {
-		schema->keyAttrs[i] = *(int *) metaData;
-		metaData += sizeof(int);
-	}
-	rel->schema = schema;
+	closeScan(&scan);
+	freeRecord(record);
+	return rc;
+}
 
-	// Unpin the metadata page after reading
-	return unpinPage(&tableMgmtData->bufferPool, &tableMgmtData->pageHandle);
+/* Creates the (empty) page file of an index */
+static RC createIndexFile(RM_TableData *rel, RMIndex *index) {
+	Schema *schema = rel->schema;
+	char *fileName = indexFileName(rel->name, index->attrNum);
+	RC rc;
+
+	if (index->type == RM_INDEX_HASH)
+		rc = createHashIndex(fileName, hashKeyLength(schema, index), index->unique);
+	else
+		rc = createBtree(fileName, schema->dataTypes[index->attrNum], schema->typeLength[index->attrNum], 0, index->unique);
+	free(fileName);
+	return rc;
 }
 
-/**
- * Function: closeTable
- * ------------------
- * Closes an open table, writing back any updated metadata and shutting down the buffer pool.
- * @param rel	Table data structure to be closed
- * @return
- *	-	RC_OK if table closing is successful
- *	-	Other error codes if buffer pool shutdown fails
- */
-RC closeTable(RM_TableData *rel) {
-	RC rc = -1;
-	RMTableMgmtData *tableMgmtData = rel->mgmtData;
+/* Writes the number of tuples and the last page in use to the metadata page */
+static RC writeTableInfo(RMTableMgmtData *tableMgmtData) {
+	RC rc;
 
 	// Pin the metadata page to update number of tuples
-	if ((rc == pinPage(&tableMgmtData->bufferPool, &tableMgmtData->pageHandle, 1)) != RC_OK)
+	if ((rc = pinPage(&tableMgmtData->bufferPool, &tableMgmtData->pageHandle, 1)) != RC_OK)
 		return rc;
 
-	char *metaData = tableMgmtData->pageHandle.data;
-	// Update number of tuples in metadata
-	*(int *) metaData = tableMgmtData->numTuples;
+	RMMetaPage *meta = (RMMetaPage *) tableMgmtData->pageHandle.data;
+	// Update number of tuples and last page in use in metadata
+	meta->numTuples = tableMgmtData->numTuples;
+	meta->firstFreePageNumber = tableMgmtData->firstFreePageNumber;
+
+	// The counts include every change logged so far
+	if (tableMgmtData->wal != NULL) {
+		tableMgmtData->infoLsn = walAppendedLsn(tableMgmtData->wal);
+		meta->infoLsn = tableMgmtData->infoLsn;
+	}
 
 	// Mark the metadata page as dirty (modified)
 	markDirty(&tableMgmtData->bufferPool, &tableMgmtData->pageHandle);
 
 	// Unpin the metadata page after updating
-	if ((rc = unpinPage(&tableMgmtData->bufferPool, &tableMgmtData->pageHandle)) != RC_OK)
-		return rc;
+	return unpinPage(&tableMgmtData->bufferPool, &tableMgmtData->pageHandle);
+}
 
-	// Shutdown the buffer pool for the table
-	if ((rc = shutdownBufferPool(&tableMgmtData->bufferPool)) != RC_OK)
-		return rc;
+/* Enters a page into the dirty page table, unless it is dirty already */
+static void notePageChange(RMTableMgmtData *tableMgmtData, int pageNum, WalLsn pos) {
+	pthread_mutex_lock(&tableMgmtData->dirtyLock);
+	if (pageNum >= tableMgmtData->numRecLsn) {
+		int size = (pageNum + 1) * 2;
+		tableMgmtData->recLsn = (WalLsn *) realloc(tableMgmtData->recLsn, size * sizeof(WalLsn));
+		for (int i = tableMgmtData->numRecLsn; i < size; i++)
+			tableMgmtData->recLsn[i] = RM_CLEAN_PAGE;
+		tableMgmtData->numRecLsn = size;
+	}
+	if (tableMgmtData->recLsn[pageNum] == RM_CLEAN_PAGE)
+		tableMgmtData->recLsn[pageNum] = pos;
+	pthread_mutex_unlock(&tableMgmtData->dirtyLock);
+}
 
-	// Clear management data pointer
-	rel->mgmtData = NULL;
-	return RC_OK;
+/* Removes pages first to last - 1 from the dirty page table */
+static void forgetPageChanges(RMTableMgmtData *tableMgmtData, int first, int last) {
+	pthread_mutex_lock(&tableMgmtData->dirtyLock);
+	for (int i = first; i < last && i < tableMgmtData->numRecLsn; i++)
+		tableMgmtData->recLsn[i] = RM_CLEAN_PAGE;
+	pthread_mutex_unlock(&tableMgmtData->dirtyLock);
 }
 
-/**
- * Function: deleteTable
- * --------------------
- * Deletes a table and its associated page file.
- * This function removes the page file that stores the table data.
- *
- * @param name	Name of the table to delete
- * @return
- *	-	RC_OK if table (page) deletion is successful
- *	-	Other error codes if destroyPageFile fails
+/* Buffer pool write hook: a page must not reach the disk before the log records of its changes */
+static RC forceLog(BM_PageHandle *const page, void *context) {
+	RMTableMgmtData *tableMgmtData = (RMTableMgmtData *) context;
+	WalLsn lsn = (page->pageNum >= 2) ? *pageLsn(page->data) : walAppendedLsn(tableMgmtData->wal);
+	RC rc = walFlush(tableMgmtData->wal, lsn);
+
+	if (rc == RC_OK)
+		forgetPageChanges(tableMgmtData, page->pageNum, page->pageNum + 1);
+	return rc;
+}
+
+/*
+ * Appends a change to the log of a logged table; lsn is set to the LSN to
+ * commit. The change is stamped on page, which must be pinned, unless page is NULL.
  */
-RC deleteTable(char *name) {
-	// Destroy the page file associated with the table
-	return destroyPageFile(name);
+static RC logChange(RM_TableData *rel, WalRecordType type, RID rid, char *data, char *page, WalLsn *lsn) {
+	RMTableMgmtData *tableMgmtData = rel->mgmtData;
+	int length = (data != NULL) ? tableMgmtData->recordSize : 0;
+	RC rc;
+
+	if (tableMgmtData->wal == NULL)
+		return RC_OK;
+	if ((rc = walAppend(tableMgmtData->wal, type, rid, data, length, lsn)) != RC_OK || page == NULL)
+		return rc;
+	*pageLsn(page) = *lsn;
+	notePageChange(tableMgmtData, rid.page, *lsn - sizeof(WalRecord) - length);
+	return RC_OK;
 }
 
-/**
- * Function: getNumTuples
- * ---------------------
- * Returns the total number of records present in the table.
- * This value is fetched from the table management data.
+/* Writes all pages and the counts to disk, after which the log is not needed any more */
+static RC resetLog(RM_TableData *rel) {
+	RMTableMgmtData *tableMgmtData = rel->mgmtData;
+	RC rc;
+
+	if ((rc = writeTableInfo(tableMgmtData)) != RC_OK || (rc = syncBufferPool(&tableMgmtData->bufferPool)) != RC_OK)
+		return rc;
+	if ((rc = walReset(tableMgmtData->wal)) == RC_OK)
+		tableMgmtData->checkpointPos = tableMgmtData->wal->startLsn;
+	return rc;
+}
+
+/*
+ * Checkpoint record data: the counts with the LSN they include, the position
+ * recovery starts reading at and the dirty page table, followed by numDirty
+ * RMDirtyPage entries.
+ */
+typedef struct RMCheckpoint {
+	int numTuples;
+	int firstFreePageNumber;
+	WalLsn infoLsn;
+	WalLsn redoPos;
+	int numDirty;
+} RMCheckpoint;
+
+typedef struct RMDirtyPage {
+	int pageNum;
+	WalLsn recLsn;
+} RMDirtyPage;
+
+/**
+ * Function: writeCheckpoint
+ * ------------------------
+ * Takes a fuzzy checkpoint of a logged table with the table latch held.
+ * Pages are not written, except those dirty since before the previous
+ * checkpoint, so that the log start keeps moving. The checkpoint record holds
+ * the counts and the dirty page table; recovery reads the log from the oldest
+ * change in that table, and the segments before it are deleted.
  *
  * @param rel	Table data structure
  * @return
- *	-	The number of tuples (records) in the table
+ *	-	RC_OK if the checkpoint was taken
+ *	-	Errors of the buffer manager and of the log otherwise
  */
-int getNumTuples(RM_TableData *rel) {
+static RC writeCheckpoint(RM_TableData *rel) {
+	RMTableMgmtData *tableMgmtData = rel->mgmtData;
+	BM_PageHandle page;
+	RC rc;
 
-	RMTableMgmtData *rmTableMgmtData = rel->mgmtData;
-	return rmTableMgmtData->numTuples;
+	// Write back the pages the previous checkpoint already found dirty
+	for (int i = 2; i < tableMgmtData->numRecLsn; i++) {
+		if (tableMgmtData->recLsn[i] < tableMgmtData->checkpointPos) {
+			page.pageNum = i;
+			if ((rc = forcePage(&tableMgmtData->bufferPool, &page)) != RC_OK && rc != RC_PAGE_NOT_FOUND)
+				return rc;
+		}
+	}
+
+	// Record the counts and the dirty page table
+	pthread_mutex_lock(&tableMgmtData->dirtyLock);
+	int numDirty = 0;
+	for (int i = 0; i < tableMgmtData->numRecLsn; i++)
+		numDirty += (tableMgmtData->recLsn[i] != RM_CLEAN_PAGE);
+	int length = sizeof(RMCheckpoint) + numDirty * sizeof(RMDirtyPage);
+	RMCheckpoint *checkpoint = (RMCheckpoint *) calloc(1, length);
+	RMDirtyPage *dirty = (RMDirtyPage *) (checkpoint + 1);
+	checkpoint->numTuples = tableMgmtData->numTuples;
+	checkpoint->firstFreePageNumber = tableMgmtData->firstFreePageNumber;
+	checkpoint->infoLsn = walAppendedLsn(tableMgmtData->wal);
+	checkpoint->redoPos = checkpoint->infoLsn;
+	for (int i = 0; i < tableMgmtData->numRecLsn; i++) {
+		if (tableMgmtData->recLsn[i] == RM_CLEAN_PAGE)
+			continue;
+		dirty->pageNum = i;
+		dirty->recLsn = tableMgmtData->recLsn[i];
+		if (dirty->recLsn < checkpoint->redoPos)
+			checkpoint->redoPos = dirty->recLsn;
+		dirty++;
+	}
+	checkpoint->numDirty = numDirty;
+	pthread_mutex_unlock(&tableMgmtData->dirtyLock);
+
+	RID none = { 0, 0 };
+	WalLsn lsn;
+	rc = walAppend(tableMgmtData->wal, WAL_CHECKPOINT, none, (char *) checkpoint, length, &lsn);
+	WalLsn redoPos = checkpoint->redoPos;
+	free(checkpoint);
+	if (rc != RC_OK || (rc = walFlush(tableMgmtData->wal, lsn)) != RC_OK)
+		return rc;
+
+	WalLsn pos = lsn - sizeof(WalRecord) - length;
+	if ((rc = walSetCheckpoint(tableMgmtData->wal, pos, redoPos)) == RC_OK)
+		tableMgmtData->checkpointPos = pos;
+	return rc;
+}
+
+/* Takes a checkpoint once enough log was written since the last one; table latch held */
+static RC checkpointIfDue(RM_TableData *rel) {
+	RMTableMgmtData *tableMgmtData = rel->mgmtData;
+
+	if (tableMgmtData->wal == NULL
+			|| walAppendedLsn(tableMgmtData->wal) - tableMgmtData->checkpointPos < RM_CHECKPOINT_INTERVAL)
+		return RC_OK;
+	return writeCheckpoint(rel);
 }
 
 /**
- * Function: insertRecord
- * ---------------------
- * Inserts a new record into the table.
- * Pins the first free page where records can be inserted
- * Checks if there is enough space in this page to insert the record
- * If not, it moves to the next page to find a free slot
- * Writes the new record at the free slot and updates RID information
- * Marks the page as dirty
- * Unpins the page
- * Increments the number of tuples
+ * Function: redoChange
+ * -------------------
+ * Applies an insert, update or delete to its page while the log is replayed.
+ * Pages store the LSN of their last change, so changes the page already holds
+ * are skipped. Changes to one page have to be applied in log order.
  *
  * @param rel	Table data structure
- * @param record	Record to be inserted
+ * @param change	Log record
+ * @param data	Record data of inserts and updates
  * @return
- *	-	RC_OK - If record insertion is successful
+ *	-	RC_OK if the record was applied or skipped
+ *	-	Errors of the buffer manager otherwise
  */
-RC insertRecord(RM_TableData *rel, Record *record) {
-    RMTableMgmtData *tableMgmtData = rel->mgmtData;
-    int recordSize = tableMgmtData->recordSize + 1;
-    RID *rid = &record->id;
-    rid->page = tableMgmtData->firstFreePageNumber;
-    rid->slot = -1;
-
-    // Pin the first free page
-    RC rc = pinPage(&tableMgmtData->bufferPool, &tableMgmtData->pageHandle, rid->page);
-    if (rc != RC_OK) {
-        return rc;
-    }
-
-    char *data = tableMgmtData->pageHandle.data;
+static RC redoChange(RM_TableData *rel, WalRecord *change, char *data) {
+	RMTableMgmtData *tableMgmtData = rel->mgmtData;
+	BM_PageHandle page;
+	RC rc;
 
-    // Calculate total slots per page
-    int totalSlots = floor(PAGE_SIZE / recordSize);
+	if ((rc = pinPage(&tableMgmtData->bufferPool, &page, change->rid.page)) != RC_OK)
+		return rc;
+	if (*pageLsn(page.data) >= change->lsn)
+		return unpinPage(&tableMgmtData->bufferPool, &page);
+
+	if (change->type == WAL_DELETE) {
+		*slotMarker(tableMgmtData, page.data, change->rid.slot) = '$';
+	} else {
+		*slotMarker(tableMgmtData, page.data, change->rid.slot) = '#';
+		writeSlot(rel, page.data, change->rid.slot, data);
+	}
+	*pageLsn(page.data) = change->lsn;
+	markDirty(&tableMgmtData->bufferPool, &page);
+	return unpinPage(&tableMgmtData->bufferPool, &page);
+}
 
-    // Find a free slot in the current page
-    for (int i = 0; i < totalSlots; i++) {
-        if (data[i * recordSize] != '#') {
-            rid->slot = i;
-            break;
-        }
-    }
+/* Log records read by a recovery that still have to be applied to their pages */
+typedef struct RMRecovery {
+	RM_TableData *rel;
+	RMCheckpoint *checkpoint;	// Checkpoint recovery started at, NULL if none
+	WalLsn checkpointLsn;	// LSN of that checkpoint record
+	WalRecord *changes;
+	char **data;
+	int numChanges;
+	int capacity;
+} RMRecovery;
+
+typedef struct RMRedoWorker {
+	RMRecovery *recovery;
+	int id;
+	int numWorkers;
+	RC rc;
+	pthread_t thread;
+} RMRedoWorker;
 
-    // If no free slot found in current page, search in subsequent pages
-    while (rid->slot == -1) {
-        unpinPage(&tableMgmtData->bufferPool, &tableMgmtData->pageHandle);
-        rid->page++; // Increment page number
+/* Applies the changes of the pages assigned to one worker, in log order */
+static void *redoWorker(void *arg) {
+	RMRedoWorker *worker = (RMRedoWorker *) arg;
+	RMRecovery *recovery = worker->recovery;
 
-        rc = pinPage(&tableMgmtData->bufferPool, &tableMgmtData->pageHandle, rid->page);
-        if (rc != RC_OK) {
-            return rc;
-        }
+	for (int i = 0; i < recovery->numChanges && worker->rc == RC_OK; i++) {
+		if (recovery->changes[i].rid.page % worker->numWorkers == worker->id)
+			worker->rc = redoChange(recovery->rel, &recovery->changes[i], recovery->data[i]);
+	}
+	return NULL;
+}
 
-        data = tableMgmtData->pageHandle.data;
+/* Applies the collected changes, partitioned by page among RM_REDO_THREADS threads */
+static RC redoChanges(RMRecovery *recovery) {
+	RMRedoWorker workers[RM_REDO_THREADS];
+	int numWorkers = (recovery->numChanges < RM_REDO_THREADS) ? recovery->numChanges : RM_REDO_THREADS;
+	RC rc = RC_OK;
+
+	for (int i = 0; i < numWorkers; i++) {
+		workers[i].recovery = recovery;
+		workers[i].id = i;
+		workers[i].numWorkers = numWorkers;
+		workers[i].rc = RC_OK;
+		pthread_create(&workers[i].thread, NULL, redoWorker, &workers[i]);
+	}
+	for (int i = 0; i < numWorkers; i++) {
+		pthread_join(workers[i].thread, NULL);
+		if (rc == RC_OK)
+			rc = workers[i].rc;
+	}
+	for (int i = 0; i < recovery->numChanges; i++)
+		free(recovery->data[i]);
+	recovery->numChanges = 0;
+	return rc;
+}
 
-        for (int i = 0; i < totalSlots; i++) {
-            if (data[i * recordSize] != '#') {
-                tableMgmtData->firstFreePageNumber = rid->page;
-                rid->slot = i;
-                break;
-            }
-        }
-    }
+/* Whether a page already held a change when the checkpoint recovery started at was taken */
+static bool changeOnDisk(RMRecovery *recovery, WalRecord *change) {
+	RMDirtyPage *dirty = (RMDirtyPage *) (recovery->checkpoint + 1);
 
-    // Mark the page as dirty
-    rc = markDirty(&tableMgmtData->bufferPool, &tableMgmtData->pageHandle);
-    if (rc != RC_OK) {
-        unpinPage(&tableMgmtData->bufferPool, &tableMgmtData->pageHandle);
-        return rc;
-    }
+	if (recovery->checkpoint == NULL || change->lsn > recovery->checkpointLsn)
+		return FALSE;
+	for (int i = 0; i < recovery->checkpoint->numDirty; i++) {
+		if (dirty[i].pageNum == change->rid.page)
+			return change->lsn - change->length < dirty[i].recLsn;
+	}
+	return TRUE;
+}
 
-    // Write record to the slot
-    char *slotAddress = data + (rid->slot * recordSize);
-    *slotAddress = '#'; // Mark slot as occupied
-    slotAddress++;
-    memcpy(slotAddress, record->data, recordSize - 1);
+/**
+ * Function: collectChange
+ * ----------------------
+ * Handles a log record read by a recovery. The counts in the metadata are
+ * changed for records after the LSN they include. Inserts, updates and deletes
+ * that may be missing on disk are collected and applied by redoChanges; a
+ * truncation is applied once the changes before it are.
+ *
+ * @param change	Log record
+ * @param data	Record data of inserts and updates
+ * @param context	Recovery state
+ * @return
+ *	-	RC_OK if the record was handled
+ *	-	Errors of the buffer manager otherwise
+ */
+static RC collectChange(WalRecord *change, char *data, void *context) {
+	RMRecovery *recovery = (RMRecovery *) context;
+	RMTableMgmtData *tableMgmtData = recovery->rel->mgmtData;
+	bool counted = (change->lsn > tableMgmtData->infoLsn);
+	RC rc;
 
-    // Unpin the page
-    rc = unpinPage(&tableMgmtData->bufferPool, &tableMgmtData->pageHandle);
-    if (rc != RC_OK) {
-        return rc;
-    }
+	if (change->type == WAL_CHECKPOINT)
+		return RC_OK;
+	if (change->type == WAL_TRUNCATE) {
+		if (counted)
+			tableMgmtData->firstFreePageNumber = change->rid.page;
+		if (change->lsn <= recovery->checkpointLsn)
+			return RC_OK;
+		if ((rc = redoChanges(recovery)) != RC_OK)
+			return rc;
+		return truncateBufferPool(&tableMgmtData->bufferPool, change->rid.page + 1);
+	}
 
-    // Update tuple count and record ID
-    tableMgmtData->numTuples++;
-    record->id = *rid;
+	if (counted && change->type == WAL_DELETE) {
+		tableMgmtData->numTuples--;
+	} else if (counted && change->type == WAL_INSERT) {
+		tableMgmtData->numTuples++;
+		if (change->rid.page > tableMgmtData->firstFreePageNumber)
+			tableMgmtData->firstFreePageNumber = change->rid.page;
+	}
+	if (changeOnDisk(recovery, change))
+		return RC_OK;
 
-    return RC_OK;
+	if (recovery->numChanges == recovery->capacity) {
+		recovery->capacity = (recovery->capacity > 0) ? 2 * recovery->capacity : 256;
+		recovery->changes = (WalRecord *) realloc(recovery->changes, recovery->capacity * sizeof(WalRecord));
+		recovery->data = (char **) realloc(recovery->data, recovery->capacity * sizeof(char *));
+	}
+	recovery->changes[recovery->numChanges] = *change;
+	recovery->data[recovery->numChanges] = NULL;
+	if (change->type != WAL_DELETE) {
+		recovery->data[recovery->numChanges] = (char *) malloc(tableMgmtData->recordSize);
+		memcpy(recovery->data[recovery->numChanges], data, tableMgmtData->recordSize);
+	}
+	recovery->numChanges++;
+	return RC_OK;
 }
 
 /**
- * Function: deleteRecord
+ * Function: recoverTable
  * ---------------------
- * Deletes a record from the table.
- * Pins the page where records is located
- * Marks the record as deleted by replacing "#" with "$" (tombstone)
- * Decrements the number of tuples
- * Marks the page as dirty
- * Unpins the page
+ * Redoes the changes in the log of a table that was not closed. Reading
+ * starts at the last checkpoint's oldest dirty page change, or at the start
+ * of the log if there was no checkpoint, so the work depends on the changes
+ * since the checkpoint rather than on the size of the table.
  *
  * @param rel	Table data structure
- * @param id	Record to be inserted
+ * @param crashed	Set to TRUE if the table was not closed
  * @return
- *	-	RC_OK - If record deletion is successful
+ *	-	RC_OK if the changes were redone
+ *	-	RC_READ_NON_EXISTING_PAGE if the checkpoint record cannot be read
+ *	-	Errors of the buffer manager otherwise
  */
-RC deleteRecord(RM_TableData *rel, RID id) {
-	RMTableMgmtData *rmTableMgmtData = rel->mgmtData;
+static RC recoverTable(RM_TableData *rel, bool *crashed) {
+	RMTableMgmtData *tableMgmtData = rel->mgmtData;
+	RMRecovery recovery = { rel, NULL, 0, NULL, NULL, 0, 0 };
+	WalLsn from = tableMgmtData->wal->startLsn;
+	WalRecord header;
+	char *data = NULL;
+	RC rc;
 
-	// Pin the page containing the record
-	RC rc = pinPage(&rmTableMgmtData->bufferPool, &rmTableMgmtData->pageHandle, id.page);
-	if (rc != RC_OK) {
+	// The checkpoint counts replace those in the metadata if they are newer
+	if (walLastCheckpoint(tableMgmtData->wal, &tableMgmtData->checkpointPos)) {
+		if ((rc = walReadRecord(tableMgmtData->wal, tableMgmtData->checkpointPos, &header, &data)) != RC_OK)
+			return rc;
+		recovery.checkpoint = (RMCheckpoint *) data;
+		recovery.checkpointLsn = header.lsn;
+		if (recovery.checkpoint->infoLsn > tableMgmtData->infoLsn) {
+			tableMgmtData->numTuples = recovery.checkpoint->numTuples;
+			tableMgmtData->firstFreePageNumber = recovery.checkpoint->firstFreePageNumber;
+			tableMgmtData->infoLsn = recovery.checkpoint->infoLsn;
+		}
+		from = recovery.checkpoint->redoPos;
+	}
+
+	rc = walReplay(tableMgmtData->wal, from, collectChange, &recovery, &tableMgmtData->numRecovered);
+	if (rc == RC_OK) {
+		rc = redoChanges(&recovery);
+	} else {
+		for (int i = 0; i < recovery.numChanges; i++)
+			free(recovery.data[i]);
+	}
+	*crashed = (recovery.checkpoint != NULL || tableMgmtData->numRecovered > 0);
+	free(recovery.changes);
+	free(recovery.data);
+	free(data);
+	return rc;
+}
+
+/**
+ * Function: openTableHandle
+ * ------------------------
+ * Opens an existing table for operations, bypassing the handle cache.
+ * This function initializes the buffer pool for the table and takes the
+ * schema, options and indexes from the catalog cache. The counts are read
+ * from the metadata page, unless the table was closed since the catalog was
+ * read, which leaves them in the cache; opening it then reads no page.
+ * @param rel	Table data structure to be initialized
+ * @param name	Name of the table to open
+ * @param pool	Buffer pool of the table, NULL for its default in the catalog
+ * @return
+ *	-	RC_OK if table opening is successful
+ *	-	RC_RM_UNKNOWN_TABLE if the catalog has no such table
+ *	-	Other error codes if buffer pool initialization fails
+ */
+static RC openTableHandle(RM_TableData *rel, char *name, RM_PoolOptions *pool) {
+	RC rc = 0;
+	CatalogTable *entry;
+	bool poolOpen = FALSE;
+	int numOpened = 0;
+
+	// The schema, the options and the indexes come from the catalog cache
+	if ((rc = catalogOpenTable(name, &entry)) != RC_OK)
 		return rc;
+
+	// Allocate memory for table management data
+	Schema *schema = entry->schema;
+	RMTableMgmtData *tableMgmtData = (RMTableMgmtData *) malloc(sizeof(RMTableMgmtData));
+	rel->mgmtData = tableMgmtData;
+	rel->name = name;
+	rel->schema = schema;
+	entry->schema = NULL;
+
+	tableMgmtData->recordSize = getRecordSize(schema);
+	tableMgmtData->layout = entry->layout;
+	tableMgmtData->accessPath = RM_PATH_AUTO;
+	pthread_rwlock_init(&tableMgmtData->latch, NULL);
+	pthread_mutex_init(&tableMgmtData->dirtyLock, NULL);
+	tableMgmtData->activeScans = 0;
+	tableMgmtData->vacuumDaemon = NULL;
+	tableMgmtData->wal = NULL;
+	tableMgmtData->recLsn = NULL;
+	tableMgmtData->numRecLsn = 0;
+	tableMgmtData->numRecovered = 0;
+	tableMgmtData->zoneMap = NULL;
+	tableMgmtData->versions = NULL;
+	bool logged = entry->logged;
+	tableMgmtData->numIndexes = entry->numIndexes;
+	for (int i = 0; i < tableMgmtData->numIndexes; i++) {
+		RMIndex *index = &tableMgmtData->indexes[i];
+		index->attrNum = entry->indexes[i].attrNum;
+		index->type = entry->indexes[i].type;
+		index->unique = entry->indexes[i].unique;
 	}
 
-	// Update number of tuples
-	rmTableMgmtData->numTuples--;
+	// Initialize buffer pool for the table, sized for the whole table (and its metadata pages) if automatic
+	tableMgmtData->pool = reservePool((pool != NULL) ? pool : &entry->pool, entry->stats.numPages + 1);
+	if ((rc = initBufferPool(&tableMgmtData->bufferPool, name, tableMgmtData->pool.numPages, tableMgmtData->pool.strategy,
+			(tableMgmtData->pool.strategy == RS_LRU_K) ? &tableMgmtData->pool.strategyParam : NULL)) != RC_OK)
+		goto fail;
+	poolOpen = TRUE;
+
+	// The counts are cached if the table was closed since the catalog was read, otherwise page 1 holds them
+	if (entry->countsCached) {
+		tableMgmtData->numTuples = entry->stats.numTuples;
+		tableMgmtData->firstFreePageNumber = entry->stats.numPages + 1;
+		tableMgmtData->infoLsn = entry->infoLsn;
+	} else {
+		if ((rc = pinPage(&tableMgmtData->bufferPool, &tableMgmtData->pageHandle, 1)) != RC_OK)
+			goto fail;
+		RMMetaPage *meta = (RMMetaPage *) tableMgmtData->pageHandle.data;
+		tableMgmtData->numTuples = meta->numTuples;
+		tableMgmtData->firstFreePageNumber = meta->firstFreePageNumber;
+		tableMgmtData->infoLsn = meta->infoLsn;
+		if ((rc = unpinPage(&tableMgmtData->bufferPool, &tableMgmtData->pageHandle)) != RC_OK)
+			goto fail;
+	}
+	catalogFreeTable(entry);
+	entry = NULL;
+
+	// Redo the changes in the log, which were not all on disk if the table was not closed
+	bool crashed = FALSE;
+	if (logged) {
+		char *logName = logFileName(name);
+		rc = openWal(&tableMgmtData->wal, logName);
+		free(logName);
+		if (rc != RC_OK) {
+			tableMgmtData->wal = NULL;
+			goto fail;
+		}
+		tableMgmtData->checkpointPos = tableMgmtData->wal->startLsn;
+		setWriteHook(&tableMgmtData->bufferPool, forceLog, tableMgmtData);
+		if ((rc = recoverTable(rel, &crashed)) != RC_OK)
+			goto fail;
+	}
 
-	// Calculate record size and slot address
-	int recordSize = rmTableMgmtData->recordSize + 1;
-	char *data = rmTableMgmtData->pageHandle.data;
-	char *slotAddress = data + (id.slot * recordSize);
+	// Page summaries are built by the first scan reading a page, unless the table is empty
+	tableMgmtData->zoneMap = createZoneMap(schema);
+	tableMgmtData->versions = createVersionStore(tableMgmtData->recordSize);
+	if (tableMgmtData->numTuples == 0) {
+		for (int page = 2; page <= tableMgmtData->firstFreePageNumber; page++)
+			zoneSetState(tableMgmtData->zoneMap, page, ZONE_EMPTY);
+	}
 
-	// Set tombstone '$' for deleted record
-	*slotAddress = '$';
+	// Index files are not logged, so they are built again after a redo
+	for (; numOpened < tableMgmtData->numIndexes; numOpened++) {
+		RMIndex *index = &tableMgmtData->indexes[numOpened];
 
-	// Mark the page as dirty and unpin
-	rc = markDirty(&rmTableMgmtData->bufferPool, &rmTableMgmtData->pageHandle);
-	if (rc != RC_OK) {
-		unpinPage(&rmTableMgmtData->bufferPool, &rmTableMgmtData->pageHandle);
-		return rc;
+		if (crashed) {
+			deleteIndexFile(name, index->attrNum, index->type);
+			if ((rc = createIndexFile(rel, index)) == RC_OK && (rc = openIndex(name, index)) == RC_OK
+					&& (rc = buildIndex(rel, index)) != RC_OK)
+				closeIndex(index);
+		} else {
+			rc = openIndex(name, index);
+		}
+		if (rc != RC_OK)
+			goto fail;
 	}
 
-	rc = unpinPage(&rmTableMgmtData->bufferPool, &rmTableMgmtData->pageHandle);
+	// The redone changes are on disk now
+	if (!crashed || (rc = resetLog(rel)) == RC_OK)
+		return RC_OK;
+
+fail:
+	// Undo the steps that succeeded, newest first
+	for (int i = 0; i < numOpened; i++)
+		closeIndex(&tableMgmtData->indexes[i]);
+	if (poolOpen)
+		shutdownBufferPool(&tableMgmtData->bufferPool);
+	releasePool(&tableMgmtData->pool);
+	if (tableMgmtData->wal != NULL)
+		closeWal(tableMgmtData->wal);
+	if (tableMgmtData->zoneMap != NULL)
+		freeZoneMap(tableMgmtData->zoneMap);
+	if (tableMgmtData->versions != NULL)
+		freeVersionStore(tableMgmtData->versions);
+	free(tableMgmtData->recLsn);
+	pthread_mutex_destroy(&tableMgmtData->dirtyLock);
+	pthread_rwlock_destroy(&tableMgmtData->latch);
+	catalogFreeTable(entry);
+	freeSchema(schema);
+	free(tableMgmtData);
+	rel->mgmtData = NULL;
+	rel->schema = NULL;
 	return rc;
 }
 
 /**
- * Function: updateRecord
- * ---------------------
- * Updates an existing record in the table.
- * Pins the page where the record is located
- * Finds the slot in the page where the record is stored
- * Updates the record data at that location
- * Marks the page as dirty
- * Unpins the page
- *
- * @param rel	Table data structure
- * @param record	Record to be inserted
+ * Function: closeTableHandle
+ * -------------------------
+ * Closes an open table, writing back any updated metadata and shutting down the buffer pool.
+ * A step that fails does not stop the later ones, so the handle is always torn down.
+ * @param rel	Table data structure to be closed
  * @return
- *	-	RC_OK - If record insertion is successful
+ *	-	RC_OK if table closing is successful
+ *	-	The error of the first step that failed otherwise
  */
-RC updateRecord(RM_TableData *rel, Record *record) {
-	RMTableMgmtData *rmTableMgmtData = rel->mgmtData;
+static RC closeTableHandle(RM_TableData *rel) {
+	RC rc = RC_OK, stepRc;
+	RMTableMgmtData *tableMgmtData = rel->mgmtData;
 
-	// Pin the page containing the record
-	RC rc = pinPage(&rmTableMgmtData->bufferPool, &rmTableMgmtData->pageHandle, record->id.page);
-	if (rc != RC_OK) {
-		return rc;
+	// The background vacuum must not run on a closed table
+	stopVacuumDaemon(rel);
+
+	// Close the indexes; a step that fails does not stop the rest, the first error is returned
+	for (int i = 0; i < tableMgmtData->numIndexes; i++) {
+		if ((stepRc = closeIndex(&tableMgmtData->indexes[i])) != RC_OK && rc == RC_OK)
+			rc = stepRc;
 	}
 
-	// Calculate record size and data address
-	int recordSize = rmTableMgmtData->recordSize + 1;
-	char *data = rmTableMgmtData->pageHandle.data;
-	char *recordAddress = data + (record->id.slot * recordSize) + 1; // +1 to skip the marker
+	// Once all pages are on disk, the log is emptied
+	if (tableMgmtData->wal != NULL)
+		stepRc = resetLog(rel);
+	else
+		stepRc = writeTableInfo(tableMgmtData);
+	if (stepRc != RC_OK && rc == RC_OK)
+		rc = stepRc;
 
-	// Update record data
-	memcpy(recordAddress, record->data, recordSize - 1);
+	// Shutdown the buffer pool for the table
+	if ((stepRc = shutdownBufferPool(&tableMgmtData->bufferPool)) != RC_OK && rc == RC_OK)
+		rc = stepRc;
+	releasePool(&tableMgmtData->pool);
+
+	// The metadata page is on disk, the catalog keeps its counts for the next open
+	RM_TableStats stats = { tableMgmtData->numTuples, tableMgmtData->firstFreePageNumber - 1 };
+	if ((stepRc = catalogCloseTable(rel->name, &stats, tableMgmtData->infoLsn)) != RC_OK && rc == RC_OK)
+		rc = stepRc;
+
+	if (tableMgmtData->wal != NULL)
+		closeWal(tableMgmtData->wal);
+	freeZoneMap(tableMgmtData->zoneMap);
+	freeVersionStore(tableMgmtData->versions);
+	free(tableMgmtData->recLsn);
+	pthread_mutex_destroy(&tableMgmtData->dirtyLock);
+	pthread_rwlock_destroy(&tableMgmtData->latch);
+
+	// The handle owns its management data and the schema it took from the catalog
+	freeSchema(rel->schema);
+	free(tableMgmtData);
+	rel->mgmtData = NULL;
+	rel->schema = NULL;
+	return rc;
+}
 
-	// Mark the page as dirty
-	if ((rc = markDirty(&rmTableMgmtData->bufferPool, &rmTableMgmtData->pageHandle)) != RC_OK) {
-		unpinPage(&rmTableMgmtData->bufferPool, &rmTableMgmtData->pageHandle);
-		return rc;
+/*
+ * The handle cache. While it is on, handles opened on the same table share
+ * one open table, with its buffer pool and schema, and a table stays open
+ * after its last handle is closed. A background thread closes the idle
+ * tables beyond the limit, least recently used first, and those idle for too
+ * long. With the cache off (the default) every handle opens the table itself.
+ */
+typedef struct RMOpenTable {
+	RM_TableData table;	// The table as opened; the handles share its schema and management data
+	int refs;	// Open handles, 0 while the table is idle
+	bool busy;	// Being opened, flushed or closed; openTable and the cleaner wait for it
+	struct timespec idleSince;	// When the last handle was closed
+	struct RMOpenTable *next;	// Most recently opened first
+} RMOpenTable;
+
+static pthread_mutex_t openTablesLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t openTablesChanged = PTHREAD_COND_INITIALIZER;	// Signalled when a table becomes idle or stops being busy
+static RMOpenTable *openTables = NULL;
+static int maxIdleTables = 0;	// Idle tables kept open, 0 if the cache is off
+static int idleTableMillis = 0;	// Idle tables are closed after this long, 0 for no limit
+static bool cleanerRunning = FALSE;
+static pthread_t cleanerThread;
+
+/* Cached table of a name; openTablesLock held */
+static RMOpenTable *findOpenTable(char *name) {
+	RMOpenTable *entry;
+
+	for (entry = openTables; entry != NULL; entry = entry->next) {
+		if (strcmp(entry->table.name, name) == 0)
+			break;
+	}
+	return entry;
+}
+
+/* Unlinks a cached table and closes it; openTablesLock held, released while closing */
+static RC closeOpenTable(RMOpenTable *entry) {
+	RMOpenTable **link;
+	RC rc;
+
+	entry->busy = TRUE;
+	pthread_mutex_unlock(&openTablesLock);
+	rc = closeTableHandle(&entry->table);
+	pthread_mutex_lock(&openTablesLock);
+
+	for (link = &openTables; *link != entry; link = &(*link)->next)
+		;
+	*link = entry->next;
+	pthread_cond_broadcast(&openTablesChanged);
+	free(entry->table.name);
+	free(entry);
+	return rc;
+}
+
+/* Idle table the cleaner closes next, the one idle longest, NULL if none; openTablesLock held */
+static RMOpenTable *idleTableToClose(void) {
+	RMOpenTable *victim = NULL;
+	struct timespec now;
+	int numIdle = 0;
+
+	for (RMOpenTable *entry = openTables; entry != NULL; entry = entry->next) {
+		if (entry->refs > 0 || entry->busy)
+			continue;
+		numIdle++;
+		if (victim == NULL || entry->idleSince.tv_sec < victim->idleSince.tv_sec
+				|| (entry->idleSince.tv_sec == victim->idleSince.tv_sec && entry->idleSince.tv_nsec < victim->idleSince.tv_nsec))
+			victim = entry;
 	}
+	if (victim == NULL || numIdle > maxIdleTables)
+		return victim;
 
-	// Unpin the page
-	return unpinPage(&rmTableMgmtData->bufferPool, &rmTableMgmtData->pageHandle);
+	// Within the limit, the least recently used table is only closed once it timed out
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	long idleMillis = (now.tv_sec - victim->idleSince.tv_sec) * 1000 + (now.tv_nsec - victim->idleSince.tv_nsec) / 1000000;
+	return (idleTableMillis > 0 && idleMillis >= idleTableMillis) ? victim : NULL;
+}
+
+static void *tableCleaner(void *arg) {
+	struct timespec until;
+	int waitMillis;
+
+	pthread_mutex_lock(&openTablesLock);
+	while (cleanerRunning) {
+		RMOpenTable *entry = idleTableToClose();
+
+		if (entry != NULL) {
+			closeOpenTable(entry);
+			continue;
+		}
+
+		// Idle tables time out without anyone signalling
+		waitMillis = (idleTableMillis > 0 && idleTableMillis < 1000) ? idleTableMillis : 1000;
+		clock_gettime(CLOCK_REALTIME, &until);
+		until.tv_nsec += (long) waitMillis * 1000000;
+		until.tv_sec += until.tv_nsec / 1000000000;
+		until.tv_nsec %= 1000000000;
+		pthread_cond_timedwait(&openTablesChanged, &openTablesLock, &until);
+	}
+	pthread_mutex_unlock(&openTablesLock);
+	return NULL;
 }
 
 /**
- * Function: getRecord
+ * Function: openTable
  * ------------------
- * Retrieves a record from the table.
- * Validates the input parameters
- * Pins the page containing the record
- * Locates the record using the slot ID
- * Checks if the record exists (marked with "#")
- * Copies the record data to the provided record structure
- * Unpins the page
+ * Opens an existing table for operations, with the buffer pool the catalog
+ * has for it.
+ * @param rel	Table data structure to be initialized
+ * @param name	Name of the table to open
+ * @return
+ *	-	RC_OK if table opening is successful
+ *	-	RC_RM_UNKNOWN_TABLE if the catalog has no such table
+ *	-	Other error codes if buffer pool initialization fails
+ */
+RC openTable(RM_TableData *rel, char *name) {
+	return openTableWithOptions(rel, name, NULL);
+}
+
+/**
+ * Function: openTableWithOptions
+ * -----------------------------
+ * Opens an existing table for operations. While the handle cache is on, a
+ * table that is open already, or idle in the cache, is not opened again: the
+ * handle shares its buffer pool, schema and management data, and the pool
+ * options are not used.
+ * @param rel	Table data structure to be initialized
+ * @param name	Name of the table to open
+ * @param pool	Buffer pool of the table, NULL for its default in the catalog
+ * @return
+ *	-	RC_OK if table opening is successful
+ *	-	RC_INVALID_PARAM if the pool options are not valid
+ *	-	RC_RM_UNKNOWN_TABLE if the catalog has no such table
+ *	-	Other error codes if buffer pool initialization fails
+ */
+RC openTableWithOptions(RM_TableData *rel, char *name, RM_PoolOptions *pool) {
+	RMOpenTable *entry;
+	RC rc;
+
+	if (pool != NULL && !validPoolOptions(pool))
+		return RC_INVALID_PARAM;
+
+	pthread_mutex_lock(&openTablesLock);
+	while ((entry = findOpenTable(name)) != NULL && entry->busy)
+		pthread_cond_wait(&openTablesChanged, &openTablesLock);
+	if (entry != NULL) {
+		entry->refs++;
+		rel->name = name;
+		rel->schema = entry->table.schema;
+		rel->mgmtData = entry->table.mgmtData;
+		pthread_mutex_unlock(&openTablesLock);
+		return RC_OK;
+	}
+	if (maxIdleTables == 0) {
+		pthread_mutex_unlock(&openTablesLock);
+		return openTableHandle(rel, name, pool);
+	}
+
+	// Others opening the table wait for this to finish
+	entry = (RMOpenTable *) calloc(1, sizeof(RMOpenTable));
+	entry->table.name = strdup(name);
+	entry->refs = 1;
+	entry->busy = TRUE;
+	entry->next = openTables;
+	openTables = entry;
+	pthread_mutex_unlock(&openTablesLock);
+
+	rc = openTableHandle(&entry->table, entry->table.name, pool);
+
+	pthread_mutex_lock(&openTablesLock);
+	entry->busy = FALSE;
+	if (rc == RC_OK) {
+		rel->name = name;
+		rel->schema = entry->table.schema;
+		rel->mgmtData = entry->table.mgmtData;
+	} else {
+		RMOpenTable **link;
+
+		for (link = &openTables; *link != entry; link = &(*link)->next)
+			;
+		*link = entry->next;
+		free(entry->table.name);
+		free(entry);
+	}
+	pthread_cond_broadcast(&openTablesChanged);
+	pthread_mutex_unlock(&openTablesLock);
+	return rc;
+}
+
+/**
+ * Function: closeTable
+ * -------------------
+ * Closes a table handle. A table shared with other handles stays open. While
+ * the handle cache is on, the last handle leaves the table idle: its pages
+ * and metadata are written back as on a close, and the cache closes it later.
+ * @param rel	Table data structure to be closed
+ * @return
+ *	-	RC_OK if table closing is successful
+ *	-	Other error codes if buffer pool shutdown fails
+ */
+RC closeTable(RM_TableData *rel) {
+	RMOpenTable *entry;
+	RC rc = RC_OK;
+
+	pthread_mutex_lock(&openTablesLock);
+	for (entry = openTables; entry != NULL; entry = entry->next) {
+		if (!entry->busy && entry->table.mgmtData == rel->mgmtData)
+			break;
+	}
+	if (entry == NULL) {
+		pthread_mutex_unlock(&openTablesLock);
+		return closeTableHandle(rel);
+	}
+	rel->mgmtData = NULL;
+	if (--entry->refs > 0) {
+		pthread_mutex_unlock(&openTablesLock);
+		return RC_OK;
+	}
+	if (maxIdleTables == 0) {
+		rc = closeOpenTable(entry);
+		pthread_mutex_unlock(&openTablesLock);
+		return rc;
+	}
+
+	// The idle table is on disk as after a close; a logged table has its changes in the log
+	RMTableMgmtData *tmt = (RMTableMgmtData *) entry->table.mgmtData;
+	entry->busy = TRUE;
+	pthread_mutex_unlock(&openTablesLock);
+	stopVacuumDaemon(&entry->table);
+	if (tmt->wal == NULL && (rc = writeTableInfo(tmt)) == RC_OK)
+		rc = forceFlushPool(&tmt->bufferPool);
+
+	pthread_mutex_lock(&openTablesLock);
+	entry->busy = FALSE;
+	clock_gettime(CLOCK_MONOTONIC, &entry->idleSince);
+	pthread_cond_broadcast(&openTablesChanged);
+	pthread_mutex_unlock(&openTablesLock);
+	return rc;
+}
+
+/**
+ * Function: setTableCache
+ * ----------------------
+ * Turns the handle cache on or off. Tables left idle by their last handle stay
+ * open until more than maxIdleTables are idle, or until they have been idle
+ * for idleMillis; a background thread closes them. Turning the cache off
+ * closes the idle tables. Must not be called concurrently with itself.
+ *
+ * @param maxIdle	Idle tables kept open, 0 to turn the cache off
+ * @param idleMillis	Milliseconds after which an idle table is closed, 0 for no limit
+ * @return
+ *	-	RC_OK
+ *	-	RC_INVALID_PARAM if a limit is negative
+ */
+RC setTableCache(int maxIdle, int idleMillis) {
+	RMOpenTable *entry;
+
+	if (maxIdle < 0 || idleMillis < 0)
+		return RC_INVALID_PARAM;
+
+	pthread_mutex_lock(&openTablesLock);
+	maxIdleTables = maxIdle;
+	idleTableMillis = idleMillis;
+	if (maxIdle > 0 && !cleanerRunning) {
+		cleanerRunning = TRUE;
+		pthread_create(&cleanerThread, NULL, tableCleaner, NULL);
+	} else if (maxIdle == 0 && cleanerRunning) {
+		cleanerRunning = FALSE;
+		pthread_cond_broadcast(&openTablesChanged);
+		pthread_mutex_unlock(&openTablesLock);
+		pthread_join(cleanerThread, NULL);
+		pthread_mutex_lock(&openTablesLock);
+	}
+
+	// The cleaner applies new limits; with the cache off the idle tables are closed here
+	pthread_cond_broadcast(&openTablesChanged);
+	while (maxIdle == 0) {
+		for (entry = openTables; entry != NULL; entry = entry->next) {
+			if (entry->refs == 0 && !entry->busy)
+				break;
+		}
+		if (entry == NULL)
+			break;
+		closeOpenTable(entry);
+	}
+	pthread_mutex_unlock(&openTablesLock);
+	return RC_OK;
+}
+
+/* Number of tables in the handle cache, open or idle */
+int getNumCachedTables(void) {
+	int count = 0;
+
+	pthread_mutex_lock(&openTablesLock);
+	for (RMOpenTable *entry = openTables; entry != NULL; entry = entry->next)
+		count++;
+	pthread_mutex_unlock(&openTablesLock);
+	return count;
+}
+
+/**
+ * Function: deleteTable
+ * --------------------
+ * Deletes a table and its associated page file.
+ * This function removes the page file that stores the table data, the
+ * page files of the table's indexes and its catalog entries.
+ *
+ * @param name	Name of the table to delete
+ * @return
+ *	-	RC_OK if table (page) deletion is successful
+ *	-	RC_RM_UNKNOWN_TABLE if the catalog has no such table
+ *	-	RC_RM_TABLE_IN_USE if a handle of the table is open in the handle cache
+ *	-	Other error codes if destroyPageFile fails
+ */
+RC deleteTable(char *name) {
+	RMOpenTable *open;
+	CatalogTable *entry;
+	RC rc = RC_OK;
+
+	// A table idle in the handle cache is closed first
+	pthread_mutex_lock(&openTablesLock);
+	while ((open = findOpenTable(name)) != NULL && open->busy)
+		pthread_cond_wait(&openTablesChanged, &openTablesLock);
+	if (open != NULL)
+		rc = (open->refs > 0) ? RC_RM_TABLE_IN_USE : closeOpenTable(open);
+	pthread_mutex_unlock(&openTablesLock);
+	if (rc != RC_OK)
+		return rc;
+
+	// Destroy the index files listed in the catalog
+	if ((rc = catalogGetTable(name, &entry)) != RC_OK)
+		return rc;
+	for (int i = 0; i < entry->numIndexes; i++)
+		deleteIndexFile(name, entry->indexes[i].attrNum, entry->indexes[i].type);
+
+	// And the log, if the table is logged
+	if (entry->logged) {
+		char *logName = logFileName(name);
+		deleteWal(logName);
+		free(logName);
+	}
+	catalogFreeTable(entry);
+
+	// Destroy the page file associated with the table
+	if ((rc = destroyPageFile(name)) != RC_OK)
+		return rc;
+	return catalogDropTable(name);
+}
+
+/**
+ * Function: getNumTuples
+ * ---------------------
+ * Returns the total number of records present in the table.
+ * This value is fetched from the table management data.
+ *
+ * @param rel	Table data structure
+ * @return
+ *	-	The number of tuples (records) in the table
+ */
+int getNumTuples(RM_TableData *rel) {
+
+	RMTableMgmtData *rmTableMgmtData = rel->mgmtData;
+	return rmTableMgmtData->numTuples;
+}
+
+/**
+ * Function: getNumLogSyncs
+ * -----------------------
+ * Returns how often the log of a logged table was synced since it was opened.
+ * Operations committing concurrently share a sync, so this can be lower than
+ * the number of changes.
+ *
+ * @param rel	Table data structure
+ * @return
+ *	-	The number of log syncs, 0 if the table is not logged
+ */
+int getNumLogSyncs(RM_TableData *rel) {
+	RMTableMgmtData *rmTableMgmtData = rel->mgmtData;
+	return (rmTableMgmtData->wal != NULL) ? getWalSyncs(rmTableMgmtData->wal) : 0;
+}
+
+/**
+ * Function: checkpointTable
+ * ------------------------
+ * Takes a checkpoint of a logged table, so that opening it after a crash
+ * only reads the log from the oldest change that may not be on disk.
+ * Changes take one on their own every RM_CHECKPOINT_INTERVAL bytes of log.
+ * Does nothing for tables that are not logged.
+ *
+ * @param rel	Table data structure
+ * @return
+ *	-	RC_OK if the checkpoint was taken
+ *	-	Errors of the buffer manager and of the log otherwise
+ */
+RC checkpointTable(RM_TableData *rel) {
+	RMTableMgmtData *tmt = (RMTableMgmtData *) rel->mgmtData;
+	RC rc = RC_OK;
+
+	pthread_rwlock_wrlock(&tmt->latch);
+	if (tmt->wal != NULL)
+		rc = writeCheckpoint(rel);
+	pthread_rwlock_unlock(&tmt->latch);
+	return rc;
+}
+
+/**
+ * Function: getNumRecoveredChanges
+ * -------------------------------
+ * Returns how many log records openTable read to recover the table.
+ *
+ * @param rel	Table data structure
+ * @return
+ *	-	The number of log records read, 0 if the table was closed or is not logged
+ */
+int getNumRecoveredChanges(RM_TableData *rel) {
+	RMTableMgmtData *rmTableMgmtData = rel->mgmtData;
+	return rmTableMgmtData->numRecovered;
+}
+
+/* Pages the buffer pool of an open table has read from disk */
+int getNumPageReads(RM_TableData *rel) {
+	RMTableMgmtData *rmTableMgmtData = rel->mgmtData;
+	return getNumReadIO(&rmTableMgmtData->bufferPool);
+}
+
+/* Frames and strategy of the buffer pool of an open table, as openTable chose them */
+RC getPoolOptions(RM_TableData *rel, RM_PoolOptions *pool) {
+	RMTableMgmtData *rmTableMgmtData = rel->mgmtData;
+	*pool = rmTableMgmtData->pool;
+	return RC_OK;
+}
+
+/**
+ * Function: setTablePoolOptions
+ * ----------------------------
+ * Changes the buffer pool the catalog keeps for a table, which openTable
+ * uses from the next time the table is opened.
+ * @param name	Name of the table
+ * @param pool	Its new default buffer pool
+ * @return
+ *	-	RC_OK if the catalog holds the new options
+ *	-	RC_INVALID_PARAM if the options are not valid
+ *	-	RC_RM_UNKNOWN_TABLE if the catalog has no such table
+ */
+RC setTablePoolOptions(char *name, RM_PoolOptions *pool) {
+	if (!validPoolOptions(pool))
+		return RC_INVALID_PARAM;
+	return catalogSetPool(name, pool);
+}
+
+/**
+ * Function: listTables
+ * -------------------
+ * Lists the tables in the catalog.
+ *
+ * @param names	Set to an array of the table names; the caller frees each name and the array
+ * @param numTables	Set to the number of tables
+ * @return
+ *	-	RC_OK if the catalog could be read
+ */
+RC listTables(char ***names, int *numTables) {
+	return catalogListTables(names, numTables);
+}
+
+/* Schema of a table from the catalog, to be freed with freeSchema */
+RC getTableSchema(char *name, Schema **schema) {
+	CatalogTable *entry;
+	RC rc;
+
+	if ((rc = catalogGetTable(name, &entry)) != RC_OK)
+		return rc;
+	*schema = entry->schema;
+	entry->schema = NULL;
+	catalogFreeTable(entry);
+	return RC_OK;
+}
+
+/* Indexes of a table from the catalog; the caller frees the array */
+RC getTableIndexes(char *name, RM_IndexInfo **indexes, int *numIndexes) {
+	CatalogTable *entry;
+	RC rc;
+
+	if ((rc = catalogGetTable(name, &entry)) != RC_OK)
+		return rc;
+	*indexes = entry->indexes;
+	*numIndexes = entry->numIndexes;
+	entry->indexes = NULL;
+	catalogFreeTable(entry);
+	return RC_OK;
+}
+
+/* Statistics of a table from the catalog, as of its last close */
+RC getTableStats(char *name, RM_TableStats *stats) {
+	CatalogTable *entry;
+	RC rc;
+
+	if ((rc = catalogGetTable(name, &entry)) != RC_OK)
+		return rc;
+	*stats = entry->stats;
+	catalogFreeTable(entry);
+	return RC_OK;
+}
+
+/**
+ * Function: createIndex
+ * ---------------------
+ * Creates an index on one attribute of an open table and adds the existing
+ * records to it. The index is stored in the page file "<table>.idx<attrNum>"
+ * and listed in the catalog, so openTable opens it again; from then
+ * on insertRecord, deleteRecord and updateRecord keep it up to date.
+ * A hash index can also cover the key attributes of the schema together
+ * (attrNum RM_PRIMARY_KEY, stored in "<table>.idxpk").
+ *
+ * @param rel	Table data structure
+ * @param attrNum	Attribute to index, or RM_PRIMARY_KEY
+ * @param type	Index structure
+ * @param unique	TRUE if no two records may share a key
+ * @return
+ *	-	RC_OK if the index has been created
+ *	-	RC_INVALID_PARAM if the attribute, type or number of indexes is invalid
+ *	-	RC_IM_KEY_ALREADY_EXISTS if unique and two records share a key
+ */
+RC createIndex(RM_TableData *rel, int attrNum, RM_IndexType type, bool unique) {
+	RMTableMgmtData *tableMgmtData = rel->mgmtData;
+	Schema *schema = rel->schema;
+	RC rc;
+
+	if (type == RM_INDEX_BTREE && (attrNum < 0 || attrNum >= schema->numAttr))
+		return RC_INVALID_PARAM;
+	if (type == RM_INDEX_HASH && (attrNum < RM_PRIMARY_KEY || attrNum >= schema->numAttr
+			|| (attrNum == RM_PRIMARY_KEY && schema->keySize <= 0)))
+		return RC_INVALID_PARAM;
+	if (type != RM_INDEX_BTREE && type != RM_INDEX_HASH)
+		return RC_INVALID_PARAM;
+	if (findIndex(tableMgmtData, attrNum) != NULL || tableMgmtData->numIndexes == RM_MAX_INDEXES)
+		return RC_INVALID_PARAM;
+
+	RMIndex *index = &tableMgmtData->indexes[tableMgmtData->numIndexes];
+	index->attrNum = attrNum;
+	index->type = type;
+	index->unique = unique;
+
+	// Create the index file and fill it with the existing records
+	rc = createIndexFile(rel, index);
+	if (rc == RC_OK && (rc = openIndex(rel->name, index)) == RC_OK) {
+		if ((rc = buildIndex(rel, index)) != RC_OK) {
+			closeIndex(index);
+			deleteIndexFile(rel->name, attrNum, type);
+		}
+	}
+	if (rc != RC_OK)
+		return rc;
+
+	tableMgmtData->numIndexes++;
+	return writeIndexList(rel);
+}
+
+/**
+ * Function: dropIndex
+ * -------------------
+ * Removes the index on an attribute and deletes its page file.
+ *
+ * @param rel	Table data structure
+ * @param attrNum	Indexed attribute
+ * @return
+ *	-	RC_OK if the index has been removed
+ *	-	RC_INVALID_PARAM if there is no index on the attribute
+ */
+RC dropIndex(RM_TableData *rel, int attrNum) {
+	RMTableMgmtData *tableMgmtData = rel->mgmtData;
+	RMIndex *index = findIndex(tableMgmtData, attrNum);
+	RC rc;
+
+	if (index == NULL)
+		return RC_INVALID_PARAM;
+	if ((rc = closeIndex(index)) != RC_OK)
+		return rc;
+	rc = deleteIndexFile(rel->name, attrNum, index->type);
+
+	// Keep the remaining indexes in order
+	int pos = index - tableMgmtData->indexes;
+	memmove(index, index + 1, sizeof(RMIndex) * (tableMgmtData->numIndexes - pos - 1));
+	tableMgmtData->numIndexes--;
+
+	if (rc != RC_OK)
+		return rc;
+	return writeIndexList(rel);
+}
+
+static RC readRecord(RM_TableData *rel, RID id, Record *record);
+static RC openIndexScan(RM_TableData *rel, RMIndexScan *indexScan);
+static RC openKeyScan(RM_TableData *rel, RMIndexScan *indexScan, char *data);
+static RC nextIndexRid(RMIndexScan *indexScan, RID *rid);
+static RC closeIndexScan(RMIndexScan *indexScan);
+static RC readVisible(RM_TableData *rel, RM_Transaction *tx, RID id, Record *record);
+static RC writeRecord(RM_TableData *rel, RM_Transaction *tx, RMWriteOp op, Record *record, RID id);
+
+/*
+ * TRUE if an index entry for the key of data leads to a record whose last committed version has that
+ * key, rather than to an uncommitted insert or change; table latch held
+ */
+static bool entryCommitted(RM_TableData *rel, RMIndex *index, RID rid, char *data) {
+	RMTableMgmtData *tmt = (RMTableMgmtData *) rel->mgmtData;
+	MvccChain *chain = findVersions(tmt->versions, rid);
+	MvccVersion *version;
+
+	if (chain == NULL)
+		return TRUE;
+	version = visibleVersion(chain, NULL, mvccCurrentTs());
+	return version->data != NULL && !keyChanged(rel->schema, index, version->data, data);
+}
+
+/**
+ * Function: lookupRecord
+ * ----------------------
+ * Finds a record by the key of an indexed attribute. If several records share
+ * the key, a B+-tree returns the one with the smallest RID, a hash index the
+ * first one in its bucket.
+ *
+ * @param rel	Table data structure
+ * @param attrNum	Indexed attribute, or RM_PRIMARY_KEY
+ * @param key	Key to look up; for RM_PRIMARY_KEY an array with one value per key attribute
+ * @param record	Filled with the record found
+ * @return
+ *	-	RC_OK if a record has been found
+ *	-	RC_IM_KEY_NOT_FOUND if no record has the key
+ *	-	RC_INVALID_PARAM if there is no index on the attribute
+ *	-	RC_RM_WRONG_DATATYPE if a key value has the wrong type
+ */
+RC lookupRecord(RM_TableData *rel, int attrNum, Value *key, Record *record) {
+	RMIndex *index = findIndex(rel->mgmtData, attrNum);
+	RMIndexScan indexScan;
+	Record probe;
+	int *attrs, n;
+	RID rid;
+	RC rc;
+
+	if (index == NULL)
+		return RC_INVALID_PARAM;
+
+	// Lay out the key values like a record, so that the key is taken from it as on insert
+	n = indexAttrs(rel->schema, index, &attrs);
+	for (int i = 0; i < n; i++) {
+		if (key[i].dt != rel->schema->dataTypes[attrs[i]])
+			return RC_RM_WRONG_DATATYPE;
+	}
+	probe.data = (char *) calloc(1, getRecordSize(rel->schema));
+	for (int i = 0; i < n; i++)
+		setAttr(&probe, rel->schema, attrs[i], &key[i]);
+
+	// Vacuuming moves records and their index entries
+	memset(&indexScan, 0, sizeof(RMIndexScan));
+	indexScan.index = index;
+	pthread_rwlock_wrlock(&((RMTableMgmtData *) rel->mgmtData)->latch);
+	if ((rc = openKeyScan(rel, &indexScan, probe.data)) == RC_OK) {
+		while ((rc = nextIndexRid(&indexScan, &rid)) == RC_OK) {
+			if (entryCommitted(rel, index, rid, probe.data)) {
+				rc = readVisible(rel, NULL, rid, record);
+				break;
+			}
+		}
+		closeIndexScan(&indexScan);
+		if (rc == RC_IM_NO_MORE_ENTRIES)
+			rc = RC_IM_KEY_NOT_FOUND;
+	}
+	pthread_rwlock_unlock(&((RMTableMgmtData *) rel->mgmtData)->latch);
+	free(probe.data);
+	return rc;
+}
+
+/**
+ * Function: lookupRecords
+ * -----------------------
+ * Finds the RIDs of all records with a key of an indexed attribute, so that
+ * callers can fetch them together with getRecords.
+ *
+ * @param rel	Table data structure
+ * @param attrNum	Attribute with an index of its own
+ * @param key	Key to look up
+ * @param ids	Set to the RIDs found, allocated with malloc; the caller frees it
+ * @param numIds	Set to their number, 0 if no record has the key
+ * @return
+ *	-	RC_OK if the index was searched
+ *	-	RC_INVALID_PARAM if there is no index on the attribute
+ *	-	RC_RM_WRONG_DATATYPE if the key has the wrong type
+ */
+RC lookupRecords(RM_TableData *rel, int attrNum, Value *key, RID **ids, int *numIds) {
+	RMTableMgmtData *tmt = (RMTableMgmtData *) rel->mgmtData;
+	RMIndex *index = (attrNum == RM_PRIMARY_KEY) ? NULL : findIndex(tmt, attrNum);
+	RMIndexScan indexScan;
+	Record probe;
+	int capacity = 8;
+	RID rid;
+	RC rc;
+
+	*ids = NULL;
+	*numIds = 0;
+	if (index == NULL)
+		return RC_INVALID_PARAM;
+	if (key->dt != rel->schema->dataTypes[attrNum])
+		return RC_RM_WRONG_DATATYPE;
+
+	memset(&indexScan, 0, sizeof(RMIndexScan));
+	indexScan.index = index;
+	probe.data = (char *) calloc(1, getRecordSize(rel->schema));
+	setAttr(&probe, rel->schema, attrNum, key);
+	*ids = (RID *) malloc(capacity * sizeof(RID));
+
+	// Vacuuming moves records and their index entries
+	pthread_rwlock_wrlock(&tmt->latch);
+	if ((rc = openKeyScan(rel, &indexScan, probe.data)) == RC_OK) {
+		while ((rc = nextIndexRid(&indexScan, &rid)) == RC_OK) {
+			if (!entryCommitted(rel, index, rid, probe.data))
+				continue;
+			if (*numIds == capacity) {
+				capacity *= 2;
+				*ids = (RID *) realloc(*ids, capacity * sizeof(RID));
+			}
+			(*ids)[(*numIds)++] = rid;
+		}
+		closeIndexScan(&indexScan);
+		if (rc == RC_IM_NO_MORE_ENTRIES)
+			rc = RC_OK;
+	}
+	pthread_rwlock_unlock(&tmt->latch);
+	free(probe.data);
+
+	if (rc != RC_OK) {
+		free(*ids);
+		*ids = NULL;
+		*numIds = 0;
+	}
+	return rc;
+}
+
+/* Whether a free slot may get its record back because the transaction that deleted it has not committed */
+static bool slotPending(RMTableMgmtData *tableMgmtData, int page, int slot) {
+	RID rid = { page, slot };
+	MvccChain *chain = findVersions(tableMgmtData->versions, rid);
+
+	return chain != NULL && chain->head->writer != NULL;
+}
+
+/* insertRecord with the table latch held; lsn is set to the LSN to commit if the table is logged */
+static RC insertSlot(RM_TableData *rel, Record *record, WalLsn *lsn) {
+    RMTableMgmtData *tableMgmtData = rel->mgmtData;
+    RID *rid = &record->id;
+    int lastUsedPage = tableMgmtData->firstFreePageNumber;
+
+    // Keys of unique indexes must not exist yet
+    RC rc = checkUniqueKeys(rel, record->data, NULL);
+    if (rc != RC_OK) {
+        return rc;
+    }
+
+    rid->page = tableMgmtData->firstFreePageNumber;
+    rid->slot = -1;
+
+    // Pin the first free page
+    rc = pinPage(&tableMgmtData->bufferPool, &tableMgmtData->pageHandle, rid->page);
+    if (rc != RC_OK) {
+        return rc;
+    }
+
+    char *data = tableMgmtData->pageHandle.data;
+
+    // Calculate total slots per page
+    int totalSlots = slotsPerPage(tableMgmtData);
+
+    // Find a free slot in the current page
+    for (int i = 0; i < totalSlots; i++) {
+        if (*slotMarker(tableMgmtData, data, i) != '#' && !slotPending(tableMgmtData, rid->page, i)) {
+            rid->slot = i;
+            break;
+        }
+    }
+
+    // If no free slot found in current page, search in subsequent pages
+    while (rid->slot == -1) {
+        unpinPage(&tableMgmtData->bufferPool, &tableMgmtData->pageHandle);
+        rid->page++; // Increment page number
+
+        rc = pinPage(&tableMgmtData->bufferPool, &tableMgmtData->pageHandle, rid->page);
+        if (rc != RC_OK) {
+            return rc;
+        }
+
+        data = tableMgmtData->pageHandle.data;
+
+        for (int i = 0; i < totalSlots; i++) {
+            if (*slotMarker(tableMgmtData, data, i) != '#' && !slotPending(tableMgmtData, rid->page, i)) {
+                tableMgmtData->firstFreePageNumber = rid->page;
+                rid->slot = i;
+                break;
+            }
+        }
+    }
+
+    // Add the record to the indexes first, so that an index error leaves no logged record behind
+    rc = updateIndexes(rel, record->data, *rid, TRUE, NULL);
+    if (rc != RC_OK) {
+        unpinPage(&tableMgmtData->bufferPool, &tableMgmtData->pageHandle);
+        return rc;
+    }
+
+    // Mark the page as dirty and log the change while the page cannot be written back;
+    // an insert that cannot be logged does not happen, so its index entries are taken out
+    rc = markDirty(&tableMgmtData->bufferPool, &tableMgmtData->pageHandle);
+    if (rc == RC_OK)
+        rc = logChange(rel, WAL_INSERT, *rid, record->data, data, lsn);
+    if (rc != RC_OK) {
+        updateIndexes(rel, record->data, *rid, FALSE, NULL);
+        unpinPage(&tableMgmtData->bufferPool, &tableMgmtData->pageHandle);
+        return rc;
+    }
+
+    // Write record to the slot
+    *slotMarker(tableMgmtData, data, rid->slot) = '#'; // Mark slot as occupied
+    writeSlot(rel, data, rid->slot, record->data);
+
+    // Pages past the last used one have never held a record
+    if (rid->page > lastUsedPage)
+        zoneSetState(tableMgmtData->zoneMap, rid->page, ZONE_EMPTY);
+    zoneAddRecord(tableMgmtData->zoneMap, rid->page, record->data);
+
+    // Unpin the page
+    rc = unpinPage(&tableMgmtData->bufferPool, &tableMgmtData->pageHandle);
+    if (rc != RC_OK) {
+        return rc;
+    }
+
+    // Update tuple count and record ID
+    tableMgmtData->numTuples++;
+    record->id = *rid;
+    return RC_OK;
+}
+
+/**
+ * Function: insertRecord
+ * ---------------------
+ * Inserts a new record into the table.
+ * Pins the first free page where records can be inserted
+ * Checks if there is enough space in this page to insert the record
+ * If not, it moves to the next page to find a free slot
+ * Writes the new record at the free slot and updates RID information
+ * Marks the page as dirty
+ * Unpins the page
+ * Increments the number of tuples
+ * Adds the record's keys to the table's indexes
+ *
+ * @param rel	Table data structure
+ * @param record	Record to be inserted
+ * @return
+ *	-	RC_OK - If record insertion is successful
+ *	-	RC_IM_KEY_ALREADY_EXISTS - If a unique index already has the record's key
+ */
+RC insertRecord(RM_TableData *rel, Record *record) {
+	return writeRecord(rel, NULL, RM_WRITE_INSERT, record, record->id);
+}
+
+/*
+ * Deletes the record of a slot of a pinned page; old is its data, which the indexes need, kept the
+ * committed version whose index entries stay (see moveIndexEntries); table latch held
+ */
+static RC deleteInPage(RM_TableData *rel, char *page, RID id, char *old, char *kept, WalLsn *lsn) {
+	RMTableMgmtData *rmTableMgmtData = rel->mgmtData;
+	RC rc;
+
+	// Remove the record from the indexes
+	if (rmTableMgmtData->numIndexes > 0 && (rc = moveIndexEntries(rel, id, old, NULL, kept)) != RC_OK) {
+		return rc;
+	}
+
+	// A delete that cannot be logged does not happen, so its index entries are put back
+	if ((rc = logChange(rel, WAL_DELETE, id, NULL, page, lsn)) != RC_OK) {
+		if (rmTableMgmtData->numIndexes > 0)
+			moveIndexEntries(rel, id, NULL, old, kept);
+		return rc;
+	}
+
+	// Update number of tuples
+	rmTableMgmtData->numTuples--;
+
+	// Set tombstone '$' for deleted record (the page's zone map ranges are left as they are)
+	*slotMarker(rmTableMgmtData, page, id.slot) = '$';
+	return RC_OK;
+}
+
+/* deleteRecord with the table latch held; kept as for deleteInPage */
+static RC deleteSlot(RM_TableData *rel, RID id, char *kept, WalLsn *lsn) {
+	RMTableMgmtData *rmTableMgmtData = rel->mgmtData;
+	char *old = NULL;
+
+	// Pin the page containing the record
+	RC rc = pinPage(&rmTableMgmtData->bufferPool, &rmTableMgmtData->pageHandle, id.page);
+	if (rc != RC_OK) {
+		return rc;
+	}
+
+	if (*slotMarker(rmTableMgmtData, rmTableMgmtData->pageHandle.data, id.slot) != '#') {
+		unpinPage(&rmTableMgmtData->bufferPool, &rmTableMgmtData->pageHandle);
+		return RC_RM_RECORD_NOT_FOUND;
+	}
+
+	if (rmTableMgmtData->numIndexes > 0) {
+		old = (char *) malloc(rel->schema->attrOffsets[rel->schema->numAttr]);
+		readSlot(rel, rmTableMgmtData->pageHandle.data, id.slot, old);
+	}
+	rc = deleteInPage(rel, rmTableMgmtData->pageHandle.data, id, old, kept, lsn);
+	free(old);
+	if (rc != RC_OK) {
+		unpinPage(&rmTableMgmtData->bufferPool, &rmTableMgmtData->pageHandle);
+		return rc;
+	}
+
+	// Mark the page as dirty and unpin
+	rc = markDirty(&rmTableMgmtData->bufferPool, &rmTableMgmtData->pageHandle);
+	if (rc != RC_OK) {
+		unpinPage(&rmTableMgmtData->bufferPool, &rmTableMgmtData->pageHandle);
+		return rc;
+	}
+
+	rc = unpinPage(&rmTableMgmtData->bufferPool, &rmTableMgmtData->pageHandle);
+	return rc;
+}
+
+/**
+ * Function: deleteRecord
+ * ---------------------
+ * Deletes a record from the table.
+ * Pins the page where records is located
+ * Marks the record as deleted by replacing "#" with "$" (tombstone)
+ * Removes the record's keys from the table's indexes
+ * Decrements the number of tuples
+ * Marks the page as dirty
+ * Unpins the page
+ *
+ * @param rel	Table data structure
+ * @param id	Record to be inserted
+ * @return
+ *	-	RC_OK - If record deletion is successful
+ *	-	RC_RM_RECORD_NOT_FOUND - If the slot holds no record
+ *	-	RC_RM_WRITE_CONFLICT - If an uncommitted transaction changed the record
+ */
+RC deleteRecord(RM_TableData *rel, RID id) {
+	return writeRecord(rel, NULL, RM_WRITE_DELETE, NULL, id);
+}
+
+/*
+ * Writes the new data of a record into its slot of a pinned page; old is the data it replaces, kept
+ * the committed version whose index entries stay (see moveIndexEntries); table latch held
+ */
+static RC updateInPage(RM_TableData *rel, char *page, Record *record, char *old, char *kept, WalLsn *lsn) {
+	RMTableMgmtData *rmTableMgmtData = rel->mgmtData;
+	RC rc;
+
+	// Move the index entries of changed keys
+	if (rmTableMgmtData->numIndexes > 0) {
+		rc = checkUniqueKeys(rel, record->data, &record->id);
+		if (rc == RC_OK)
+			rc = moveIndexEntries(rel, record->id, old, record->data, kept);
+		if (rc != RC_OK) {
+			return rc;
+		}
+	}
+
+	// An update that cannot be logged does not happen, so its index entries are moved back
+	if ((rc = logChange(rel, WAL_UPDATE, record->id, record->data, page, lsn)) != RC_OK) {
+		if (rmTableMgmtData->numIndexes > 0)
+			moveIndexEntries(rel, record->id, record->data, old, kept);
+		return rc;
+	}
+
+	// Update record data and widen the page's zone map ranges
+	writeSlot(rel, page, record->id.slot, record->data);
+	zoneAddRecord(rmTableMgmtData->zoneMap, record->id.page, record->data);
+	return RC_OK;
+}
+
+/* updateRecord with the table latch held; kept as for updateInPage */
+static RC updateSlot(RM_TableData *rel, Record *record, char *kept, WalLsn *lsn) {
+	RMTableMgmtData *rmTableMgmtData = rel->mgmtData;
+	char *old = NULL;
+
+	// Pin the page containing the record
+	RC rc = pinPage(&rmTableMgmtData->bufferPool, &rmTableMgmtData->pageHandle, record->id.page);
+	if (rc != RC_OK) {
+		return rc;
+	}
+
+	// A free slot has no record to update; writing it would bring a deleted record back
+	if (*slotMarker(rmTableMgmtData, rmTableMgmtData->pageHandle.data, record->id.slot) != '#') {
+		unpinPage(&rmTableMgmtData->bufferPool, &rmTableMgmtData->pageHandle);
+		return RC_TUPLE_WIT_RID_ON_EXISTING;
+	}
+
+	if (rmTableMgmtData->numIndexes > 0) {
+		old = (char *) malloc(rel->schema->attrOffsets[rel->schema->numAttr]);
+		readSlot(rel, rmTableMgmtData->pageHandle.data, record->id.slot, old);
+	}
+	rc = updateInPage(rel, rmTableMgmtData->pageHandle.data, record, old, kept, lsn);
+	free(old);
+	if (rc != RC_OK) {
+		unpinPage(&rmTableMgmtData->bufferPool, &rmTableMgmtData->pageHandle);
+		return rc;
+	}
+
+	// Mark the page as dirty
+	if ((rc = markDirty(&rmTableMgmtData->bufferPool, &rmTableMgmtData->pageHandle)) != RC_OK) {
+		unpinPage(&rmTableMgmtData->bufferPool, &rmTableMgmtData->pageHandle);
+		return rc;
+	}
+
+	// Unpin the page
+	return unpinPage(&rmTableMgmtData->bufferPool, &rmTableMgmtData->pageHandle);
+}
+
+/**
+ * Function: updateRecord
+ * ---------------------
+ * Updates an existing record in the table.
+ * Pins the page where the record is located
+ * Finds the slot in the page where the record is stored
+ * Moves the index entries of attributes whose value changes
+ * Updates the record data at that location
+ * Marks the page as dirty
+ * Unpins the page
+ *
+ * @param rel	Table data structure
+ * @param record	Record to be inserted
+ * @return
+ *	-	RC_OK - If record insertion is successful
+ *	-	RC_TUPLE_WIT_RID_ON_EXISTING - If the slot holds no record, as for getRecord
+ *	-	RC_IM_KEY_ALREADY_EXISTS - If a unique index already has the new key
+ *	-	RC_RM_WRITE_CONFLICT - If an uncommitted transaction changed the record
+ */
+RC updateRecord(RM_TableData *rel, Record *record) {
+	return writeRecord(rel, NULL, RM_WRITE_UPDATE, record, record->id);
+}
+
+/* getRecord with the table latch held */
+static RC readRecord(RM_TableData *rel, RID id, Record *record) {
+	RC rc;
+	RMTableMgmtData *rmTableMgmtData = rel->mgmtData;
+
+	// Pin the page containing the record
+	if ((rc = pinPage(&rmTableMgmtData->bufferPool, &rmTableMgmtData->pageHandle, id.page)) != RC_OK) {
+		return rc;
+	}
+
+	char *data = rmTableMgmtData->pageHandle.data;
+
+	// Check if record exists (marked with "#")
+	if (*slotMarker(rmTableMgmtData, data, id.slot) != '#') {
+		unpinPage(&rmTableMgmtData->bufferPool, &rmTableMgmtData->pageHandle);
+		return RC_TUPLE_WIT_RID_ON_EXISTING;
+	}
+
+	// Copy record data to the provided record structure
+	readSlot(rel, data, id.slot, record->data);
+	record->id = id;
+
+	// Unpin the page
+	return unpinPage(&rmTableMgmtData->bufferPool, &rmTableMgmtData->pageHandle);
+}
+
+/**
+ * Function: getRecord
+ * ------------------
+ * Retrieves a record from the table.
+ * Validates the input parameters
+ * Pins the page containing the record
+ * Locates the record using the slot ID
+ * Checks if the record exists (marked with "#")
+ * Copies the record data to the provided record structure
+ * Unpins the page
+ * Records changed by a transaction that has not committed are returned as
+ * they were last committed
+ *
+ * @param rel	Table data structure
+ * @param id	Record ID to retrieve
+ * @param record	Record to be inserted
+ * @return
+ *	-	RC_OK - If record insertion is successful
+ */
+RC getRecord(RM_TableData *rel, RID id, Record *record) {
+	RMTableMgmtData *tmt = (RMTableMgmtData *) rel->mgmtData;
+	RC rc;
+
+	pthread_rwlock_wrlock(&tmt->latch);
+	rc = readVisible(rel, NULL, id, record);
+	pthread_rwlock_unlock(&tmt->latch);
+	return rc;
+}
+
+/* Reads the version of a record the snapshot of tx (or the last committed state) holds; table latch held */
+static RC readVisible(RM_TableData *rel, RM_Transaction *tx, RID id, Record *record) {
+	RMTableMgmtData *tmt = (RMTableMgmtData *) rel->mgmtData;
+	MvccChain *chain = findVersions(tmt->versions, id);
+	MvccVersion *version;
+
+	if (chain == NULL)
+		return readRecord(rel, id, record);
+	version = visibleVersion(chain, tx, (tx != NULL) ? tx->snapshot : mvccCurrentTs());
+	if (version->data == NULL)
+		return RC_TUPLE_WIT_RID_ON_EXISTING;
+	memcpy(record->data, version->data, tmt->recordSize);
+	record->id = id;
+	return RC_OK;
+}
+
+// distinct pages getRecords prefetches ahead of the page it reads
+#define RM_PREFETCH_DEPTH 4
+
+/* A requested RID and its position in the caller's array, sorted by page */
+typedef struct RMFetch {
+	RID rid;
+	int pos;
+} RMFetch;
+
+/* Index of the first request after i for another page */
+static int nextFetchPage(RMFetch *fetches, int numFetches, int i) {
+	int page = (i < numFetches) ? fetches[i].rid.page : 0;
+
+	while (i < numFetches && fetches[i].rid.page == page)
+		i++;
+	return i;
+}
+
+static void prefetchFetchPage(RMTableMgmtData *tmt, int pageNum) {
+	if (pageNum >= 2 && pageNum <= tmt->firstFreePageNumber)
+		prefetchPage(&tmt->bufferPool, pageNum);
+}
+
+static int compareFetches(const void *a, const void *b) {
+	const RMFetch *x = (const RMFetch *) a, *y = (const RMFetch *) b;
+
+	if (x->rid.page != y->rid.page)
+		return (x->rid.page < y->rid.page) ? -1 : 1;
+	return x->rid.slot - y->rid.slot;
+}
+
+/**
+ * Function: getRecords
+ * -------------------
+ * Retrieves many records at once, like getRecord for each RID. The RIDs are
+ * sorted by page, so that each page is pinned once however often and in
+ * whatever order the caller lists its records; while a page is read, the
+ * next RM_PREFETCH_DEPTH pages are prefetched. The records are returned in
+ * the caller's order. Like getRecord, records changed by a transaction that
+ * has not committed are returned as they were last committed.
+ *
+ * @param rel	Table data structure
+ * @param ids	Record IDs to retrieve, in any order and possibly repeated
+ * @param numIds	Number of record IDs
+ * @param records	numIds records created with createRecord; records[i] receives ids[i]
+ * @return
+ *	-	RC_OK if all records were found
+ *	-	RC_TUPLE_WIT_RID_ON_EXISTING if some RID has no record; its record gets the id (-1, -1), the others are filled in
+ *	-	Errors of the buffer manager otherwise
+ */
+RC getRecords(RM_TableData *rel, RID *ids, int numIds, Record **records) {
+	RMTableMgmtData *tmt = (RMTableMgmtData *) rel->mgmtData;
+	RMFetch *fetches = (RMFetch *) malloc((numIds + 1) * sizeof(RMFetch));
+	int slots = slotsPerPage(tmt), ahead, next;
+	MvccTs snapshot;
+	BM_PageHandle page;
+	RC rc = RC_OK;
+
+	for (int i = 0; i < numIds; i++) {
+		fetches[i].rid = ids[i];
+		fetches[i].pos = i;
+	}
+	qsort(fetches, numIds, sizeof(RMFetch), compareFetches);
+
+	pthread_rwlock_wrlock(&tmt->latch);
+	snapshot = mvccCurrentTs();
+
+	// The pages after the first are announced up front, then one more as each page is read
+	ahead = nextFetchPage(fetches, numIds, 0);
+	for (int d = 1; d < RM_PREFETCH_DEPTH && ahead < numIds; d++) {
+		prefetchFetchPage(tmt, fetches[ahead].rid.page);
+		ahead = nextFetchPage(fetches, numIds, ahead);
+	}
+
+	for (int i = 0; i < numIds; i = next) {
+		int pageNum = fetches[i].rid.page;
+		bool pinned = FALSE;
+
+		if (ahead < numIds) {
+			prefetchFetchPage(tmt, fetches[ahead].rid.page);
+			ahead = nextFetchPage(fetches, numIds, ahead);
+		}
+
+		// All requested records of the page, with a single pin; pages not in use hold none
+		if (pageNum >= 2 && pageNum <= tmt->firstFreePageNumber) {
+			RC pinRc = pinPage(&tmt->bufferPool, &page, pageNum);
+			if (pinRc != RC_OK) {
+				rc = pinRc;
+				break;
+			}
+			pinned = TRUE;
+		}
+		for (next = i; next < numIds && fetches[next].rid.page == pageNum; next++) {
+			RID rid = fetches[next].rid;
+			Record *record = records[fetches[next].pos];
+			MvccChain *chain = pinned ? findVersions(tmt->versions, rid) : NULL;
+			MvccVersion *version = (chain != NULL) ? visibleVersion(chain, NULL, snapshot) : NULL;
+
+			if (version != NULL && version->data != NULL) {
+				memcpy(record->data, version->data, tmt->recordSize);
+				record->id = rid;
+			} else if (chain == NULL && pinned && rid.slot >= 0 && rid.slot < slots
+					&& *slotMarker(tmt, page.data, rid.slot) == '#') {
+				readSlot(rel, page.data, rid.slot, record->data);
+				record->id = rid;
+			} else {
+				record->id.page = -1;
+				record->id.slot = -1;
+				rc = RC_TUPLE_WIT_RID_ON_EXISTING;
+			}
+		}
+		if (pinned)
+			unpinPage(&tmt->bufferPool, &page);
+	}
+	pthread_rwlock_unlock(&tmt->latch);
+
+	free(fetches);
+	return rc;
+}
+
+/*
+ * Puts a deleted record back into its slot, undoing the delete of an aborted transaction; its index
+ * entries were kept until the commit; table latch held
+ */
+static RC restoreSlot(RM_TableData *rel, Record *record, WalLsn *lsn) {
+	RMTableMgmtData *tmt = (RMTableMgmtData *) rel->mgmtData;
+	BM_PageHandle page;
+	RC rc;
+
+	if ((rc = pinPage(&tmt->bufferPool, &page, record->id.page)) != RC_OK)
+		return rc;
+	if ((rc = logChange(rel, WAL_INSERT, record->id, record->data, page.data, lsn)) != RC_OK) {
+		unpinPage(&tmt->bufferPool, &page);
+		return rc;
+	}
+	*slotMarker(tmt, page.data, record->id.slot) = '#';
+	writeSlot(rel, page.data, record->id.slot, record->data);
+	zoneAddRecord(tmt->zoneMap, record->id.page, record->data);
+	tmt->numTuples++;
+	markDirty(&tmt->bufferPool, &page);
+	return unpinPage(&tmt->bufferPool, &page);
+}
+
+/**
+ * Function: changeRecord
+ * ---------------------
+ * Applies an insert, update or delete with the table latch held. While
+ * snapshots are open, or the record has versions already, the record before
+ * the change is kept as a version. A transaction's change stays uncommitted
+ * until commitTransaction; other changes commit at once. A record whose
+ * newest version was committed after the snapshot of tx cannot be changed
+ * (first writer wins), nor one whose newest version is uncommitted, which
+ * the record lock taken by writeRecord normally waits for.
+ *
+ * @param rel	Table data structure
+ * @param tx	Transaction making the change, NULL for a change of its own
+ * @param op	Kind of change
+ * @param record	Record to insert, or new data of the record to update
+ * @param id	Record to update or delete
+ * @param lsn	Set to the LSN to commit if the table is logged
+ * @return
+ *	-	RC_OK if the record was changed
+ *	-	RC_RM_WRITE_CONFLICT if another transaction changed it
+ *	-	Errors of insertRecord, updateRecord and deleteRecord otherwise
+ */
+static RC changeRecord(RM_TableData *rel, RM_Transaction *tx, RMWriteOp op, Record *record, RID id, WalLsn *lsn) {
+	RMTableMgmtData *tmt = (RMTableMgmtData *) rel->mgmtData;
+	bool keep = (tx != NULL || mvccSnapshotsActive());
+	MvccChain *chain = NULL;
+	char *before = NULL, *kept = NULL;
+	RC rc;
+
+	if (op != RM_WRITE_INSERT && (chain = findVersions(tmt->versions, id)) != NULL) {
+		MvccVersion *head = chain->head;
+		if ((head->writer != NULL && head->writer != tx)
+				|| (tx != NULL && head->writer == NULL && head->commitTs > tx->snapshot))
+			return RC_RM_WRITE_CONFLICT;
+	}
+
+	// Copy the record before the change, it becomes the oldest version
+	if (op != RM_WRITE_INSERT && (keep || chain != NULL)) {
+		Record old;
+		old.data = before = (char *) malloc(tmt->recordSize);
+		if (readRecord(rel, id, &old) != RC_OK) {
+			free(before);
+			before = NULL;
+		}
+	}
+
+	// The index entries of the last committed version stay until the transaction commits
+	if (tx != NULL && op != RM_WRITE_INSERT)
+		kept = (chain != NULL && chain->head->writer == tx) ? chain->head->older->data : before;
+
+	if (op == RM_WRITE_INSERT) {
+		rc = insertSlot(rel, record, lsn);
+		id = record->id;
+		chain = findVersions(tmt->versions, id);
+	} else if (op == RM_WRITE_UPDATE) {
+		rc = updateSlot(rel, record, kept, lsn);
+	} else {
+		rc = deleteSlot(rel, id, kept, lsn);
+	}
+
+	if (rc == RC_OK && (keep || chain != NULL)) {
+		bool rewrite = (tx != NULL && chain != NULL && chain->head->writer == tx);
+
+		addVersion(tmt->versions, id, before, tx, (tx != NULL) ? 0 : mvccNextTs(),
+				(op == RM_WRITE_DELETE) ? NULL : record->data);
+		if (tx != NULL && !rewrite) {
+			if (tx->numWrites == tx->capacity) {
+				tx->capacity = (tx->capacity > 0) ? 2 * tx->capacity : 16;
+				tx->writes = (RMTxWrite *) realloc(tx->writes, tx->capacity * sizeof(RMTxWrite));
+			}
+			tx->writes[tx->numWrites].rel = rel;
+			tx->writes[tx->numWrites].rid = id;
+			tx->numWrites++;
+		}
+		if (tmt->versions->numVersions >= tmt->versions->collectAt)
+			collectVersions(tmt->versions, mvccHorizon());
+	}
+	free(before);
+	return rc;
+}
+
+/**
+ * Function: writeRecord
+ * --------------------
+ * Runs changeRecord under the table latch. The writer first locks the table
+ * in IX and the record in X, waiting while another transaction holds the
+ * record; the locks are kept until the transaction ends, so writers of
+ * different records only share the latch for the change itself. Changes
+ * outside a transaction lock for their own duration and are durable when
+ * this returns.
+ *
+ * @param rel	Table data structure
+ * @param tx	Transaction making the change, NULL for a change of its own
+ * @param op	Kind of change
+ * @param record	Record to insert, or new data of the record to update
+ * @param id	Record to update or delete
+ * @return
+ *	-	RC_OK if the record was changed
+ *	-	RC_RM_DEADLOCK or RC_RM_LOCK_TIMEOUT if the locks could not be taken
+ *	-	Errors of changeRecord otherwise
+ */
+static RC writeRecord(RM_TableData *rel, RM_Transaction *tx, RMWriteOp op, Record *record, RID id) {
+	RMTableMgmtData *tmt = (RMTableMgmtData *) rel->mgmtData;
+	LockOwner single, *owner = (tx != NULL) ? &tx->locks : &single;
+	WalLsn lsn = 0;
+	RC rc;
+
+	if (tx != NULL)
+		useTable(tx, rel);
+	else
+		initLockOwner(&single);
+
+	rc = lockAcquire(owner, tmt, tableLockId, LOCK_IX);
+	if (rc == RC_OK && op != RM_WRITE_INSERT)
+		rc = lockAcquire(owner, tmt, id, LOCK_X);
+	if (rc == RC_OK) {
+		pthread_rwlock_wrlock(&tmt->latch);
+		rc = changeRecord(rel, tx, op, record, id, &lsn);
+
+		// Nobody waits for a slot that was free, unless a failed change left a lock on it;
+		// changeRecord's version check then still keeps others off the new record
+		if (rc == RC_OK && op == RM_WRITE_INSERT)
+			lockTry(owner, tmt, record->id, LOCK_X);
+		if (rc == RC_OK)
+			rc = checkpointIfDue(rel);
+		pthread_rwlock_unlock(&tmt->latch);
+	}
+
+	// Commit: wait until the log record is durable, sharing the sync with concurrent operations
+	if (rc == RC_OK && tx == NULL && tmt->wal != NULL)
+		rc = walFlush(tmt->wal, lsn);
+	if (tx == NULL) {
+		lockReleaseAll(&single);
+		destroyLockOwner(&single);
+	}
+	return rc;
+}
+
+/**
+ * Function: beginTransaction
+ * -------------------------
+ * Starts a transaction. Its reads see the changes committed before it started
+ * and its own changes, whatever is committed meanwhile, and take no locks.
+ * Its writes lock the records they change until it ends.
+ *
+ * @param tx	Set to the new transaction
+ * @return
+ *	-	RC_OK
+ */
+RC beginTransaction(RM_Transaction **tx) {
+	*tx = (RM_Transaction *) calloc(1, sizeof(RM_Transaction));
+	(*tx)->snapshot = mvccBeginSnapshot();
+	initLockOwner(&(*tx)->locks);
+	return RC_OK;
+}
+
+/* Ends the snapshot of a finished transaction and frees it */
+static void endTransaction(RM_Transaction *tx) {
+	mvccEndSnapshot(tx->snapshot);
+	lockReleaseAll(&tx->locks);
+	destroyLockOwner(&tx->locks);
+
+	// Without open snapshots the committed versions are not needed any more
+	for (int i = 0; i < tx->numTables; i++) {
+		RMTableMgmtData *tmt = (RMTableMgmtData *) tx->tables[i]->mgmtData;
+		pthread_rwlock_wrlock(&tmt->latch);
+		if (!mvccSnapshotsActive() || tmt->versions->numVersions >= tmt->versions->collectAt)
+			collectVersions(tmt->versions, mvccHorizon());
+		pthread_rwlock_unlock(&tmt->latch);
+	}
+	free(tx->writes);
+	free(tx->tables);
+	free(tx);
+}
+
+/**
+ * Function: commitTransaction
+ * --------------------------
+ * Commits a transaction: once the log records of its changes are durable,
+ * its versions get a commit timestamp, so that snapshots started afterwards
+ * see all of its changes and earlier ones none. Frees the transaction.
+ *
+ * @param tx	Transaction to commit
+ * @return
+ *	-	RC_OK if the transaction committed
+ *	-	Errors of the log otherwise; the changes stay uncommitted then
+ */
+RC commitTransaction(RM_Transaction *tx) {
+	MvccTs commitTs;
+	RC rc;
+
+	for (int i = 0; i < tx->numWrites; i++) {
+		RMTableMgmtData *tmt = (RMTableMgmtData *) tx->writes[i].rel->mgmtData;
+		if (tmt->wal != NULL && (rc = walFlush(tmt->wal, walAppendedLsn(tmt->wal))) != RC_OK)
+			return rc;
+	}
+
+	commitTs = mvccStartCommit();
+	for (int i = 0; i < tx->numWrites; i++) {
+		RMTableMgmtData *tmt = (RMTableMgmtData *) tx->writes[i].rel->mgmtData;
+		pthread_rwlock_wrlock(&tmt->latch);
+		MvccChain *chain = findVersions(tmt->versions, tx->writes[i].rid);
+		if (chain != NULL && chain->head->writer == tx) {
+			// The entries of keys the transaction removed, kept for the versions before it
+			char *kept = chain->head->older->data;
+			if (kept != NULL && tmt->numIndexes > 0)
+				updateIndexes(tx->writes[i].rel, kept, chain->rid, FALSE, chain->head->data);
+			chain->head->writer = NULL;
+			chain->head->commitTs = commitTs;
+		}
+		pthread_rwlock_unlock(&tmt->latch);
+	}
+	mvccFinishCommit(commitTs);
+
+	endTransaction(tx);
+	return RC_OK;
+}
+
+/**
+ * Function: abortTransaction
+ * -------------------------
+ * Rolls a transaction back: its changes are undone newest first, restoring
+ * the records and their index entries, and their versions are dropped.
+ * Frees the transaction.
+ *
+ * @param tx	Transaction to abort
+ * @return
+ *	-	RC_OK if all changes were undone
+ *	-	Errors of the buffer manager otherwise
+ */
+RC abortTransaction(RM_Transaction *tx) {
+	RC rc = RC_OK;
+
+	for (int i = tx->numWrites - 1; i >= 0; i--) {
+		RM_TableData *rel = tx->writes[i].rel;
+		RMTableMgmtData *tmt = (RMTableMgmtData *) rel->mgmtData;
+		Record current, restored;
+		WalLsn lsn = 0;
+		RC undo = RC_OK;
+
+		pthread_rwlock_wrlock(&tmt->latch);
+		MvccChain *chain = findVersions(tmt->versions, tx->writes[i].rid);
+		if (chain != NULL && chain->head->writer == tx) {
+			restored.id = chain->rid;
+			restored.data = chain->head->older->data;
+			current.data = (char *) malloc(tmt->recordSize);
+			bool present = (readRecord(rel, chain->rid, &current) == RC_OK);
+			free(current.data);
+
+			if (restored.data == NULL)
+				undo = present ? deleteSlot(rel, chain->rid, NULL, &lsn) : RC_OK;
+			else if (present)
+				undo = updateSlot(rel, &restored, restored.data, &lsn);
+			else
+				undo = restoreSlot(rel, &restored, &lsn);
+			if (undo == RC_OK)
+				dropVersion(tmt->versions, chain);
+		}
+		pthread_rwlock_unlock(&tmt->latch);
+		if (rc == RC_OK)
+			rc = undo;
+	}
+
+	endTransaction(tx);
+	return rc;
+}
+
+/* insertRecord as part of a transaction; see changeRecord */
+RC insertRecordTx(RM_TableData *rel, RM_Transaction *tx, Record *record) {
+	return writeRecord(rel, tx, RM_WRITE_INSERT, record, record->id);
+}
+
+/* deleteRecord as part of a transaction; RC_RM_WRITE_CONFLICT if a transaction committed a change to the record after tx began */
+RC deleteRecordTx(RM_TableData *rel, RM_Transaction *tx, RID id) {
+	return writeRecord(rel, tx, RM_WRITE_DELETE, NULL, id);
+}
+
+/* updateRecord as part of a transaction; RC_RM_WRITE_CONFLICT if a transaction committed a change to the record after tx began */
+RC updateRecordTx(RM_TableData *rel, RM_Transaction *tx, Record *record) {
+	return writeRecord(rel, tx, RM_WRITE_UPDATE, record, record->id);
+}
+
+/* getRecord from the snapshot of a transaction */
+RC getRecordTx(RM_TableData *rel, RM_Transaction *tx, RID id, Record *record) {
+	RMTableMgmtData *tmt = (RMTableMgmtData *) rel->mgmtData;
+	RC rc;
+
+	useTable(tx, rel);
+	pthread_rwlock_wrlock(&tmt->latch);
+	rc = readVisible(rel, tx, id, record);
+	pthread_rwlock_unlock(&tmt->latch);
+	return rc;
+}
+
+/**
+ * Function: getNumRecordVersions
+ * -----------------------------
+ * Returns the number of record versions the table keeps for snapshots.
+ *
+ * @param rel	Table data structure
+ * @return
+ *	-	The number of versions, 0 once no snapshot needs any
+ */
+int getNumRecordVersions(RM_TableData *rel) {
+	RMTableMgmtData *tmt = (RMTableMgmtData *) rel->mgmtData;
+	int numVersions;
+
+	pthread_rwlock_wrlock(&tmt->latch);
+	numVersions = tmt->versions->numVersions;
+	pthread_rwlock_unlock(&tmt->latch);
+	return numVersions;
+}
+
+/**
+ * Function: lockTableTx
+ * --------------------
+ * Locks a whole table until a transaction ends. A shared lock keeps all
+ * other transactions from writing to it; an exclusive one also keeps them
+ * from locking it shared. Writes outside transactions wait as well.
+ *
+ * @param rel	Table data structure
+ * @param tx	Transaction taking the lock
+ * @param exclusive	TRUE for an exclusive lock, FALSE for a shared one
+ * @return
+ *	-	RC_OK if the lock is held
+ *	-	RC_RM_DEADLOCK or RC_RM_LOCK_TIMEOUT if it could not be taken
+ */
+RC lockTableTx(RM_TableData *rel, RM_Transaction *tx, bool exclusive) {
+	return lockAcquire(&tx->locks, rel->mgmtData, tableLockId, exclusive ? LOCK_X : LOCK_S);
+}
+
+/* Makes writers give up with RC_RM_LOCK_TIMEOUT after waiting timeoutMillis for a lock; 0 detects deadlocks instead */
+void setLockTimeout(int timeoutMillis) {
+	setLockWaitTimeout(timeoutMillis);
+}
+
+/* Keeps page pageNum pinned in handle, unpinning the page the handle held before */
+static RC movePin(RMTableMgmtData *tmt, BM_PageHandle *handle, int pageNum) {
+	RC rc;
+
+	if (handle->pageNum == pageNum)
+		return RC_OK;
+	if (handle->pageNum != NO_PAGE && (rc = unpinPage(&tmt->bufferPool, handle)) != RC_OK)
+		return rc;
+	if ((rc = pinPage(&tmt->bufferPool, handle, pageNum)) != RC_OK) {
+		handle->pageNum = NO_PAGE;
+		return rc;
+	}
+	return RC_OK;
+}
+
+/* Pages vacuumTable would give back to the storage manager */
+static int reclaimablePages(RMTableMgmtData *tmt) {
+	int slots = slotsPerPage(tmt);
+	int needed = (tmt->numTuples > 0) ? (tmt->numTuples - 1) / slots + 1 : 1;
+
+	return (tmt->firstFreePageNumber - 1) - needed;
+}
+
+/*
+ * vacuumTable with the table latch held. Slots are numbered across the data
+ * pages; the last live record is moved into the first free slot until the two
+ * meet, so that the records end up in the first numTuples slots.
+ */
+static RC compactTable(RM_TableData *rel) {
+	RMTableMgmtData *tmt = (RMTableMgmtData *) rel->mgmtData;
+	int slots = slotsPerPage(tmt);
+	int low = 0, high = (tmt->firstFreePageNumber - 1) * slots - 1;
+	BM_PageHandle dest, src;
+	char *record = (char *) malloc(rel->schema->attrOffsets[rel->schema->numAttr]);
+	WalLsn lsn = 0;
+	RC rc = RC_OK;
+
+	dest.pageNum = NO_PAGE;
+	src.pageNum = NO_PAGE;
+	while (low < high) {
+		// Find the first free slot and the last record
+		if ((rc = movePin(tmt, &dest, 2 + low / slots)) != RC_OK)
+			break;
+		if (*slotMarker(tmt, dest.data, low % slots) == '#') {
+			low++;
+			continue;
+		}
+		if ((rc = movePin(tmt, &src, 2 + high / slots)) != RC_OK)
+			break;
+		if (*slotMarker(tmt, src.data, high % slots) != '#') {
+			high--;
+			continue;
+		}
+
+		// Move the index entries (unique keys have to be removed first), then the record;
+		// a move that fails leaves the entries where they were
+		RID from = { 2 + high / slots, high % slots };
+		RID to = { 2 + low / slots, low % slots };
+		readSlot(rel, src.data, from.slot, record);
+		if ((rc = updateIndexes(rel, record, from, FALSE, NULL)) != RC_OK)
+			break;
+		if ((rc = updateIndexes(rel, record, to, TRUE, NULL)) != RC_OK) {
+			updateIndexes(rel, record, from, TRUE, NULL);
+			break;
+		}
+		if ((rc = logChange(rel, WAL_INSERT, to, record, dest.data, &lsn)) != RC_OK
+				|| (rc = logChange(rel, WAL_DELETE, from, NULL, src.data, &lsn)) != RC_OK) {
+			updateIndexes(rel, record, to, FALSE, NULL);
+			updateIndexes(rel, record, from, TRUE, NULL);
+			break;
+		}
+		*slotMarker(tmt, dest.data, to.slot) = '#';
+		writeSlot(rel, dest.data, to.slot, record);
+		*slotMarker(tmt, src.data, from.slot) = '$';
+		zoneAddRecord(tmt->zoneMap, to.page, record);
+		markDirty(&tmt->bufferPool, &dest);
+		markDirty(&tmt->bufferPool, &src);
+		low++;
+		high--;
+	}
+	free(record);
+	if (dest.pageNum != NO_PAGE)
+		unpinPage(&tmt->bufferPool, &dest);
+	if (src.pageNum != NO_PAGE)
+		unpinPage(&tmt->bufferPool, &src);
+	if (rc != RC_OK)
+		return rc;
+
+	// Inserts continue on the last page holding records, the pages after it are given back
+	int lastPage = (tmt->numTuples > 0) ? 2 + (tmt->numTuples - 1) / slots : 2;
+	for (int page = lastPage + 1; page <= tmt->firstFreePageNumber; page++)
+		zoneSetState(tmt->zoneMap, page, ZONE_EMPTY);
+	tmt->firstFreePageNumber = lastPage;
+	RID last = { lastPage, 0 };
+	if ((rc = logChange(rel, WAL_TRUNCATE, last, NULL, NULL, &lsn)) != RC_OK || (rc = writeTableInfo(tmt)) != RC_OK)
+		return rc;
+
+	// The moves must be durable before the pages they were moved from are gone
+	if (tmt->wal != NULL && (rc = walFlush(tmt->wal, lsn)) != RC_OK)
+		return rc;
+	if (tmt->wal != NULL)
+		forgetPageChanges(tmt, lastPage + 1, tmt->numRecLsn);
+	return truncateBufferPool(&tmt->bufferPool, lastPage + 1);
+}
+
+/**
+ * Function: vacuumTable
+ * --------------------
+ * Reclaims the slots of deleted records.
+ * Moves the records at the end of the table into free slots at its front
+ * Moves their index entries along
+ * Continues inserts on the last page holding records
+ * Truncates the page file after that page
+ * Moved records get new RIDs; the RIDs of the other records stay valid.
+ *
+ * @param rel	Table data structure
+ * @return
+ *	-	RC_OK - If the table was compacted
+ *	-	RC_RM_TABLE_IN_USE - If a scan of the table is open or records have versions that snapshots may read
+ */
+RC vacuumTable(RM_TableData *rel) {
+	RMTableMgmtData *tmt = (RMTableMgmtData *) rel->mgmtData;
+	RC rc = RC_RM_TABLE_IN_USE;
+
+	pthread_rwlock_wrlock(&tmt->latch);
+	if (tmt->activeScans == 0 && tmt->versions->numChains == 0)
+		rc = compactTable(rel);
+	pthread_rwlock_unlock(&tmt->latch);
+	return rc;
+}
+
+/* Background thread vacuuming a table */
+typedef struct RMVacuumDaemon {
+	RM_TableData rel;	// Copy of the handle that started it, which may be closed while the table stays open
+	int intervalMillis;	// Time between checks of the table
+	int minPages;	// Pages that must be reclaimable for a vacuum
+	bool stop;	// Set by stopVacuumDaemon
+	pthread_mutex_t lock;
+	pthread_cond_t wakeup;
+	pthread_t thread;
+} RMVacuumDaemon;
+
+static void *vacuumDaemon(void *arg) {
+	RMVacuumDaemon *daemon = (RMVacuumDaemon *) arg;
+	RMTableMgmtData *tmt = (RMTableMgmtData *) daemon->rel.mgmtData;
+	struct timespec until;
+
+	pthread_mutex_lock(&daemon->lock);
+	while (!daemon->stop) {
+		clock_gettime(CLOCK_REALTIME, &until);
+		until.tv_sec += daemon->intervalMillis / 1000;
+		until.tv_nsec += (long) (daemon->intervalMillis % 1000) * 1000000;
+		if (until.tv_nsec >= 1000000000) {
+			until.tv_sec++;
+			until.tv_nsec -= 1000000000;
+		}
+		pthread_cond_timedwait(&daemon->wakeup, &daemon->lock, &until);
+		if (daemon->stop)
+			break;
+
+		// Tables with open scans or record versions are tried again on the next round
+		pthread_rwlock_wrlock(&tmt->latch);
+		if (tmt->activeScans == 0 && tmt->versions->numChains == 0 && reclaimablePages(tmt) >= daemon->minPages)
+			compactTable(&daemon->rel);
+		pthread_rwlock_unlock(&tmt->latch);
+	}
+	pthread_mutex_unlock(&daemon->lock);
+	return NULL;
+}
+
+/**
+ * Function: startVacuumDaemon
+ * --------------------------
+ * Starts a thread that checks the table every intervalMillis milliseconds and
+ * vacuums it once at least minPages pages can be given back (see vacuumTable).
+ * The thread is stopped by stopVacuumDaemon or closeTable.
+ *
+ * @param rel	Table data structure
+ * @param intervalMillis	Time between checks
+ * @param minPages	Number of reclaimable pages that triggers a vacuum, at least 1
+ * @return
+ *	-	RC_OK - If the thread was started
+ *	-	RC_INVALID_PARAM - If a parameter is out of range or a thread is already running
+ */
+RC startVacuumDaemon(RM_TableData *rel, int intervalMillis, int minPages) {
+	RMTableMgmtData *tmt = (RMTableMgmtData *) rel->mgmtData;
+	RMVacuumDaemon *daemon;
+
+	if (intervalMillis <= 0 || minPages < 1 || tmt->vacuumDaemon != NULL)
+		return RC_INVALID_PARAM;
+
+	daemon = (RMVacuumDaemon *) malloc(sizeof(RMVacuumDaemon));
+	daemon->rel = *rel;
+	daemon->intervalMillis = intervalMillis;
+	daemon->minPages = minPages;
+	daemon->stop = FALSE;
+	pthread_mutex_init(&daemon->lock, NULL);
+	pthread_cond_init(&daemon->wakeup, NULL);
+	if (pthread_create(&daemon->thread, NULL, vacuumDaemon, daemon) != 0) {
+		pthread_cond_destroy(&daemon->wakeup);
+		pthread_mutex_destroy(&daemon->lock);
+		free(daemon);
+		return RC_MEMORY_ALLOCATION_ERROR;
+	}
+	tmt->vacuumDaemon = daemon;
+	return RC_OK;
+}
+
+/**
+ * Function: stopVacuumDaemon
+ * -------------------------
+ * Stops the thread started by startVacuumDaemon, waiting for a running vacuum
+ * to finish. Does nothing if no thread is running.
+ *
+ * @param rel	Table data structure
+ * @return
+ *	-	RC_OK
+ */
+RC stopVacuumDaemon(RM_TableData *rel) {
+	RMTableMgmtData *tmt = (RMTableMgmtData *) rel->mgmtData;
+	RMVacuumDaemon *daemon = tmt->vacuumDaemon;
+
+	if (daemon == NULL)
+		return RC_OK;
+
+	pthread_mutex_lock(&daemon->lock);
+	daemon->stop = TRUE;
+	pthread_cond_signal(&daemon->wakeup);
+	pthread_mutex_unlock(&daemon->lock);
+	pthread_join(daemon->thread, NULL);
+
+	pthread_cond_destroy(&daemon->wakeup);
+	pthread_mutex_destroy(&daemon->lock);
+	free(daemon);
+	tmt->vacuumDaemon = NULL;
+	return RC_OK;
+}
+
+
+/* TRUE if an index can return the records satisfying a (non-negated) predicate */
+static bool indexAnswers(Schema *schema, RMIndex *index, ZonePredicate *pred) {
+	int *attrs;
+
+	if (pred->negate || indexAttrs(schema, index, &attrs) != 1 || attrs[0] != pred->attrNum)
+		return FALSE;
+	return index->type == RM_INDEX_BTREE || pred->cmp == KERNEL_CMP_EQ;
+}
+
+/**
+ * Function: openIndexScan
+ * ----------------------
+ * Opens the index scan returning the records that may satisfy the scan's
+ * predicate: a probe for "attr = c", a B+-tree range up to or from c
+ * (inclusive; the condition is checked on every record anyway) for
+ * "attr < c" and "c < attr".
+ *
+ * @param rel       Scanned table
+ * @param indexScan Index and predicate; its scan handle is set
+ * @return
+ *  -   RC_OK if the index scan was opened
+ */
+static RC openIndexScan(RM_TableData *rel, RMIndexScan *indexScan) {
+	RMIndex *index = indexScan->index;
+	ZonePredicate *pred = &indexScan->pred;
+
+	indexScan->pending = NULL;
+	indexScan->numPending = 0;
+	if (index->type == RM_INDEX_BTREE) {
+		Value *low = (pred->cmp == KERNEL_CMP_LT) ? NULL : pred->cons;
+		Value *high = (pred->cmp == KERNEL_CMP_GT) ? NULL : pred->cons;
+		return openTreeRangeScan(index->btree, low, high, &indexScan->treeScan);
+	}
+
+	Record probe;
+	probe.data = (char *) calloc(1, getRecordSize(rel->schema));
+	setAttr(&probe, rel->schema, pred->attrNum, pred->cons);
+	RC rc = openKeyScan(rel, indexScan, probe.data);
+	free(probe.data);
+	return rc;
+}
+
+/* Opens the scan of the entries of an index that have the key of record data */
+static RC openKeyScan(RM_TableData *rel, RMIndexScan *indexScan, char *data) {
+	RMIndex *index = indexScan->index;
+
+	if (index->type == RM_INDEX_BTREE) {
+		Record record;
+		Value key;
+		char strBuf[PAGE_SIZE];
+		record.data = data;
+		getAttrInto(&record, rel->schema, index->attrNum, &key, strBuf);
+		return openTreeRangeScan(index->btree, &key, &key, &indexScan->treeScan);
+	}
+
+	// Hash keys are the attribute bytes as laid out in a record
+	char *key = (char *) malloc(hashKeyLength(rel->schema, index));
+	hashKeyOf(rel->schema, index, data, key);
+	RC rc = openHashScan(index->hash, key, &indexScan->hashScan);
+	free(key);
+	return rc;
+}
+
+static RC nextIndexRid(RMIndexScan *indexScan, RID *rid) {
+	if (indexScan->index->type == RM_INDEX_BTREE)
+		return nextEntry(indexScan->treeScan, rid);
+	return nextHashEntry(indexScan->hashScan, rid);
+}
+
+static RC closeIndexScan(RMIndexScan *indexScan) {
+	free(indexScan->pending);
+	indexScan->pending = NULL;
+	indexScan->numPending = 0;
+	if (indexScan->index->type == RM_INDEX_BTREE)
+		return closeTreeScan(indexScan->treeScan);
+	return closeHashScan(indexScan->hashScan);
+}
+
+/* Number of records an index scan returns, counting no further than limit */
+static int countIndexMatches(RM_TableData *rel, RMIndexScan *indexScan, int limit) {
+	int count = 0;
+	RID rid;
+
+	if (openIndexScan(rel, indexScan) != RC_OK)
+		return limit;
+	while (count < limit && nextIndexRid(indexScan, &rid) == RC_OK)
+		count++;
+	closeIndexScan(indexScan);
+	return count;
+}
+
+/**
+ * Function: chooseIndex
+ * --------------------
+ * Picks the index, if any, that a scan reads instead of the data pages.
+ * Candidates are the indexes that answer one of the scan's simple predicates.
+ * The number of records each would return is estimated by counting its
+ * entries, but only up to the point where the index (one random page read
+ * per record) would cost as much as reading all data pages in order; the
+ * cheapest candidate below that point wins. RM_PATH_INDEX takes the first
+ * candidate without estimating, preferring equality predicates.
+ *
+ * @param rel       Scanned table
+ * @param scanData  Scan with its predicates; indexScan is set
+ * @param path      Access path setting of the table
+ */
+static void chooseIndex(RM_TableData *rel, RMScanMgmtData *scanData, RM_AccessPath path) {
+	RMTableMgmtData *tmt = (RMTableMgmtData *) rel->mgmtData;
+	RMIndexScan *best = &scanData->indexScan;
+	int limit = (tmt->firstFreePageNumber - 1) / RM_RANDOM_PAGE_COST;
+
+	best->index = NULL;
+	if (path == RM_PATH_SEQUENTIAL)
+		return;
+
+	for (int i = 0; i < scanData->numZonePreds; i++) {
+		for (int j = 0; j < tmt->numIndexes; j++) {
+			RMIndexScan candidate;
+
+			if (!indexAnswers(rel->schema, &tmt->indexes[j], &scanData->zonePreds[i]))
+				continue;
+			candidate.index = &tmt->indexes[j];
+			candidate.pred = scanData->zonePreds[i];
+
+			if (path == RM_PATH_INDEX) {
+				if (best->index == NULL || (candidate.pred.cmp == KERNEL_CMP_EQ && best->pred.cmp != KERNEL_CMP_EQ))
+					*best = candidate;
+				continue;
+			}
+			int count = countIndexMatches(rel, &candidate, limit);
+			if (count < limit) {
+				*best = candidate;
+				limit = count;
+			}
+		}
+	}
+}
+
+/**
+ * Function: startTableScan
+ * -----------------------
+ * Sets up a scan, reading either the data pages or, if the access path
+ * allows and chooseIndex finds one, an index.
+ *
+ * @param rel       Table data structure to scan
+ * @param scan      Scan handle to be initialized
+ * @param cond      Expression condition to filter records (can be NULL for all records)
+ * @param path      How to choose between the data pages and an index
+ * @return
+ *  -   RC_OK if scan initialization is successful
+ *  -   Type errors of the condition if it cannot be evaluated against the schema
+ */
+static RC startTableScan(RM_TableData *rel, RM_ScanHandle *scan, Expr *cond, RM_AccessPath path) {
+	RMTableMgmtData *tmt = (RMTableMgmtData *) rel->mgmtData;
+	CompiledExpr *program = NULL;
+	RC rc;
+
+	// Compile the condition up front so that type errors surface here and not per row
+	if (cond != NULL && (rc = compileExpr(cond, rel->schema, &program)) != RC_OK
+			&& rc != RC_RM_EXPR_TOO_COMPLEX) {
+		return rc;
+	}
+
+	// Set the relation for the scan
+	scan->rel = rel;
+
+	// Allocate and initialize scan management data
+	RMScanMgmtData *rmScanMgmtData = (RMScanMgmtData *) malloc(sizeof(RMScanMgmtData));
+
+	// Initialize scan to start at the first data page (page 2) and first slot
+	rmScanMgmtData->rid.page = 2;
+	rmScanMgmtData->rid.slot = 0;
+	rmScanMgmtData->lastPage = -1;
+	rmScanMgmtData->count = 0;
+	rmScanMgmtData->condition = cond;
+	rmScanMgmtData->program = program;
+	rmScanMgmtData->useKernel = extractScanKernel(cond, rel->schema, &rmScanMgmtData->kernel);
+	rmScanMgmtData->maskPage = -1;
+	rmScanMgmtData->row = (char *) malloc(getRecordSize(rel->schema));
+	rmScanMgmtData->numZonePreds = extractZonePredicates(cond, rel->schema, rmScanMgmtData->zonePreds, ZONE_MAX_PREDICATES);
+	rmScanMgmtData->pagesSkipped = 0;
+	rmScanMgmtData->tx = NULL;
+	rmScanMgmtData->snapshot = mvccCurrentTs();
+	rmScanMgmtData->page = (char *) malloc(PAGE_SIZE);
+	rmScanMgmtData->arena = NULL;
+	rmScanMgmtData->numProjected = 0;
+	rmScanMgmtData->projected = NULL;
+	rmScanMgmtData->projSchema = NULL;
+	rmScanMgmtData->endPending = FALSE;
+
+	// Read an index instead of the pages if that is cheaper
+	chooseIndex(rel, rmScanMgmtData, path);
+	if (rmScanMgmtData->indexScan.index != NULL && (rc = openIndexScan(rel, &rmScanMgmtData->indexScan)) != RC_OK) {
+		freeCompiledExpr(program);
+		free(rmScanMgmtData->row);
+		free(rmScanMgmtData->page);
+		free(rmScanMgmtData);
+		return rc;
+	}
+
+	// Attach management data to scan handle
+	scan->mgmtData = rmScanMgmtData;
+
+	// Records must stay in place while the scan is open; summaries of the pages
+	// in use are filled in while scanning, possibly by several threads
+	pthread_rwlock_wrlock(&tmt->latch);
+	tmt->activeScans++;
+	zoneReserve(tmt->zoneMap, tmt->firstFreePageNumber);
+	pthread_rwlock_unlock(&tmt->latch);
+
+	return RC_OK;
+}
+
+/**
+ * Function: startScan
+ * ------------------
+ * Initializes a scan operation on the table.
+ * This function sets up the scan handle with the necessary data to perform
+ * a sequential scan of the table records, optionally filtering by a condition.
+ * The condition is compiled once into a register program; conditions too large
+ * for a program are evaluated with evalExpr instead.
+ * If an index answers an "attr = const" or "attr < const" conjunct of the
+ * condition and is estimated to be cheaper, the scan reads the records it
+ * returns instead of the data pages and applies the whole condition to them
+ * (see setAccessPath to force either choice).
+ *
+ * @param rel       Table data structure to scan
+ * @param scan      Scan handle to be initialized
+ * @param cond      Expression condition to filter records (can be NULL for all records)
+ * @return
+ *  -   RC_OK if scan initialization is successful
+ *  -   Type errors of the condition if it cannot be evaluated against the schema
+ */
+RC startScan(RM_TableData *rel, RM_ScanHandle *scan, Expr *cond) {
+	return startTableScan(rel, scan, cond, ((RMTableMgmtData *) rel->mgmtData)->accessPath);
+}
+
+/**
+ * Function: startScanProjected
+ * ---------------------------
+ * Starts a scan that returns only some attributes of the matching records.
+ * next() and nextBatch() copy just these attributes out of the scanned page,
+ * into compact tuples laid out like records of getScanSchema(scan); the
+ * condition may still refer to any attribute of the table.
+ *
+ * @param rel       Table data structure to scan
+ * @param scan      Scan handle to be initialized
+ * @param cond      Expression condition to filter records (can be NULL for all records)
+ * @param attrs     Attributes to return, in tuple order
+ * @param numAttrs  Number of attributes to return
+ * @return
+ *  -   RC_OK if scan initialization is successful
+ *  -   RC_INVALID_PARAM if an attribute is not in the schema or none is given
+ *  -   Type errors of the condition if it cannot be evaluated against the schema
+ */
+RC startScanProjected(RM_TableData *rel, RM_ScanHandle *scan, Expr *cond, int *attrs, int numAttrs) {
+	Schema *projSchema = projectSchema(rel->schema, attrs, numAttrs);
+	RMScanMgmtData *scanMgmtData;
+	RC rc;
+
+	if (projSchema == NULL)
+		return RC_INVALID_PARAM;
+	if ((rc = startScan(rel, scan, cond)) != RC_OK) {
+		freeSchema(projSchema);
+		return rc;
+	}
+	scanMgmtData = (RMScanMgmtData *) scan->mgmtData;
+	scanMgmtData->numProjected = numAttrs;
+	scanMgmtData->projected = (int *) malloc(numAttrs * sizeof(int));
+	memcpy(scanMgmtData->projected, attrs, numAttrs * sizeof(int));
+	scanMgmtData->projSchema = projSchema;
+	return RC_OK;
+}
+
+/* Schema of the tuples a scan returns: the projected attributes, or the table's schema */
+Schema *getScanSchema(RM_ScanHandle *scan) {
+	RMScanMgmtData *scanMgmtData = (RMScanMgmtData *) scan->mgmtData;
+
+	return (scanMgmtData->projSchema != NULL) ? scanMgmtData->projSchema : scan->rel->schema;
+}
+
+/**
+ * Function: startScanTx
+ * --------------------
+ * Starts a scan reading the snapshot of a transaction: it returns the records
+ * as they were when the transaction began, with the transaction's own changes.
+ * Changes committed by others while the scan runs are not seen, and do not
+ * wait for the scan. Index entries only exist for the newest versions, so the
+ * scan reads the data pages.
+ *
+ * @param rel       Table data structure to scan
+ * @param tx        Transaction whose snapshot is read
+ * @param scan      Scan handle to be initialized
+ * @param cond      Expression condition to filter records (can be NULL for all records)
+ * @return
+ *  -   RC_OK if scan initialization is successful
+ *  -   Type errors of the condition if it cannot be evaluated against the schema
+ */
+RC startScanTx(RM_TableData *rel, RM_Transaction *tx, RM_ScanHandle *scan, Expr *cond) {
+	RC rc = startTableScan(rel, scan, cond, RM_PATH_SEQUENTIAL);
+
+	if (rc == RC_OK && tx != NULL) {
+		useTable(tx, rel);
+		((RMScanMgmtData *) scan->mgmtData)->tx = tx;
+		((RMScanMgmtData *) scan->mgmtData)->snapshot = tx->snapshot;
+	}
+	return rc;
+}
+
+/**
+ * Function: summarizePage
+ * ----------------------
+ * Records the min/max of the live records of a pinned page in the zone map,
+ * so that later scans can skip the page without reading it.
+ *
+ * @param rel       Table the page belongs to
+ * @param pageNum   Number of the page
+ * @param page      Data of the pinned page
+ * @param row       Scratch record for assembling PAX records
+ */
+static void summarizePage(RM_TableData *rel, int pageNum, char *page, char *row) {
+	RMTableMgmtData *tmt = (RMTableMgmtData *) rel->mgmtData;
+	int totalSlots = slotsPerPage(tmt);
+
+	zoneSetState(tmt->zoneMap, pageNum, ZONE_EMPTY);
+	for (int slot = 0; slot < totalSlots; slot++) {
+		if (*slotMarker(tmt, page, slot) != '#')
+			continue;
+		if (tmt->layout == RM_LAYOUT_ROW) {
+			zoneAddRecord(tmt->zoneMap, pageNum, page + slot * (tmt->recordSize + 1) + 1);
+		} else {
+			readSlot(rel, page, slot, row);
+			zoneAddRecord(tmt->zoneMap, pageNum, row);
+		}
+	}
+
+	// Snapshots may still see earlier versions of the records
+	for (MvccChain *chain = pageVersions(tmt->versions, pageNum); chain != NULL; chain = chain->next) {
+		for (MvccVersion *version = chain->head; chain->rid.page == pageNum && version != NULL; version = version->older) {
+			if (version->data != NULL)
+				zoneAddRecord(tmt->zoneMap, pageNum, version->data);
+		}
+	}
+}
+
+/* Evaluates the scan condition on record data; the values of an uncompiled condition come from the scan's arena */
+static bool matchesCondition(RMScanMgmtData *scanMgmtData, Schema *schema, char *data) {
+	Record inPlace;
+	Value *result;
+	ArenaMark mark;
+	bool match;
+
+	if (scanMgmtData->condition == NULL)
+		return TRUE;
+	if (scanMgmtData->program != NULL)
+		return evalCompiledExpr(scanMgmtData->program, data);
+
+	if (scanMgmtData->arena == NULL && (scanMgmtData->arena = createArena(0)) == NULL)
+		return FALSE;
+	mark = arenaMark(scanMgmtData->arena);
+	inPlace.data = data;
+	match = (evalExprIn(scanMgmtData->arena, &inPlace, schema, scanMgmtData->condition, &result) == RC_OK
+			&& result->v.boolV);
+	arenaRelease(scanMgmtData->arena, mark);
+	return match;
+}
+
+/**
+ * Function: filterPage
+ * -------------------
+ * Computes the slots of a pinned data page that hold a record matching the
+ * scan condition. Occupied slots are found with the marker kernel; a simple
+ * int/float comparison is evaluated for all slots at once by a vectorized
+ * kernel (reading only that attribute's minipage in PAX tables), everything
+ * else by the compiled condition on the occupied slots. Row records are
+ * evaluated in place, without copying them out of the page.
+ *
+ * @param scan      Scan handle whose mask is filled
+ * @param page      Data of the pinned page
+ * @param numSlots  Number of slots on the page
+ */
+static void filterPage(RM_ScanHandle *scan, char *page, int numSlots) {
+	RMScanMgmtData *scanMgmtData = (RMScanMgmtData *) scan->mgmtData;
+	RMTableMgmtData *tmt = (RMTableMgmtData *) scan->rel->mgmtData;
+	Schema *schema = scan->rel->schema;
+
+	kernelMarkerMask(page, markerStride(tmt), numSlots, '#', scanMgmtData->mask);
+
+	if (scanMgmtData->useKernel) {
+		ScanKernel *kernel = &scanMgmtData->kernel;
+		uint64_t hits[KERNEL_MASK_WORDS];
+		char *base = attrBase(scan->rel, page, kernel->attrNum);
+		int stride = attrStride(scan->rel, kernel->attrNum);
+
+		if (kernel->dt == DT_INT)
+			kernelFilterInt(base, stride, numSlots, kernel->cmp, kernel->negate, kernel->cons.intV, hits);
+		else
+			kernelFilterFloat(base, stride, numSlots, kernel->cmp, kernel->negate, kernel->cons.floatV, hits);
+		kernelAndMask(scanMgmtData->mask, hits, numSlots);
+
+		if (kernel->exact)
+			return;
+	}
+
+	if (scanMgmtData->condition == NULL)
+		return;
+
+	// Evaluate the (rest of the) condition on the remaining candidates
+	for (int slot = kernelNextBit(scanMgmtData->mask, 0, numSlots); slot >= 0;
+			slot = kernelNextBit(scanMgmtData->mask, slot + 1, numSlots)) {
+		char *data;
+
+		// Row records are evaluated in place, PAX records are assembled first
+		if (tmt->layout == RM_LAYOUT_ROW) {
+			data = page + slot * (tmt->recordSize + 1) + 1;
+		} else {
+			readSlot(scan->rel, page, slot, scanMgmtData->row);
+			data = scanMgmtData->row;
+		}
+
+		if (!matchesCondition(scanMgmtData, schema, data))
+			scanMgmtData->mask[slot >> 6] &= ~(((uint64_t) 1) << (slot & 63));
+	}
+}
+
+/* Copies the tuple a scan returns for a slot of a data page: the projected attributes only, or the whole record */
+static void readTuple(RM_ScanHandle *scan, char *page, int slot, char *tuple) {
+	RMScanMgmtData *scanMgmtData = (RMScanMgmtData *) scan->mgmtData;
+	int *offsets;
+
+	if (scanMgmtData->projSchema == NULL) {
+		readSlot(scan->rel, page, slot, tuple);
+		return;
+	}
+	offsets = scanMgmtData->projSchema->attrOffsets;
+	for (int i = 0; i < scanMgmtData->numProjected; i++) {
+		int attrNum = scanMgmtData->projected[i];
+		memcpy(tuple + offsets[i], attrBase(scan->rel, page, attrNum) + slot * attrStride(scan->rel, attrNum),
+				offsets[i + 1] - offsets[i]);
+	}
+}
+
+/* Copies the projected attributes of contiguous record data into a tuple */
+static void projectRecord(RM_ScanHandle *scan, char *data, char *tuple) {
+	RMScanMgmtData *scanMgmtData = (RMScanMgmtData *) scan->mgmtData;
+	int *offsets = scanMgmtData->projSchema->attrOffsets;
+
+	for (int i = 0; i < scanMgmtData->numProjected; i++)
+		memcpy(tuple + offsets[i], data + scan->rel->schema->attrOffsets[scanMgmtData->projected[i]],
+				offsets[i + 1] - offsets[i]);
+}
+
+/* Version of a record a scan sees; a scan outside a transaction whose timestamp is older than every version kept reads the oldest, which is committed */
+static MvccVersion *scanVersion(RMScanMgmtData *scanMgmtData, MvccChain *chain) {
+	MvccVersion *version = visibleVersion(chain, scanMgmtData->tx, scanMgmtData->snapshot);
+
+	if (version == NULL)
+		for (version = chain->head; version->older != NULL; version = version->older)
+			;
+	return version;
+}
+
+/**
+ * Function: snapshotPage
+ * ---------------------
+ * Filters a data page for a scan and copies out the tuples of the matching
+ * slots, as the scan's snapshot sees them, so that next() reads them without
+ * holding a pin or the latch. The page is filtered where it lies in the
+ * buffer pool; only the records that have versions are looked up in the
+ * version store, and their slots are decided on the version the scan sees.
+ * The caller holds the table latch shared, so the page does not change
+ * while it is read but other scans read pages at the same time.
+ *
+ * @param scan      Scan handle whose mask and tuples are filled
+ * @param pageNum   Page to read
+ * @return
+ *  -   RC_OK if the page was read
+ *  -   Errors of the buffer manager otherwise
+ */
+static RC snapshotPage(RM_ScanHandle *scan, int pageNum) {
+	RMScanMgmtData *scanMgmtData = (RMScanMgmtData *) scan->mgmtData;
+	RMTableMgmtData *tmt = (RMTableMgmtData *) scan->rel->mgmtData;
+	int size = getRecordSize(getScanSchema(scan));
+	int totalSlots = slotsPerPage(tmt);
+	BM_PageHandle page;
+	RC rc;
+
+	if ((rc = pinPage(&tmt->bufferPool, &page, pageNum)) != RC_OK)
+		return rc;
+	filterPage(scan, page.data, totalSlots);
+	for (int slot = kernelNextBit(scanMgmtData->mask, 0, totalSlots); slot >= 0;
+			slot = kernelNextBit(scanMgmtData->mask, slot + 1, totalSlots))
+		readTuple(scan, page.data, slot, scanMgmtData->page + slot * size);
+
+	// The page holds the newest version of records with versions, which the scan may not see
+	for (MvccChain *chain = pageVersions(tmt->versions, pageNum); chain != NULL; chain = chain->next) {
+		if (chain->rid.page != pageNum)
+			continue;
+		MvccVersion *version = scanVersion(scanMgmtData, chain);
+		int slot = chain->rid.slot;
+		uint64_t bit = ((uint64_t) 1) << (slot & 63);
+
+		if (version->data == NULL || !matchesCondition(scanMgmtData, scan->rel->schema, version->data)) {
+			scanMgmtData->mask[slot >> 6] &= ~bit;
+			continue;
+		}
+		scanMgmtData->mask[slot >> 6] |= bit;
+		if (scanMgmtData->projSchema != NULL)
+			projectRecord(scan, version->data, scanMgmtData->page + slot * size);
+		else
+			memcpy(scanMgmtData->page + slot * size, version->data, size);
+	}
+	return unpinPage(&tmt->bufferPool, &page);
+}
+
+/* Summarizes a page the zone map knows nothing about yet; takes the table latch exclusively, as the zone map changes */
+static RC summarizeUnknownPage(RM_ScanHandle *scan, int pageNum) {
+	RMTableMgmtData *tmt = (RMTableMgmtData *) scan->rel->mgmtData;
+	BM_PageHandle page;
+	RC rc = RC_OK;
+
+	pthread_rwlock_wrlock(&tmt->latch);
+	if (zoneState(tmt->zoneMap, pageNum) == ZONE_UNKNOWN && (rc = pinPage(&tmt->bufferPool, &page, pageNum)) == RC_OK) {
+		summarizePage(scan->rel, pageNum, page.data, ((RMScanMgmtData *) scan->mgmtData)->row);
+		rc = unpinPage(&tmt->bufferPool, &page);
+	}
+	pthread_rwlock_unlock(&tmt->latch);
+	return rc;
+}
+
+/*
+ * getRecord for the entry of an index scan; RC_TUPLE_WIT_RID_ON_EXISTING if the record has no committed
+ * version, or was already read through the entry of the other key that an uncommitted change gives it
+ */
+static RC readIndexed(RM_TableData *rel, RMIndexScan *indexScan, RID rid, Record *record) {
+	RMTableMgmtData *tmt = (RMTableMgmtData *) rel->mgmtData;
+	MvccChain *chain;
+	RC rc;
+
+	pthread_rwlock_wrlock(&tmt->latch);
+	rc = readVisible(rel, NULL, rid, record);
+	chain = findVersions(tmt->versions, rid);
+	if (rc == RC_OK && chain != NULL && chain->head->writer != NULL && chain->head->data != NULL
+			&& keyChanged(rel->schema, indexScan->index, chain->head->data, record->data)) {
+		for (int i = 0; i < indexScan->numPending && rc == RC_OK; i++) {
+			if (indexScan->pending[i].page == rid.page && indexScan->pending[i].slot == rid.slot)
+				rc = RC_TUPLE_WIT_RID_ON_EXISTING;
+		}
+		if (rc == RC_OK) {
+			indexScan->pending = (RID *) realloc(indexScan->pending, (indexScan->numPending + 1) * sizeof(RID));
+			indexScan->pending[indexScan->numPending++] = rid;
+		}
+	}
+	pthread_rwlock_unlock(&tmt->latch);
+	return rc;
+}
+
+/**
+ * Function: nextFromIndex
+ * ----------------------
+ * Retrieves the next record of an index scan that satisfies the whole scan
+ * condition. Once the index has no more entries, its scan is reopened, so
+ * that the scan starts over like a sequential one. A projecting scan reads
+ * the record into its scratch row and returns the projected attributes.
+ * Entries whose record has no committed version are skipped, and so is the
+ * second entry of a record whose key a transaction has changed but not
+ * committed.
+ *
+ * @param scan      Scan handle reading an index
+ * @param record    Record structure to populate with the next matching record
+ * @return
+ *  -   RC_OK if a matching record is found
+ *  -   RC_RM_NO_MORE_TUPLES if no more matching records exist
+ */
+static RC nextFromIndex(RM_ScanHandle *scan, Record *record) {
+	RMScanMgmtData *scanMgmtData = (RMScanMgmtData *) scan->mgmtData;
+	RMIndexScan *indexScan = &scanMgmtData->indexScan;
+	Record full, *target = record;
+	RID rid;
+	RC rc;
+
+	if (scanMgmtData->projSchema != NULL) {
+		full.data = scanMgmtData->row;
+		target = &full;
+	}
+	while ((rc = nextIndexRid(indexScan, &rid)) == RC_OK) {
+		// Records inserted by transactions that have not committed have entries but no visible version
+		if ((rc = readIndexed(scan->rel, indexScan, rid, target)) == RC_TUPLE_WIT_RID_ON_EXISTING)
+			continue;
+		if (rc != RC_OK)
+			return rc;
+		if (matchesCondition(scanMgmtData, scan->rel->schema, target->data)) {
+			if (target != record) {
+				projectRecord(scan, full.data, record->data);
+				record->id = full.id;
+			}
+			scanMgmtData->count++;
+			return RC_OK;
+		}
+	}
+	if (rc != RC_IM_NO_MORE_ENTRIES)
+		return rc;
+
+	closeIndexScan(indexScan);
+	scanMgmtData->count = 0;
+	if ((rc = openIndexScan(scan->rel, indexScan)) != RC_OK)
+		return rc;
+	return RC_RM_NO_MORE_TUPLES;
+}
+
+/**
+ * Function: loadPage
+ * -----------------
+ * Moves a sequential scan to the first page at or after its position that
+ * the zone map does not rule out, and makes its tuples and mask that
+ * page's, unless they are already (see snapshotPage). The pages are read
+ * with the table latch held shared. At the end of the pages the scan is
+ * reset to the start.
+ *
+ * @param scan      Scan handle reading the data pages
+ * @return
+ *  -   RC_OK if the page at rid.page is loaded
+ *  -   RC_RM_NO_MORE_TUPLES if no page is left
+ *  -   Errors of the buffer manager otherwise
+ */
+static RC loadPage(RM_ScanHandle *scan) {
+	RMScanMgmtData *scanMgmtData = (RMScanMgmtData *) scan->mgmtData;
+	RMTableMgmtData *tmt = (RMTableMgmtData *) scan->rel->mgmtData;
+	RC rc = RC_RM_NO_MORE_TUPLES;
+
+	pthread_rwlock_rdlock(&tmt->latch);
+	while ((tmt->numTuples > 0 || tmt->versions->numChains > 0) && scanMgmtData->rid.page <= tmt->firstFreePageNumber
+			&& (scanMgmtData->lastPage < 0 || scanMgmtData->rid.page <= scanMgmtData->lastPage)) {
+		int pageNum = scanMgmtData->rid.page;
+
+		// Skip pages whose zone map ranges rule out the condition without reading them;
+		// pages without a summary are read and get one, which changes the zone map
+		if (zoneState(tmt->zoneMap, pageNum) == ZONE_UNKNOWN) {
+			pthread_rwlock_unlock(&tmt->latch);
+			rc = summarizeUnknownPage(scan, pageNum);
+			pthread_rwlock_rdlock(&tmt->latch);
+			if (rc != RC_OK)
+				break;
+		} else if (!zoneMayMatch(tmt->zoneMap, pageNum, scanMgmtData->zonePreds, scanMgmtData->numZonePreds)) {
+			scanMgmtData->pagesSkipped++;
+			scanMgmtData->rid.page++;
+			scanMgmtData->rid.slot = 0;
+			continue;
+		}
+
+		// Filter the whole page when the scan first reaches it
+		rc = RC_OK;
+		if (scanMgmtData->maskPage != pageNum) {
+			scanMgmtData->maskPage = -1;
+			if ((rc = snapshotPage(scan, pageNum)) == RC_OK)
+				scanMgmtData->maskPage = pageNum;
+		}
+		break;
+	}
+	pthread_rwlock_unlock(&tmt->latch);
+	if (rc != RC_RM_NO_MORE_TUPLES)
+		return rc;
+
+	// Reset scan position for next scan; the next pass sees the commits made until it starts,
+	// while the workers of a parallel scan keep the timestamp taken when it started
+	scanMgmtData->rid.page = 2;
+	scanMgmtData->rid.slot = 0;
+	scanMgmtData->count = 0;
+	scanMgmtData->maskPage = -1;
+	if (scanMgmtData->tx == NULL && scanMgmtData->lastPage < 0)
+		scanMgmtData->snapshot = mvccCurrentTs();
+	return RC_RM_NO_MORE_TUPLES;
+}
+
+/**
+ * Function: next
+ * -------------
+ * Retrieves the next record that satisfies the scan condition.
+ * Pages whose zone map ranges show that no record can match are skipped
+ * without being read; pages without a summary get one when they are read.
+ * Pages are filtered as a whole the first time the scan reaches them, and
+ * the tuples of the matching slots are copied out with the record versions
+ * the scan sees (see snapshotPage); they are then handed out one per call, until the last page in
+ * use (or the last page of a parallel scan morsel) has been processed.
+ * Scans that read an index get their records from nextFromIndex.
+ * Projecting scans fill record->data with a tuple of getScanSchema(scan).
+ *
+ * @param scan      Scan handle containing scan state information
+ * @param record    Record structure to populate with the next matching record
+ * @return
+ *  -   RC_OK if a matching record is found
+ *  -   RC_RM_NO_MORE_TUPLES if no more matching records exist
+ */
+RC next(RM_ScanHandle *scan, Record *record) {
+	RMScanMgmtData *scanMgmtData = (RMScanMgmtData *) scan->mgmtData;
+	int totalSlots = slotsPerPage((RMTableMgmtData *) scan->rel->mgmtData);
+	int size = getRecordSize(getScanSchema(scan));
+	RC rc;
+
+	if (scanMgmtData->indexScan.index != NULL)
+		return nextFromIndex(scan, record);
+
+	while ((rc = loadPage(scan)) == RC_OK) {
+		int slot = kernelNextBit(scanMgmtData->mask, scanMgmtData->rid.slot, totalSlots);
+		if (slot >= 0) {
+			// Copy the tuple (only the projected attributes, if any) and set record ID
+			memcpy(record->data, scanMgmtData->page + slot * size, size);
+			record->id.page = scanMgmtData->rid.page;
+			record->id.slot = slot;
+
+			scanMgmtData->rid.slot = slot + 1;
+			scanMgmtData->count++;
+			return RC_OK;
+		}
+
+		// No more matches on this page, move to the next one
+		scanMgmtData->rid.page++;
+		scanMgmtData->rid.slot = 0;
+	}
+	return rc;
+}
+
+/**
+ * Function: nextBatch
+ * ------------------
+ * Retrieves up to maxTuples matching tuples at once, stored back to back in
+ * tuples (getRecordSize(getScanSchema(scan)) bytes each), so that callers
+ * handle a page worth of results per call. Like next(), the scan starts over
+ * after reporting its end.
+ *
+ * @param scan      Scan handle containing scan state information
+ * @param tuples    Filled with the tuples
+ * @param ids       Filled with the RIDs of the tuples; may be NULL
+ * @param maxTuples Capacity of tuples and ids
+ * @param numTuples Set to the number of tuples returned
+ * @return
+ *  -   RC_OK if at least one tuple was returned
+ *  -   RC_RM_NO_MORE_TUPLES if the previous call returned the last ones
+ */
+RC nextBatch(RM_ScanHandle *scan, char *tuples, RID *ids, int maxTuples, int *numTuples) {
+	RMScanMgmtData *scanMgmtData = (RMScanMgmtData *) scan->mgmtData;
+	int size = getRecordSize(getScanSchema(scan));
+	Record tuple;
+	RC rc = RC_OK;
+
+	*numTuples = 0;
+	if (scanMgmtData->endPending) {
+		scanMgmtData->endPending = FALSE;
+		return RC_RM_NO_MORE_TUPLES;
+	}
+	while (*numTuples < maxTuples) {
+		tuple.data = tuples + (long) *numTuples * size;
+		if ((rc = next(scan, &tuple)) != RC_OK)
+			break;
+		if (ids != NULL)
+			ids[*numTuples] = tuple.id;
+		(*numTuples)++;
+	}
+
+	// The scan has already started over; the end is reported by the next call
+	if (rc == RC_RM_NO_MORE_TUPLES && *numTuples > 0) {
+		scanMgmtData->endPending = TRUE;
+		return RC_OK;
+	}
+	return rc;
+}
+
+/**
+ * Function: closeScan
+ * ------------------
+ * Closes a scan operation and frees associated resources.
+ * next() does not keep pages pinned between calls, so only the scan
+ * management data has to be freed.
+ *
+ * @param scan      Scan handle to be closed
+ * @return
+ *  -   RC_OK if scan is successfully closed
+ */
+RC closeScan(RM_ScanHandle *scan) {
+	RMScanMgmtData *rmScanMgmtData = (RMScanMgmtData *) scan->mgmtData;
+	RMTableMgmtData *tmt = (RMTableMgmtData *) scan->rel->mgmtData;
+
+	pthread_rwlock_wrlock(&tmt->latch);
+	tmt->activeScans--;
+	pthread_rwlock_unlock(&tmt->latch);
+
+	// Free scan management data
+	if (rmScanMgmtData->indexScan.index != NULL)
+		closeIndexScan(&rmScanMgmtData->indexScan);
+	freeCompiledExpr(rmScanMgmtData->program);
+	free(rmScanMgmtData->row);
+	free(rmScanMgmtData->page);
+	freeArena(rmScanMgmtData->arena);
+	free(rmScanMgmtData->projected);
+	freeSchema(rmScanMgmtData->projSchema);
+	free(scan->mgmtData);
+	scan->mgmtData = NULL;
+	return RC_OK;
+}
+
+/**
+ * Function: getScanArena
+ * ---------------------
+ * Returns the arena of a scan, for records and values that live as long as
+ * the scan (see createRecordIn and getAttrIn). closeScan releases all of
+ * them at once.
+ *
+ * @param scan  Open scan
+ * @return
+ *  -   The arena of the scan, NULL if out of memory
+ */
+RM_Arena *getScanArena(RM_ScanHandle *scan) {
+	RMScanMgmtData *rmScanMgmtData = (RMScanMgmtData *) scan->mgmtData;
+
+	if (rmScanMgmtData->arena == NULL)
+		rmScanMgmtData->arena = createArena(0);
+	return rmScanMgmtData->arena;
+}
+
+/*
+ * Parallel scans split the data pages into morsels of RM_MORSEL_PAGES pages.
+ * Every worker owns a queue holding a contiguous range of morsels and takes
+ * them from the front; a worker whose queue runs dry steals the back half of
+ * another worker's remaining range, so slow workers do not hold up the scan.
+ */
+#define RM_MORSEL_PAGES 4
+
+typedef struct MorselQueue {
+	pthread_mutex_t lock;
+	int next;	// first morsel not taken yet
+	int end;	// one past the last morsel of the queue
+} MorselQueue;
+
+typedef struct ParallelScanData {
+	RM_TableData *rel;
+	RM_ScanConsumer consumer;
+	void *context;
+	int numWorkers;
+	MorselQueue *queues;	// one per worker
+	RM_ScanHandle *scans;	// one per worker, each with its own compiled condition
+	pthread_mutex_t statusLock;
+	RC status;	// first error reported by a worker
+} ParallelScanData;
+
+typedef struct ParallelScanWorker {
+	ParallelScanData *data;
+	int id;
+	pthread_t thread;
+} ParallelScanWorker;
+
+/* Takes the next morsel of a worker, stealing from the other queues when its own is empty */
+static bool takeMorsel(ParallelScanData *data, int id, int *morsel) {
+	MorselQueue *own = &data->queues[id];
+	int first = 0, end = 0;
+
+	pthread_mutex_lock(&own->lock);
+	if (own->next < own->end)
+		*morsel = own->next++;
+	else
+		*morsel = -1;
+	pthread_mutex_unlock(&own->lock);
+	if (*morsel >= 0)
+		return TRUE;
+
+	// Steal the back half of the first non-empty queue
+	for (int i = 1; i < data->numWorkers && first == end; i++) {
+		MorselQueue *victim = &data->queues[(id + i) % data->numWorkers];
+
+		pthread_mutex_lock(&victim->lock);
+		if (victim->next < victim->end) {
+			end = victim->end;
+			first = end - (end - victim->next + 1) / 2;
+			victim->end = first;
+		}
+		pthread_mutex_unlock(&victim->lock);
+	}
+	if (first == end)
+		return FALSE;
+
+	pthread_mutex_lock(&own->lock);
+	own->next = first + 1;
+	own->end = end;
+	pthread_mutex_unlock(&own->lock);
+	*morsel = first;
+	return TRUE;
+}
+
+static RC parallelScanStatus(ParallelScanData *data) {
+	pthread_mutex_lock(&data->statusLock);
+	RC rc = data->status;
+	pthread_mutex_unlock(&data->statusLock);
+	return rc;
+}
+
+/* Scans morsels with the worker's own scan handle until no work is left or a worker failed */
+static void *parallelScanWorker(void *arg) {
+	ParallelScanWorker *worker = (ParallelScanWorker *) arg;
+	ParallelScanData *data = worker->data;
+	RM_ScanHandle *scan = &data->scans[worker->id];
+	RMScanMgmtData *scanMgmtData = (RMScanMgmtData *) scan->mgmtData;
+	Record *record;
+	int morsel;
+	RC rc = RC_OK;
+
+	createRecord(&record, data->rel->schema);
+	while (parallelScanStatus(data) == RC_OK && takeMorsel(data, worker->id, &morsel)) {
+		scanMgmtData->rid.page = 2 + morsel * RM_MORSEL_PAGES;
+		scanMgmtData->rid.slot = 0;
+		scanMgmtData->lastPage = scanMgmtData->rid.page + RM_MORSEL_PAGES - 1;
+
+		while ((rc = next(scan, record)) == RC_OK && (rc = data->consumer(record, worker->id, data->context)) == RC_OK)
+			;
+		if (rc != RC_RM_NO_MORE_TUPLES)
+			break;
+		rc = RC_OK;
+	}
+	freeRecord(record);
+
+	if (rc != RC_OK) {
+		pthread_mutex_lock(&data->statusLock);
+		if (data->status == RC_OK)
+			data->status = rc;
+		pthread_mutex_unlock(&data->statusLock);
+	}
+	return NULL;
+}
+
+/**
+ * Function: getScanSkippedPages
+ * ----------------------------
+ * Returns the number of pages the scan skipped because of the zone map.
+ *
+ * @param scan      Scan handle
+ * @return
+ *  -   Number of pages skipped since startScan
+ */
+int getScanSkippedPages(RM_ScanHandle *scan) {
+	return ((RMScanMgmtData *) scan->mgmtData)->pagesSkipped;
+}
+
+/**
+ * Function: setAccessPath
+ * ----------------------
+ * Sets how scans started on an open table choose between reading the data
+ * pages and reading an index. The default, RM_PATH_AUTO, decides by the
+ * estimated cost; the other settings force either path (an index is still
+ * only used if one answers a predicate of the condition), e.g. to compare
+ * them in benchmarks. The setting is not stored with the table.
+ *
+ * @param rel       Table data structure
+ * @param path      Access path setting
+ * @return
+ *  -   RC_OK
+ */
+RC setAccessPath(RM_TableData *rel, RM_AccessPath path) {
+	((RMTableMgmtData *) rel->mgmtData)->accessPath = path;
+	return RC_OK;
+}
+
+/* RM_PATH_INDEX if the scan reads an index, RM_PATH_SEQUENTIAL if it reads the data pages */
+RM_AccessPath getScanAccessPath(RM_ScanHandle *scan) {
+	return (((RMScanMgmtData *) scan->mgmtData)->indexScan.index != NULL) ? RM_PATH_INDEX : RM_PATH_SEQUENTIAL;
+}
+
+/**
+ * Function: parallelScan
+ * ---------------------
+ * Scans a table with several threads and hands every record matching the
+ * condition to a consumer callback.
+ * The data pages are split into morsels that the workers take from
+ * work-stealing queues; each worker filters its pages with the same page
+ * kernels as next(). The consumer is called from the worker threads, with the
+ * worker number (0 .. numThreads - 1) so that results can be collected into
+ * per-worker batches without locking; the record passed in is reused after
+ * the call returns. Records are delivered in no particular order. The table
+ * is locked shared for the scan, so it waits for transactions that have
+ * written to the table, and writers wait for the scan to finish.
+ * The number of threads is capped at the size of the table's buffer pool,
+ * since every worker keeps one page pinned while filtering it.
+ *
+ * @param rel           Table to scan
+ * @param cond          Condition to filter records (can be NULL for all records)
+ * @param numThreads    Number of worker threads, including the calling thread
+ * @param consumer      Callback receiving the matching records
+ * @param context       Passed through to the consumer
+ * @return
+ *  -   RC_OK if all matching records have been consumed
+ *  -   RC_INVALID_PARAM if numThreads is less than 1 or consumer is NULL
+ *  -   RC_RM_DEADLOCK or RC_RM_LOCK_TIMEOUT if the table could not be locked
+ *  -   Type errors of the condition if it cannot be evaluated against the schema
+ *  -   The first error returned by the consumer, which stops the scan
+ */
+RC parallelScan(RM_TableData *rel, Expr *cond, int numThreads, RM_ScanConsumer consumer, void *context) {
+	RMTableMgmtData *tmt = (RMTableMgmtData *) rel->mgmtData;
+	ParallelScanData data;
+	ParallelScanWorker *workers;
+	LockOwner owner;
+	int lastPage, numMorsels, i;
+	RC rc = RC_OK;
+
+	if (numThreads < 1 || consumer == NULL)
+		return RC_INVALID_PARAM;
+	if (numThreads > tmt->bufferPool.numPages)
+		numThreads = tmt->bufferPool.numPages;
+
+	// The pages stay as last committed while the workers read them
+	initLockOwner(&owner);
+	if ((rc = lockAcquire(&owner, tmt, tableLockId, LOCK_S)) != RC_OK) {
+		destroyLockOwner(&owner);
+		return rc;
+	}
+	lastPage = tmt->firstFreePageNumber;
+
+	data.rel = rel;
+	data.consumer = consumer;
+	data.context = context;
+	data.numWorkers = numThreads;
+	data.status = RC_OK;
+	data.queues = (MorselQueue *) malloc(sizeof(MorselQueue) * numThreads);
+	data.scans = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle) * numThreads);
+	workers = (ParallelScanWorker *) malloc(sizeof(ParallelScanWorker) * numThreads);
+
+	// One scan per worker: compiled conditions keep their registers in the program
+	for (i = 0; i < numThreads && rc == RC_OK; i++)
+		rc = startTableScan(rel, &data.scans[i], cond, RM_PATH_SEQUENTIAL);
+	if (rc != RC_OK) {
+		for (int j = 0; j < i - 1; j++)
+			closeScan(&data.scans[j]);
+		free(workers);
+		free(data.scans);
+		free(data.queues);
+		lockReleaseAll(&owner);
+		destroyLockOwner(&owner);
+		return rc;
+	}
+
+	// Hand every worker an equal share of the morsels
+	numMorsels = (lastPage >= 2) ? (lastPage - 2) / RM_MORSEL_PAGES + 1 : 0;
+	for (i = 0; i < numThreads; i++) {
+		pthread_mutex_init(&data.queues[i].lock, NULL);
+		data.queues[i].next = (int) ((long) numMorsels * i / numThreads);
+		data.queues[i].end = (int) ((long) numMorsels * (i + 1) / numThreads);
+		workers[i].data = &data;
+		workers[i].id = i;
+	}
+	pthread_mutex_init(&data.statusLock, NULL);
+
+	// Worker 0 runs on the calling thread; the morsels of threads that cannot be started get stolen
+	for (i = 1; i < numThreads; i++) {
+		if (pthread_create(&workers[i].thread, NULL, parallelScanWorker, &workers[i]) != 0)
+			workers[i].id = -1;
+	}
+	parallelScanWorker(&workers[0]);
+	for (i = 1; i < numThreads; i++) {
+		if (workers[i].id >= 0)
+			pthread_join(workers[i].thread, NULL);
+	}
+
+	for (i = 0; i < numThreads; i++) {
+		closeScan(&data.scans[i]);
+		pthread_mutex_destroy(&data.queues[i].lock);
+	}
+	pthread_mutex_destroy(&data.statusLock);
+	free(workers);
+	free(data.scans);
+	free(data.queues);
+	lockReleaseAll(&owner);
+	destroyLockOwner(&owner);
+	return data.status;
+}
+
+/**
+ * Function: changeWhere
+ * --------------------
+ * Deletes or updates all records matching a condition in one pass over the
+ * data pages. Each page is pinned once: the condition is evaluated with the
+ * page kernels of a scan, the matching records are changed in place and the
+ * page is marked dirty once. The table is locked exclusively for the pass,
+ * so no transaction has uncommitted changes in it and the pages hold the
+ * records as last committed. The changes commit together: snapshots see all
+ * of them or none. An error stops the pass; the records changed before it
+ * stay changed and are counted.
  *
  * @param rel	Table data structure
- * @param id	Record ID to retrieve
- * @param record	Record to be inserted
+ * @param cond	Condition selecting the records, NULL for all records
+ * @param op	RM_WRITE_DELETE or RM_WRITE_UPDATE
+ * @param assignments	New attribute values of updated records
+ * @param numAssignments	Number of assignments
+ * @param numChanged	Set to the number of records changed
  * @return
- *	-	RC_OK - If record insertion is successful
+ *	-	RC_OK if all matching records were changed
+ *	-	RC_RM_DEADLOCK or RC_RM_LOCK_TIMEOUT if the table could not be locked
+ *	-	Type errors of the condition, errors of deleteRecord and updateRecord otherwise
  */
-RC getRecord(RM_TableData *rel, RID id, Record *record) {
+static RC changeWhere(RM_TableData *rel, Expr *cond, RMWriteOp op, RM_Assignment *assignments, int numAssignments, int *numChanged) {
+	RMTableMgmtData *tmt = (RMTableMgmtData *) rel->mgmtData;
+	int totalSlots = slotsPerPage(tmt);
+	RMScanMgmtData *scanData;
+	RM_ScanHandle scan;
+	LockOwner owner;
+	MvccTs commitTs;
+	WalLsn lsn = 0;
+	Record row;
+	char *old;
+	bool keep;
 	RC rc;
-	RMTableMgmtData *rmTableMgmtData = rel->mgmtData;
 
-	// Pin the page containing the record
-	if ((rc = pinPage(&rmTableMgmtData->bufferPool, &rmTableMgmtData->pageHandle, id.page)) != RC_OK) {
+	*numChanged = 0;
+	initLockOwner(&owner);
+	if ((rc = lockAcquire(&owner, tmt, tableLockId, LOCK_X)) != RC_OK
+			|| (rc = startTableScan(rel, &scan, cond, RM_PATH_SEQUENTIAL)) != RC_OK) {
+		lockReleaseAll(&owner);
+		destroyLockOwner(&owner);
 		return rc;
 	}
+	scanData = (RMScanMgmtData *) scan.mgmtData;
+	old = (char *) malloc(tmt->recordSize);
+	row.data = (char *) malloc(tmt->recordSize);
+
+	pthread_rwlock_wrlock(&tmt->latch);
+	commitTs = mvccStartCommit();
+	keep = mvccSnapshotsActive();
+	for (int pageNum = 2; rc == RC_OK && tmt->numTuples > 0 && pageNum <= tmt->firstFreePageNumber; pageNum++) {
+		BM_PageHandle page;
+		bool dirty = FALSE;
+
+		if (!zoneMayMatch(tmt->zoneMap, pageNum, scanData->zonePreds, scanData->numZonePreds))
+			continue;
+		if ((rc = pinPage(&tmt->bufferPool, &page, pageNum)) != RC_OK)
+			break;
+		if (zoneState(tmt->zoneMap, pageNum) == ZONE_UNKNOWN)
+			summarizePage(rel, pageNum, page.data, scanData->row);
+		filterPage(&scan, page.data, totalSlots);
+
+		for (int slot = kernelNextBit(scanData->mask, 0, totalSlots); slot >= 0;
+				slot = kernelNextBit(scanData->mask, slot + 1, totalSlots)) {
+			RID id = { pageNum, slot };
+			bool versioned = keep || findVersions(tmt->versions, id) != NULL;
+
+			readSlot(rel, page.data, slot, old);
+			if (op == RM_WRITE_DELETE) {
+				rc = deleteInPage(rel, page.data, id, old, NULL, &lsn);
+			} else {
+				memcpy(row.data, old, tmt->recordSize);
+				row.id = id;
+				for (int i = 0; i < numAssignments; i++)
+					setAttr(&row, rel->schema, assignments[i].attrNum, assignments[i].value);
+				rc = updateInPage(rel, page.data, &row, old, NULL, &lsn);
+			}
+			if (rc != RC_OK)
+				break;
 
-	// Calculate record size and slot address
-	int recordSize = rmTableMgmtData->recordSize + 1;
-	char *recordSlotAddress = rmTableMgmtData->pageHandle.data + (id.slot * recordSize);
+			dirty = TRUE;
+			(*numChanged)++;
+			if (versioned)
+				addVersion(tmt->versions, id, old, NULL, commitTs, (op == RM_WRITE_DELETE) ? NULL : row.data);
+		}
 
-	// Check if record exists (marked with "#")
-	if (*recordSlotAddress != '#') {
-		unpinPage(&rmTableMgmtData->bufferPool, &rmTableMgmtData->pageHandle);
-		return RC_TUPLE_WIT_RID_ON_EXISTING;
+		if (dirty)
+			markDirty(&tmt->bufferPool, &page);
+		unpinPage(&tmt->bufferPool, &page);
 	}
+	mvccFinishCommit(commitTs);
+
+	if (tmt->versions->numVersions >= tmt->versions->collectAt)
+		collectVersions(tmt->versions, mvccHorizon());
+	if (*numChanged > 0) {
+		RC checkpointRc = checkpointIfDue(rel);
+		if (rc == RC_OK)
+			rc = checkpointRc;
+	}
+	pthread_rwlock_unlock(&tmt->latch);
 
-	// Copy record data to the provided record structure
-	memcpy(record->data, recordSlotAddress + 1, recordSize - 1);
-	record->id = id;
-
-	// Unpin the page
-	return unpinPage(&rmTableMgmtData->bufferPool, &rmTableMgmtData->pageHandle);
+	// Commit: the log records of all changes become durable with one sync
+	if (*numChanged > 0 && tmt->wal != NULL) {
+		RC flushRc = walFlush(tmt->wal, lsn);
+		if (rc == RC_OK)
+			rc = flushRc;
+	}
+	closeScan(&scan);
+	free(row.data);
+	free(old);
+	lockReleaseAll(&owner);
+	destroyLockOwner(&owner);
+	return rc;
 }
 
-
 /**
- * Function: startScan
- * ------------------
- * Initializes a scan operation on the table.
- * This function sets up the scan handle with the necessary data to perform
- * a sequential scan of the table records, optionally filtering by a condition.
+ * Function: deleteWhere
+ * --------------------
+ * Deletes all records matching a condition, without collecting their RIDs
+ * first (see changeWhere).
  *
- * @param rel       Table data structure to scan
- * @param scan      Scan handle to be initialized
- * @param cond      Expression condition to filter records (can be NULL for all records)
+ * @param rel	Table data structure
+ * @param cond	Condition selecting the records, NULL for all records
+ * @param numDeleted	Set to the number of records deleted
  * @return
- *  -   RC_OK if scan initialization is successful
+ *	-	RC_OK if all matching records were deleted
+ *	-	Errors of changeWhere otherwise
  */
-RC startScan(RM_TableData *rel, RM_ScanHandle *scan, Expr *cond) {
-	// Set the relation for the scan
-	scan->rel = rel;
-
-	// Allocate and initialize scan management data
-	RMScanMgmtData *rmScanMgmtData = (RMScanMgmtData *) malloc(sizeof(RMScanMgmtData));
-
-	// Initialize scan to start at the first data page (page 2) and first slot
-	rmScanMgmtData->rid.page = 2;
-	rmScanMgmtData->rid.slot = 0;
-	rmScanMgmtData->count = 0;
-	rmScanMgmtData->condition = cond;
-
-	// Attach management data to scan handle
-	scan->mgmtData = rmScanMgmtData;
+RC deleteWhere(RM_TableData *rel, Expr *cond, int *numDeleted) {
+	return changeWhere(rel, cond, RM_WRITE_DELETE, NULL, 0, numDeleted);
+}
 
-	return RC_OK;
+/**
+ * Function: updateWhere
+ * --------------------
+ * Sets attributes of all records matching a condition to constant values in
+ * one pass (see changeWhere). The condition is evaluated on the records
+ * before the update.
+ *
+ * @param rel	Table data structure
+ * @param cond	Condition selecting the records, NULL for all records
+ * @param assignments	Attributes to set and their values
+ * @param numAssignments	Number of assignments
+ * @param numUpdated	Set to the number of records updated
+ * @return
+ *	-	RC_OK if all matching records were updated
+ *	-	RC_INVALID_PARAM if an assignment names no attribute of the schema
+ *	-	RC_RM_WRONG_DATATYPE if a value does not have the type of its attribute
+ *	-	RC_IM_KEY_ALREADY_EXISTS if a unique index already has a new key
+ *	-	Errors of changeWhere otherwise
+ */
+RC updateWhere(RM_TableData *rel, Expr *cond, RM_Assignment *assignments, int numAssignments, int *numUpdated) {
+	*numUpdated = 0;
+	for (int i = 0; i < numAssignments; i++) {
+		int attrNum = assignments[i].attrNum;
+
+		if (attrNum < 0 || attrNum >= rel->schema->numAttr || assignments[i].value == NULL)
+			return RC_INVALID_PARAM;
+		if (assignments[i].value->dt != rel->schema->dataTypes[attrNum])
+			return RC_RM_WRONG_DATATYPE;
+	}
+	return changeWhere(rel, cond, RM_WRITE_UPDATE, assignments, numAssignments, numUpdated);
 }
 
 /**
- * Function: next
- * -------------
- * Retrieves the next record that satisfies the scan condition.
- * This function iterates through table records, evaluating each against
- * the scan condition until a match is found or the end of table is reached.
+ * Function: aggregateScan
+ * ----------------------
+ * Computes aggregates over the tuples a scan returns from its position on,
+ * grouped by the values of the group-by attributes (attribute numbers refer
+ * to getScanSchema(scan)). Groups live in an open-addressing hash table with
+ * their keys and accumulators inline (see rm_aggregate.c). Sequential scans
+ * are aggregated inside the page loop: the values are read where they lie
+ * in the tuples copied out of the filtered page, nothing is copied per record, and a single
+ * group is updated without hashing; counting alone adds up the page masks.
+ * Index scans aggregate the tuples next() returns. The scan starts over
+ * afterwards, as after next() has returned RC_RM_NO_MORE_TUPLES.
  *
- * @param scan      Scan handle containing scan state information
- * @param record    Record structure to populate with the next matching record
+ * @param scan          Open scan
+ * @param groupBy       Group-by attributes
+ * @param numGroupBy    Number of group-by attributes, 0 for one group of all tuples
+ * @param aggs          Aggregates to compute
+ * @param numAggs       Number of aggregates
+ * @param result        Set to one tuple per group, freed with freeAggResult
  * @return
- *  -   RC_OK if a matching record is found
- *  -   RC_RM_NO_MORE_TUPLES if no more matching records exist
+ *  -   RC_OK if the aggregates have been computed
+ *  -   Errors of createAggPlan, or of the scan otherwise
  */
-RC next(RM_ScanHandle *scan, Record *record) {
+RC aggregateScan(RM_ScanHandle *scan, int *groupBy, int numGroupBy, RM_Aggregate *aggs, int numAggs, RM_AggResult **result) {
 	RMScanMgmtData *scanMgmtData = (RMScanMgmtData *) scan->mgmtData;
-	RMTableMgmtData *tmt = (RMTableMgmtData *) scan->rel->mgmtData;
-
-	Value *result = (Value *) malloc(sizeof(Value));
-	static char *data;
-
-	int recordSize = tmt->recordSize + 1;
-	int totalSlots = floor(PAGE_SIZE/recordSize);
-
-	// Return early if table is empty
-	if (tmt->numTuples == 0)
-		return RC_RM_NO_MORE_TUPLES;
-
-	// Scan through records until we find a match or reach the end
-	while (scanMgmtData->count <= tmt->numTuples) {
-		// Initialize scan position if this is the first call
-		if (scanMgmtData->count <= 0) {
-			scanMgmtData->rid.page = 2;
-			scanMgmtData->rid.slot = 0;
-
-			pinPage(&tmt->bufferPool, &scanMgmtData->pHandle, scanMgmtData->rid.page);
-			data = scanMgmtData->pHandle.data;
-		} else {
-			// Move to next slot
-			scanMgmtData->rid.slot++;
+	Schema *schema = getScanSchema(scan);
+	int totalSlots = slotsPerPage((RMTableMgmtData *) scan->rel->mgmtData);
+	char **groupCols, **aggCols;
+	AggPlan *plan;
+	RC rc;
 
-			// If we've reached the end of the page, move to next page
-			if (scanMgmtData->rid.slot >= totalSlots) {
-				scanMgmtData->rid.slot = 0;
-				scanMgmtData->rid.page++;
+	if ((rc = createAggPlan(schema, groupBy, numGroupBy, aggs, numAggs, &plan)) != RC_OK)
+		return rc;
+	groupCols = (char **) malloc((numGroupBy + 1) * sizeof(char *));
+	aggCols = (char **) calloc(numAggs + 1, sizeof(char *));
+
+	if (scanMgmtData->indexScan.index != NULL) {
+		Record tuple;
+
+		tuple.data = (char *) malloc(getRecordSize(schema));
+		while ((rc = next(scan, &tuple)) == RC_OK) {
+			for (int i = 0; i < numGroupBy; i++)
+				groupCols[i] = tuple.data + schema->attrOffsets[groupBy[i]];
+			for (int i = 0; i < numAggs; i++) {
+				if (aggs[i].func != RM_AGG_COUNT)
+					aggCols[i] = tuple.data + schema->attrOffsets[aggs[i].attrNum];
 			}
-
-			pinPage(&tmt->bufferPool, &scanMgmtData->pHandle, scanMgmtData->rid.page);
-			data = scanMgmtData->pHandle.data;
+			aggAddRow(plan, groupCols, aggCols);
 		}
-
-		// Calculate address of record data (skip marker byte)
-		data = data + (scanMgmtData->rid.slot * recordSize) + 1;
-
-		// Set record ID
-		record->id.page = scanMgmtData->rid.page;
-		record->id.slot = scanMgmtData->rid.slot;
-		scanMgmtData->count++;
-
-		// Copy record data
-		memcpy(record->data, data, recordSize-1);
-
-		// Evaluate condition if one exists
-		if (scanMgmtData->condition != NULL) {
-			evalExpr(record, (scan->rel)->schema, scanMgmtData->condition, &result);
-		} else {
-			result->v.boolV = TRUE; // When no condition, return all records
+		free(tuple.data);
+	} else {
+		// The tuples of a page stay at one address, so the attributes of slot 0 are found once
+		char **groupBase = (char **) malloc((numGroupBy + 1) * sizeof(char *));
+		char **aggBase = (char **) calloc(numAggs + 1, sizeof(char *));
+		int stride = getRecordSize(schema);
+
+		for (int i = 0; i < numGroupBy; i++)
+			groupBase[i] = scanMgmtData->page + schema->attrOffsets[groupBy[i]];
+		for (int i = 0; i < numAggs; i++) {
+			if (aggs[i].func != RM_AGG_COUNT)
+				aggBase[i] = scanMgmtData->page + schema->attrOffsets[aggs[i].attrNum];
 		}
 
-		// If condition is satisfied, return the record
-		if (result->v.boolV == TRUE) {
-			unpinPage(&tmt->bufferPool, &scanMgmtData->pHandle);
-			return RC_OK;
-		} else {
-			unpinPage(&tmt->bufferPool, &scanMgmtData->pHandle);
+		while ((rc = loadPage(scan)) == RC_OK) {
+			if (plan->countOnly && numGroupBy == 0) {
+				aggAddCount(plan, kernelCountBits(scanMgmtData->mask, scanMgmtData->rid.slot, totalSlots));
+			} else {
+				for (int slot = kernelNextBit(scanMgmtData->mask, scanMgmtData->rid.slot, totalSlots); slot >= 0;
+						slot = kernelNextBit(scanMgmtData->mask, slot + 1, totalSlots)) {
+					for (int i = 0; i < numGroupBy; i++)
+						groupCols[i] = groupBase[i] + slot * stride;
+					for (int i = 0; i < numAggs; i++) {
+						if (aggBase[i] != NULL)
+							aggCols[i] = aggBase[i] + slot * stride;
+					}
+					aggAddRow(plan, groupCols, aggCols);
+				}
+			}
+			scanMgmtData->rid.page++;
+			scanMgmtData->rid.slot = 0;
 		}
+		free(groupBase);
+		free(aggBase);
 	}
 
-	// Reset scan position for next scan
-	scanMgmtData->rid.page = 2;
-	scanMgmtData->rid.slot = 0;
-	scanMgmtData->count = 0;
-	return RC_RM_NO_MORE_TUPLES;
+	if (rc == RC_RM_NO_MORE_TUPLES)
+		rc = aggResult(plan, result);
+	free(groupCols);
+	free(aggCols);
+	freeAggPlan(plan);
+	return rc;
 }
 
-/**
- * Function: closeScan
- * ------------------
- * Closes a scan operation and frees associated resources.
- * This function unpins any pinned pages and frees the scan management data.
- *
- * @param scan      Scan handle to be closed
- * @return
- *  -   RC_OK if scan is successfully closed
- */
-RC closeScan(RM_ScanHandle *scan) {
-	RMScanMgmtData *rmScanMgmtData = (RMScanMgmtData *) scan->mgmtData;
-	RMTableMgmtData *rmTableMgmtData = (RMTableMgmtData *) scan->rel->mgmtData;
-
-	// Unpin page if scan was active
-	if (rmScanMgmtData->count > 0) {
-		unpinPage(&rmTableMgmtData->bufferPool, &rmTableMgmtData->pageHandle);
-	}
-
-	// Free scan management data
-	free(scan->mgmtData);
-	scan->mgmtData = NULL;
+RC freeAggResult(RM_AggResult *result) {
+	if (result == NULL)
+		return RC_OK;
+	freeSchema(result->schema);
+	free(result->rows);
+	free(result);
 	return RC_OK;
 }
 
 /**
  * Function: getRecordSize
  * ----------------------
- * Calculates the size of a record based on the schema.
- * This function sums up the size of each attribute based on its data type.
+ * Returns the size of a record of the schema, the end of its last attribute
+ * in the offset table that createSchema builds.
  *
  * @param schema	Schema defining the record structure
  * @return
  *  -   Total size of the record in bytes
  */
 int getRecordSize(Schema *schema) {
-	int size = 0;
-
-	// Calculate size based on each attribute's data type
-	for (int i = 0; i < schema->numAttr; ++i) {
-		switch (schema->dataTypes[i]) {
-			case DT_STRING:
-				size += schema->typeLength[i];
-			break;
-			case DT_INT:
-				size += sizeof(int);
-			break;
-			case DT_FLOAT:
-				size += sizeof(float);
-			break;
-			case DT_BOOL:
-				size += sizeof(bool);
-			break;
-			default:
-				break;
-		}
-	}
-	return size;
+	return schema->attrOffsets[schema->numAttr];
 }
 
 /**
  * Function: createSchema
  * ---------------------
  * Creates a new schema with the given attributes.
- * This function allocates memory for the schema and initializes its fields.
+ * This function allocates memory for the schema, initializes its fields and
+ * precomputes the attribute offsets.
  *
  * @param numAttr       Number of attributes in the schema
  * @param attrNames     Array of attribute names
@@ -704,6 +4511,7 @@ Schema *createSchema(int numAttr, char **attrNames, DataType *dataTypes, int *ty
 	schema->typeLength = typeLength;
 	schema->keySize = keySize;
 	schema->keyAttrs = keys;
+	schema->attrOffsets = computeAttrOffsets(schema);
 
 	return schema;
 }
@@ -733,6 +4541,7 @@ RC freeSchema(Schema *schema) {
 		if (schema->dataTypes) free(schema->dataTypes);
 		if (schema->typeLength) free(schema->typeLength);
 		if (schema->keyAttrs) free(schema->keyAttrs);
+		if (schema->attrOffsets) free(schema->attrOffsets);
 
 		// Free schema structure itself
 		free(schema);
@@ -740,6 +4549,41 @@ RC freeSchema(Schema *schema) {
 	return RC_OK;
 }
 
+/**
+ * Function: projectSchema
+ * ----------------------
+ * Creates the schema of tuples holding some attributes of a schema, in the
+ * given order. The new schema has no key.
+ *
+ * @param schema    Schema the attributes are taken from
+ * @param attrs     Attribute numbers in schema
+ * @param numAttrs  Number of attributes
+ * @return
+ *  -   The new schema, NULL if an attribute is not in schema or none is given
+ */
+Schema *projectSchema(Schema *schema, int *attrs, int numAttrs) {
+	char **names;
+	DataType *dataTypes;
+	int *typeLength;
+
+	if (numAttrs < 1)
+		return NULL;
+	for (int i = 0; i < numAttrs; i++) {
+		if (attrs[i] < 0 || attrs[i] >= schema->numAttr)
+			return NULL;
+	}
+
+	names = (char **) malloc(numAttrs * sizeof(char *));
+	dataTypes = (DataType *) malloc(numAttrs * sizeof(DataType));
+	typeLength = (int *) malloc(numAttrs * sizeof(int));
+	for (int i = 0; i < numAttrs; i++) {
+		names[i] = strdup(schema->attrNames[attrs[i]]);
+		dataTypes[i] = schema->dataTypes[attrs[i]];
+		typeLength[i] = schema->typeLength[attrs[i]];
+	}
+	return createSchema(numAttrs, names, dataTypes, typeLength, 0, NULL);
+}
+
 /**
  * Function: createRecord
  * ---------------------
@@ -752,11 +4596,36 @@ RC freeSchema(Schema *schema) {
  *  -   RC_OK if record is successfully created
  */
 RC createRecord(Record **record, Schema *schema) {
+	return createRecordIn(NULL, record, schema);
+}
+
+/**
+ * Function: createRecordIn
+ * -----------------------
+ * Creates a new record like createRecord, but allocated from an arena. The
+ * record is released with the arena and must not be passed to freeRecord.
+ *
+ * @param arena     Arena to allocate from, NULL for malloc
+ * @param record    Pointer to store the newly created record
+ * @param schema    Schema defining the record structure
+ * @return
+ *  -   RC_OK if record is successfully created
+ *  -   RC_MEMORY_ALLOCATION_ERROR if the arena is out of memory
+ */
+RC createRecordIn(RM_Arena *arena, Record **record, Schema *schema) {
 	int recordSize = getRecordSize(schema);
 
 	// Allocate memory for record
-	Record *newRecord = (Record *) malloc(sizeof(Record));
-	newRecord->data = (char *) malloc(recordSize);
+	Record *newRecord = (Record *) ((arena != NULL) ? arenaAlloc(arena, sizeof(Record)) : malloc(sizeof(Record)));
+	if (newRecord == NULL)
+		return RC_MEMORY_ALLOCATION_ERROR;
+	newRecord->data = (char *) ((arena != NULL) ? arenaAlloc(arena, recordSize) : malloc(recordSize));
+	if (newRecord->data == NULL) {
+		// Arena memory is released with the arena
+		if (arena == NULL)
+			free(newRecord);
+		return RC_MEMORY_ALLOCATION_ERROR;
+	}
 
 	// Initialize record ID to invalid values
 	newRecord->id.page = -1;
@@ -792,9 +4661,9 @@ RC freeRecord(Record *record) {
 /**
  * Function: determineAttributeOffsetInRecord
  * ----------------------------------------
- * Calculates the byte offset of an attribute within a record.
- * This function computes the offset by summing the sizes of all
- * preceding attributes in the schema.
+ * Returns the byte offset of an attribute within a record from the offset
+ * table of the schema. Every schema has one, since all of them are built by
+ * createSchema.
  *
  * @param schema    Schema defining the record structure
  * @param attrNum   Index of the attribute to find
@@ -803,29 +4672,7 @@ RC freeRecord(Record *record) {
  *  -   RC_OK if offset is successfully calculated
  */
 RC determineAttributeOffsetInRecord(Schema *schema, int attrNum, int *result) {
-	int offset = 0;
-	int attrPos = 0;
-
-	// Sum sizes of all attributes before the target attribute
-	for (attrPos = 0; attrPos < attrNum; attrPos++) {
-		switch (schema->dataTypes[attrPos]) {
-			case DT_STRING:
-				offset += schema->typeLength[attrPos];
-			break;
-			case DT_INT:
-				offset += sizeof(int);
-			break;
-			case DT_FLOAT:
-				offset += sizeof(float);
-			break;
-			case DT_BOOL:
-				offset += sizeof(bool);
-			break;
-		}
-	}
-
-	// Store result
-	*result = offset;
+	*result = schema->attrOffsets[attrNum];
 	return RC_OK;
 }
 
@@ -844,38 +4691,65 @@ RC determineAttributeOffsetInRecord(Schema *schema, int attrNum, int *result) {
  *  -   RC_OK if attribute is successfully retrieved
  */
 RC getAttr(Record *record, Schema *schema, int attrNum, Value **value) {
+	return getAttrIn(NULL, record, schema, attrNum, value);
+}
+
+/**
+ * Function: getAttrIn
+ * ------------------
+ * Retrieves an attribute value like getAttr, but allocates the value and its
+ * string from an arena. The value is released with the arena and must not be
+ * passed to freeVal.
+ *
+ * @param arena     Arena to allocate from, NULL for malloc
+ * @param record    Record to retrieve attribute from
+ * @param schema    Schema defining the record structure
+ * @param attrNum   Index of the attribute to retrieve
+ * @param value     Pointer to store the retrieved value
+ * @return
+ *  -   RC_OK if attribute is successfully retrieved
+ *  -   RC_MEMORY_ALLOCATION_ERROR if the arena is out of memory
+ */
+RC getAttrIn(RM_Arena *arena, Record *record, Schema *schema, int attrNum, Value **value) {
 	int offset = 0;
 
 	// Calculate attribute offset
 	determineAttributeOffsetInRecord(schema, attrNum, &offset);
 
 	// Allocate memory for value
-	Value *tempValue = (Value *) malloc(sizeof(Value));
+	Value *tempValue = (Value *) ((arena != NULL) ? arenaAlloc(arena, sizeof(Value)) : malloc(sizeof(Value)));
+	if (tempValue == NULL)
+		return RC_MEMORY_ALLOCATION_ERROR;
 
 	// Get pointer to attribute data
-	char *string = record->data;
-	string += offset;
+	char *string = record->data + offset;
 
 	// Extract value based on data type
 	switch (schema->dataTypes[attrNum]) {
 		case DT_INT:
-			memcpy(&(tempValue->v.intV), string, sizeof(int));
-		tempValue->dt = DT_INT;
+			tempValue->dt = DT_INT;
+			tempValue->v.intV = readIntAttr(string);
 		break;
-		case DT_STRING:
+		case DT_STRING: {
+			int len = schema->typeLength[attrNum];
 			tempValue->dt = DT_STRING;
-		int len = schema->typeLength[attrNum];
-		tempValue->v.stringV = (char *) malloc(len + 1);
-		strncpy(tempValue->v.stringV, string, len);
-		tempValue->v.stringV[len] = '\0';
+			if (arena != NULL) {
+				if ((tempValue->v.stringV = arenaStrndup(arena, string, len)) == NULL)
+					return RC_MEMORY_ALLOCATION_ERROR;
+				break;
+			}
+			tempValue->v.stringV = (char *) malloc(len + 1);
+			strncpy(tempValue->v.stringV, string, len);
+			tempValue->v.stringV[len] = '\0';
+		}
 		break;
 		case DT_FLOAT:
 			tempValue->dt = DT_FLOAT;
-		memcpy(&(tempValue->v.floatV), string, sizeof(float));
+			tempValue->v.floatV = readFloatAttr(string);
 		break;
 		case DT_BOOL:
 			tempValue->dt = DT_BOOL;
-		memcpy(&(tempValue->v.boolV), string, sizeof(bool));
+			tempValue->v.boolV = readBoolAttr(string);
 		break;
 	}
 
@@ -902,31 +4776,184 @@ RC setAttr(Record *record, Schema *schema, int attrNum, Value *value) {
 	determineAttributeOffsetInRecord(schema, attrNum, &offset);
 
 	// Get pointer to attribute data
-	char *data = record->data;
-	data = data + offset;
+	char *data = record->data + offset;
 
 	// Set value based on data type
 	switch (schema->dataTypes[attrNum]) {
 		case DT_INT:
-			*(int *) data = value->v.intV;
+			writeIntAttr(data, value->v.intV);
+		break;
+		case DT_STRING:
+			// strncpy pads shorter strings with '\0' up to the attribute length
+			strncpy(data, value->v.stringV, schema->typeLength[attrNum]);
+		break;
+		case DT_FLOAT:
+			writeFloatAttr(data, value->v.floatV);
+		break;
+		case DT_BOOL:
+			writeBoolAttr(data, value->v.boolV);
+		break;
+	}
+
+	return RC_OK;
+}
+
+/*
+ * Accessors that decode attributes into storage of the caller instead of a
+ * new Value; strings are returned as a pointer into the record and a length.
+ */
+
+/* Checks that an attribute exists and has the given type; RC_INVALID_PARAM or RC_RM_WRONG_DATATYPE otherwise */
+static RC typedAttr(Schema *schema, int attrNum, DataType dt) {
+	if (attrNum < 0 || attrNum >= schema->numAttr)
+		return RC_INVALID_PARAM;
+	return (schema->dataTypes[attrNum] == dt) ? RC_OK : RC_RM_WRONG_DATATYPE;
+}
+
+/**
+ * Function: getAttrInto
+ * --------------------
+ * Retrieves an attribute value like getAttr, into a Value of the caller. A
+ * string is copied to strBuf, which stringV then points to.
+ *
+ * @param record    Record to retrieve attribute from
+ * @param schema    Schema defining the record structure
+ * @param attrNum   Index of the attribute to retrieve
+ * @param value     Value to fill in
+ * @param strBuf    typeLength + 1 bytes for a string attribute, unused otherwise
+ * @return
+ *  -   RC_OK if attribute is successfully retrieved
+ *  -   RC_INVALID_PARAM if there is no such attribute, or no buffer for a string
+ */
+RC getAttrInto(Record *record, Schema *schema, int attrNum, Value *value, char *strBuf) {
+	if (attrNum < 0 || attrNum >= schema->numAttr)
+		return RC_INVALID_PARAM;
+	char *data = record->data + schema->attrOffsets[attrNum];
+
+	value->dt = schema->dataTypes[attrNum];
+	switch (value->dt) {
+		case DT_INT:
+			value->v.intV = readIntAttr(data);
 		break;
 		case DT_STRING: {
-			char *buf;
-			int len = schema->typeLength[attrNum];
-			buf = (char *) malloc(len + 1);
-			strncpy(buf, value->v.stringV, len);
-			buf[len] = '\0';
-			strncpy(data, buf, len);
-			free(buf);
+			int len = strnlen(data, schema->typeLength[attrNum]);
+			if (strBuf == NULL)
+				return RC_INVALID_PARAM;
+			memcpy(strBuf, data, len);
+			strBuf[len] = '\0';
+			value->v.stringV = strBuf;
 		}
 		break;
 		case DT_FLOAT:
-			*(float *) data = value->v.floatV;
+			value->v.floatV = readFloatAttr(data);
 		break;
 		case DT_BOOL:
-			*(bool *) data = value->v.boolV;
+			value->v.boolV = readBoolAttr(data);
 		break;
 	}
-
 	return RC_OK;
-}
\ No newline at end of file
+}
+
+/* Typed attribute getters; RC_RM_WRONG_DATATYPE if the attribute has another type */
+RC getIntAttr(Record *record, Schema *schema, int attrNum, int *value) {
+	RC rc = typedAttr(schema, attrNum, DT_INT);
+
+	if (rc == RC_OK)
+		*value = readIntAttr(record->data + schema->attrOffsets[attrNum]);
+	return rc;
+}
+
+RC getFloatAttr(Record *record, Schema *schema, int attrNum, float *value) {
+	RC rc = typedAttr(schema, attrNum, DT_FLOAT);
+
+	if (rc == RC_OK)
+		*value = readFloatAttr(record->data + schema->attrOffsets[attrNum]);
+	return rc;
+}
+
+RC getBoolAttr(Record *record, Schema *schema, int attrNum, bool *value) {
+	RC rc = typedAttr(schema, attrNum, DT_BOOL);
+
+	if (rc == RC_OK)
+		*value = readBoolAttr(record->data + schema->attrOffsets[attrNum]);
+	return rc;
+}
+
+/**
+ * Function: getStringAttr
+ * ----------------------
+ * Returns a string attribute without copying it: a pointer to its bytes in
+ * the record and its length up to the first NUL. The string is not
+ * NUL-terminated if it fills the attribute, and is valid as long as the
+ * record's data is.
+ *
+ * @param record    Record to retrieve attribute from
+ * @param schema    Schema defining the record structure
+ * @param attrNum   Index of the attribute to retrieve
+ * @param str       Set to the start of the string in the record
+ * @param len       Set to the length of the string
+ * @return
+ *  -   RC_OK if attribute is successfully retrieved
+ *  -   RC_RM_WRONG_DATATYPE if the attribute is not a string
+ */
+RC getStringAttr(Record *record, Schema *schema, int attrNum, const char **str, int *len) {
+	RC rc = typedAttr(schema, attrNum, DT_STRING);
+
+	if (rc == RC_OK) {
+		*str = record->data + schema->attrOffsets[attrNum];
+		*len = strnlen(*str, schema->typeLength[attrNum]);
+	}
+	return rc;
+}
+
+/**
+ * Function: getIntColumn
+ * ---------------------
+ * Extracts an int attribute from an array of records into a contiguous
+ * array. getFloatColumn and getBoolColumn do the same for their types.
+ *
+ * @param records       Records to read
+ * @param numRecords    Number of records
+ * @param schema        Schema of the records
+ * @param attrNum       Attribute to extract
+ * @param out           numRecords values, in the order of the records
+ * @return
+ *  -   RC_OK if the values were extracted
+ *  -   RC_RM_WRONG_DATATYPE if the attribute has another type
+ */
+RC getIntColumn(Record *records, int numRecords, Schema *schema, int attrNum, int *out) {
+	RC rc = typedAttr(schema, attrNum, DT_INT);
+
+	for (int i = 0; rc == RC_OK && i < numRecords; i++)
+		out[i] = readIntAttr(records[i].data + schema->attrOffsets[attrNum]);
+	return rc;
+}
+
+RC getFloatColumn(Record *records, int numRecords, Schema *schema, int attrNum, float *out) {
+	RC rc = typedAttr(schema, attrNum, DT_FLOAT);
+
+	for (int i = 0; rc == RC_OK && i < numRecords; i++)
+		out[i] = readFloatAttr(records[i].data + schema->attrOffsets[attrNum]);
+	return rc;
+}
+
+RC getBoolColumn(Record *records, int numRecords, Schema *schema, int attrNum, bool *out) {
+	RC rc = typedAttr(schema, attrNum, DT_BOOL);
+
+	for (int i = 0; rc == RC_OK && i < numRecords; i++)
+		out[i] = readBoolAttr(records[i].data + schema->attrOffsets[attrNum]);
+	return rc;
+}
+
+/* Copies a string attribute of each record to out, typeLength + 1 bytes per record, NUL-terminated */
+RC getStringColumn(Record *records, int numRecords, Schema *schema, int attrNum, char *out) {
+	RC rc = typedAttr(schema, attrNum, DT_STRING);
+	int len = (rc == RC_OK) ? schema->typeLength[attrNum] : 0;
+
+	for (int i = 0; rc == RC_OK && i < numRecords; i++) {
+		char *dst = out + (size_t) i * (len + 1);
+		strncpy(dst, records[i].data + schema->attrOffsets[attrNum], len);
+		dst[len] = '\0';
+	}
+	return rc;
+}
@@ -4,6 +4,7 @@
 #include "dberror.h"
 #include "expr.h"
 #include "tables.h"
+#include "buffer_mgr.h"
 
 // Bookkeeping for scans
 typedef struct RM_ScanHandle
@@ -12,35 +13,246 @@ typedef struct RM_ScanHandle
 	void *mgmtData;
 } RM_ScanHandle;
 
+// physical layout of records on the data pages of a table
+typedef enum RM_PageLayout {
+	RM_LAYOUT_ROW = 0, // each slot holds a whole record
+	RM_LAYOUT_PAX = 1  // each page holds one minipage per attribute
+} RM_PageLayout;
+
+// size and replacement strategy of the buffer pool of an open table; all zero for the default
+typedef struct RM_PoolOptions
+{
+	int numPages;                 // frames, RM_POOL_DEFAULT or RM_POOL_AUTO
+	ReplacementStrategy strategy;
+	int strategyParam;            // k of RS_LRU_K, 0 for 2; unused by the other strategies
+} RM_PoolOptions;
+
+#define RM_POOL_DEFAULT 0     // 10 frames replaced by LRU, whatever the strategy
+#define RM_POOL_AUTO -1       // as many frames as the table has pages, within the buffer memory left
+#define RM_POOL_MIN_PAGES 4   // smallest pool RM_POOL_AUTO chooses
+#define RM_BUFFER_MEMORY 1024 // default budget of frames for the RM_POOL_AUTO pools of all open tables
+
+// options given when a table is created; the layout and logging are fixed
+typedef struct RM_TableOptions
+{
+	RM_PageLayout layout;
+	bool logged; // changes go to a write-ahead log <name>.wal and are committed by group fsync
+	RM_PoolOptions pool; // default buffer pool of openTable, kept in the catalog
+} RM_TableOptions;
+
+// structures available for secondary indexes
+typedef enum RM_IndexType {
+	RM_INDEX_BTREE = 0, // ordered, supports range scans
+	RM_INDEX_HASH = 1   // linear hashing, exact-match lookups only
+} RM_IndexType;
+
+// attrNum of a hash index over all key attributes of the schema
+#define RM_PRIMARY_KEY -1
+
+// an index as the catalog lists it
+typedef struct RM_IndexInfo {
+	int attrNum;
+	RM_IndexType type;
+	bool unique;
+} RM_IndexInfo;
+
+// statistics the catalog keeps for a table, as of its last close
+typedef struct RM_TableStats {
+	int numTuples;
+	int numPages; // data pages in use
+} RM_TableStats;
+
+// page file of the catalog of tables, columns, indexes and statistics
+#define RM_CATALOG_FILE "rm_catalog"
+
+// how scans read a table
+typedef enum RM_AccessPath {
+	RM_PATH_AUTO = 0,       // use an index if the condition allows and it is estimated to be cheaper
+	RM_PATH_SEQUENTIAL = 1, // read every data page
+	RM_PATH_INDEX = 2       // use an index whenever the condition allows
+} RM_AccessPath;
+
 // table and manager
 extern RC initRecordManager (void *mgmtData);
 extern RC shutdownRecordManager ();
 extern RC createTable (char *name, Schema *schema);
+extern RC createTableWithOptions (char *name, Schema *schema, RM_TableOptions *options);
 extern RC openTable (RM_TableData *rel, char *name);
+extern RC openTableWithOptions (RM_TableData *rel, char *name, RM_PoolOptions *pool);
 extern RC closeTable (RM_TableData *rel);
 extern RC deleteTable (char *name);
 extern int getNumTuples (RM_TableData *rel);
+extern int getNumLogSyncs (RM_TableData *rel);
+extern RC checkpointTable (RM_TableData *rel);
+extern int getNumRecoveredChanges (RM_TableData *rel);
+extern int getNumPageReads (RM_TableData *rel);
+
+// buffer pools
+extern RC getPoolOptions (RM_TableData *rel, RM_PoolOptions *pool);
+extern RC setTablePoolOptions (char *name, RM_PoolOptions *pool);
+extern RC setBufferMemory (int numPages);
+
+// the catalog
+extern RC listTables (char ***names, int *numTables);
+extern RC getTableSchema (char *name, Schema **schema);
+extern RC getTableIndexes (char *name, RM_IndexInfo **indexes, int *numIndexes);
+extern RC getTableStats (char *name, RM_TableStats *stats);
+
+// the handle cache: handles of a table share it, idle tables stay open within the limits
+extern RC setTableCache (int maxIdleTables, int idleMillis);
+extern int getNumCachedTables (void);
+
+// indexes on single attributes, maintained by insertRecord, deleteRecord and updateRecord
+extern RC createIndex (RM_TableData *rel, int attrNum, RM_IndexType type, bool unique);
+extern RC dropIndex (RM_TableData *rel, int attrNum);
+extern RC lookupRecord (RM_TableData *rel, int attrNum, Value *key, Record *record);
+extern RC lookupRecords (RM_TableData *rel, int attrNum, Value *key, RID **ids, int *numIds);
 
 // handling records in a table
 extern RC insertRecord (RM_TableData *rel, Record *record);
 extern RC deleteRecord (RM_TableData *rel, RID id);
 extern RC updateRecord (RM_TableData *rel, Record *record);
 extern RC getRecord (RM_TableData *rel, RID id, Record *record);
+extern RC getRecords (RM_TableData *rel, RID *ids, int numIds, Record **records);
 
 // scans
 extern RC startScan (RM_TableData *rel, RM_ScanHandle *scan, Expr *cond);
+extern RC startScanProjected (RM_TableData *rel, RM_ScanHandle *scan, Expr *cond, int *attrs, int numAttrs);
+extern Schema *getScanSchema (RM_ScanHandle *scan);
 extern RC next (RM_ScanHandle *scan, Record *record);
+extern RC nextBatch (RM_ScanHandle *scan, char *tuples, RID *ids, int maxTuples, int *numTuples);
 extern RC closeScan (RM_ScanHandle *scan);
+extern RM_Arena *getScanArena (RM_ScanHandle *scan);
+extern int getScanSkippedPages (RM_ScanHandle *scan);
+extern RC setAccessPath (RM_TableData *rel, RM_AccessPath path);
+extern RM_AccessPath getScanAccessPath (RM_ScanHandle *scan);
+
+// transactions: writes create record versions, reads see the snapshot taken at begin
+typedef struct RM_Transaction RM_Transaction;
+extern RC beginTransaction (RM_Transaction **tx);
+extern RC commitTransaction (RM_Transaction *tx);
+extern RC abortTransaction (RM_Transaction *tx);
+extern RC insertRecordTx (RM_TableData *rel, RM_Transaction *tx, Record *record);
+extern RC deleteRecordTx (RM_TableData *rel, RM_Transaction *tx, RID id);
+extern RC updateRecordTx (RM_TableData *rel, RM_Transaction *tx, Record *record);
+extern RC getRecordTx (RM_TableData *rel, RM_Transaction *tx, RID id, Record *record);
+extern RC startScanTx (RM_TableData *rel, RM_Transaction *tx, RM_ScanHandle *scan, Expr *cond);
+extern int getNumRecordVersions (RM_TableData *rel);
+extern RC lockTableTx (RM_TableData *rel, RM_Transaction *tx, bool exclusive);
+extern void setLockTimeout (int timeoutMillis);
+
+// parallel scans: the consumer is called from worker threads, worker is 0 .. numThreads - 1
+typedef RC (*RM_ScanConsumer) (Record *record, int worker, void *context);
+extern RC parallelScan (RM_TableData *rel, Expr *cond, int numThreads, RM_ScanConsumer consumer, void *context);
+
+// aggregation over the records a scan returns, grouped by hashing or all in one group
+typedef enum RM_AggFunc {
+	RM_AGG_COUNT = 0, // number of records; attrNum is ignored
+	RM_AGG_SUM = 1,   // int or float attribute
+	RM_AGG_MIN = 2,
+	RM_AGG_MAX = 3,
+	RM_AGG_AVG = 4    // int or float attribute, as a float
+} RM_AggFunc;
+
+typedef struct RM_Aggregate {
+	RM_AggFunc func;
+	int attrNum; // attribute of the scan's tuples
+} RM_Aggregate;
+
+// one tuple per group: the group-by attributes, then one attribute per aggregate
+typedef struct RM_AggResult {
+	Schema *schema;
+	int numGroups;
+	char *rows; // numGroups tuples of schema, back to back
+} RM_AggResult;
+extern RC aggregateScan (RM_ScanHandle *scan, int *groupBy, int numGroupBy, RM_Aggregate *aggs, int numAggs, RM_AggResult **result);
+extern RC freeAggResult (RM_AggResult *result);
+
+// sorting the records a scan returns, spilling sorted runs to a temporary page file beyond the memory budget
+typedef struct RM_SortKey {
+	int attrNum;     // attribute of the scan's tuples
+	bool descending;
+} RM_SortKey;
+
+typedef struct RM_SortOptions {
+	int memoryPages; // pages of memory for tuples and merge frames, 0 for RM_SORT_DEFAULT_PAGES
+	int numThreads;  // threads sorting the pieces of each run, 0 or 1 to sort on the calling thread
+} RM_SortOptions;
+
+#define RM_SORT_DEFAULT_PAGES 256
+#define RM_SORT_MIN_PAGES 3 // two runs merged into a third
+
+typedef struct RM_SortHandle RM_SortHandle;
+extern RC startSort (RM_ScanHandle *scan, RM_SortKey *keys, int numKeys, RM_SortOptions *options, RM_SortHandle **sort);
+extern RC nextSorted (RM_SortHandle *sort, Record *record);
+extern int getSortNumRuns (RM_SortHandle *sort);
+extern RC closeSort (RM_SortHandle *sort);
+
+// equi-joins of two tables on one attribute each, returned as batches of joined tuples
+typedef enum RM_JoinMethod {
+	RM_JOIN_AUTO = 0,       // index nested loops if the right attribute has an index, else hash
+	RM_JOIN_HASH = 1,       // builds on the table with fewer records, partitions both beyond the budget
+	RM_JOIN_SORT_MERGE = 2, // sorts both inputs with startSort and merges them
+	RM_JOIN_INDEX_NL = 3    // looks every left tuple up in the index on the right attribute
+} RM_JoinMethod;
+
+typedef struct RM_JoinOptions {
+	RM_JoinMethod method;
+	int memoryPages; // pages of the hash table or of each sort, 0 for RM_JOIN_DEFAULT_PAGES
+} RM_JoinOptions;
+
+#define RM_JOIN_DEFAULT_PAGES 256
+#define RM_JOIN_MIN_PAGES 3
+
+typedef struct RM_JoinHandle RM_JoinHandle;
+extern RC startJoin (RM_TableData *left, Expr *leftCond, int leftAttr, RM_TableData *right, Expr *rightCond, int rightAttr,
+		RM_JoinOptions *options, RM_JoinHandle **join);
+extern Schema *getJoinSchema (RM_JoinHandle *join);
+extern RM_JoinMethod getJoinMethod (RM_JoinHandle *join);
+extern RC nextJoinBatch (RM_JoinHandle *join, char *tuples, RID *leftIds, RID *rightIds, int maxTuples, int *numTuples);
+extern RC closeJoin (RM_JoinHandle *join);
+
+// set-oriented changes: one pass over the pages, changing every record matching cond where it lies
+typedef struct RM_Assignment {
+	int attrNum;  // attribute to set
+	Value *value; // its new value, of the attribute's type
+} RM_Assignment;
+extern RC deleteWhere (RM_TableData *rel, Expr *cond, int *numDeleted);
+extern RC updateWhere (RM_TableData *rel, Expr *cond, RM_Assignment *assignments, int numAssignments, int *numUpdated);
+
+// reclaiming the slots of deleted records; moved records get new RIDs
+extern RC vacuumTable (RM_TableData *rel);
+extern RC startVacuumDaemon (RM_TableData *rel, int intervalMillis, int minPages);
+extern RC stopVacuumDaemon (RM_TableData *rel);
 
 // dealing with schemas
 extern int getRecordSize (Schema *schema);
 extern Schema *createSchema (int numAttr, char **attrNames, DataType *dataTypes, int *typeLength, int keySize, int *keys);
 extern RC freeSchema (Schema *schema);
+extern Schema *projectSchema (Schema *schema, int *attrs, int numAttrs);
 
 // dealing with records and attribute values
 extern RC createRecord (Record **record, Schema *schema);
 extern RC freeRecord (Record *record);
 extern RC getAttr (Record *record, Schema *schema, int attrNum, Value **value);
+
+// the same allocated from an arena, released all at once with it (not freeRecord/freeVal)
+extern RC createRecordIn (RM_Arena *arena, Record **record, Schema *schema);
+extern RC getAttrIn (RM_Arena *arena, Record *record, Schema *schema, int attrNum, Value **value);
 extern RC setAttr (Record *record, Schema *schema, int attrNum, Value *value);
+extern RC determineAttributeOffsetInRecord (Schema *schema, int attrNum, int *result);
+
+// reading attributes without allocating: into storage of the caller, strings as pointer and length into the record
+extern RC getAttrInto (Record *record, Schema *schema, int attrNum, Value *value, char *strBuf);
+extern RC getIntAttr (Record *record, Schema *schema, int attrNum, int *value);
+extern RC getFloatAttr (Record *record, Schema *schema, int attrNum, float *value);
+extern RC getBoolAttr (Record *record, Schema *schema, int attrNum, bool *value);
+extern RC getStringAttr (Record *record, Schema *schema, int attrNum, const char **str, int *len);
+
+// one attribute of an array of records into a contiguous array
+extern RC getIntColumn (Record *records, int numRecords, Schema *schema, int attrNum, int *out);
+extern RC getFloatColumn (Record *records, int numRecords, Schema *schema, int attrNum, float *out);
+extern RC getBoolColumn (Record *records, int numRecords, Schema *schema, int attrNum, bool *out);
+extern RC getStringColumn (Record *records, int numRecords, Schema *schema, int attrNum, char *out);
 
 #endif // RECORD_MGR_H
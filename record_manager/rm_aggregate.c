@@ -0,0 +1,432 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rm_aggregate.h"
+
+/*
+ * Aggregates are computed on the attribute bytes of the aggregated tuples,
+ * which the scan points to in its page copy, so no record or Value is
+ * built per row. A group's key is its group-by attributes back to back,
+ * strings zero-padded behind their end, so that equal groups have equal
+ * keys and a key is compared with memcmp.
+ */
+
+// state of one aggregate of a group; MIN/MAX of strings keep the value in the bytes that follow
+typedef struct AggAcc {
+	long count;          // rows added
+	union {
+		long intV;       // SUM of ints, MIN/MAX of ints and bools
+		double floatV;   // SUM/AVG, MIN/MAX of floats
+	} v;
+} AggAcc;
+
+static int
+align8 (int n)
+{
+	return (n + 7) & ~7;
+}
+
+static int
+attrSize (Schema *schema, int attrNum)
+{
+	return schema->attrOffsets[attrNum + 1] - schema->attrOffsets[attrNum];
+}
+
+/************************************************************
+ *                    group table                           *
+ ************************************************************/
+
+static uint32_t
+hashKey (const char *key, int keySize)
+{
+	uint32_t hash = 2166136261u;
+
+	for (int i = 0; i < keySize; i++)
+		hash = (hash ^ (unsigned char) key[i]) * 16777619u;
+	return (hash != 0) ? hash : 1;
+}
+
+static AggTable *
+createAggTable (int keySize, int accSize)
+{
+	AggTable *table = (AggTable *) malloc(sizeof(AggTable));
+
+	table->keySize = keySize;
+	table->accOffset = align8(sizeof(uint32_t) + keySize);
+	table->entrySize = table->accOffset + align8(accSize);
+	table->capacity = AGG_INITIAL_GROUPS * 2;
+	table->numGroups = 0;
+	table->entries = (char *) calloc(table->capacity, table->entrySize);
+	return table;
+}
+
+static void
+freeAggTable (AggTable *table)
+{
+	if (table == NULL)
+		return;
+	free(table->entries);
+	free(table);
+}
+
+static uint32_t *
+entryHash (AggTable *table, int i)
+{
+	return (uint32_t *) (table->entries + (long) i * table->entrySize);
+}
+
+/* Doubles the capacity, moving every entry to its slot in the larger table */
+static void
+growAggTable (AggTable *table)
+{
+	char *old = table->entries;
+	int oldCapacity = table->capacity;
+
+	table->capacity *= 2;
+	table->entries = (char *) calloc(table->capacity, table->entrySize);
+	for (int i = 0; i < oldCapacity; i++) {
+		char *entry = old + (long) i * table->entrySize;
+		uint32_t hash = *(uint32_t *) entry;
+		int slot;
+
+		if (hash == 0)
+			continue;
+		for (slot = hash & (table->capacity - 1); *entryHash(table, slot) != 0; slot = (slot + 1) & (table->capacity - 1))
+			;
+		memcpy(table->entries + (long) slot * table->entrySize, entry, table->entrySize);
+	}
+	free(old);
+}
+
+/* Accumulators of the group with a key; created is set if the group is new, its accumulators zeroed */
+static char *
+findGroup (AggTable *table, const char *key, bool *created)
+{
+	uint32_t hash = hashKey(key, table->keySize);
+	int slot;
+
+	*created = FALSE;
+	for (slot = hash & (table->capacity - 1); *entryHash(table, slot) != 0; slot = (slot + 1) & (table->capacity - 1)) {
+		char *entry = table->entries + (long) slot * table->entrySize;
+		if (*(uint32_t *) entry == hash && memcmp(entry + sizeof(uint32_t), key, table->keySize) == 0)
+			return entry + table->accOffset;
+	}
+
+	// Keep the table at most 3/4 full, so that probe sequences stay short
+	if (4 * (table->numGroups + 1) > 3 * table->capacity) {
+		growAggTable(table);
+		return findGroup(table, key, created);
+	}
+	char *entry = table->entries + (long) slot * table->entrySize;
+	*(uint32_t *) entry = hash;
+	memcpy(entry + sizeof(uint32_t), key, table->keySize);
+	table->numGroups++;
+	*created = TRUE;
+	return entry + table->accOffset;
+}
+
+/************************************************************
+ *                    plans                                 *
+ ************************************************************/
+
+/**
+ * Function: createAggPlan
+ * ----------------------
+ * Checks aggregates against the schema of the aggregated tuples and lays
+ * out their accumulators.
+ *
+ * @param schema        Schema of the aggregated tuples
+ * @param groupBy       Group-by attributes
+ * @param numGroupBy    Number of group-by attributes, 0 for a single group
+ * @param aggs          Aggregates
+ * @param numAggs       Number of aggregates
+ * @param plan          Set to the new plan
+ * @return
+ *  -   RC_OK if the aggregates can be computed
+ *  -   RC_INVALID_PARAM if an attribute is not in the schema, or there is nothing to compute
+ *  -   RC_RM_WRONG_DATATYPE if SUM or AVG is asked of an attribute that is not a number
+ */
+RC
+createAggPlan (Schema *schema, int *groupBy, int numGroupBy, RM_Aggregate *aggs, int numAggs, AggPlan **plan)
+{
+	AggPlan *p;
+	int keySize = 0;
+
+	if (numGroupBy < 0 || numAggs < 0 || numGroupBy + numAggs == 0)
+		return RC_INVALID_PARAM;
+	for (int i = 0; i < numGroupBy; i++) {
+		if (groupBy[i] < 0 || groupBy[i] >= schema->numAttr)
+			return RC_INVALID_PARAM;
+	}
+	for (int i = 0; i < numAggs; i++) {
+		if (aggs[i].func == RM_AGG_COUNT)
+			continue;
+		if (aggs[i].func < RM_AGG_COUNT || aggs[i].func > RM_AGG_AVG
+				|| aggs[i].attrNum < 0 || aggs[i].attrNum >= schema->numAttr)
+			return RC_INVALID_PARAM;
+		if ((aggs[i].func == RM_AGG_SUM || aggs[i].func == RM_AGG_AVG)
+				&& schema->dataTypes[aggs[i].attrNum] != DT_INT && schema->dataTypes[aggs[i].attrNum] != DT_FLOAT)
+			return RC_RM_WRONG_DATATYPE;
+	}
+
+	p = (AggPlan *) calloc(1, sizeof(AggPlan));
+	p->schema = schema;
+	p->numGroupBy = numGroupBy;
+	p->groupBy = (int *) malloc((numGroupBy + 1) * sizeof(int));
+	p->keyOffsets = (int *) malloc((numGroupBy + 1) * sizeof(int));
+	for (int i = 0; i < numGroupBy; i++) {
+		p->groupBy[i] = groupBy[i];
+		p->keyOffsets[i] = keySize;
+		keySize += attrSize(schema, groupBy[i]);
+	}
+
+	p->numAggs = numAggs;
+	p->aggs = (RM_Aggregate *) malloc((numAggs + 1) * sizeof(RM_Aggregate));
+	p->accOffsets = (int *) malloc((numAggs + 1) * sizeof(int));
+	p->countOnly = TRUE;
+	for (int i = 0; i < numAggs; i++) {
+		p->aggs[i] = aggs[i];
+		p->accOffsets[i] = p->accSize;
+		p->accSize += sizeof(AggAcc);
+		if ((aggs[i].func == RM_AGG_MIN || aggs[i].func == RM_AGG_MAX) && schema->dataTypes[aggs[i].attrNum] == DT_STRING)
+			p->accSize += align8(schema->typeLength[aggs[i].attrNum]);
+		if (aggs[i].func != RM_AGG_COUNT)
+			p->countOnly = FALSE;
+	}
+
+	if (numGroupBy > 0) {
+		p->groups = createAggTable(keySize, p->accSize);
+		p->key = (char *) malloc(keySize);
+	} else {
+		p->single = (char *) calloc(1, p->accSize + 1);
+	}
+	*plan = p;
+	return RC_OK;
+}
+
+void
+freeAggPlan (AggPlan *plan)
+{
+	if (plan == NULL)
+		return;
+	freeAggTable(plan->groups);
+	free(plan->single);
+	free(plan->key);
+	free(plan->groupBy);
+	free(plan->keyOffsets);
+	free(plan->aggs);
+	free(plan->accOffsets);
+	free(plan);
+}
+
+/************************************************************
+ *                    rows                                  *
+ ************************************************************/
+
+/* Adds an attribute value to the accumulator of an aggregate */
+static void
+accumulate (AggPlan *plan, int i, char *acc, const char *value)
+{
+	AggAcc *a = (AggAcc *) acc;
+	RM_AggFunc func = plan->aggs[i].func;
+	bool first = (a->count++ == 0);
+
+	if (func == RM_AGG_COUNT)
+		return;
+
+	int attrNum = plan->aggs[i].attrNum;
+	switch (plan->schema->dataTypes[attrNum]) {
+	case DT_INT: {
+		int v = readIntAttr(value);
+		if (func == RM_AGG_AVG)
+			a->v.floatV += v;
+		else if (func == RM_AGG_SUM)
+			a->v.intV += v;
+		else if (first || (func == RM_AGG_MIN ? v < a->v.intV : v > a->v.intV))
+			a->v.intV = v;
+		break;
+	}
+	case DT_FLOAT: {
+		float v = readFloatAttr(value);
+		if (func == RM_AGG_SUM || func == RM_AGG_AVG)
+			a->v.floatV += v;
+		else if (first || (func == RM_AGG_MIN ? v < a->v.floatV : v > a->v.floatV))
+			a->v.floatV = v;
+		break;
+	}
+	case DT_BOOL: {
+		int v = readBoolAttr(value);
+		if (first || (func == RM_AGG_MIN ? v < a->v.intV : v > a->v.intV))
+			a->v.intV = v;
+		break;
+	}
+	case DT_STRING: {
+		int len = plan->schema->typeLength[attrNum];
+		char *best = acc + sizeof(AggAcc);
+		int cmp = first ? 0 : strncmp(value, best, len);
+		if (first || (func == RM_AGG_MIN ? cmp < 0 : cmp > 0))
+			strncpy(best, value, len);
+		break;
+	}
+	}
+}
+
+/**
+ * Function: aggAddRow
+ * ------------------
+ * Adds a tuple to its group: the group-by values form the key the group is
+ * looked up by, without hashing if there is a single group.
+ *
+ * @param plan      Aggregation plan
+ * @param groupCols Values of the group-by attributes
+ * @param aggCols   Values of the aggregated attributes (ignored for COUNT)
+ */
+void
+aggAddRow (AggPlan *plan, char **groupCols, char **aggCols)
+{
+	char *accs = plan->single;
+
+	if (plan->groups != NULL) {
+		bool created;
+
+		for (int i = 0; i < plan->numGroupBy; i++) {
+			int attrNum = plan->groupBy[i];
+			int size = attrSize(plan->schema, attrNum);
+			char *dst = plan->key + plan->keyOffsets[i];
+
+			if (plan->schema->dataTypes[attrNum] == DT_STRING) {
+				int len = strnlen(groupCols[i], size);
+				memcpy(dst, groupCols[i], len);
+				memset(dst + len, 0, size - len);
+			} else if (plan->schema->dataTypes[attrNum] == DT_FLOAT && readFloatAttr(groupCols[i]) == 0) {
+				writeFloatAttr(dst, 0); // -0.0 and 0.0 are one group
+			} else {
+				memcpy(dst, groupCols[i], size);
+			}
+		}
+		accs = findGroup(plan->groups, plan->key, &created);
+	}
+
+	for (int i = 0; i < plan->numAggs; i++)
+		accumulate(plan, i, accs + plan->accOffsets[i], aggCols[i]);
+}
+
+/* Adds numRows tuples to the single group of a plan whose aggregates are all COUNT */
+void
+aggAddCount (AggPlan *plan, int numRows)
+{
+	for (int i = 0; i < plan->numAggs; i++)
+		((AggAcc *) (plan->single + plan->accOffsets[i]))->count += numRows;
+}
+
+/************************************************************
+ *                    results                               *
+ ************************************************************/
+
+static Schema *
+resultSchema (AggPlan *plan)
+{
+	static const char *funcNames[] = { "count", "sum", "min", "max", "avg" };
+	int numAttr = plan->numGroupBy + plan->numAggs;
+	char **names = (char **) malloc(numAttr * sizeof(char *));
+	DataType *dataTypes = (DataType *) malloc(numAttr * sizeof(DataType));
+	int *typeLength = (int *) malloc(numAttr * sizeof(int));
+	Schema *in = plan->schema;
+
+	for (int i = 0; i < plan->numGroupBy; i++) {
+		names[i] = strdup(in->attrNames[plan->groupBy[i]]);
+		dataTypes[i] = in->dataTypes[plan->groupBy[i]];
+		typeLength[i] = in->typeLength[plan->groupBy[i]];
+	}
+	for (int i = 0; i < plan->numAggs; i++) {
+		RM_Aggregate *agg = &plan->aggs[i];
+		int n = plan->numGroupBy + i;
+
+		if (agg->func == RM_AGG_COUNT) {
+			names[n] = strdup(funcNames[RM_AGG_COUNT]);
+			dataTypes[n] = DT_INT;
+			typeLength[n] = 0;
+			continue;
+		}
+		names[n] = (char *) malloc(strlen(funcNames[agg->func]) + strlen(in->attrNames[agg->attrNum]) + 3);
+		sprintf(names[n], "%s(%s)", funcNames[agg->func], in->attrNames[agg->attrNum]);
+		dataTypes[n] = (agg->func == RM_AGG_AVG) ? DT_FLOAT : in->dataTypes[agg->attrNum];
+		typeLength[n] = in->typeLength[agg->attrNum];
+	}
+	return createSchema(numAttr, names, dataTypes, typeLength, 0, NULL);
+}
+
+/* Writes a group as a result tuple; key is NULL for the single group */
+static void
+writeGroup (AggPlan *plan, Schema *schema, const char *key, char *accs, char *row)
+{
+	for (int i = 0; i < plan->numGroupBy; i++)
+		memcpy(row + schema->attrOffsets[i], key + plan->keyOffsets[i], attrSize(schema, i));
+
+	for (int i = 0; i < plan->numAggs; i++) {
+		AggAcc *a = (AggAcc *) (accs + plan->accOffsets[i]);
+		int n = plan->numGroupBy + i;
+		char *dst = row + schema->attrOffsets[n];
+
+		if (plan->aggs[i].func == RM_AGG_COUNT) {
+			writeIntAttr(dst, (int) a->count);
+		} else if (plan->aggs[i].func == RM_AGG_AVG) {
+			writeFloatAttr(dst, (a->count > 0) ? (float) (a->v.floatV / a->count) : 0);
+		} else {
+			switch (schema->dataTypes[n]) {
+			case DT_INT:
+				writeIntAttr(dst, (int) a->v.intV);
+				break;
+			case DT_FLOAT:
+				writeFloatAttr(dst, (float) a->v.floatV);
+				break;
+			case DT_BOOL:
+				writeBoolAttr(dst, (bool) a->v.intV);
+				break;
+			case DT_STRING:
+				memcpy(dst, (char *) a + sizeof(AggAcc), attrSize(schema, n));
+				break;
+			}
+		}
+	}
+}
+
+/**
+ * Function: aggResult
+ * ------------------
+ * Builds the result of an aggregation: one tuple per group, in no particular
+ * order. Without group-by attributes there is exactly one tuple, whose
+ * aggregates are 0 (or an empty string) if no row was added.
+ *
+ * @param plan      Aggregation plan all rows have been added to
+ * @param result    Set to the new result, freed with freeAggResult
+ * @return
+ *  -   RC_OK
+ */
+RC
+aggResult (AggPlan *plan, RM_AggResult **result)
+{
+	RM_AggResult *r = (RM_AggResult *) malloc(sizeof(RM_AggResult));
+	int size;
+
+	r->schema = resultSchema(plan);
+	size = getRecordSize(r->schema);
+	r->numGroups = (plan->groups != NULL) ? plan->groups->numGroups : 1;
+	r->rows = (char *) calloc((long) r->numGroups * size + 1, 1);
+
+	if (plan->groups == NULL) {
+		writeGroup(plan, r->schema, NULL, plan->single, r->rows);
+	} else {
+		AggTable *table = plan->groups;
+		int n = 0;
+
+		for (int i = 0; i < table->capacity; i++) {
+			char *entry = table->entries + (long) i * table->entrySize;
+			if (*(uint32_t *) entry != 0)
+				writeGroup(plan, r->schema, entry + sizeof(uint32_t), entry + table->accOffset, r->rows + (long) n++ * size);
+		}
+	}
+	*result = r;
+	return RC_OK;
+}
@@ -0,0 +1,49 @@
+#ifndef RM_AGGREGATE_H
+#define RM_AGGREGATE_H
+
+#include <stdint.h>
+
+#include "dberror.h"
+#include "tables.h"
+#include "record_mgr.h"
+
+// groups a hash table starts with room for
+#define AGG_INITIAL_GROUPS 64
+
+// a hash table of groups with open addressing (linear probing); each entry
+// holds the hash, the fixed-width key and the accumulators of the group inline
+typedef struct AggTable {
+	int keySize;   // bytes of a key
+	int accOffset; // offset of the accumulators within an entry
+	int entrySize; // bytes of an entry, a multiple of 8
+	int capacity;  // entries, a power of two
+	int numGroups;
+	char *entries; // an entry whose hash is 0 is free
+} AggTable;
+
+// how the aggregates of a scan are computed
+typedef struct AggPlan {
+	Schema *schema;     // schema of the aggregated tuples
+	int numGroupBy;
+	int *groupBy;       // group-by attributes
+	int *keyOffsets;    // offset of each group-by attribute within a key
+	int numAggs;
+	RM_Aggregate *aggs;
+	int *accOffsets;    // offset of the accumulator of each aggregate within an entry's accumulators
+	int accSize;        // bytes of the accumulators of a group
+	bool countOnly;     // all aggregates are COUNT
+	AggTable *groups;   // NULL if there is no group-by attribute
+	char *single;       // accumulators of the only group, if there is no group-by attribute
+	char *key;          // key of the row being added
+} AggPlan;
+
+// plans
+extern RC createAggPlan (Schema *schema, int *groupBy, int numGroupBy, RM_Aggregate *aggs, int numAggs, AggPlan **plan);
+extern void freeAggPlan (AggPlan *plan);
+
+// rows: groupCols and aggCols point to the attribute values, in the order of groupBy and aggs
+extern void aggAddRow (AggPlan *plan, char **groupCols, char **aggCols);
+extern void aggAddCount (AggPlan *plan, int numRows);
+extern RC aggResult (AggPlan *plan, RM_AggResult **result);
+
+#endif // RM_AGGREGATE_H
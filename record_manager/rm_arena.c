@@ -0,0 +1,178 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "rm_arena.h"
+
+/*
+ * An arena hands out memory by bumping a pointer through blocks it
+ * allocates with malloc, and releases all of it in one arenaReset. The
+ * blocks stay allocated for the next round, so a scan that resets its arena
+ * after every record reaches its high-water mark once and then runs without
+ * calling malloc. An arena is used by one thread at a time.
+ */
+
+// every allocation starts at a multiple of this
+#define ARENA_ALIGN 16
+
+#define ALIGN_UP(n) (((n) + ARENA_ALIGN - 1) & ~((size_t) ARENA_ALIGN - 1))
+
+typedef struct ArenaBlock {
+	struct ArenaBlock *next;
+	size_t size; // bytes after the header
+	size_t used;
+} ArenaBlock;
+
+static char *
+blockData (ArenaBlock *block)
+{
+	return (char *) block + ALIGN_UP(sizeof(ArenaBlock));
+}
+
+static ArenaBlock *
+newBlock (size_t size)
+{
+	ArenaBlock *block = (ArenaBlock *) malloc(ALIGN_UP(sizeof(ArenaBlock)) + size);
+
+	if (block == NULL)
+		return NULL;
+	block->next = NULL;
+	block->size = size;
+	block->used = 0;
+	return block;
+}
+
+/**
+ * Function: createArena
+ * --------------------
+ * Creates an empty arena. Its first block is allocated on first use.
+ *
+ * @param blockSize Bytes of the blocks it allocates, 0 for ARENA_BLOCK_SIZE
+ * @return
+ *  -   The new arena, NULL if out of memory
+ */
+RM_Arena *
+createArena (size_t blockSize)
+{
+	RM_Arena *arena = (RM_Arena *) malloc(sizeof(RM_Arena));
+
+	if (arena == NULL)
+		return NULL;
+	arena->first = NULL;
+	arena->current = NULL;
+	arena->blockSize = (blockSize > 0) ? ALIGN_UP(blockSize) : ARENA_BLOCK_SIZE;
+	arena->bytesUsed = 0;
+	return arena;
+}
+
+void
+freeArena (RM_Arena *arena)
+{
+	if (arena == NULL)
+		return;
+	while (arena->first != NULL) {
+		ArenaBlock *next = arena->first->next;
+		free(arena->first);
+		arena->first = next;
+	}
+	free(arena);
+}
+
+/* Releases everything allocated from the arena, keeping its blocks */
+void
+arenaReset (RM_Arena *arena)
+{
+	for (ArenaBlock *block = arena->first; block != NULL; block = block->next)
+		block->used = 0;
+	arena->current = arena->first;
+	arena->bytesUsed = 0;
+}
+
+/* Current position of an arena, for releasing later allocations only */
+ArenaMark
+arenaMark (RM_Arena *arena)
+{
+	ArenaMark mark;
+
+	mark.block = arena->current;
+	mark.used = (arena->current != NULL) ? arena->current->used : 0;
+	mark.bytesUsed = arena->bytesUsed;
+	return mark;
+}
+
+/* Frees what was allocated since a mark was taken; allocations before it stay valid */
+void
+arenaRelease (RM_Arena *arena, ArenaMark mark)
+{
+	if (mark.block == NULL) {
+		arenaReset(arena);
+		return;
+	}
+	for (ArenaBlock *block = mark.block->next; block != NULL; block = block->next)
+		block->used = 0;
+	mark.block->used = mark.used;
+	arena->current = mark.block;
+	arena->bytesUsed = mark.bytesUsed;
+}
+
+/**
+ * Function: arenaAlloc
+ * -------------------
+ * Allocates memory that stays valid until the arena is reset or freed.
+ * Requests larger than a block get a block of their own.
+ *
+ * @param arena     Arena to allocate from
+ * @param size      Bytes needed
+ * @return
+ *  -   The memory, aligned for any type; NULL if out of memory
+ */
+void *
+arenaAlloc (RM_Arena *arena, size_t size)
+{
+	ArenaBlock *block = arena->current;
+	void *p;
+
+	size = ALIGN_UP(size > 0 ? size : 1);
+
+	// Blocks kept by a reset are used again before new ones are allocated
+	while (block != NULL && block->used + size > block->size && block->next != NULL && block->next->size >= size)
+		block = block->next;
+	if (block == NULL || block->used + size > block->size) {
+		ArenaBlock *fresh = newBlock(size > arena->blockSize ? size : arena->blockSize);
+
+		if (fresh == NULL)
+			return NULL;
+		if (block == NULL) {
+			arena->first = fresh;
+		} else {
+			fresh->next = block->next;
+			block->next = fresh;
+		}
+		block = fresh;
+	}
+
+	arena->current = block;
+	p = blockData(block) + block->used;
+	block->used += size;
+	arena->bytesUsed += size;
+	return p;
+}
+
+/* Copy of at most n bytes of a string, NUL-terminated, in the arena */
+char *
+arenaStrndup (RM_Arena *arena, const char *s, size_t n)
+{
+	size_t len = strnlen(s, n);
+	char *copy = (char *) arenaAlloc(arena, len + 1);
+
+	if (copy == NULL)
+		return NULL;
+	memcpy(copy, s, len);
+	copy[len] = '\0';
+	return copy;
+}
+
+size_t
+arenaBytesUsed (RM_Arena *arena)
+{
+	return arena->bytesUsed;
+}
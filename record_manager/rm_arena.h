@@ -0,0 +1,38 @@
+#ifndef RM_ARENA_H
+#define RM_ARENA_H
+
+#include <stddef.h>
+
+// default size of the blocks an arena allocates from
+#define ARENA_BLOCK_SIZE 8192
+
+struct ArenaBlock;
+
+// a region: allocations are taken from blocks and all released at once by arenaReset
+typedef struct RM_Arena {
+	struct ArenaBlock *first;   // blocks in allocation order; kept by arenaReset for reuse
+	struct ArenaBlock *current; // block allocations are taken from
+	size_t blockSize;
+	size_t bytesUsed;           // bytes handed out since the last reset
+} RM_Arena;
+
+// a position in an arena; arenaRelease frees what was allocated after it
+typedef struct ArenaMark {
+	struct ArenaBlock *block;
+	size_t used;
+	size_t bytesUsed;
+} ArenaMark;
+
+// arenas
+extern RM_Arena *createArena (size_t blockSize);
+extern void freeArena (RM_Arena *arena);
+extern void arenaReset (RM_Arena *arena);
+extern ArenaMark arenaMark (RM_Arena *arena);
+extern void arenaRelease (RM_Arena *arena, ArenaMark mark);
+
+// allocation
+extern void *arenaAlloc (RM_Arena *arena, size_t size);
+extern char *arenaStrndup (RM_Arena *arena, const char *s, size_t n);
+extern size_t arenaBytesUsed (RM_Arena *arena);
+
+#endif // RM_ARENA_H
@@ -0,0 +1,651 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "storage_mgr.h"
+#include "rm_catalog.h"
+
+/*
+ * The catalog describes the tables in four kinds of entries: a table entry
+ * (name, layout, logging, buffer pool, key attributes), one entry per column, one per
+ * index and one with the statistics, tied to the table entry by its id.
+ * The entries are a byte stream over the pages of the catalog's own page
+ * file, after a header page holding the stream length, so neither names nor
+ * schemas are limited by a page. A change writes the whole catalog to a new
+ * file that then replaces the old one, so that a crash leaves either.
+ *
+ * The file is read once, into a cache of the tables that the record manager
+ * keeps until shutdownRecordManager. Callers get copies of the cached
+ * entries, which stay valid while others change the catalog.
+ */
+
+#define CATALOG_MAGIC 0x52434154 // "RCAT"
+#define CATALOG_NEW_FILE RM_CATALOG_FILE ".new"
+
+typedef enum CatalogEntryType {
+	CAT_TABLE = 1,
+	CAT_COLUMN = 2,
+	CAT_INDEX = 3,
+	CAT_STATS = 4
+} CatalogEntryType;
+
+// a growing byte stream, read from pos
+typedef struct CatalogStream {
+	char *data;
+	int size;
+	int capacity;
+	int pos;
+} CatalogStream;
+
+static pthread_mutex_t catalogLock = PTHREAD_MUTEX_INITIALIZER;
+static CatalogTable *tables = NULL;
+static bool loaded = FALSE;
+static int nextId = 1;
+
+/************************************************************
+ *                    entry encoding                        *
+ ************************************************************/
+
+static void
+putBytes (CatalogStream *stream, const void *src, int n)
+{
+	if (stream->size + n > stream->capacity) {
+		stream->capacity = (stream->capacity > 0) ? 2 * stream->capacity : PAGE_SIZE;
+		if (stream->capacity < stream->size + n)
+			stream->capacity = stream->size + n;
+		stream->data = (char *) realloc(stream->data, stream->capacity);
+	}
+	memcpy(stream->data + stream->size, src, n);
+	stream->size += n;
+}
+
+static void
+putInt (CatalogStream *stream, int value)
+{
+	putBytes(stream, &value, sizeof(int));
+}
+
+static void
+putString (CatalogStream *stream, const char *s)
+{
+	int length = strlen(s);
+
+	putInt(stream, length);
+	putBytes(stream, s, length);
+}
+
+static bool
+getInt (CatalogStream *stream, int *value)
+{
+	if (stream->pos + (int) sizeof(int) > stream->size)
+		return FALSE;
+	memcpy(value, stream->data + stream->pos, sizeof(int));
+	stream->pos += sizeof(int);
+	return TRUE;
+}
+
+/* Reads a string written by putString, NULL if the stream ends first */
+static char *
+getString (CatalogStream *stream)
+{
+	int length;
+	char *s;
+
+	if (!getInt(stream, &length) || length < 0 || stream->pos + length > stream->size)
+		return NULL;
+	s = (char *) malloc(length + 1);
+	memcpy(s, stream->data + stream->pos, length);
+	s[length] = '\0';
+	stream->pos += length;
+	return s;
+}
+
+/* Writes the entries of all tables; catalogLock held */
+static void
+encodeCatalog (CatalogStream *stream)
+{
+	for (CatalogTable *t = tables; t != NULL; t = t->next) {
+		Schema *schema = t->schema;
+
+		putInt(stream, CAT_TABLE);
+		putInt(stream, t->id);
+		putString(stream, t->name);
+		putInt(stream, t->layout);
+		putInt(stream, t->logged);
+		putInt(stream, t->pool.numPages);
+		putInt(stream, t->pool.strategy);
+		putInt(stream, t->pool.strategyParam);
+		putInt(stream, schema->keySize);
+		for (int i = 0; i < schema->keySize; i++)
+			putInt(stream, schema->keyAttrs[i]);
+
+		for (int i = 0; i < schema->numAttr; i++) {
+			putInt(stream, CAT_COLUMN);
+			putInt(stream, t->id);
+			putString(stream, schema->attrNames[i]);
+			putInt(stream, schema->dataTypes[i]);
+			putInt(stream, schema->typeLength[i]);
+		}
+		for (int i = 0; i < t->numIndexes; i++) {
+			putInt(stream, CAT_INDEX);
+			putInt(stream, t->id);
+			putInt(stream, t->indexes[i].attrNum);
+			putInt(stream, t->indexes[i].type);
+			putInt(stream, t->indexes[i].unique);
+		}
+		putInt(stream, CAT_STATS);
+		putInt(stream, t->id);
+		putInt(stream, t->stats.numTuples);
+		putInt(stream, t->stats.numPages);
+	}
+}
+
+static CatalogTable *
+tableById (int id)
+{
+	for (CatalogTable *t = tables; t != NULL; t = t->next) {
+		if (t->id == id)
+			return t;
+	}
+	return NULL;
+}
+
+/**
+ * Function: decodeCatalog
+ * ----------------------
+ * Builds the cached tables from the entries of the catalog file. Columns
+ * are appended to the schema of their table in the order they come; the
+ * attribute offsets are computed once all entries are read.
+ *
+ * @param stream    Entries of the catalog file
+ * @return
+ *  -   RC_OK if all entries were read
+ *  -   RC_READ_FAILED if the stream ends inside an entry or names an unknown table
+ */
+static RC
+decodeCatalog (CatalogStream *stream)
+{
+	int type, id;
+
+	while (getInt(stream, &type)) {
+		CatalogTable *t;
+
+		if (!getInt(stream, &id))
+			return RC_READ_FAILED;
+		if (type == CAT_TABLE) {
+			int layout, logged, strategy, keySize;
+
+			t = (CatalogTable *) calloc(1, sizeof(CatalogTable));
+			t->id = id;
+			t->schema = (Schema *) calloc(1, sizeof(Schema));
+			t->next = tables;
+			tables = t;
+			if (id >= nextId)
+				nextId = id + 1;
+			if ((t->name = getString(stream)) == NULL || !getInt(stream, &layout)
+					|| !getInt(stream, &logged) || !getInt(stream, &t->pool.numPages) || !getInt(stream, &strategy)
+					|| !getInt(stream, &t->pool.strategyParam) || !getInt(stream, &keySize))
+				return RC_READ_FAILED;
+			t->layout = (RM_PageLayout) layout;
+			t->logged = logged;
+			t->pool.strategy = (ReplacementStrategy) strategy;
+			t->schema->keyAttrs = (int *) malloc(keySize * sizeof(int));
+			for (int i = 0; i < keySize; i++) {
+				if (!getInt(stream, &t->schema->keyAttrs[i]))
+					return RC_READ_FAILED;
+				t->schema->keySize++;
+			}
+			continue;
+		}
+
+		if ((t = tableById(id)) == NULL)
+			return RC_READ_FAILED;
+		if (type == CAT_COLUMN) {
+			Schema *schema = t->schema;
+			int n = schema->numAttr, dataType;
+
+			schema->attrNames = (char **) realloc(schema->attrNames, (n + 1) * sizeof(char *));
+			schema->dataTypes = (DataType *) realloc(schema->dataTypes, (n + 1) * sizeof(DataType));
+			schema->typeLength = (int *) realloc(schema->typeLength, (n + 1) * sizeof(int));
+			if ((schema->attrNames[n] = getString(stream)) == NULL)
+				return RC_READ_FAILED;
+			schema->numAttr++;
+			if (!getInt(stream, &dataType) || !getInt(stream, &schema->typeLength[n]))
+				return RC_READ_FAILED;
+			schema->dataTypes[n] = (DataType) dataType;
+		} else if (type == CAT_INDEX) {
+			RM_IndexInfo *index;
+			int indexType, unique;
+
+			t->indexes = (RM_IndexInfo *) realloc(t->indexes, (t->numIndexes + 1) * sizeof(RM_IndexInfo));
+			index = &t->indexes[t->numIndexes++];
+			if (!getInt(stream, &index->attrNum) || !getInt(stream, &indexType) || !getInt(stream, &unique))
+				return RC_READ_FAILED;
+			index->type = (RM_IndexType) indexType;
+			index->unique = unique;
+		} else if (type == CAT_STATS) {
+			if (!getInt(stream, &t->stats.numTuples) || !getInt(stream, &t->stats.numPages))
+				return RC_READ_FAILED;
+		} else {
+			return RC_READ_FAILED;
+		}
+	}
+
+	for (CatalogTable *t = tables; t != NULL; t = t->next) {
+		Schema *s = t->schema;
+		t->schema = createSchema(s->numAttr, s->attrNames, s->dataTypes, s->typeLength, s->keySize, s->keyAttrs);
+		free(s);
+	}
+	return RC_OK;
+}
+
+/************************************************************
+ *                    catalog file                          *
+ ************************************************************/
+
+static void
+freeCatalogTable (CatalogTable *t)
+{
+	free(t->name);
+	freeSchema(t->schema);
+	free(t->indexes);
+	free(t);
+}
+
+static void
+clearCache (void)
+{
+	while (tables != NULL) {
+		CatalogTable *next = tables->next;
+		freeCatalogTable(tables);
+		tables = next;
+	}
+	loaded = FALSE;
+}
+
+/* Reads the catalog file into the cache, unless it is there already; catalogLock held */
+static RC
+loadCatalog (void)
+{
+	SM_FileHandle fHandle;
+	CatalogStream stream = { NULL, 0, 0, 0 };
+	char page[PAGE_SIZE];
+	RC rc;
+
+	if (loaded)
+		return RC_OK;
+
+	// No file: no tables yet
+	if (openPageFile(RM_CATALOG_FILE, &fHandle) != RC_OK) {
+		loaded = TRUE;
+		return RC_OK;
+	}
+	if ((rc = readBlock(0, &fHandle, page)) != RC_OK) {
+		closePageFile(&fHandle);
+		return rc;
+	}
+	if (((int *) page)[0] != CATALOG_MAGIC) {
+		closePageFile(&fHandle);
+		return RC_READ_FAILED;
+	}
+	stream.size = stream.capacity = ((int *) page)[1];
+	stream.data = (char *) malloc(stream.size + PAGE_SIZE);
+	for (int offset = 0, pageNum = 1; offset < stream.size && rc == RC_OK; offset += PAGE_SIZE, pageNum++)
+		rc = readBlock(pageNum, &fHandle, stream.data + offset);
+	closePageFile(&fHandle);
+
+	if (rc == RC_OK)
+		rc = decodeCatalog(&stream);
+	free(stream.data);
+	if (rc != RC_OK) {
+		clearCache();
+		return rc;
+	}
+	loaded = TRUE;
+	return RC_OK;
+}
+
+/**
+ * Function: storeCatalog
+ * ---------------------
+ * Writes the cached catalog to a new file and puts it in place of the old
+ * one. Without tables the file is removed.
+ *
+ * @return
+ *  -   RC_OK if the catalog file holds the cache
+ *  -   Errors of the storage manager otherwise
+ */
+static RC
+storeCatalog (void)
+{
+	char newName[] = CATALOG_NEW_FILE;
+	CatalogStream stream = { NULL, 0, 0, 0 };
+	SM_FileHandle fHandle;
+	char page[PAGE_SIZE];
+	RC rc;
+
+	if (tables == NULL) {
+		remove(RM_CATALOG_FILE);
+		return RC_OK;
+	}
+	encodeCatalog(&stream);
+
+	remove(newName);
+	if ((rc = createPageFile(newName)) != RC_OK || (rc = openPageFile(newName, &fHandle)) != RC_OK) {
+		free(stream.data);
+		return rc;
+	}
+	memset(page, 0, PAGE_SIZE);
+	((int *) page)[0] = CATALOG_MAGIC;
+	((int *) page)[1] = stream.size;
+	rc = writeBlock(0, &fHandle, page);
+	for (int offset = 0, pageNum = 1; offset < stream.size && rc == RC_OK; offset += PAGE_SIZE, pageNum++) {
+		int n = (stream.size - offset < PAGE_SIZE) ? stream.size - offset : PAGE_SIZE;
+		memset(page, 0, PAGE_SIZE);
+		memcpy(page, stream.data + offset, n);
+		rc = writeBlock(pageNum, &fHandle, page);
+	}
+	if (rc == RC_OK)
+		rc = syncPageFile(&fHandle);
+	closePageFile(&fHandle);
+	free(stream.data);
+
+	if (rc == RC_OK && rename(newName, RM_CATALOG_FILE) != 0)
+		rc = RC_WRITE_FAILED;
+	return rc;
+}
+
+/************************************************************
+ *                    tables                                *
+ ************************************************************/
+
+static CatalogTable *
+tableByName (char *name)
+{
+	for (CatalogTable *t = tables; t != NULL; t = t->next) {
+		if (strcmp(t->name, name) == 0)
+			return t;
+	}
+	return NULL;
+}
+
+static Schema *
+copySchema (Schema *schema)
+{
+	char **names = (char **) malloc(schema->numAttr * sizeof(char *));
+	DataType *dataTypes = (DataType *) malloc(schema->numAttr * sizeof(DataType));
+	int *typeLength = (int *) malloc(schema->numAttr * sizeof(int));
+	int *keys = (int *) malloc(schema->keySize * sizeof(int));
+
+	for (int i = 0; i < schema->numAttr; i++) {
+		names[i] = strdup(schema->attrNames[i]);
+		dataTypes[i] = schema->dataTypes[i];
+		typeLength[i] = schema->typeLength[i];
+	}
+	memcpy(keys, schema->keyAttrs, schema->keySize * sizeof(int));
+	return createSchema(schema->numAttr, names, dataTypes, typeLength, schema->keySize, keys);
+}
+
+static CatalogTable *
+copyTable (CatalogTable *t)
+{
+	CatalogTable *copy = (CatalogTable *) malloc(sizeof(CatalogTable));
+
+	*copy = *t;
+	copy->name = strdup(t->name);
+	copy->schema = copySchema(t->schema);
+	copy->indexes = (RM_IndexInfo *) malloc(t->numIndexes * sizeof(RM_IndexInfo) + 1);
+	if (t->numIndexes > 0)
+		memcpy(copy->indexes, t->indexes, t->numIndexes * sizeof(RM_IndexInfo));
+	copy->next = NULL;
+	return copy;
+}
+
+/**
+ * Function: catalogAddTable
+ * ------------------------
+ * Enters a new table, replacing an entry of the same name. It has no
+ * indexes and no records yet.
+ *
+ * @param name      Name of the table
+ * @param schema    Its schema, which is copied
+ * @param options   Its layout, logging and default buffer pool
+ * @return
+ *  -   RC_OK if the table is in the catalog file
+ *  -   Errors of the storage manager otherwise
+ */
+RC
+catalogAddTable (char *name, Schema *schema, RM_TableOptions *options)
+{
+	CatalogTable *t, **link;
+	RC rc;
+
+	pthread_mutex_lock(&catalogLock);
+	if ((rc = loadCatalog()) != RC_OK) {
+		pthread_mutex_unlock(&catalogLock);
+		return rc;
+	}
+	for (link = &tables; *link != NULL; link = &(*link)->next) {
+		if (strcmp((*link)->name, name) == 0) {
+			t = *link;
+			*link = t->next;
+			freeCatalogTable(t);
+			break;
+		}
+	}
+
+	t = (CatalogTable *) calloc(1, sizeof(CatalogTable));
+	t->id = nextId++;
+	t->name = strdup(name);
+	t->schema = copySchema(schema);
+	t->layout = options->layout;
+	t->logged = options->logged;
+	t->pool = options->pool;
+	t->stats.numPages = 1;
+	t->next = tables;
+	tables = t;
+	rc = storeCatalog();
+	pthread_mutex_unlock(&catalogLock);
+	return rc;
+}
+
+/* Removes a table from the catalog; RC_RM_UNKNOWN_TABLE if it is not there */
+RC
+catalogDropTable (char *name)
+{
+	CatalogTable **link, *t;
+	RC rc;
+
+	pthread_mutex_lock(&catalogLock);
+	if ((rc = loadCatalog()) != RC_OK) {
+		pthread_mutex_unlock(&catalogLock);
+		return rc;
+	}
+	rc = RC_RM_UNKNOWN_TABLE;
+	for (link = &tables; *link != NULL; link = &(*link)->next) {
+		if (strcmp((*link)->name, name) == 0) {
+			t = *link;
+			*link = t->next;
+			freeCatalogTable(t);
+			rc = storeCatalog();
+			break;
+		}
+	}
+	pthread_mutex_unlock(&catalogLock);
+	return rc;
+}
+
+/**
+ * Function: catalogGetTable
+ * ------------------------
+ * Looks a table up in the catalog cache, reading the catalog file on first
+ * use.
+ *
+ * @param name      Name of the table
+ * @param table     Set to a copy of its entry, to be freed with catalogFreeTable
+ * @return
+ *  -   RC_OK if the table was found
+ *  -   RC_RM_UNKNOWN_TABLE if the catalog has no such table
+ *  -   Errors reading the catalog file otherwise
+ */
+RC
+catalogGetTable (char *name, CatalogTable **table)
+{
+	CatalogTable *t;
+	RC rc;
+
+	pthread_mutex_lock(&catalogLock);
+	if ((rc = loadCatalog()) == RC_OK) {
+		if ((t = tableByName(name)) != NULL)
+			*table = copyTable(t);
+		else
+			rc = RC_RM_UNKNOWN_TABLE;
+	}
+	pthread_mutex_unlock(&catalogLock);
+	return rc;
+}
+
+/* catalogGetTable for openTable: the cached counts are not current any more once the table changes */
+RC
+catalogOpenTable (char *name, CatalogTable **table)
+{
+	CatalogTable *t;
+	RC rc;
+
+	pthread_mutex_lock(&catalogLock);
+	if ((rc = loadCatalog()) == RC_OK) {
+		if ((t = tableByName(name)) != NULL) {
+			*table = copyTable(t);
+			t->countsCached = FALSE;
+		} else {
+			rc = RC_RM_UNKNOWN_TABLE;
+		}
+	}
+	pthread_mutex_unlock(&catalogLock);
+	return rc;
+}
+
+/**
+ * Function: catalogCloseTable
+ * --------------------------
+ * Records the statistics of a table that was closed, and keeps the counts
+ * its metadata page holds now, so that opening it again needs no page I/O.
+ *
+ * @param name      Name of the table
+ * @param stats     Its statistics
+ * @param infoLsn   Log position the counts of the metadata page include
+ * @return
+ *  -   RC_OK if the statistics are in the catalog file
+ *  -   RC_RM_UNKNOWN_TABLE if the catalog has no such table
+ */
+RC
+catalogCloseTable (char *name, RM_TableStats *stats, WalLsn infoLsn)
+{
+	CatalogTable *t;
+	RC rc;
+
+	pthread_mutex_lock(&catalogLock);
+	if ((rc = loadCatalog()) == RC_OK) {
+		if ((t = tableByName(name)) != NULL) {
+			bool changed = (t->stats.numTuples != stats->numTuples || t->stats.numPages != stats->numPages);
+
+			t->stats = *stats;
+			t->infoLsn = infoLsn;
+			t->countsCached = TRUE;
+			if (changed)
+				rc = storeCatalog();
+		} else {
+			rc = RC_RM_UNKNOWN_TABLE;
+		}
+	}
+	pthread_mutex_unlock(&catalogLock);
+	return rc;
+}
+
+void
+catalogFreeTable (CatalogTable *table)
+{
+	if (table != NULL)
+		freeCatalogTable(table);
+}
+
+/* Names of all tables, in no particular order; the caller frees each name and the array */
+RC
+catalogListTables (char ***names, int *numTables)
+{
+	int n = 0;
+	RC rc;
+
+	pthread_mutex_lock(&catalogLock);
+	if ((rc = loadCatalog()) == RC_OK) {
+		for (CatalogTable *t = tables; t != NULL; t = t->next)
+			n++;
+		*names = (char **) malloc(n * sizeof(char *) + 1);
+		n = 0;
+		for (CatalogTable *t = tables; t != NULL; t = t->next)
+			(*names)[n++] = strdup(t->name);
+		*numTables = n;
+	}
+	pthread_mutex_unlock(&catalogLock);
+	return rc;
+}
+
+/* Replaces the default buffer pool of a table */
+RC
+catalogSetPool (char *name, RM_PoolOptions *pool)
+{
+	CatalogTable *t;
+	RC rc;
+
+	pthread_mutex_lock(&catalogLock);
+	if ((rc = loadCatalog()) == RC_OK) {
+		if ((t = tableByName(name)) != NULL) {
+			t->pool = *pool;
+			rc = storeCatalog();
+		} else {
+			rc = RC_RM_UNKNOWN_TABLE;
+		}
+	}
+	pthread_mutex_unlock(&catalogLock);
+	return rc;
+}
+
+/************************************************************
+ *                    indexes                               *
+ ************************************************************/
+
+/* Replaces the index entries of a table */
+RC
+catalogSetIndexes (char *name, RM_IndexInfo *indexes, int numIndexes)
+{
+	CatalogTable *t;
+	RC rc;
+
+	pthread_mutex_lock(&catalogLock);
+	if ((rc = loadCatalog()) == RC_OK) {
+		if ((t = tableByName(name)) != NULL) {
+			t->indexes = (RM_IndexInfo *) realloc(t->indexes, numIndexes * sizeof(RM_IndexInfo) + 1);
+			memcpy(t->indexes, indexes, numIndexes * sizeof(RM_IndexInfo));
+			t->numIndexes = numIndexes;
+			rc = storeCatalog();
+		} else {
+			rc = RC_RM_UNKNOWN_TABLE;
+		}
+	}
+	pthread_mutex_unlock(&catalogLock);
+	return rc;
+}
+
+/************************************************************
+ *                    cache                                 *
+ ************************************************************/
+
+/* Empties the cache; the next use reads the catalog file again */
+void
+catalogShutdown (void)
+{
+	pthread_mutex_lock(&catalogLock);
+	clearCache();
+	pthread_mutex_unlock(&catalogLock);
+}
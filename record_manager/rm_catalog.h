@@ -0,0 +1,41 @@
+#ifndef RM_CATALOG_H
+#define RM_CATALOG_H
+
+#include "dberror.h"
+#include "tables.h"
+#include "record_mgr.h"
+#include "rm_wal.h"
+
+// a table as the catalog describes it
+typedef struct CatalogTable {
+	int id;             // ties the column, index and statistics entries to the table entry
+	char *name;
+	Schema *schema;
+	RM_PageLayout layout;
+	bool logged;
+	RM_PoolOptions pool; // default buffer pool
+	int numIndexes;
+	RM_IndexInfo *indexes;
+	RM_TableStats stats; // as of the last close
+	bool countsCached;  // stats and infoLsn are what the metadata page holds: closed in this process, not reopened since
+	WalLsn infoLsn;
+	struct CatalogTable *next;
+} CatalogTable;
+
+// tables
+extern RC catalogAddTable (char *name, Schema *schema, RM_TableOptions *options);
+extern RC catalogDropTable (char *name);
+extern RC catalogOpenTable (char *name, CatalogTable **table);
+extern RC catalogCloseTable (char *name, RM_TableStats *stats, WalLsn infoLsn);
+extern RC catalogGetTable (char *name, CatalogTable **table);
+extern void catalogFreeTable (CatalogTable *table);
+extern RC catalogListTables (char ***names, int *numTables);
+extern RC catalogSetPool (char *name, RM_PoolOptions *pool);
+
+// indexes
+extern RC catalogSetIndexes (char *name, RM_IndexInfo *indexes, int numIndexes);
+
+// cache
+extern void catalogShutdown (void);
+
+#endif // RM_CATALOG_H
@@ -0,0 +1,1070 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "record_mgr.h"
+#include "storage_mgr.h"
+#include "buffer_mgr.h"
+
+/*
+ * A join returns the pairs of left and right records whose join attributes
+ * are equal, each as the left tuple followed by the right one. The inputs
+ * are scans of the two tables with their conditions; keys of either side
+ * are compared and hashed by value, so strings of different lengths join.
+ *
+ * The hash join builds a chained hash table from the input of the table
+ * with fewer records and probes it with the other as that is scanned. If
+ * the build input does not fit in the budget, both inputs are split by a
+ * second hash of the key into as many partitions as the budget has frames
+ * less one, written to a temporary page file through a buffer pool, and
+ * then joined partition by partition. A build partition still too large is
+ * loaded in chunks, each probed with the whole probe partition.
+ *
+ * The sort-merge join sorts both inputs with startSort and merges them,
+ * keeping the right tuples of the current key in memory. The index nested
+ * loop join looks up the key of every left tuple in the index on the right
+ * attribute and fetches the matches with getRecords.
+ */
+
+#define JOIN_FILE_PREFIX "rm_join_"
+#define JOIN_END -1 // end of a bucket chain
+
+typedef struct JoinKey {
+	int offset;       // of the attribute in the tuple
+	int length;       // of strings
+	DataType dataType;
+} JoinKey;
+
+// one input of the join
+typedef struct JoinSide {
+	RM_TableData *rel;
+	Expr *cond;
+	int attrNum;
+	JoinKey key;
+	int tupleSize;
+	int entrySize;    // RID and tuple in a partition
+	int perPage;      // tuples of a partition page
+} JoinSide;
+
+// the tuples of one side that fall into a partition, on pages of the spill file
+typedef struct JoinPartition {
+	int *pages;
+	int numPages;
+	long numTuples;
+	BM_PageHandle out; // last page, pinned while the partition is written
+} JoinPartition;
+
+// tuples and their RIDs read from a scan or a partition
+typedef struct JoinInput {
+	JoinSide *side;
+	const char *tuple;   // current tuple, NULL at the end
+	RID id;
+	RM_ScanHandle *scan; // NULL if not reading a scan
+	char *batch;         // tuples read from the scan, up to a page of them
+	RID *ids;
+	int batchSize;
+	int numBatched;
+	int pos;
+	JoinPartition *part; // NULL if not reading a partition
+	long next;           // number of the next tuple of the partition
+	BM_PageHandle page;  // page of the partition pinned for the current tuple, NO_PAGE if none
+} JoinInput;
+
+// hash table of build tuples; an entry is the number of the next entry of its chain, the RID and the tuple
+typedef struct JoinTable {
+	int *buckets;
+	int numBuckets;   // a power of two
+	char *entries;
+	int entrySize;
+	int capacity;
+	int numEntries;
+} JoinTable;
+
+// a joined pair, pointing to the tuples where they are held
+typedef struct JoinPair {
+	const char *left;
+	RID leftId;
+	const char *right;
+	RID rightId;
+} JoinPair;
+
+struct RM_JoinHandle {
+	RM_JoinMethod method;
+	Schema *schema;
+	JoinSide left;
+	JoinSide right;
+	int memoryPages;
+	bool done;
+
+	// hash join
+	JoinSide *build;
+	JoinSide *probe;
+	JoinTable table;
+	JoinInput probeInput;
+	int chain;        // next entry of the probe tuple's bucket to check
+	bool spilled;
+	bool poolOpen;
+	char fileName[64];
+	BM_BufferPool pool;
+	int nextPage;
+	int numPartitions;
+	JoinPartition *buildParts;
+	JoinPartition *probeParts;
+	int partition;    // partition being joined
+	JoinInput buildInput; // of that partition, at the first tuple not in the table
+
+	// sort-merge join
+	RM_SortHandle *leftSort;
+	RM_SortHandle *rightSort;
+	Record leftRec;
+	Record rightRec;
+	bool haveLeft;
+	bool haveRight;
+	char *group;      // right tuples with the key of the last match
+	RID *groupIds;
+	int groupSize;
+	int groupCapacity;
+	int groupPos;     // next of them to pair with the left tuple
+
+	// index nested loops
+	JoinInput outer;
+	CompiledExpr *rightProgram; // compiled right condition, NULL if none or not compilable
+	Record **matches; // right records with the key of the outer tuple
+	int numMatches;
+	int matchCapacity;
+	int matchPos;
+};
+
+static pthread_mutex_t fileLock = PTHREAD_MUTEX_INITIALIZER;
+static int fileCounter = 0;
+
+/************************************************************
+ *                    keys                                  *
+ ************************************************************/
+
+static uint32_t
+hashBytes (uint32_t h, const void *data, int len)
+{
+	const unsigned char *p = (const unsigned char *) data;
+
+	for (int i = 0; i < len; i++) {
+		h ^= p[i];
+		h *= 16777619u;
+	}
+	return h;
+}
+
+/* Hash of a key; equal keys hash alike whatever the side, so -0.0 is 0.0 and strings end at their end */
+static uint32_t
+keyHash (const JoinKey *key, const char *tuple)
+{
+	const char *x = tuple + key->offset;
+	uint32_t h = 2166136261u;
+
+	switch (key->dataType) {
+	case DT_INT:
+		return hashBytes(h, x, sizeof(int));
+	case DT_FLOAT: {
+		float f;
+		memcpy(&f, x, sizeof(float));
+		if (f == 0.0f)
+			f = 0.0f;
+		return hashBytes(h, &f, sizeof(float));
+	}
+	case DT_BOOL: {
+		bool b;
+		char c;
+		memcpy(&b, x, sizeof(bool));
+		c = (b != 0);
+		return hashBytes(h, &c, 1);
+	}
+	case DT_STRING:
+		return hashBytes(h, x, strnlen(x, key->length));
+	}
+	return h;
+}
+
+/* Orders keys of the same type: numbers by value, strings like strncmp over their lengths */
+static int
+compareKeys (const JoinKey *ka, const char *a, const JoinKey *kb, const char *b)
+{
+	const char *x = a + ka->offset, *y = b + kb->offset;
+
+	switch (ka->dataType) {
+	case DT_INT: {
+		int u, v;
+		memcpy(&u, x, sizeof(int));
+		memcpy(&v, y, sizeof(int));
+		return (u > v) - (u < v);
+	}
+	case DT_FLOAT: {
+		float u, v;
+		memcpy(&u, x, sizeof(float));
+		memcpy(&v, y, sizeof(float));
+		return (u > v) - (u < v);
+	}
+	case DT_BOOL: {
+		bool u, v;
+		memcpy(&u, x, sizeof(bool));
+		memcpy(&v, y, sizeof(bool));
+		return (u != 0) - (v != 0);
+	}
+	case DT_STRING: {
+		int lx = strnlen(x, ka->length), ly = strnlen(y, kb->length);
+		int cmp = memcmp(x, y, lx < ly ? lx : ly);
+		if (cmp == 0)
+			cmp = lx - ly;
+		return (cmp > 0) - (cmp < 0);
+	}
+	}
+	return 0;
+}
+
+/************************************************************
+ *                    inputs                                *
+ ************************************************************/
+
+static RC
+openScanInput (JoinInput *input, JoinSide *side)
+{
+	RC rc;
+
+	memset(input, 0, sizeof(JoinInput));
+	input->side = side;
+	input->page.pageNum = NO_PAGE;
+	input->scan = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+	if ((rc = startScan(side->rel, input->scan, side->cond)) != RC_OK) {
+		free(input->scan);
+		input->scan = NULL;
+		return rc;
+	}
+	input->batchSize = PAGE_SIZE / side->tupleSize;
+	if (input->batchSize < 1)
+		input->batchSize = 1;
+	input->batch = (char *) malloc((long) input->batchSize * side->tupleSize);
+	input->ids = (RID *) malloc(input->batchSize * sizeof(RID));
+	return RC_OK;
+}
+
+static void
+openPartitionInput (JoinInput *input, JoinSide *side, JoinPartition *part)
+{
+	memset(input, 0, sizeof(JoinInput));
+	input->side = side;
+	input->part = part;
+	input->page.pageNum = NO_PAGE;
+}
+
+static RC
+releaseInputPage (RM_JoinHandle *join, JoinInput *input)
+{
+	RC rc = RC_OK;
+
+	if (input->page.pageNum != NO_PAGE) {
+		rc = unpinPage(&join->pool, &input->page);
+		input->page.pageNum = NO_PAGE;
+	}
+	return rc;
+}
+
+/* Makes the next tuple of an input current; tuple is NULL at its end */
+static RC
+advanceInput (RM_JoinHandle *join, JoinInput *input)
+{
+	JoinSide *side = input->side;
+	RC rc;
+
+	if (input->scan != NULL) {
+		if (input->pos == input->numBatched) {
+			input->pos = input->numBatched = 0;
+			rc = nextBatch(input->scan, input->batch, input->ids, input->batchSize, &input->numBatched);
+			if (rc == RC_RM_NO_MORE_TUPLES) {
+				input->tuple = NULL;
+				return RC_OK;
+			}
+			if (rc != RC_OK)
+				return rc;
+		}
+		input->tuple = input->batch + (long) input->pos * side->tupleSize;
+		input->id = input->ids[input->pos++];
+		return RC_OK;
+	}
+
+	if (input->part == NULL || input->next == input->part->numTuples) {
+		input->tuple = NULL;
+		return releaseInputPage(join, input);
+	}
+	int pageNum = input->part->pages[input->next / side->perPage];
+	if (input->page.pageNum != pageNum) {
+		if ((rc = releaseInputPage(join, input)) != RC_OK)
+			return rc;
+		if ((rc = pinPage(&join->pool, &input->page, pageNum)) != RC_OK) {
+			input->page.pageNum = NO_PAGE;
+			return rc;
+		}
+	}
+	char *entry = input->page.data + (input->next % side->perPage) * side->entrySize;
+	memcpy(&input->id, entry, sizeof(RID));
+	input->tuple = entry + sizeof(RID);
+	input->next++;
+	return RC_OK;
+}
+
+static RC
+closeInput (RM_JoinHandle *join, JoinInput *input)
+{
+	RC rc = RC_OK;
+
+	if (input->scan != NULL) {
+		rc = closeScan(input->scan);
+		free(input->scan);
+		free(input->batch);
+		free(input->ids);
+	} else {
+		rc = releaseInputPage(join, input);
+	}
+	memset(input, 0, sizeof(JoinInput));
+	input->page.pageNum = NO_PAGE;
+	return rc;
+}
+
+/************************************************************
+ *                    hash join                             *
+ ************************************************************/
+
+static void
+initTable (JoinTable *table, JoinSide *side, int memoryPages)
+{
+	table->entrySize = (sizeof(int) + sizeof(RID) + side->tupleSize + 3) & ~3;
+	table->capacity = (int) ((long) memoryPages * PAGE_SIZE / (table->entrySize + 2 * sizeof(int)));
+	if (table->capacity < 1)
+		table->capacity = 1;
+	table->numBuckets = 1;
+	while (table->numBuckets < table->capacity)
+		table->numBuckets *= 2;
+	table->buckets = (int *) malloc(table->numBuckets * sizeof(int));
+	table->entries = (char *) malloc((long) table->capacity * table->entrySize);
+	memset(table->buckets, 0xff, table->numBuckets * sizeof(int));
+	table->numEntries = 0;
+}
+
+static void
+clearTable (JoinTable *table)
+{
+	memset(table->buckets, 0xff, table->numBuckets * sizeof(int));
+	table->numEntries = 0;
+}
+
+static char *
+tableEntry (JoinTable *table, int n)
+{
+	return table->entries + (long) n * table->entrySize;
+}
+
+/* Adds a build tuple; FALSE if the table is full */
+static bool
+addToTable (JoinTable *table, JoinSide *side, const char *tuple, RID id)
+{
+	int bucket, n = table->numEntries;
+	char *entry;
+
+	if (n == table->capacity)
+		return FALSE;
+	bucket = keyHash(&side->key, tuple) & (table->numBuckets - 1);
+	entry = tableEntry(table, n);
+	memcpy(entry, &table->buckets[bucket], sizeof(int));
+	memcpy(entry + sizeof(int), &id, sizeof(RID));
+	memcpy(entry + sizeof(int) + sizeof(RID), tuple, side->tupleSize);
+	table->buckets[bucket] = n;
+	table->numEntries++;
+	return TRUE;
+}
+
+/* Partition of a key, from bits of its hash the table does not use for buckets */
+static int
+partitionOf (RM_JoinHandle *join, JoinSide *side, const char *tuple)
+{
+	return (int) ((keyHash(&side->key, tuple) >> 16) % join->numPartitions);
+}
+
+static RC
+addToPartition (RM_JoinHandle *join, JoinSide *side, JoinPartition *part, const char *tuple, RID id)
+{
+	long slot = part->numTuples % side->perPage;
+	char *entry;
+	RC rc;
+
+	if (slot == 0) {
+		if (part->out.pageNum != NO_PAGE) {
+			markDirty(&join->pool, &part->out);
+			if ((rc = unpinPage(&join->pool, &part->out)) != RC_OK)
+				return rc;
+			part->out.pageNum = NO_PAGE;
+		}
+		part->pages = (int *) realloc(part->pages, (part->numPages + 1) * sizeof(int));
+		part->pages[part->numPages++] = join->nextPage++;
+		if ((rc = pinPage(&join->pool, &part->out, part->pages[part->numPages - 1])) != RC_OK) {
+			part->out.pageNum = NO_PAGE;
+			return rc;
+		}
+	}
+	entry = part->out.data + slot * side->entrySize;
+	memcpy(entry, &id, sizeof(RID));
+	memcpy(entry + sizeof(RID), tuple, side->tupleSize);
+	part->numTuples++;
+	return RC_OK;
+}
+
+/* Unpins the last pages of the partitions of one side once it is written */
+static RC
+finishPartitions (RM_JoinHandle *join, JoinPartition *parts)
+{
+	RC rc = RC_OK;
+
+	for (int i = 0; i < join->numPartitions; i++) {
+		if (parts[i].out.pageNum != NO_PAGE) {
+			RC r;
+			markDirty(&join->pool, &parts[i].out);
+			r = unpinPage(&join->pool, &parts[i].out);
+			parts[i].out.pageNum = NO_PAGE;
+			if (rc == RC_OK)
+				rc = r;
+		}
+	}
+	return rc;
+}
+
+static JoinPartition *
+createPartitions (int numPartitions)
+{
+	JoinPartition *parts = (JoinPartition *) calloc(numPartitions, sizeof(JoinPartition));
+
+	for (int i = 0; i < numPartitions; i++)
+		parts[i].out.pageNum = NO_PAGE;
+	return parts;
+}
+
+/* Switches to the grace hash join when the build input overflows the table: moves the table to partitions */
+static RC
+spillTable (RM_JoinHandle *join)
+{
+	JoinTable *table = &join->table;
+	RC rc;
+
+	pthread_mutex_lock(&fileLock);
+	sprintf(join->fileName, JOIN_FILE_PREFIX "%d_%d.tmp", (int) getpid(), fileCounter++);
+	pthread_mutex_unlock(&fileLock);
+	if ((rc = createPageFile(join->fileName)) != RC_OK)
+		return rc;
+	join->spilled = TRUE;
+	if ((rc = initBufferPool(&join->pool, join->fileName, join->memoryPages, RS_LRU, NULL)) != RC_OK)
+		return rc;
+	join->poolOpen = TRUE;
+
+	// One frame per partition being written
+	join->numPartitions = join->memoryPages - 1;
+	join->buildParts = createPartitions(join->numPartitions);
+	join->probeParts = createPartitions(join->numPartitions);
+	for (int n = 0; n < table->numEntries; n++) {
+		char *entry = tableEntry(table, n), *tuple = entry + sizeof(int) + sizeof(RID);
+		RID id;
+
+		memcpy(&id, entry + sizeof(int), sizeof(RID));
+		rc = addToPartition(join, join->build, &join->buildParts[partitionOf(join, join->build, tuple)], tuple, id);
+		if (rc != RC_OK)
+			return rc;
+	}
+	clearTable(table);
+	return RC_OK;
+}
+
+/* Builds the hash table, or partitions both inputs if the build input does not fit */
+static RC
+startHashJoin (RM_JoinHandle *join)
+{
+	JoinInput input;
+	RC rc;
+
+	// The sizes of the tables are all that is known before the conditions are applied
+	if (getNumTuples(join->right.rel) <= getNumTuples(join->left.rel)) {
+		join->build = &join->right;
+		join->probe = &join->left;
+	} else {
+		join->build = &join->left;
+		join->probe = &join->right;
+	}
+	initTable(&join->table, join->build, join->memoryPages);
+	join->chain = JOIN_END;
+	join->partition = -1;
+
+	if ((rc = openScanInput(&input, join->build)) != RC_OK)
+		return rc;
+	while ((rc = advanceInput(join, &input)) == RC_OK && input.tuple != NULL) {
+		if (!join->spilled && addToTable(&join->table, join->build, input.tuple, input.id))
+			continue;
+		if (!join->spilled && (rc = spillTable(join)) != RC_OK)
+			break;
+		JoinPartition *part = &join->buildParts[partitionOf(join, join->build, input.tuple)];
+		if ((rc = addToPartition(join, join->build, part, input.tuple, input.id)) != RC_OK)
+			break;
+	}
+	closeInput(join, &input);
+	if (rc != RC_OK)
+		return rc;
+
+	// Everything fit: the probe input is streamed against the table
+	if (!join->spilled)
+		return openScanInput(&join->probeInput, join->probe);
+
+	if ((rc = finishPartitions(join, join->buildParts)) != RC_OK)
+		return rc;
+	if ((rc = openScanInput(&input, join->probe)) != RC_OK)
+		return rc;
+	while ((rc = advanceInput(join, &input)) == RC_OK && input.tuple != NULL) {
+		JoinPartition *part = &join->probeParts[partitionOf(join, join->probe, input.tuple)];
+		if ((rc = addToPartition(join, join->probe, part, input.tuple, input.id)) != RC_OK)
+			break;
+	}
+	closeInput(join, &input);
+	if (rc != RC_OK)
+		return rc;
+	rc = finishPartitions(join, join->probeParts);
+	openPartitionInput(&join->buildInput, join->build, NULL);
+	openPartitionInput(&join->probeInput, join->probe, NULL);
+	return rc;
+}
+
+/* Loads the next chunk of build tuples of the spilled join into the table and restarts their probe partition */
+static RC
+nextChunk (RM_JoinHandle *join)
+{
+	RC rc;
+
+	if ((rc = closeInput(join, &join->probeInput)) != RC_OK)
+		return rc;
+	while (join->buildInput.tuple == NULL) {
+		if ((rc = closeInput(join, &join->buildInput)) != RC_OK)
+			return rc;
+		if (++join->partition == join->numPartitions)
+			return RC_RM_NO_MORE_TUPLES;
+		// A partition without tuples on either side has no matches
+		if (join->probeParts[join->partition].numTuples == 0)
+			continue;
+		openPartitionInput(&join->buildInput, join->build, &join->buildParts[join->partition]);
+		if ((rc = advanceInput(join, &join->buildInput)) != RC_OK)
+			return rc;
+	}
+
+	clearTable(&join->table);
+	while (join->buildInput.tuple != NULL
+			&& addToTable(&join->table, join->build, join->buildInput.tuple, join->buildInput.id)) {
+		if ((rc = advanceInput(join, &join->buildInput)) != RC_OK)
+			return rc;
+	}
+	openPartitionInput(&join->probeInput, join->probe, &join->probeParts[join->partition]);
+	join->chain = JOIN_END;
+	return RC_OK;
+}
+
+static RC
+nextHashPair (RM_JoinHandle *join, JoinPair *pair)
+{
+	JoinTable *table = &join->table;
+	JoinInput *probe = &join->probeInput;
+	RC rc;
+
+	for (;;) {
+		// The rest of the probe tuple's bucket
+		while (join->chain != JOIN_END) {
+			char *entry = tableEntry(table, join->chain), *tuple = entry + sizeof(int) + sizeof(RID);
+			RID id;
+
+			memcpy(&join->chain, entry, sizeof(int));
+			if (compareKeys(&join->build->key, tuple, &join->probe->key, probe->tuple) != 0)
+				continue;
+			memcpy(&id, entry + sizeof(int), sizeof(RID));
+			if (join->build == &join->left) {
+				pair->left = tuple;
+				pair->leftId = id;
+				pair->right = probe->tuple;
+				pair->rightId = probe->id;
+			} else {
+				pair->left = probe->tuple;
+				pair->leftId = probe->id;
+				pair->right = tuple;
+				pair->rightId = id;
+			}
+			return RC_OK;
+		}
+
+		if ((rc = advanceInput(join, probe)) != RC_OK)
+			return rc;
+		if (probe->tuple != NULL) {
+			join->chain = table->buckets[keyHash(&join->probe->key, probe->tuple) & (table->numBuckets - 1)];
+			continue;
+		}
+		if (!join->spilled)
+			return RC_RM_NO_MORE_TUPLES;
+		if ((rc = nextChunk(join)) != RC_OK)
+			return rc;
+	}
+}
+
+/************************************************************
+ *                    sort-merge join                       *
+ ************************************************************/
+
+static RC
+sortSide (RM_JoinHandle *join, JoinSide *side, RM_SortHandle **sort)
+{
+	RM_ScanHandle scan;
+	RM_SortKey key = { side->attrNum, FALSE };
+	RM_SortOptions options = { join->memoryPages, 0 };
+	RC rc, r;
+
+	if ((rc = startScan(side->rel, &scan, side->cond)) != RC_OK)
+		return rc;
+	rc = startSort(&scan, &key, 1, &options, sort);
+	r = closeScan(&scan);
+	return (rc != RC_OK) ? rc : r;
+}
+
+/* Moves a side of the merge to its next tuple; have is FALSE at the end */
+static RC
+advanceSorted (RM_SortHandle *sort, Record *record, bool *have)
+{
+	RC rc = nextSorted(sort, record);
+
+	*have = (rc == RC_OK);
+	return (rc == RC_RM_NO_MORE_TUPLES) ? RC_OK : rc;
+}
+
+static RC
+startMergeJoin (RM_JoinHandle *join)
+{
+	RC rc;
+
+	join->leftRec.data = (char *) malloc(join->left.tupleSize);
+	join->rightRec.data = (char *) malloc(join->right.tupleSize);
+	if ((rc = sortSide(join, &join->left, &join->leftSort)) != RC_OK)
+		return rc;
+	if ((rc = sortSide(join, &join->right, &join->rightSort)) != RC_OK)
+		return rc;
+	if ((rc = advanceSorted(join->leftSort, &join->leftRec, &join->haveLeft)) != RC_OK)
+		return rc;
+	return advanceSorted(join->rightSort, &join->rightRec, &join->haveRight);
+}
+
+/* Collects the right tuples with the key of the left tuple, which the current right tuple has */
+static RC
+collectGroup (RM_JoinHandle *join)
+{
+	RC rc;
+
+	join->groupSize = 0;
+	join->groupPos = 0;
+	while (join->haveRight
+			&& compareKeys(&join->right.key, join->rightRec.data, &join->left.key, join->leftRec.data) == 0) {
+		if (join->groupSize == join->groupCapacity) {
+			join->groupCapacity = (join->groupCapacity == 0) ? 16 : 2 * join->groupCapacity;
+			join->group = (char *) realloc(join->group, (long) join->groupCapacity * join->right.tupleSize);
+			join->groupIds = (RID *) realloc(join->groupIds, join->groupCapacity * sizeof(RID));
+		}
+		memcpy(join->group + (long) join->groupSize * join->right.tupleSize, join->rightRec.data, join->right.tupleSize);
+		join->groupIds[join->groupSize++] = join->rightRec.id;
+		if ((rc = advanceSorted(join->rightSort, &join->rightRec, &join->haveRight)) != RC_OK)
+			return rc;
+	}
+	return RC_OK;
+}
+
+static RC
+nextMergePair (RM_JoinHandle *join, JoinPair *pair)
+{
+	RC rc;
+	int cmp;
+
+	for (;;) {
+		if (!join->haveLeft)
+			return RC_RM_NO_MORE_TUPLES;
+
+		// Left tuples with the key of the group pair with all of it
+		if (join->groupSize > 0) {
+			if (compareKeys(&join->left.key, join->leftRec.data, &join->right.key, join->group) == 0) {
+				if (join->groupPos < join->groupSize) {
+					pair->left = join->leftRec.data;
+					pair->leftId = join->leftRec.id;
+					pair->right = join->group + (long) join->groupPos * join->right.tupleSize;
+					pair->rightId = join->groupIds[join->groupPos++];
+					return RC_OK;
+				}
+				if ((rc = advanceSorted(join->leftSort, &join->leftRec, &join->haveLeft)) != RC_OK)
+					return rc;
+				join->groupPos = 0;
+				continue;
+			}
+			join->groupSize = 0;
+		}
+
+		if (!join->haveRight)
+			return RC_RM_NO_MORE_TUPLES;
+		cmp = compareKeys(&join->left.key, join->leftRec.data, &join->right.key, join->rightRec.data);
+		if (cmp < 0)
+			rc = advanceSorted(join->leftSort, &join->leftRec, &join->haveLeft);
+		else if (cmp > 0)
+			rc = advanceSorted(join->rightSort, &join->rightRec, &join->haveRight);
+		else
+			rc = collectGroup(join);
+		if (rc != RC_OK)
+			return rc;
+	}
+}
+
+/************************************************************
+ *                    index nested loop join                *
+ ************************************************************/
+
+static bool
+hasIndex (JoinSide *side)
+{
+	RM_IndexInfo *indexes;
+	int numIndexes;
+	bool found = FALSE;
+
+	if (getTableIndexes(side->rel->name, &indexes, &numIndexes) != RC_OK)
+		return FALSE;
+	for (int i = 0; i < numIndexes; i++)
+		found |= (indexes[i].attrNum == side->attrNum);
+	free(indexes);
+	return found;
+}
+
+static bool
+rightMatches (RM_JoinHandle *join, Record *record)
+{
+	Value *result;
+	bool match;
+
+	if (join->right.cond == NULL)
+		return TRUE;
+	if (join->rightProgram != NULL)
+		return evalCompiledExpr(join->rightProgram, record->data);
+	if (evalExpr(record, join->right.rel->schema, join->right.cond, &result) != RC_OK)
+		return FALSE;
+	match = result->v.boolV;
+	freeVal(result);
+	return match;
+}
+
+/* Fetches the right records with the key of the outer tuple */
+static RC
+lookupMatches (RM_JoinHandle *join)
+{
+	Record outer;
+	Value *key;
+	RID *ids;
+	int numIds;
+	RC rc;
+
+	outer.id = join->outer.id;
+	outer.data = (char *) join->outer.tuple;
+	if ((rc = getAttr(&outer, join->left.rel->schema, join->left.attrNum, &key)) != RC_OK)
+		return rc;
+	rc = lookupRecords(join->right.rel, join->right.attrNum, key, &ids, &numIds);
+	freeVal(key);
+	if (rc != RC_OK)
+		return rc;
+
+	while (join->matchCapacity < numIds) {
+		join->matches = (Record **) realloc(join->matches, (join->matchCapacity + 1) * sizeof(Record *));
+		createRecord(&join->matches[join->matchCapacity++], join->right.rel->schema);
+	}
+	// Records deleted since their index entry was read come back with the id (-1, -1)
+	rc = (numIds > 0) ? getRecords(join->right.rel, ids, numIds, join->matches) : RC_OK;
+	free(ids);
+	join->numMatches = numIds;
+	join->matchPos = 0;
+	return (rc == RC_TUPLE_WIT_RID_ON_EXISTING) ? RC_OK : rc;
+}
+
+static RC
+nextIndexPair (RM_JoinHandle *join, JoinPair *pair)
+{
+	RC rc;
+
+	for (;;) {
+		while (join->matchPos < join->numMatches) {
+			Record *match = join->matches[join->matchPos++];
+
+			if (match->id.page < 0 || !rightMatches(join, match))
+				continue;
+			pair->left = join->outer.tuple;
+			pair->leftId = join->outer.id;
+			pair->right = match->data;
+			pair->rightId = match->id;
+			return RC_OK;
+		}
+		if ((rc = advanceInput(join, &join->outer)) != RC_OK)
+			return rc;
+		if (join->outer.tuple == NULL)
+			return RC_RM_NO_MORE_TUPLES;
+		if ((rc = lookupMatches(join)) != RC_OK)
+			return rc;
+	}
+}
+
+/************************************************************
+ *                    interface                             *
+ ************************************************************/
+
+static void
+initSide (JoinSide *side, RM_TableData *rel, Expr *cond, int attrNum)
+{
+	side->rel = rel;
+	side->cond = cond;
+	side->attrNum = attrNum;
+	determineAttributeOffsetInRecord(rel->schema, attrNum, &side->key.offset);
+	side->key.length = rel->schema->typeLength[attrNum];
+	side->key.dataType = rel->schema->dataTypes[attrNum];
+	side->tupleSize = getRecordSize(rel->schema);
+	side->entrySize = side->tupleSize + sizeof(RID);
+	side->perPage = PAGE_SIZE / side->entrySize;
+}
+
+/* The attributes of the left table, then those of the right one, named <table>.<attribute> */
+static Schema *
+joinSchema (RM_TableData *left, RM_TableData *right)
+{
+	int numAttr = left->schema->numAttr + right->schema->numAttr;
+	char **names = (char **) malloc(numAttr * sizeof(char *));
+	DataType *dataTypes = (DataType *) malloc(numAttr * sizeof(DataType));
+	int *typeLength = (int *) malloc(numAttr * sizeof(int));
+	int n = 0;
+
+	for (int side = 0; side < 2; side++) {
+		RM_TableData *rel = (side == 0) ? left : right;
+
+		for (int i = 0; i < rel->schema->numAttr; i++, n++) {
+			names[n] = (char *) malloc(strlen(rel->name) + strlen(rel->schema->attrNames[i]) + 2);
+			sprintf(names[n], "%s.%s", rel->name, rel->schema->attrNames[i]);
+			dataTypes[n] = rel->schema->dataTypes[i];
+			typeLength[n] = rel->schema->typeLength[i];
+		}
+	}
+	return createSchema(numAttr, names, dataTypes, typeLength, 0, NULL);
+}
+
+/**
+ * Function: startJoin
+ * ------------------
+ * Starts joining the records of left that satisfy leftCond with those of
+ * right that satisfy rightCond on left.leftAttr = right.rightAttr. The
+ * joined tuples (left record, then right record, see getJoinSchema) are
+ * read with nextJoinBatch. The hash join reads its build input here, the
+ * sort-merge join both inputs. The conditions must be kept until closeJoin.
+ *
+ * @param left      Left table
+ * @param leftCond  Condition on the left records; NULL for all
+ * @param leftAttr  Join attribute of the left table
+ * @param right     Right table
+ * @param rightCond Condition on the right records; NULL for all
+ * @param rightAttr Join attribute of the right table, of the same type
+ * @param options   Method and memory budget; NULL for RM_JOIN_AUTO and the default budget
+ * @param join      Set to the new join
+ * @return
+ *  -   RC_OK                   Joined tuples can be read with nextJoinBatch
+ *  -   RC_INVALID_PARAM        An attribute does not exist, the budget is below RM_JOIN_MIN_PAGES,
+ *                              or RM_JOIN_INDEX_NL was asked for without an index on rightAttr
+ *  -   RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE  The join attributes have different types
+ */
+RC
+startJoin (RM_TableData *left, Expr *leftCond, int leftAttr, RM_TableData *right, Expr *rightCond, int rightAttr,
+		RM_JoinOptions *options, RM_JoinHandle **join)
+{
+	RM_JoinMethod method = (options != NULL) ? options->method : RM_JOIN_AUTO;
+	RM_JoinHandle *j;
+	RC rc;
+
+	if (left == NULL || right == NULL || join == NULL)
+		return RC_INVALID_PARAM;
+	if (leftAttr < 0 || leftAttr >= left->schema->numAttr || rightAttr < 0 || rightAttr >= right->schema->numAttr)
+		return RC_INVALID_PARAM;
+	if (options != NULL && ((options->memoryPages != 0 && options->memoryPages < RM_JOIN_MIN_PAGES)
+			|| method < RM_JOIN_AUTO || method > RM_JOIN_INDEX_NL))
+		return RC_INVALID_PARAM;
+	if (left->schema->dataTypes[leftAttr] != right->schema->dataTypes[rightAttr])
+		return RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE;
+
+	j = (RM_JoinHandle *) calloc(1, sizeof(RM_JoinHandle));
+	initSide(&j->left, left, leftCond, leftAttr);
+	initSide(&j->right, right, rightCond, rightAttr);
+	if (j->left.perPage == 0 || j->right.perPage == 0) {
+		free(j);
+		return RC_INVALID_PARAM;
+	}
+	j->memoryPages = (options != NULL && options->memoryPages != 0) ? options->memoryPages : RM_JOIN_DEFAULT_PAGES;
+	j->buildInput.page.pageNum = NO_PAGE;
+	j->probeInput.page.pageNum = NO_PAGE;
+	j->outer.page.pageNum = NO_PAGE;
+
+	if (method == RM_JOIN_AUTO)
+		method = hasIndex(&j->right) ? RM_JOIN_INDEX_NL : RM_JOIN_HASH;
+	else if (method == RM_JOIN_INDEX_NL && !hasIndex(&j->right)) {
+		free(j);
+		return RC_INVALID_PARAM;
+	}
+	j->method = method;
+	j->schema = joinSchema(left, right);
+	*join = j;
+
+	switch (method) {
+	case RM_JOIN_HASH:
+		rc = startHashJoin(j);
+		break;
+	case RM_JOIN_SORT_MERGE:
+		rc = startMergeJoin(j);
+		break;
+	default:
+		if (rightCond != NULL && compileExpr(rightCond, right->schema, &j->rightProgram) != RC_OK)
+			j->rightProgram = NULL;
+		rc = openScanInput(&j->outer, &j->left);
+		break;
+	}
+	if (rc != RC_OK) {
+		closeJoin(j);
+		*join = NULL;
+	}
+	return rc;
+}
+
+/* Layout of the joined tuples; owned by the join */
+Schema *
+getJoinSchema (RM_JoinHandle *join)
+{
+	return join->schema;
+}
+
+/* The method chosen for RM_JOIN_AUTO, or the one asked for */
+RM_JoinMethod
+getJoinMethod (RM_JoinHandle *join)
+{
+	return join->method;
+}
+
+/**
+ * Function: nextJoinBatch
+ * ----------------------
+ * Returns up to maxTuples joined tuples, stored back to back in tuples
+ * (getRecordSize(getJoinSchema(join)) bytes each). Pairs come in no
+ * particular order, except that the sort-merge join returns them by key.
+ *
+ * @param join      Join started by startJoin
+ * @param tuples    Filled with the joined tuples
+ * @param leftIds   Filled with the RIDs of their left records; may be NULL
+ * @param rightIds  Filled with the RIDs of their right records; may be NULL
+ * @param maxTuples Capacity of tuples, leftIds and rightIds
+ * @param numTuples Set to the number of tuples returned
+ * @return
+ *  -   RC_OK                   At least one tuple was returned
+ *  -   RC_RM_NO_MORE_TUPLES    All joined tuples have been returned
+ */
+RC
+nextJoinBatch (RM_JoinHandle *join, char *tuples, RID *leftIds, RID *rightIds, int maxTuples, int *numTuples)
+{
+	int size, rightOffset;
+	JoinPair pair;
+	RC rc;
+
+	if (join == NULL || tuples == NULL || numTuples == NULL || maxTuples < 1)
+		return RC_INVALID_PARAM;
+	size = getRecordSize(join->schema);
+	rightOffset = join->schema->attrOffsets[join->left.rel->schema->numAttr];
+	*numTuples = 0;
+
+	while (*numTuples < maxTuples && !join->done) {
+		switch (join->method) {
+		case RM_JOIN_HASH:
+			rc = nextHashPair(join, &pair);
+			break;
+		case RM_JOIN_SORT_MERGE:
+			rc = nextMergePair(join, &pair);
+			break;
+		default:
+			rc = nextIndexPair(join, &pair);
+			break;
+		}
+		if (rc == RC_RM_NO_MORE_TUPLES) {
+			join->done = TRUE;
+			break;
+		}
+		if (rc != RC_OK)
+			return rc;
+
+		char *out = tuples + (long) *numTuples * size;
+		memcpy(out, pair.left, join->left.tupleSize);
+		memcpy(out + rightOffset, pair.right, join->right.tupleSize);
+		if (leftIds != NULL)
+			leftIds[*numTuples] = pair.leftId;
+		if (rightIds != NULL)
+			rightIds[*numTuples] = pair.rightId;
+		(*numTuples)++;
+	}
+	return (*numTuples > 0) ? RC_OK : RC_RM_NO_MORE_TUPLES;
+}
+
+/* Frees a join, closing its scans and sorts and removing its spill file */
+RC
+closeJoin (RM_JoinHandle *join)
+{
+	RC rc = RC_OK, r;
+
+	if (join == NULL)
+		return RC_INVALID_PARAM;
+
+	// Inputs and partitions first, as they hold pages of the pool
+	JoinInput *inputs[3] = { &join->probeInput, &join->buildInput, &join->outer };
+	for (int i = 0; i < 3; i++) {
+		r = closeInput(join, inputs[i]);
+		if (rc == RC_OK)
+			rc = r;
+	}
+	for (int i = 0; i < join->numPartitions; i++) {
+		free(join->buildParts[i].pages);
+		free(join->probeParts[i].pages);
+	}
+	if (join->poolOpen) {
+		finishPartitions(join, join->buildParts);
+		finishPartitions(join, join->probeParts);
+		r = shutdownBufferPool(&join->pool);
+		if (rc == RC_OK)
+			rc = r;
+	}
+	if (join->spilled)
+		destroyPageFile(join->fileName);
+	free(join->buildParts);
+	free(join->probeParts);
+	free(join->table.buckets);
+	free(join->table.entries);
+
+	if (join->leftSort != NULL)
+		closeSort(join->leftSort);
+	if (join->rightSort != NULL)
+		closeSort(join->rightSort);
+	free(join->leftRec.data);
+	free(join->rightRec.data);
+	free(join->group);
+	free(join->groupIds);
+
+	if (join->rightProgram != NULL)
+		freeCompiledExpr(join->rightProgram);
+	for (int i = 0; i < join->matchCapacity; i++)
+		freeRecord(join->matches[i]);
+	free(join->matches);
+
+	freeSchema(join->schema);
+	free(join);
+	return rc;
+}
@@ -0,0 +1,457 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "rm_kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define KERNELS_X86
+#endif
+
+typedef void (*MarkerMaskFn) (const char *, int, int, char, uint64_t *);
+
+// kernels chosen for this CPU, set once on first use (scans may start on several threads at once)
+static MarkerMaskFn markerMaskImpl = NULL;
+static KernelFilterIntFn filterIntImpl = NULL;
+static KernelFilterFloatFn filterFloatImpl = NULL;
+static const char *implName = NULL;
+
+#define SET_BIT(mask, i) ((mask)[(i) >> 6] |= ((uint64_t) 1) << ((i) & 63))
+
+/************************************************************
+ *                    predicate analysis                    *
+ ************************************************************/
+
+// matches "attr op const", "const op attr" and NOT of either on an int or float attribute
+static bool
+simpleComparison (Expr *expr, Schema *schema, ScanKernel *kernel, bool negate)
+{
+	Operator *op;
+	Expr *attr, *cons;
+	bool attrLeft;
+
+	if (expr->type != EXPR_OP)
+		return FALSE;
+	op = expr->expr.op;
+
+	if (op->type == OP_BOOL_NOT)
+		return simpleComparison(op->args[0], schema, kernel, !negate);
+	if (op->type != OP_COMP_EQUAL && op->type != OP_COMP_SMALLER)
+		return FALSE;
+
+	attrLeft = (op->args[0]->type == EXPR_ATTRREF);
+	attr = attrLeft ? op->args[0] : op->args[1];
+	cons = attrLeft ? op->args[1] : op->args[0];
+	if (attr->type != EXPR_ATTRREF || cons->type != EXPR_CONST)
+		return FALSE;
+	if (attr->expr.attrRef < 0 || attr->expr.attrRef >= schema->numAttr)
+		return FALSE;
+
+	kernel->attrNum = attr->expr.attrRef;
+	kernel->dt = schema->dataTypes[kernel->attrNum];
+	if ((kernel->dt != DT_INT && kernel->dt != DT_FLOAT) || cons->expr.cons->dt != kernel->dt)
+		return FALSE;
+
+	if (kernel->dt == DT_INT)
+		kernel->cons.intV = cons->expr.cons->v.intV;
+	else
+		kernel->cons.floatV = cons->expr.cons->v.floatV;
+
+	if (op->type == OP_COMP_EQUAL)
+		kernel->cmp = KERNEL_CMP_EQ;
+	else
+		kernel->cmp = attrLeft ? KERNEL_CMP_LT : KERNEL_CMP_GT;
+	kernel->negate = negate;
+	return TRUE;
+}
+
+/**
+ * Function: extractScanKernel
+ * ---------------------------
+ * Checks whether a scan condition can be evaluated by a page kernel.
+ * This is the case if the condition is a comparison of an int or float
+ * attribute with a constant, or a conjunction that contains one. In the
+ * latter case the kernel is only a prefilter (kernel->exact is FALSE) and
+ * the full condition still has to be evaluated on the surviving slots.
+ *
+ * @param cond      Scan condition
+ * @param schema    Schema of the scanned table
+ * @param kernel    Filled with the kernel description if one is found
+ * @return
+ *  -   TRUE if a kernel can be used
+ */
+bool
+extractScanKernel (Expr *cond, Schema *schema, ScanKernel *kernel)
+{
+	if (cond == NULL)
+		return FALSE;
+
+	if (simpleComparison(cond, schema, kernel, FALSE))
+	{
+		kernel->exact = TRUE;
+		return TRUE;
+	}
+
+	if (cond->type == EXPR_OP && cond->expr.op->type == OP_BOOL_AND)
+	{
+		if (extractScanKernel(cond->expr.op->args[0], schema, kernel)
+				|| extractScanKernel(cond->expr.op->args[1], schema, kernel))
+		{
+			kernel->exact = FALSE;
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+/************************************************************
+ *                    scalar kernels                        *
+ ************************************************************/
+
+static void
+markerMaskScalar (const char *base, int stride, int n, char marker, uint64_t *mask)
+{
+	memset(mask, 0, sizeof(uint64_t) * ((n + 63) / 64));
+	for (int i = 0; i < n; i++)
+		if (base[(long) i * stride] == marker)
+			SET_BIT(mask, i);
+}
+
+static void
+filterIntScalarFrom (const char *base, int stride, int from, int n, KernelCmp cmp, bool negate, int constant, uint64_t *mask)
+{
+	for (int i = from; i < n; i++)
+	{
+		int v = readIntAttr(base + (long) i * stride);
+		bool hit = (cmp == KERNEL_CMP_EQ) ? (v == constant) : (cmp == KERNEL_CMP_LT) ? (v < constant) : (v > constant);
+		if (hit != negate)
+			SET_BIT(mask, i);
+	}
+}
+
+static void
+filterFloatScalarFrom (const char *base, int stride, int from, int n, KernelCmp cmp, bool negate, float constant, uint64_t *mask)
+{
+	for (int i = from; i < n; i++)
+	{
+		float v = readFloatAttr(base + (long) i * stride);
+		bool hit = (cmp == KERNEL_CMP_EQ) ? (v == constant) : (cmp == KERNEL_CMP_LT) ? (v < constant) : (v > constant);
+		if (hit != negate)
+			SET_BIT(mask, i);
+	}
+}
+
+static void
+filterIntScalar (const char *base, int stride, int n, KernelCmp cmp, bool negate, int constant, uint64_t *mask)
+{
+	memset(mask, 0, sizeof(uint64_t) * ((n + 63) / 64));
+	filterIntScalarFrom(base, stride, 0, n, cmp, negate, constant, mask);
+}
+
+static void
+filterFloatScalar (const char *base, int stride, int n, KernelCmp cmp, bool negate, float constant, uint64_t *mask)
+{
+	memset(mask, 0, sizeof(uint64_t) * ((n + 63) / 64));
+	filterFloatScalarFrom(base, stride, 0, n, cmp, negate, constant, mask);
+}
+
+#ifdef KERNELS_X86
+/************************************************************
+ *                    SSE2 kernels (4 lanes)                *
+ ************************************************************/
+
+// SSE2 has no gather, so strided lanes are loaded one by one and compared together
+#define SSE_LOAD_INT(base, i, stride)										\
+		((stride) == sizeof(int) ? _mm_loadu_si128((const __m128i *) ((base) + (long) (i) * 4))	\
+				: _mm_setr_epi32(readIntAttr((base) + (long) (i) * (stride)),				\
+						readIntAttr((base) + (long) ((i) + 1) * (stride)),				\
+						readIntAttr((base) + (long) ((i) + 2) * (stride)),				\
+						readIntAttr((base) + (long) ((i) + 3) * (stride))))
+
+__attribute__((target("sse2")))
+static void
+filterIntSse2 (const char *base, int stride, int n, KernelCmp cmp, bool negate, int constant, uint64_t *mask)
+{
+	__m128i c = _mm_set1_epi32(constant);
+	int i = 0;
+
+	memset(mask, 0, sizeof(uint64_t) * ((n + 63) / 64));
+	for (; i + 4 <= n; i += 4)
+	{
+		__m128i v = SSE_LOAD_INT(base, i, stride);
+		__m128i r = (cmp == KERNEL_CMP_EQ) ? _mm_cmpeq_epi32(v, c)
+				: (cmp == KERNEL_CMP_LT) ? _mm_cmplt_epi32(v, c) : _mm_cmpgt_epi32(v, c);
+		uint64_t bits = _mm_movemask_ps(_mm_castsi128_ps(r));
+
+		if (negate)
+			bits ^= 0xF;
+		mask[i >> 6] |= bits << (i & 63);
+	}
+	filterIntScalarFrom(base, stride, i, n, cmp, negate, constant, mask);
+}
+
+__attribute__((target("sse2")))
+static void
+filterFloatSse2 (const char *base, int stride, int n, KernelCmp cmp, bool negate, float constant, uint64_t *mask)
+{
+	__m128 c = _mm_set1_ps(constant);
+	int i = 0;
+
+	memset(mask, 0, sizeof(uint64_t) * ((n + 63) / 64));
+	for (; i + 4 <= n; i += 4)
+	{
+		__m128 v = _mm_castsi128_ps(SSE_LOAD_INT(base, i, stride));
+		__m128 r = (cmp == KERNEL_CMP_EQ) ? _mm_cmpeq_ps(v, c)
+				: (cmp == KERNEL_CMP_LT) ? _mm_cmplt_ps(v, c) : _mm_cmpgt_ps(v, c);
+		uint64_t bits = _mm_movemask_ps(r);
+
+		if (negate)
+			bits ^= 0xF;
+		mask[i >> 6] |= bits << (i & 63);
+	}
+	filterFloatScalarFrom(base, stride, i, n, cmp, negate, constant, mask);
+}
+
+/************************************************************
+ *                    AVX2 kernels (8 lanes)                *
+ ************************************************************/
+
+__attribute__((target("avx2")))
+static __m256i
+gatherInt (const char *base, int i, int stride, __m256i index)
+{
+	if (stride == sizeof(int))
+		return _mm256_loadu_si256((const __m256i *) (base + (long) i * 4));
+	return _mm256_i32gather_epi32((const int *) (base + (long) i * stride), index, 1);
+}
+
+__attribute__((target("avx2")))
+static void
+markerMaskAvx2 (const char *base, int stride, int n, char marker, uint64_t *mask)
+{
+	__m256i index = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(stride));
+	__m256i low = _mm256_set1_epi32(0xFF);
+	__m256i m = _mm256_set1_epi32((unsigned char) marker);
+	int i = 0;
+
+	memset(mask, 0, sizeof(uint64_t) * ((n + 63) / 64));
+
+	// contiguous markers (PAX pages) are compared 32 at a time
+	if (stride == 1)
+	{
+		__m256i m8 = _mm256_set1_epi8(marker);
+		for (; i + 32 <= n; i += 32)
+		{
+			__m256i v = _mm256_loadu_si256((const __m256i *) (base + i));
+			uint64_t bits = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, m8));
+			mask[i >> 6] |= bits << (i & 63);
+		}
+	}
+
+	// a gather reads 4 bytes per slot, which would run past the page for slots smaller than that
+	if (stride >= (int) sizeof(int))
+	{
+		for (; i + 8 <= n; i += 8)
+		{
+			__m256i v = _mm256_and_si256(_mm256_i32gather_epi32((const int *) (base + (long) i * stride), index, 1), low);
+			uint64_t bits = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(v, m)));
+			mask[i >> 6] |= bits << (i & 63);
+		}
+	}
+	for (; i < n; i++)
+		if (base[(long) i * stride] == marker)
+			SET_BIT(mask, i);
+}
+
+__attribute__((target("avx2")))
+static void
+filterIntAvx2 (const char *base, int stride, int n, KernelCmp cmp, bool negate, int constant, uint64_t *mask)
+{
+	__m256i index = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(stride));
+	__m256i c = _mm256_set1_epi32(constant);
+	int i = 0;
+
+	memset(mask, 0, sizeof(uint64_t) * ((n + 63) / 64));
+	for (; i + 8 <= n; i += 8)
+	{
+		__m256i v = gatherInt(base, i, stride, index);
+		__m256i r = (cmp == KERNEL_CMP_EQ) ? _mm256_cmpeq_epi32(v, c)
+				: (cmp == KERNEL_CMP_LT) ? _mm256_cmpgt_epi32(c, v) : _mm256_cmpgt_epi32(v, c);
+		uint64_t bits = _mm256_movemask_ps(_mm256_castsi256_ps(r));
+
+		if (negate)
+			bits ^= 0xFF;
+		mask[i >> 6] |= bits << (i & 63);
+	}
+	filterIntScalarFrom(base, stride, i, n, cmp, negate, constant, mask);
+}
+
+__attribute__((target("avx2")))
+static void
+filterFloatAvx2 (const char *base, int stride, int n, KernelCmp cmp, bool negate, float constant, uint64_t *mask)
+{
+	__m256i index = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(stride));
+	__m256 c = _mm256_set1_ps(constant);
+	int i = 0;
+
+	memset(mask, 0, sizeof(uint64_t) * ((n + 63) / 64));
+	for (; i + 8 <= n; i += 8)
+	{
+		__m256 v = _mm256_castsi256_ps(gatherInt(base, i, stride, index));
+		__m256 r = (cmp == KERNEL_CMP_EQ) ? _mm256_cmp_ps(v, c, _CMP_EQ_OQ)
+				: (cmp == KERNEL_CMP_LT) ? _mm256_cmp_ps(v, c, _CMP_LT_OQ) : _mm256_cmp_ps(v, c, _CMP_GT_OQ);
+		uint64_t bits = _mm256_movemask_ps(r);
+
+		// negating the bits keeps NaN semantics identical to !(v op c)
+		if (negate)
+			bits ^= 0xFF;
+		mask[i >> 6] |= bits << (i & 63);
+	}
+	filterFloatScalarFrom(base, stride, i, n, cmp, negate, constant, mask);
+}
+#endif // KERNELS_X86
+
+/************************************************************
+ *                    dispatch                              *
+ ************************************************************/
+
+// pick the widest kernels the CPU supports (CPUID via __builtin_cpu_supports)
+static pthread_once_t kernelsSelected = PTHREAD_ONCE_INIT;
+
+static void
+selectKernels (void)
+{
+	MarkerMaskFn marker = markerMaskScalar;
+	KernelFilterIntFn filterInt = filterIntScalar;
+	KernelFilterFloatFn filterFloat = filterFloatScalar;
+	const char *name = "scalar";
+
+#ifdef KERNELS_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+	{
+		marker = markerMaskAvx2;
+		filterInt = filterIntAvx2;
+		filterFloat = filterFloatAvx2;
+		name = "avx2";
+	}
+	else if (__builtin_cpu_supports("sse2"))
+	{
+		filterInt = filterIntSse2;
+		filterFloat = filterFloatSse2;
+		name = "sse2";
+	}
+#endif
+
+	markerMaskImpl = marker;
+	filterIntImpl = filterInt;
+	filterFloatImpl = filterFloat;
+	implName = name;
+}
+
+void
+kernelMarkerMask (const char *base, int stride, int n, char marker, uint64_t *mask)
+{
+	pthread_once(&kernelsSelected, selectKernels);
+	markerMaskImpl(base, stride, n, marker, mask);
+}
+
+void
+kernelFilterInt (const char *base, int stride, int n, KernelCmp cmp, bool negate, int constant, uint64_t *mask)
+{
+	pthread_once(&kernelsSelected, selectKernels);
+	filterIntImpl(base, stride, n, cmp, negate, constant, mask);
+}
+
+void
+kernelFilterFloat (const char *base, int stride, int n, KernelCmp cmp, bool negate, float constant, uint64_t *mask)
+{
+	pthread_once(&kernelsSelected, selectKernels);
+	filterFloatImpl(base, stride, n, cmp, negate, constant, mask);
+}
+
+const char *
+kernelImplementation (void)
+{
+	pthread_once(&kernelsSelected, selectKernels);
+	return implName;
+}
+
+bool
+kernelVariant (const char *name, KernelFilterIntFn *filterInt, KernelFilterFloatFn *filterFloat)
+{
+	if (strcmp(name, "scalar") == 0)
+	{
+		*filterInt = filterIntScalar;
+		*filterFloat = filterFloatScalar;
+		return TRUE;
+	}
+#ifdef KERNELS_X86
+	__builtin_cpu_init();
+	if (strcmp(name, "sse2") == 0 && __builtin_cpu_supports("sse2"))
+	{
+		*filterInt = filterIntSse2;
+		*filterFloat = filterFloatSse2;
+		return TRUE;
+	}
+	if (strcmp(name, "avx2") == 0 && __builtin_cpu_supports("avx2"))
+	{
+		*filterInt = filterIntAvx2;
+		*filterFloat = filterFloatAvx2;
+		return TRUE;
+	}
+#endif
+	return FALSE;
+}
+
+void
+kernelAndMask (uint64_t *mask, const uint64_t *other, int n)
+{
+	for (int w = 0; w < (n + 63) / 64; w++)
+		mask[w] &= other[w];
+}
+
+// index of the first set bit at or after from, or -1
+int
+kernelNextBit (const uint64_t *mask, int from, int n)
+{
+	int w = from >> 6;
+
+	if (from >= n)
+		return -1;
+
+	uint64_t word = mask[w] & (~((uint64_t) 0) << (from & 63));
+	while (TRUE)
+	{
+		if (word != 0)
+		{
+			int bit = (w << 6) + __builtin_ctzll(word);
+			return (bit < n) ? bit : -1;
+		}
+		if (++w >= (n + 63) / 64)
+			return -1;
+		word = mask[w];
+	}
+}
+
+// number of set bits from from up to n
+int
+kernelCountBits (const uint64_t *mask, int from, int n)
+{
+	int count = 0;
+
+	if (from >= n)
+		return 0;
+	for (int w = from >> 6; w < (n + 63) / 64; w++)
+	{
+		uint64_t word = mask[w];
+		if (w == from >> 6)
+			word &= ~((uint64_t) 0) << (from & 63);
+		if (w == (n - 1) >> 6 && (n & 63) != 0)
+			word &= ~(~((uint64_t) 0) << (n & 63));
+		count += __builtin_popcountll(word);
+	}
+	return count;
+}
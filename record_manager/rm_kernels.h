@@ -0,0 +1,54 @@
+#ifndef RM_KERNELS_H
+#define RM_KERNELS_H
+
+#include <stdint.h>
+#include "dberror.h"
+#include "expr.h"
+#include "tables.h"
+
+// one bit per slot; a slot takes at least one byte, so a page never has more than PAGE_SIZE slots
+#define KERNEL_MASK_WORDS (PAGE_SIZE / 64)
+
+// comparison evaluated by a page kernel: attr <cmp> constant, optionally negated
+typedef enum KernelCmp {
+	KERNEL_CMP_EQ,
+	KERNEL_CMP_LT,
+	KERNEL_CMP_GT
+} KernelCmp;
+
+// a predicate of the form "attr op constant" on an int or float attribute
+typedef struct ScanKernel {
+	int attrNum;
+	DataType dt;
+	KernelCmp cmp;
+	bool negate;
+	bool exact; // FALSE if the kernel only prefilters a larger conjunction
+	union kernelConst {
+		int intV;
+		float floatV;
+	} cons;
+} ScanKernel;
+
+// predicate analysis
+extern bool extractScanKernel (Expr *cond, Schema *schema, ScanKernel *kernel);
+
+// page kernels: bit i of mask is set for slot i, slots are stride bytes apart starting at base
+extern void kernelMarkerMask (const char *base, int stride, int n, char marker, uint64_t *mask);
+extern void kernelFilterInt (const char *base, int stride, int n, KernelCmp cmp, bool negate, int constant, uint64_t *mask);
+extern void kernelFilterFloat (const char *base, int stride, int n, KernelCmp cmp, bool negate, float constant, uint64_t *mask);
+
+// mask helpers
+extern void kernelAndMask (uint64_t *mask, const uint64_t *other, int n);
+extern int kernelNextBit (const uint64_t *mask, int from, int n);
+extern int kernelCountBits (const uint64_t *mask, int from, int n);
+
+// name of the instruction set selected at runtime ("avx2", "sse2" or "scalar")
+extern const char *kernelImplementation (void);
+
+// filter kernels of one instruction set, so that tests can compare them with the scalar ones;
+// FALSE if this build or CPU does not have the instruction set
+typedef void (*KernelFilterIntFn) (const char *base, int stride, int n, KernelCmp cmp, bool negate, int constant, uint64_t *mask);
+typedef void (*KernelFilterFloatFn) (const char *base, int stride, int n, KernelCmp cmp, bool negate, float constant, uint64_t *mask);
+extern bool kernelVariant (const char *name, KernelFilterIntFn *filterInt, KernelFilterFloatFn *filterFloat);
+
+#endif // RM_KERNELS_H
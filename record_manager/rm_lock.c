@@ -0,0 +1,492 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "rm_lock.h"
+
+/*
+ * Locks are kept in a hash table keyed by table and RID, split into
+ * partitions that each have their own mutex, so that owners locking
+ * different records rarely share a mutex. A lock has a queue of requests in
+ * arrival order: a new request is granted when it is compatible with the
+ * modes granted to other owners and nobody waits ahead of it. An owner
+ * asking for a stronger mode than it holds (an upgrade) only waits for the
+ * granted modes.
+ *
+ * A waiting owner records the owners it waits for. Before it sleeps it looks
+ * for a path from them back to itself in this waits-for graph; if there is
+ * one, its request fails with RC_RM_DEADLOCK and the caller aborts. With a
+ * wait timeout set, no graph is kept and a request fails with
+ * RC_RM_LOCK_TIMEOUT when it is not granted in time.
+ */
+
+#define LOCK_BUCKETS 16 // per partition
+
+typedef struct LockRequest {
+	LockOwner *owner;
+	LockMode mode;      // mode granted, if granted
+	LockMode wanted;    // mode waited for, if waiting
+	bool granted;
+	bool waiting;       // for the first grant or for an upgrade
+	struct LockHead *head;
+	struct LockRequest *next;     // in the queue of the lock
+	struct LockRequest *nextHeld; // in the list of the owner
+} LockRequest;
+
+typedef struct LockHead {
+	void *table;
+	RID rid;
+	LockRequest *queue;
+	struct LockHead *next; // in the bucket
+} LockHead;
+
+typedef struct LockPartition {
+	pthread_mutex_t mutex;
+	LockHead *buckets[LOCK_BUCKETS];
+} LockPartition;
+
+static LockPartition partitions[LOCK_PARTITIONS];
+static pthread_once_t partitionsOnce = PTHREAD_ONCE_INIT;
+
+// the waits-for graph: the owners waiting, whose waitsFor lists are its edges
+static pthread_mutex_t graphLock = PTHREAD_MUTEX_INITIALIZER;
+static LockOwner **waiters = NULL;
+static int numWaiters = 0;
+
+static int waitTimeout = 0; // milliseconds, 0 to detect deadlocks instead
+
+// compatible[held][wanted]
+static const bool compatible[4][4] = {
+	/* IS */ { TRUE, TRUE, TRUE, FALSE },
+	/* IX */ { TRUE, TRUE, FALSE, FALSE },
+	/* S  */ { TRUE, FALSE, TRUE, FALSE },
+	/* X  */ { FALSE, FALSE, FALSE, FALSE }
+};
+
+static void
+initPartitions (void)
+{
+	for (int i = 0; i < LOCK_PARTITIONS; i++)
+		pthread_mutex_init(&partitions[i].mutex, NULL);
+}
+
+static unsigned int
+hashKey (void *table, RID rid)
+{
+	uint64_t h = (uint64_t) (uintptr_t) table;
+
+	h = (h ^ (h >> 17)) * 0x9E3779B97F4A7C15ULL;
+	h ^= (uint64_t) (unsigned int) rid.page * 0xC2B2AE3D27D4EB4FULL;
+	h ^= (uint64_t) (unsigned int) rid.slot * 0x165667B19E3779F9ULL;
+	return (unsigned int) (h ^ (h >> 32));
+}
+
+/* Whether a held mode includes everything a wanted mode allows */
+static bool
+covers (LockMode held, LockMode wanted)
+{
+	return held == wanted || held == LOCK_X || (wanted == LOCK_IS && (held == LOCK_IX || held == LOCK_S));
+}
+
+/* Weakest mode covering both */
+static LockMode
+combine (LockMode held, LockMode wanted)
+{
+	if (covers(held, wanted))
+		return held;
+	if (covers(wanted, held))
+		return wanted;
+	return LOCK_X; // S and IX
+}
+
+static LockHead *
+findHead (LockPartition *part, unsigned int hash, void *table, RID rid, bool create)
+{
+	LockHead **bucket = &part->buckets[(hash / LOCK_PARTITIONS) % LOCK_BUCKETS];
+	LockHead *head;
+
+	for (head = *bucket; head != NULL; head = head->next) {
+		if (head->table == table && head->rid.page == rid.page && head->rid.slot == rid.slot)
+			return head;
+	}
+	if (!create)
+		return NULL;
+	head = (LockHead *) malloc(sizeof(LockHead));
+	head->table = table;
+	head->rid = rid;
+	head->queue = NULL;
+	head->next = *bucket;
+	*bucket = head;
+	return head;
+}
+
+/* Frees a lock nobody holds or waits for; partition mutex held */
+static void
+dropHeadIfUnused (LockPartition *part, LockHead *head)
+{
+	LockHead **link = &part->buckets[(hashKey(head->table, head->rid) / LOCK_PARTITIONS) % LOCK_BUCKETS];
+
+	if (head->queue != NULL)
+		return;
+	while (*link != head)
+		link = &(*link)->next;
+	*link = head->next;
+	free(head);
+}
+
+/* Wakes the owners waiting for a lock, whose requests may be grantable now; partition mutex held */
+static void
+wakeWaiters (LockHead *head)
+{
+	for (LockRequest *r = head->queue; r != NULL; r = r->next) {
+		if (r->waiting)
+			pthread_cond_signal(&r->owner->wakeup);
+	}
+}
+
+/**
+ * Function: blockers
+ * -----------------
+ * Finds the requests a waiting request has to wait for: other owners'
+ * granted modes it conflicts with and, unless it is an upgrade, every
+ * request waiting ahead of it.
+ *
+ * @param head      Lock of the request
+ * @param req       Waiting request
+ * @param owners    If not NULL, set to the owners of those requests
+ * @return
+ *  -   The number of those requests; 0 if req can be granted
+ */
+static int
+blockers (LockHead *head, LockRequest *req, LockOwner ***owners)
+{
+	int count = 0;
+	bool ahead = TRUE;
+
+	for (LockRequest *r = head->queue; r != NULL; r = r->next) {
+		bool blocks;
+
+		if (r == req) {
+			ahead = FALSE;
+			continue;
+		}
+		blocks = (r->granted && !compatible[r->mode][req->wanted])
+				|| (ahead && !req->granted && !r->granted);
+		if (!blocks)
+			continue;
+		if (owners != NULL) {
+			*owners = (LockOwner **) realloc(*owners, (count + 1) * sizeof(LockOwner *));
+			(*owners)[count] = r->owner;
+		}
+		count++;
+	}
+	return count;
+}
+
+static bool
+isWaiting (LockOwner *owner)
+{
+	for (int i = 0; i < numWaiters; i++) {
+		if (waiters[i] == owner)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/* Whether target can be reached from an owner in the waits-for graph; graphLock held */
+static bool
+reaches (LockOwner *from, LockOwner *target, LockOwner **visited, int *numVisited)
+{
+	for (int i = 0; i < from->numWaitsFor; i++) {
+		LockOwner *next = from->waitsFor[i];
+		bool seen = FALSE;
+
+		if (next == target)
+			return TRUE;
+
+		// Owners not waiting have no edges, and may have been freed already
+		if (!isWaiting(next))
+			continue;
+		for (int j = 0; j < *numVisited && !seen; j++)
+			seen = (visited[j] == next);
+		if (seen)
+			continue;
+		visited[(*numVisited)++] = next;
+		if (reaches(next, target, visited, numVisited))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/**
+ * Function: noteWait
+ * -----------------
+ * Replaces the edges of a waiting owner in the waits-for graph by the
+ * owners of the requests it waits for now, and checks whether they close a
+ * cycle. An owner waits for a single request at a time.
+ *
+ * @param owner     Owner about to wait
+ * @param head      Lock it waits for
+ * @param req       Its request
+ * @return
+ *  -   TRUE if waiting would deadlock
+ */
+static bool
+noteWait (LockOwner *owner, LockHead *head, LockRequest *req)
+{
+	LockOwner **visited;
+	int numVisited = 0;
+	bool deadlock;
+
+	pthread_mutex_lock(&graphLock);
+	free(owner->waitsFor);
+	owner->waitsFor = NULL;
+	owner->numWaitsFor = blockers(head, req, &owner->waitsFor);
+	if (!isWaiting(owner)) {
+		waiters = (LockOwner **) realloc(waiters, (numWaiters + 1) * sizeof(LockOwner *));
+		waiters[numWaiters++] = owner;
+	}
+
+	visited = (LockOwner **) malloc(numWaiters * sizeof(LockOwner *));
+	deadlock = reaches(owner, owner, visited, &numVisited);
+	free(visited);
+	pthread_mutex_unlock(&graphLock);
+	return deadlock;
+}
+
+/* Removes an owner that stopped waiting from the waits-for graph */
+static void
+endWait (LockOwner *owner)
+{
+	pthread_mutex_lock(&graphLock);
+	for (int i = 0; i < numWaiters; i++) {
+		if (waiters[i] == owner) {
+			waiters[i] = waiters[--numWaiters];
+			break;
+		}
+	}
+	free(owner->waitsFor);
+	owner->waitsFor = NULL;
+	owner->numWaitsFor = 0;
+	pthread_mutex_unlock(&graphLock);
+}
+
+/* Withdraws a request that was not granted, or an upgrade; partition mutex held */
+static void
+cancelRequest (LockPartition *part, LockHead *head, LockRequest *req)
+{
+	req->waiting = FALSE;
+	if (!req->granted) {
+		LockRequest **link = &head->queue;
+		while (*link != req)
+			link = &(*link)->next;
+		*link = req->next;
+		free(req);
+	}
+	wakeWaiters(head);
+	dropHeadIfUnused(part, head);
+}
+
+static void
+grant (LockRequest *req)
+{
+	if (!req->granted) {
+		req->nextHeld = req->owner->held;
+		req->owner->held = req;
+	}
+	req->mode = req->wanted;
+	req->granted = TRUE;
+	req->waiting = FALSE;
+}
+
+/* Queues a request of an owner, or an upgrade of its request; partition mutex held */
+static LockRequest *
+request (LockHead *head, LockOwner *owner, LockMode mode)
+{
+	LockRequest *req, **link = &head->queue;
+
+	for (req = head->queue; req != NULL; req = req->next) {
+		if (req->owner == owner) {
+			req->wanted = combine(req->mode, mode);
+			req->waiting = TRUE;
+			return req;
+		}
+	}
+	req = (LockRequest *) malloc(sizeof(LockRequest));
+	req->owner = owner;
+	req->mode = req->wanted = mode;
+	req->granted = FALSE;
+	req->waiting = TRUE;
+	req->head = head;
+	req->next = NULL;
+	req->nextHeld = NULL;
+	while (*link != NULL)
+		link = &(*link)->next;
+	*link = req;
+	return req;
+}
+
+/* Request of an owner on a lock, NULL if it has none */
+static LockRequest *
+heldBy (LockHead *head, LockOwner *owner)
+{
+	for (LockRequest *r = head->queue; r != NULL; r = r->next) {
+		if (r->owner == owner)
+			return r;
+	}
+	return NULL;
+}
+
+void
+initLockOwner (LockOwner *owner)
+{
+	owner->held = NULL;
+	pthread_cond_init(&owner->wakeup, NULL);
+	owner->waitsFor = NULL;
+	owner->numWaitsFor = 0;
+}
+
+/* Frees what an owner uses; its locks must have been released */
+void
+destroyLockOwner (LockOwner *owner)
+{
+	pthread_cond_destroy(&owner->wakeup);
+	free(owner->waitsFor);
+}
+
+/**
+ * Function: lockAcquire
+ * --------------------
+ * Locks a record, or a whole table with rid {LOCK_TABLE_SLOT,
+ * LOCK_TABLE_SLOT}, waiting while other owners hold conflicting modes. The
+ * lock is held until lockReleaseAll; asking again for a mode the owner holds
+ * returns at once, and asking for a stronger one upgrades the lock.
+ *
+ * @param owner     Owner of the lock
+ * @param table     Table the record belongs to
+ * @param rid       Record to lock
+ * @param mode      Mode to lock it in
+ * @return
+ *  -   RC_OK if the lock is held in (at least) mode
+ *  -   RC_RM_DEADLOCK if waiting would close a cycle of waiting owners
+ *  -   RC_RM_LOCK_TIMEOUT if a wait timeout is set and ran out
+ */
+RC
+lockAcquire (LockOwner *owner, void *table, RID rid, LockMode mode)
+{
+	unsigned int hash = hashKey(table, rid);
+	LockPartition *part = &partitions[hash % LOCK_PARTITIONS];
+	LockHead *head;
+	LockRequest *req;
+	struct timespec deadline;
+	bool waited = FALSE;
+	RC rc = RC_OK;
+
+	pthread_once(&partitionsOnce, initPartitions);
+	if (waitTimeout > 0) {
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_sec += waitTimeout / 1000;
+		deadline.tv_nsec += (long) (waitTimeout % 1000) * 1000000;
+		if (deadline.tv_nsec >= 1000000000) {
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000;
+		}
+	}
+
+	pthread_mutex_lock(&part->mutex);
+	head = findHead(part, hash, table, rid, TRUE);
+	req = heldBy(head, owner);
+	if (req != NULL && req->granted && covers(req->mode, mode)) {
+		pthread_mutex_unlock(&part->mutex);
+		return RC_OK;
+	}
+
+	req = request(head, owner, mode);
+	while (blockers(head, req, NULL) > 0) {
+		if (waitTimeout > 0) {
+			if (pthread_cond_timedwait(&owner->wakeup, &part->mutex, &deadline) == ETIMEDOUT
+					&& blockers(head, req, NULL) > 0) {
+				rc = RC_RM_LOCK_TIMEOUT;
+				break;
+			}
+			continue;
+		}
+		waited = TRUE;
+		if (noteWait(owner, head, req)) {
+			rc = RC_RM_DEADLOCK;
+			break;
+		}
+		pthread_cond_wait(&owner->wakeup, &part->mutex);
+	}
+
+	if (rc == RC_OK)
+		grant(req);
+	else
+		cancelRequest(part, head, req);
+	pthread_mutex_unlock(&part->mutex);
+	if (waited)
+		endWait(owner);
+	return rc;
+}
+
+/* lockAcquire that does not wait: FALSE if the lock cannot be granted at once */
+bool
+lockTry (LockOwner *owner, void *table, RID rid, LockMode mode)
+{
+	unsigned int hash = hashKey(table, rid);
+	LockPartition *part = &partitions[hash % LOCK_PARTITIONS];
+	LockHead *head;
+	LockRequest *req;
+	bool granted;
+
+	pthread_once(&partitionsOnce, initPartitions);
+	pthread_mutex_lock(&part->mutex);
+	head = findHead(part, hash, table, rid, TRUE);
+	req = heldBy(head, owner);
+	if (req != NULL && req->granted && covers(req->mode, mode)) {
+		pthread_mutex_unlock(&part->mutex);
+		return TRUE;
+	}
+	req = request(head, owner, mode);
+	granted = (blockers(head, req, NULL) == 0);
+	if (granted)
+		grant(req);
+	else
+		cancelRequest(part, head, req);
+	pthread_mutex_unlock(&part->mutex);
+	return granted;
+}
+
+/* Releases all locks of an owner and wakes the owners waiting for them */
+void
+lockReleaseAll (LockOwner *owner)
+{
+	LockRequest *req = owner->held;
+
+	while (req != NULL) {
+		LockRequest *nextHeld = req->nextHeld;
+		LockHead *head = req->head;
+		LockPartition *part = &partitions[hashKey(head->table, head->rid) % LOCK_PARTITIONS];
+		LockRequest **link;
+
+		pthread_mutex_lock(&part->mutex);
+		for (link = &head->queue; *link != req; link = &(*link)->next)
+			;
+		*link = req->next;
+		free(req);
+		wakeWaiters(head);
+		dropHeadIfUnused(part, head);
+		pthread_mutex_unlock(&part->mutex);
+		req = nextHeld;
+	}
+	owner->held = NULL;
+}
+
+/* Sets how long lockAcquire waits, 0 to wait until granted or deadlocked; not while owners wait */
+void
+setLockWaitTimeout (int timeoutMillis)
+{
+	waitTimeout = (timeoutMillis > 0) ? timeoutMillis : 0;
+}
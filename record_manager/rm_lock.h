@@ -0,0 +1,42 @@
+#ifndef RM_LOCK_H
+#define RM_LOCK_H
+
+#include <pthread.h>
+
+#include "dberror.h"
+#include "tables.h"
+
+// locks are spread over this many hash partitions, each with its own mutex
+#define LOCK_PARTITIONS 64
+
+// the RID of the lock on a whole table
+#define LOCK_TABLE_SLOT -1
+
+typedef enum LockMode {
+	LOCK_IS = 0, // intention to lock rows shared
+	LOCK_IX = 1, // intention to lock rows exclusive
+	LOCK_S = 2,  // shared
+	LOCK_X = 3   // exclusive
+} LockMode;
+
+struct LockRequest;
+
+// a transaction (or single operation) holding and waiting for locks
+typedef struct LockOwner {
+	struct LockRequest *held;   // granted requests, linked through nextHeld
+	pthread_cond_t wakeup;      // signalled when a lock the owner waits for may be free
+	struct LockOwner **waitsFor; // owners it waits for, while waiting
+	int numWaitsFor;
+} LockOwner;
+
+// owners
+extern void initLockOwner (LockOwner *owner);
+extern void destroyLockOwner (LockOwner *owner);
+
+// locking
+extern RC lockAcquire (LockOwner *owner, void *table, RID rid, LockMode mode);
+extern bool lockTry (LockOwner *owner, void *table, RID rid, LockMode mode);
+extern void lockReleaseAll (LockOwner *owner);
+extern void setLockWaitTimeout (int timeoutMillis);
+
+#endif // RM_LOCK_H
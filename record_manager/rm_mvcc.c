@@ -0,0 +1,402 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "rm_mvcc.h"
+
+/*
+ * Records are changed in place and the state before a change is kept in a
+ * version chain until no snapshot can need it any more. A snapshot sees the
+ * newest version of a chain that was committed at or before its timestamp,
+ * or written by the snapshot's own transaction; records without a chain are
+ * read from the page. The oldest version of a chain is the state before the
+ * first change that was kept, which every open snapshot sees.
+ *
+ * Commits take a timestamp and then mark their versions committed table by
+ * table. Until that is done a commit is in progress. New snapshots wait for
+ * the commits in progress to finish, so that they see every commit that
+ * finished before them; reads outside snapshots, which may hold a table
+ * latch a commit needs, get a timestamp below the commits in progress
+ * instead. Either way no one sees part of a commit.
+ */
+
+#define MVCC_BUCKETS 256
+#define MVCC_MIN_COLLECT 64
+
+/************************************************************
+ *                    snapshots and commits                 *
+ ************************************************************/
+
+static pthread_mutex_t mvccLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t commitDone = PTHREAD_COND_INITIALIZER; // signalled when a commit finishes
+static MvccTs lastTs = 0;        // last timestamp handed out
+static MvccTs *snapshots = NULL; // timestamps of the open snapshots
+static int numSnapshots = 0;
+static MvccTs *commits = NULL;   // timestamps of the commits in progress
+static int numCommits = 0;
+
+static void
+addTs (MvccTs **list, int *count, MvccTs ts)
+{
+	*list = (MvccTs *) realloc(*list, (*count + 1) * sizeof(MvccTs));
+	(*list)[(*count)++] = ts;
+}
+
+static void
+removeTs (MvccTs *list, int *count, MvccTs ts)
+{
+	for (int i = 0; i < *count; i++) {
+		if (list[i] == ts) {
+			list[i] = list[--(*count)];
+			return;
+		}
+	}
+}
+
+/* Newest timestamp all of whose commits are complete; mvccLock held */
+static MvccTs
+stableTs (void)
+{
+	MvccTs ts = lastTs;
+
+	for (int i = 0; i < numCommits; i++) {
+		if (commits[i] - 1 < ts)
+			ts = commits[i] - 1;
+	}
+	return ts;
+}
+
+/**
+ * Function: mvccBeginSnapshot
+ * --------------------------
+ * Opens a snapshot of the changes committed so far, waiting for the commits
+ * in progress to finish. Its versions are kept until mvccEndSnapshot. The
+ * caller must not hold a table latch.
+ *
+ * @return
+ *  -   The timestamp of the snapshot
+ */
+MvccTs
+mvccBeginSnapshot (void)
+{
+	MvccTs ts;
+
+	pthread_mutex_lock(&mvccLock);
+	ts = lastTs;
+	while (stableTs() < ts)
+		pthread_cond_wait(&commitDone, &mvccLock);
+	addTs(&snapshots, &numSnapshots, ts);
+	pthread_mutex_unlock(&mvccLock);
+	return ts;
+}
+
+void
+mvccEndSnapshot (MvccTs snapshot)
+{
+	pthread_mutex_lock(&mvccLock);
+	removeTs(snapshots, &numSnapshots, snapshot);
+	pthread_mutex_unlock(&mvccLock);
+}
+
+/* Whether changes have to keep versions for open snapshots */
+bool
+mvccSnapshotsActive (void)
+{
+	bool active;
+
+	pthread_mutex_lock(&mvccLock);
+	active = (numSnapshots > 0);
+	pthread_mutex_unlock(&mvccLock);
+	return active;
+}
+
+/* Timestamp of a snapshot that is not kept open, for reading the last committed state */
+MvccTs
+mvccCurrentTs (void)
+{
+	MvccTs ts;
+
+	pthread_mutex_lock(&mvccLock);
+	ts = stableTs();
+	pthread_mutex_unlock(&mvccLock);
+	return ts;
+}
+
+/* Starts a commit; snapshots do not see it before mvccFinishCommit */
+MvccTs
+mvccStartCommit (void)
+{
+	MvccTs ts;
+
+	pthread_mutex_lock(&mvccLock);
+	ts = ++lastTs;
+	addTs(&commits, &numCommits, ts);
+	pthread_mutex_unlock(&mvccLock);
+	return ts;
+}
+
+void
+mvccFinishCommit (MvccTs commitTs)
+{
+	pthread_mutex_lock(&mvccLock);
+	removeTs(commits, &numCommits, commitTs);
+	pthread_cond_broadcast(&commitDone);
+	pthread_mutex_unlock(&mvccLock);
+}
+
+/* Timestamp of a single change committed while its table is latched */
+MvccTs
+mvccNextTs (void)
+{
+	MvccTs ts;
+
+	pthread_mutex_lock(&mvccLock);
+	ts = ++lastTs;
+	pthread_mutex_unlock(&mvccLock);
+	return ts;
+}
+
+/* Timestamp of the oldest open snapshot; versions replaced at or before it are not needed */
+MvccTs
+mvccHorizon (void)
+{
+	MvccTs ts;
+
+	pthread_mutex_lock(&mvccLock);
+	ts = stableTs();
+	for (int i = 0; i < numSnapshots; i++) {
+		if (snapshots[i] < ts)
+			ts = snapshots[i];
+	}
+	pthread_mutex_unlock(&mvccLock);
+	return ts;
+}
+
+/************************************************************
+ *                    version chains                        *
+ ************************************************************/
+
+static MvccVersion *
+newVersion (VersionStore *store, void *writer, MvccTs commitTs, const char *data)
+{
+	MvccVersion *version = (MvccVersion *) malloc(sizeof(MvccVersion));
+
+	version->writer = writer;
+	version->commitTs = commitTs;
+	version->data = NULL;
+	if (data != NULL) {
+		version->data = (char *) malloc(store->recordSize);
+		memcpy(version->data, data, store->recordSize);
+	}
+	version->older = NULL;
+	store->numVersions++;
+	return version;
+}
+
+/* Frees a version and all older ones */
+static void
+freeVersions (VersionStore *store, MvccVersion *version)
+{
+	while (version != NULL) {
+		MvccVersion *older = version->older;
+		free(version->data);
+		free(version);
+		store->numVersions--;
+		version = older;
+	}
+}
+
+/* Unlinks and frees a chain; prev is the chain before it in its bucket, or NULL */
+static void
+removeChain (VersionStore *store, MvccChain *chain, MvccChain *prev)
+{
+	if (prev == NULL)
+		store->buckets[chain->rid.page % store->numBuckets] = chain->next;
+	else
+		prev->next = chain->next;
+	freeVersions(store, chain->head);
+	free(chain);
+	store->numChains--;
+}
+
+/**
+ * Function: createVersionStore
+ * ---------------------------
+ * Creates an empty version store for a table.
+ *
+ * @param recordSize    Bytes of a record image
+ * @return
+ *  -   The new version store
+ */
+VersionStore *
+createVersionStore (int recordSize)
+{
+	VersionStore *store = (VersionStore *) malloc(sizeof(VersionStore));
+
+	store->recordSize = recordSize;
+	store->numBuckets = MVCC_BUCKETS;
+	store->buckets = (MvccChain **) calloc(MVCC_BUCKETS, sizeof(MvccChain *));
+	store->numChains = 0;
+	store->numVersions = 0;
+	store->collectAt = MVCC_MIN_COLLECT;
+	return store;
+}
+
+void
+freeVersionStore (VersionStore *store)
+{
+	if (store == NULL)
+		return;
+	for (int i = 0; i < store->numBuckets; i++) {
+		while (store->buckets[i] != NULL)
+			removeChain(store, store->buckets[i], NULL);
+	}
+	free(store->buckets);
+	free(store);
+}
+
+/* Version chain of a record, NULL if the page holds its only version */
+MvccChain *
+findVersions (VersionStore *store, RID rid)
+{
+	MvccChain *chain;
+
+	if (store->numChains == 0)
+		return NULL;
+	for (chain = store->buckets[rid.page % store->numBuckets]; chain != NULL; chain = chain->next) {
+		if (chain->rid.page == rid.page && chain->rid.slot == rid.slot)
+			return chain;
+	}
+	return NULL;
+}
+
+/* First chain of the bucket holding the chains of a page; callers skip chains of other pages */
+MvccChain *
+pageVersions (VersionStore *store, int page)
+{
+	return (store->numChains == 0) ? NULL : store->buckets[page % store->numBuckets];
+}
+
+/**
+ * Function: addVersion
+ * -------------------
+ * Records a change to a record. A record without a chain gets one whose
+ * oldest version is the state before the change. A transaction changing its
+ * own uncommitted version again replaces it.
+ *
+ * @param store     Version store of the table
+ * @param rid       Record that changed
+ * @param before    Record image before the change, NULL if the slot was free
+ * @param writer    Uncommitted transaction, NULL if the change is committed
+ * @param commitTs  Timestamp of a committed change
+ * @param data      Record image after the change, NULL if the record was deleted
+ */
+void
+addVersion (VersionStore *store, RID rid, const char *before, void *writer, MvccTs commitTs, const char *data)
+{
+	MvccChain *chain = findVersions(store, rid);
+	MvccVersion *version;
+
+	if (chain == NULL) {
+		int bucket = rid.page % store->numBuckets;
+		chain = (MvccChain *) malloc(sizeof(MvccChain));
+		chain->rid = rid;
+		chain->head = newVersion(store, NULL, 0, before);
+		chain->next = store->buckets[bucket];
+		store->buckets[bucket] = chain;
+		store->numChains++;
+	} else if (writer != NULL && chain->head->writer == writer) {
+		version = chain->head;
+		free(version->data);
+		version->data = NULL;
+		if (data != NULL) {
+			version->data = (char *) malloc(store->recordSize);
+			memcpy(version->data, data, store->recordSize);
+		}
+		return;
+	}
+
+	version = newVersion(store, writer, commitTs, data);
+	version->older = chain->head;
+	chain->head = version;
+}
+
+/* Removes the newest version of a chain after its change was undone */
+void
+dropVersion (VersionStore *store, MvccChain *chain)
+{
+	MvccVersion *head = chain->head;
+	MvccChain *prev = NULL;
+
+	chain->head = head->older;
+	head->older = NULL;
+	freeVersions(store, head);
+	if (chain->head->older != NULL)
+		return;
+
+	// The page holds the oldest version again, which all snapshots see
+	for (MvccChain *c = store->buckets[chain->rid.page % store->numBuckets]; c != chain; c = c->next)
+		prev = c;
+	removeChain(store, chain, prev);
+}
+
+/**
+ * Function: visibleVersion
+ * -----------------------
+ * Finds the version of a record a snapshot sees.
+ *
+ * @param chain     Versions of the record
+ * @param reader    Transaction of the snapshot, whose own changes it sees; may be NULL
+ * @param snapshot  Timestamp of the snapshot
+ * @return
+ *  -   The newest version committed at or before the snapshot or written by reader
+ */
+MvccVersion *
+visibleVersion (MvccChain *chain, void *reader, MvccTs snapshot)
+{
+	for (MvccVersion *version = chain->head; version != NULL; version = version->older) {
+		if (version->writer != NULL ? version->writer == reader : version->commitTs <= snapshot)
+			return version;
+	}
+	return NULL;
+}
+
+/**
+ * Function: collectVersions
+ * ------------------------
+ * Frees the versions no snapshot at or after horizon can see: everything
+ * older than the newest version committed at or before it. Chains whose
+ * newest version is such a version are removed, as the page holds it.
+ *
+ * @param store     Version store of the table
+ * @param horizon   Timestamp of the oldest open snapshot
+ * @return
+ *  -   The number of versions freed
+ */
+int
+collectVersions (VersionStore *store, MvccTs horizon)
+{
+	int before = store->numVersions;
+
+	for (int i = 0; i < store->numBuckets; i++) {
+		MvccChain *prev = NULL, *chain = store->buckets[i];
+
+		while (chain != NULL) {
+			MvccChain *next = chain->next;
+			MvccVersion *version = chain->head;
+
+			while (version->writer != NULL || version->commitTs > horizon)
+				version = version->older;
+			if (version == chain->head) {
+				removeChain(store, chain, prev);
+			} else {
+				freeVersions(store, version->older);
+				version->older = NULL;
+				prev = chain;
+			}
+			chain = next;
+		}
+	}
+	store->collectAt = (2 * store->numVersions > MVCC_MIN_COLLECT) ? 2 * store->numVersions : MVCC_MIN_COLLECT;
+	return before - store->numVersions;
+}
@@ -0,0 +1,57 @@
+#ifndef RM_MVCC_H
+#define RM_MVCC_H
+
+#include <stdint.h>
+
+#include "dberror.h"
+#include "tables.h"
+
+// commit timestamps; a snapshot sees the changes committed at or before its timestamp
+typedef uint64_t MvccTs;
+
+// one state of a record, newest first
+typedef struct MvccVersion {
+	void *writer;       // transaction that wrote it, NULL once committed
+	MvccTs commitTs;    // 0 for the state before the first kept change, visible to all
+	char *data;         // record image, NULL if the slot held no record
+	struct MvccVersion *older;
+} MvccVersion;
+
+// versions of one record; the newest is the one on the page
+typedef struct MvccChain {
+	RID rid;
+	MvccVersion *head;
+	struct MvccChain *next; // in the bucket of the page
+} MvccChain;
+
+// versions of the records of a table that some snapshot may not see on the page
+typedef struct VersionStore {
+	int recordSize;
+	int numBuckets;     // chains are hashed by page, so a page's chains share a bucket
+	MvccChain **buckets;
+	int numChains;
+	int numVersions;
+	int collectAt;      // numVersions at which the writers collect garbage
+} VersionStore;
+
+// snapshots and commits, shared by all tables
+extern MvccTs mvccBeginSnapshot (void);
+extern void mvccEndSnapshot (MvccTs snapshot);
+extern bool mvccSnapshotsActive (void);
+extern MvccTs mvccCurrentTs (void);
+extern MvccTs mvccStartCommit (void);
+extern void mvccFinishCommit (MvccTs commitTs);
+extern MvccTs mvccNextTs (void);
+extern MvccTs mvccHorizon (void);
+
+// version store handling
+extern VersionStore *createVersionStore (int recordSize);
+extern void freeVersionStore (VersionStore *store);
+extern MvccChain *findVersions (VersionStore *store, RID rid);
+extern MvccChain *pageVersions (VersionStore *store, int page);
+extern void addVersion (VersionStore *store, RID rid, const char *before, void *writer, MvccTs commitTs, const char *data);
+extern void dropVersion (VersionStore *store, MvccChain *chain);
+extern MvccVersion *visibleVersion (MvccChain *chain, void *reader, MvccTs snapshot);
+extern int collectVersions (VersionStore *store, MvccTs horizon);
+
+#endif // RM_MVCC_H
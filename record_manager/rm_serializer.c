@@ -283,26 +283,6 @@ stringToValue(char *val)
 RC
 attrOffset (Schema *schema, int attrNum, int *result)
 {
-	int offset = 0;
-	int attrPos = 0;
-
-	for(attrPos = 0; attrPos < attrNum; attrPos++)
-		switch (schema->dataTypes[attrPos])
-		{
-		case DT_STRING:
-			offset += schema->typeLength[attrPos];
-			break;
-		case DT_INT:
-			offset += sizeof(int);
-			break;
-		case DT_FLOAT:
-			offset += sizeof(float);
-			break;
-		case DT_BOOL:
-			offset += sizeof(bool);
-			break;
-		}
-
-	*result = offset;
+	*result = schema->attrOffsets[attrNum];
 	return RC_OK;
 }
@@ -0,0 +1,670 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "record_mgr.h"
+#include "storage_mgr.h"
+#include "buffer_mgr.h"
+
+/*
+ * A sort reads its whole scan when it starts. The tuples are collected in a
+ * memory load as large as the budget allows and sorted in pieces small
+ * enough for the CPU cache, by several threads if asked; a loser tree then
+ * merges the pieces. If the input fits in one load, that merge is the
+ * output. Otherwise every load is merged into a run on a temporary page
+ * file, written through a buffer pool of one frame, and once the input is
+ * read the runs are merged by the same loser tree through a pool of the
+ * budget's size, in several passes if there are more runs than frames.
+ * Runs hold every tuple behind its RID. Ties are broken by the order in
+ * which the scan returned the tuples, so the sort is stable.
+ */
+
+#define SORT_CACHE_BYTES (256 * 1024) // memory of the tuples of a piece
+#define SORT_FILE_PREFIX "rm_sort_"
+
+typedef struct SortKeyInfo {
+	int offset;        // of the attribute in the tuple
+	int length;        // of strings
+	DataType dataType;
+	bool descending;
+} SortKeyInfo;
+
+// a tuple of the memory load; the addresses of the tuples are in scan order
+typedef struct SortRef {
+	const char *tuple;
+	const RID *id;
+	const struct RM_SortHandle *sort;
+} SortRef;
+
+// a sorted run on the spill file: consecutive pages, no tuple crossing a page
+typedef struct SortRun {
+	int firstPage;
+	long numTuples;
+} SortRun;
+
+// an input of a merge: a sorted piece of the memory load or a run
+typedef struct SortSource {
+	const char *tuple;  // current tuple, NULL once exhausted
+	RID id;
+	long pos;           // number of the next tuple
+	long end;           // of a piece: refs[pos] .. refs[end - 1] are left
+	SortRef *refs;
+	SortRun *run;       // NULL for a piece
+	BM_PageHandle page; // page of the run pinned for the current tuple, NO_PAGE if none
+} SortSource;
+
+// loser tree over k sources: tree[0] is the source whose tuple comes first, tree[1 .. k-1] the losers of the matches
+typedef struct SortMerge {
+	SortSource *sources;
+	int k;
+	int *tree;
+} SortMerge;
+
+struct RM_SortHandle {
+	int numKeys;
+	SortKeyInfo *keys;
+	int tupleSize;
+	int entrySize;   // of a tuple and its RID in a run
+	int perPage;     // tuples of a run page
+	int memoryPages;
+	int numThreads;
+
+	// memory load
+	char *tuples;
+	RID *ids;
+	SortRef *refs;
+	long capacity;
+	long numLoaded;
+	long pieceSize;
+	long nextPiece;  // next piece to sort, taken under pieceLock
+	pthread_mutex_t pieceLock;
+
+	// spill file
+	char fileName[64];
+	bool spilled;
+	bool poolOpen;
+	BM_BufferPool pool;
+	int nextPage;    // first page after the runs
+	SortRun *runs;   // runs left to merge, in scan order
+	int numRuns;
+	int runsWritten;
+
+	SortMerge merge; // producing the output
+};
+
+static pthread_mutex_t fileLock = PTHREAD_MUTEX_INITIALIZER;
+static int fileCounter = 0;
+
+/************************************************************
+ *                    comparing tuples                      *
+ ************************************************************/
+
+static int
+compareTuples (const struct RM_SortHandle *sort, const char *a, const char *b)
+{
+	for (int i = 0; i < sort->numKeys; i++) {
+		const SortKeyInfo *key = &sort->keys[i];
+		const char *x = a + key->offset, *y = b + key->offset;
+		int cmp = 0;
+
+		switch (key->dataType) {
+		case DT_INT: {
+			int u, v;
+			memcpy(&u, x, sizeof(int));
+			memcpy(&v, y, sizeof(int));
+			cmp = (u > v) - (u < v);
+			break;
+		}
+		case DT_FLOAT: {
+			float u, v;
+			memcpy(&u, x, sizeof(float));
+			memcpy(&v, y, sizeof(float));
+			cmp = (u > v) - (u < v);
+			break;
+		}
+		case DT_BOOL: {
+			bool u, v;
+			memcpy(&u, x, sizeof(bool));
+			memcpy(&v, y, sizeof(bool));
+			cmp = (u != 0) - (v != 0);
+			break;
+		}
+		case DT_STRING:
+			cmp = strncmp(x, y, key->length);
+			cmp = (cmp > 0) - (cmp < 0);
+			break;
+		}
+		if (cmp != 0)
+			return key->descending ? -cmp : cmp;
+	}
+	return 0;
+}
+
+static int
+compareRefs (const void *a, const void *b)
+{
+	const SortRef *x = (const SortRef *) a, *y = (const SortRef *) b;
+	int cmp = compareTuples(x->sort, x->tuple, y->tuple);
+
+	if (cmp == 0)
+		cmp = (x->tuple > y->tuple) - (x->tuple < y->tuple);
+	return cmp;
+}
+
+/************************************************************
+ *                    merge sources                         *
+ ************************************************************/
+
+static RC
+releaseSource (RM_SortHandle *sort, SortSource *source)
+{
+	RC rc = RC_OK;
+
+	if (source->run != NULL && source->page.pageNum != NO_PAGE) {
+		rc = unpinPage(&sort->pool, &source->page);
+		source->page.pageNum = NO_PAGE;
+	}
+	return rc;
+}
+
+/* Makes the next tuple of a source current, pinning its page if it is in a run */
+static RC
+advanceSource (RM_SortHandle *sort, SortSource *source)
+{
+	RC rc;
+
+	if (source->run == NULL) {
+		if (source->pos == source->end) {
+			source->tuple = NULL;
+			return RC_OK;
+		}
+		source->tuple = source->refs[source->pos].tuple;
+		source->id = *source->refs[source->pos].id;
+		source->pos++;
+		return RC_OK;
+	}
+
+	if (source->pos == source->run->numTuples) {
+		source->tuple = NULL;
+		return releaseSource(sort, source);
+	}
+	int pageNum = source->run->firstPage + (int) (source->pos / sort->perPage);
+	if (source->page.pageNum != pageNum) {
+		if ((rc = releaseSource(sort, source)) != RC_OK)
+			return rc;
+		if ((rc = pinPage(&sort->pool, &source->page, pageNum)) != RC_OK) {
+			source->page.pageNum = NO_PAGE;
+			return rc;
+		}
+	}
+	char *entry = source->page.data + (source->pos % sort->perPage) * sort->entrySize;
+	memcpy(&source->id, entry, sizeof(RID));
+	source->tuple = entry + sizeof(RID);
+	source->pos++;
+	return RC_OK;
+}
+
+/* The sorted pieces of the memory load as merge sources */
+static SortSource *
+pieceSources (RM_SortHandle *sort, int *k)
+{
+	SortSource *sources;
+
+	*k = (int) ((sort->numLoaded + sort->pieceSize - 1) / sort->pieceSize);
+	sources = (SortSource *) calloc(*k > 0 ? *k : 1, sizeof(SortSource));
+	for (int i = 0; i < *k; i++) {
+		sources[i].refs = sort->refs;
+		sources[i].pos = i * sort->pieceSize;
+		sources[i].end = sources[i].pos + sort->pieceSize;
+		if (sources[i].end > sort->numLoaded)
+			sources[i].end = sort->numLoaded;
+		sources[i].page.pageNum = NO_PAGE;
+	}
+	return sources;
+}
+
+static SortSource *
+runSources (SortRun *runs, int k)
+{
+	SortSource *sources = (SortSource *) calloc(k > 0 ? k : 1, sizeof(SortSource));
+
+	for (int i = 0; i < k; i++) {
+		sources[i].run = &runs[i];
+		sources[i].page.pageNum = NO_PAGE;
+	}
+	return sources;
+}
+
+/************************************************************
+ *                    loser tree                            *
+ ************************************************************/
+
+/* Whether the tuple of source a comes before that of b; source k comes before all others */
+static bool
+sourceBefore (RM_SortHandle *sort, SortMerge *merge, int a, int b)
+{
+	int cmp;
+
+	if (a == merge->k)
+		return TRUE;
+	if (b == merge->k)
+		return FALSE;
+	if (merge->sources[a].tuple == NULL)
+		return FALSE;
+	if (merge->sources[b].tuple == NULL)
+		return TRUE;
+	cmp = compareTuples(sort, merge->sources[a].tuple, merge->sources[b].tuple);
+	return cmp < 0 || (cmp == 0 && a < b);
+}
+
+/* Replays the matches from leaf s to the root after the tuple of source s changed */
+static void
+adjustMerge (RM_SortHandle *sort, SortMerge *merge, int s)
+{
+	for (int t = (s + merge->k) / 2; t > 0; t /= 2) {
+		if (sourceBefore(sort, merge, merge->tree[t], s)) {
+			int winner = merge->tree[t];
+			merge->tree[t] = s;
+			s = winner;
+		}
+	}
+	merge->tree[0] = s;
+}
+
+/* Starts merging k sources; the merge owns the sources array */
+static RC
+startMerge (RM_SortHandle *sort, SortMerge *merge, SortSource *sources, int k)
+{
+	RC rc = RC_OK;
+
+	merge->sources = sources;
+	merge->k = k;
+	merge->tree = (int *) malloc((k > 0 ? k : 1) * sizeof(int));
+	for (int i = 0; i < k && rc == RC_OK; i++)
+		rc = advanceSource(sort, &sources[i]);
+
+	// Every match starts out won by the sentinel k, which each leaf then beats its way past
+	for (int i = 0; i < k; i++)
+		merge->tree[i] = k;
+	for (int s = k - 1; s >= 0; s--)
+		adjustMerge(sort, merge, s);
+	return rc;
+}
+
+/* Source of the first tuple left, NULL when all are exhausted */
+static SortSource *
+mergeWinner (SortMerge *merge)
+{
+	SortSource *source;
+
+	if (merge->k == 0)
+		return NULL;
+	source = &merge->sources[merge->tree[0]];
+	return source->tuple != NULL ? source : NULL;
+}
+
+static RC
+advanceMerge (RM_SortHandle *sort, SortMerge *merge)
+{
+	int s = merge->tree[0];
+	RC rc = advanceSource(sort, &merge->sources[s]);
+
+	adjustMerge(sort, merge, s);
+	return rc;
+}
+
+static RC
+endMerge (RM_SortHandle *sort, SortMerge *merge)
+{
+	RC rc = RC_OK;
+
+	for (int i = 0; i < merge->k; i++) {
+		RC r = releaseSource(sort, &merge->sources[i]);
+		if (rc == RC_OK)
+			rc = r;
+	}
+	free(merge->sources);
+	free(merge->tree);
+	merge->sources = NULL;
+	merge->tree = NULL;
+	merge->k = 0;
+	return rc;
+}
+
+/************************************************************
+ *                    runs                                  *
+ ************************************************************/
+
+/* Merges k sources into a new run appended to the spill file */
+static RC
+writeRun (RM_SortHandle *sort, SortSource *sources, int k, SortRun *run)
+{
+	SortMerge merge;
+	SortSource *source;
+	BM_PageHandle page;
+	long n = 0;
+	RC rc, r;
+
+	page.pageNum = NO_PAGE;
+	run->firstPage = sort->nextPage;
+	rc = startMerge(sort, &merge, sources, k);
+	while (rc == RC_OK && (source = mergeWinner(&merge)) != NULL) {
+		if (n % sort->perPage == 0) {
+			if (page.pageNum != NO_PAGE) {
+				markDirty(&sort->pool, &page);
+				if ((rc = unpinPage(&sort->pool, &page)) != RC_OK)
+					break;
+				page.pageNum = NO_PAGE;
+			}
+			if ((rc = pinPage(&sort->pool, &page, run->firstPage + (int) (n / sort->perPage))) != RC_OK) {
+				page.pageNum = NO_PAGE;
+				break;
+			}
+		}
+		char *entry = page.data + (n % sort->perPage) * sort->entrySize;
+		memcpy(entry, &source->id, sizeof(RID));
+		memcpy(entry + sizeof(RID), source->tuple, sort->tupleSize);
+		n++;
+		rc = advanceMerge(sort, &merge);
+	}
+	if (page.pageNum != NO_PAGE) {
+		markDirty(&sort->pool, &page);
+		r = unpinPage(&sort->pool, &page);
+		if (rc == RC_OK)
+			rc = r;
+	}
+	r = endMerge(sort, &merge);
+	if (rc == RC_OK)
+		rc = r;
+
+	run->numTuples = n;
+	sort->nextPage += (int) ((n + sort->perPage - 1) / sort->perPage);
+	sort->runsWritten++;
+	return rc;
+}
+
+static void *
+sortPieces (void *arg)
+{
+	RM_SortHandle *sort = (RM_SortHandle *) arg;
+	long numPieces = (sort->numLoaded + sort->pieceSize - 1) / sort->pieceSize;
+
+	for (;;) {
+		long piece, size;
+
+		pthread_mutex_lock(&sort->pieceLock);
+		piece = sort->nextPiece++;
+		pthread_mutex_unlock(&sort->pieceLock);
+		if (piece >= numPieces)
+			return NULL;
+		size = sort->numLoaded - piece * sort->pieceSize;
+		if (size > sort->pieceSize)
+			size = sort->pieceSize;
+		qsort(sort->refs + piece * sort->pieceSize, size, sizeof(SortRef), compareRefs);
+	}
+}
+
+/* Sorts the cache-sized pieces of the memory load, on numThreads threads if there are enough pieces */
+static void
+sortLoad (RM_SortHandle *sort)
+{
+	long numPieces = (sort->numLoaded + sort->pieceSize - 1) / sort->pieceSize;
+	int numThreads = (sort->numThreads < numPieces) ? sort->numThreads : (int) numPieces;
+	pthread_t *threads = NULL;
+	int started = 0;
+
+	for (long i = 0; i < sort->numLoaded; i++) {
+		sort->refs[i].tuple = sort->tuples + i * sort->tupleSize;
+		sort->refs[i].id = &sort->ids[i];
+		sort->refs[i].sort = sort;
+	}
+	sort->nextPiece = 0;
+
+	// The calling thread sorts too; pieces are left to it if a thread cannot be created
+	if (numThreads > 1) {
+		threads = (pthread_t *) malloc((numThreads - 1) * sizeof(pthread_t));
+		while (started < numThreads - 1 && pthread_create(&threads[started], NULL, sortPieces, sort) == 0)
+			started++;
+	}
+	sortPieces(sort);
+	for (int i = 0; i < started; i++)
+		pthread_join(threads[i], NULL);
+	free(threads);
+}
+
+/* Sorts the memory load and writes it to the spill file as a run, emptying it */
+static RC
+spillLoad (RM_SortHandle *sort)
+{
+	SortSource *sources;
+	RC rc;
+	int k;
+
+	if (!sort->spilled) {
+		pthread_mutex_lock(&fileLock);
+		sprintf(sort->fileName, SORT_FILE_PREFIX "%d_%d.tmp", (int) getpid(), fileCounter++);
+		pthread_mutex_unlock(&fileLock);
+		if ((rc = createPageFile(sort->fileName)) != RC_OK)
+			return rc;
+		sort->spilled = TRUE;
+		if ((rc = initBufferPool(&sort->pool, sort->fileName, 1, RS_FIFO, NULL)) != RC_OK)
+			return rc;
+		sort->poolOpen = TRUE;
+	}
+
+	sortLoad(sort);
+	sources = pieceSources(sort, &k);
+	sort->runs = (SortRun *) realloc(sort->runs, (sort->numRuns + 1) * sizeof(SortRun));
+	rc = writeRun(sort, sources, k, &sort->runs[sort->numRuns++]);
+	sort->numLoaded = 0;
+	return rc;
+}
+
+/* Reopens the spill file with a frame per merged run and merges runs until one pass is left for the output */
+static RC
+mergeRuns (RM_SortHandle *sort)
+{
+	int fanIn = sort->memoryPages - 1;
+	RC rc;
+
+	sort->poolOpen = FALSE;
+	if ((rc = shutdownBufferPool(&sort->pool)) != RC_OK)
+		return rc;
+	if ((rc = initBufferPool(&sort->pool, sort->fileName, sort->memoryPages, RS_LRU, NULL)) != RC_OK)
+		return rc;
+	sort->poolOpen = TRUE;
+
+	while (sort->numRuns > fanIn) {
+		int numMerged = (sort->numRuns + fanIn - 1) / fanIn;
+		SortRun *merged = (SortRun *) malloc(numMerged * sizeof(SortRun));
+
+		// Consecutive runs are merged, so the runs stay in scan order
+		for (int i = 0; i < numMerged; i++) {
+			int first = i * fanIn;
+			int k = (sort->numRuns - first < fanIn) ? sort->numRuns - first : fanIn;
+
+			if (k == 1)
+				merged[i] = sort->runs[first];
+			else if ((rc = writeRun(sort, runSources(sort->runs + first, k), k, &merged[i])) != RC_OK) {
+				free(merged);
+				return rc;
+			}
+		}
+		free(sort->runs);
+		sort->runs = merged;
+		sort->numRuns = numMerged;
+	}
+	return startMerge(sort, &sort->merge, runSources(sort->runs, sort->numRuns), sort->numRuns);
+}
+
+/************************************************************
+ *                    interface                             *
+ ************************************************************/
+
+/**
+ * Function: startSort
+ * ------------------
+ * Sorts the tuples a scan returns (in the layout of getScanSchema(scan)),
+ * reading the scan to its end; nextSorted then returns them in order. Only
+ * options->memoryPages pages of memory hold tuples; larger inputs are
+ * spilled to a temporary page file as sorted runs and merged from there.
+ * Tuples with equal keys keep the order the scan returned them in.
+ *
+ * @param scan      Scan whose tuples are sorted; it can be closed afterwards
+ * @param keys      Attributes of the scan's tuples to sort by, most significant first
+ * @param numKeys   Number of keys
+ * @param options   Memory budget and threads of run generation; NULL for the defaults
+ * @param sort      Set to the new sort
+ * @return
+ *  -   RC_OK                   Tuples can be read with nextSorted
+ *  -   RC_INVALID_PARAM        No keys, a key is not an attribute, or the options are out of range
+ */
+RC
+startSort (RM_ScanHandle *scan, RM_SortKey *keys, int numKeys, RM_SortOptions *options, RM_SortHandle **sort)
+{
+	RM_SortHandle *s;
+	Schema *schema;
+	long perTuple;
+	RC rc;
+
+	if (scan == NULL || keys == NULL || numKeys <= 0 || sort == NULL)
+		return RC_INVALID_PARAM;
+	if (options != NULL && ((options->memoryPages != 0 && options->memoryPages < RM_SORT_MIN_PAGES)
+			|| options->numThreads < 0))
+		return RC_INVALID_PARAM;
+	schema = getScanSchema(scan);
+	for (int i = 0; i < numKeys; i++) {
+		if (keys[i].attrNum < 0 || keys[i].attrNum >= schema->numAttr)
+			return RC_INVALID_PARAM;
+	}
+	if (getRecordSize(schema) + (int) sizeof(RID) > PAGE_SIZE)
+		return RC_INVALID_PARAM;
+
+	s = (RM_SortHandle *) calloc(1, sizeof(RM_SortHandle));
+	s->numKeys = numKeys;
+	s->keys = (SortKeyInfo *) malloc(numKeys * sizeof(SortKeyInfo));
+	for (int i = 0; i < numKeys; i++) {
+		determineAttributeOffsetInRecord(schema, keys[i].attrNum, &s->keys[i].offset);
+		s->keys[i].length = schema->typeLength[keys[i].attrNum];
+		s->keys[i].dataType = schema->dataTypes[keys[i].attrNum];
+		s->keys[i].descending = keys[i].descending;
+	}
+	s->tupleSize = getRecordSize(schema);
+	s->entrySize = s->tupleSize + sizeof(RID);
+	s->perPage = PAGE_SIZE / s->entrySize;
+	s->memoryPages = (options != NULL && options->memoryPages != 0) ? options->memoryPages : RM_SORT_DEFAULT_PAGES;
+	s->numThreads = (options != NULL && options->numThreads > 1) ? options->numThreads : 1;
+	pthread_mutex_init(&s->pieceLock, NULL);
+
+	// One page of the budget is the frame runs are written through
+	perTuple = s->tupleSize + sizeof(RID) + sizeof(SortRef);
+	s->capacity = (long) (s->memoryPages - 1) * PAGE_SIZE / perTuple;
+	if (s->capacity < 1)
+		s->capacity = 1;
+	s->pieceSize = SORT_CACHE_BYTES / perTuple;
+	if (s->pieceSize < 1)
+		s->pieceSize = 1;
+	s->tuples = (char *) malloc(s->capacity * s->tupleSize);
+	s->ids = (RID *) malloc(s->capacity * sizeof(RID));
+	s->refs = (SortRef *) malloc(s->capacity * sizeof(SortRef));
+	*sort = s;
+
+	for (;;) {
+		int numTuples;
+
+		if (s->numLoaded == s->capacity && (rc = spillLoad(s)) != RC_OK)
+			break;
+		rc = nextBatch(scan, s->tuples + s->numLoaded * s->tupleSize, s->ids + s->numLoaded,
+				(int) (s->capacity - s->numLoaded), &numTuples);
+		if (rc != RC_OK)
+			break;
+		s->numLoaded += numTuples;
+	}
+
+	if (rc == RC_RM_NO_MORE_TUPLES) {
+		if (!s->spilled) {
+			// Everything fit: the sorted pieces are the output
+			int k;
+			sortLoad(s);
+			SortSource *sources = pieceSources(s, &k);
+			rc = startMerge(s, &s->merge, sources, k);
+		} else {
+			rc = (s->numLoaded > 0) ? spillLoad(s) : RC_OK;
+			// The memory load is not needed any more; the merge uses the budget for frames
+			free(s->tuples);
+			free(s->ids);
+			free(s->refs);
+			s->tuples = NULL;
+			s->ids = NULL;
+			s->refs = NULL;
+			if (rc == RC_OK)
+				rc = mergeRuns(s);
+		}
+	}
+	if (rc != RC_OK) {
+		closeSort(s);
+		*sort = NULL;
+	}
+	return rc;
+}
+
+/**
+ * Function: nextSorted
+ * -------------------
+ * Returns the next tuple in sort order.
+ *
+ * @param sort      Sort started by startSort
+ * @param record    Filled with the tuple and the RID the scan returned it with
+ * @return
+ *  -   RC_OK                   A tuple was returned
+ *  -   RC_RM_NO_MORE_TUPLES    All tuples have been returned
+ */
+RC
+nextSorted (RM_SortHandle *sort, Record *record)
+{
+	SortSource *source;
+
+	if (sort == NULL || record == NULL)
+		return RC_INVALID_PARAM;
+	if ((source = mergeWinner(&sort->merge)) == NULL)
+		return RC_RM_NO_MORE_TUPLES;
+	memcpy(record->data, source->tuple, sort->tupleSize);
+	record->id = source->id;
+	return advanceMerge(sort, &sort->merge);
+}
+
+/* Number of runs written to the spill file, including those of intermediate merges; 0 if the input fit in memory */
+int
+getSortNumRuns (RM_SortHandle *sort)
+{
+	return sort->runsWritten;
+}
+
+/* Frees a sort and removes its spill file */
+RC
+closeSort (RM_SortHandle *sort)
+{
+	RC rc, r;
+
+	if (sort == NULL)
+		return RC_INVALID_PARAM;
+	rc = endMerge(sort, &sort->merge);
+	if (sort->poolOpen) {
+		r = shutdownBufferPool(&sort->pool);
+		if (rc == RC_OK)
+			rc = r;
+	}
+	if (sort->spilled)
+		destroyPageFile(sort->fileName);
+
+	pthread_mutex_destroy(&sort->pieceLock);
+	free(sort->keys);
+	free(sort->tuples);
+	free(sort->ids);
+	free(sort->refs);
+	free(sort->runs);
+	free(sort);
+	return rc;
+}
@@ -0,0 +1,571 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "rm_wal.h"
+
+/*
+ * The log is one stream of records, cut into segment files of
+ * WAL_SEGMENT_SIZE bytes: position p lives in segment p / WAL_SEGMENT_SIZE.
+ * Records may cross segment boundaries. The control file <name> holds the
+ * position of the first record and of the last checkpoint record as text;
+ * segments before the first record are deleted.
+ * Replay stops at the first position that does not hold a record whose
+ * checksum and LSN match, which is where appending continues.
+ *
+ * Appends only copy the record into a buffer. walFlush makes the records up
+ * to an LSN durable: the first thread that finds no flush in progress takes
+ * the whole buffer, writes it and syncs the segment while later records go to
+ * the other buffer; threads waiting for an LSN covered by that flush return
+ * when it completes. So one sync commits all operations that were waiting
+ * for it (group commit).
+ */
+
+#define WAL_INITIAL_BUFFER (64 * 1024)
+
+/************************************************************
+ *                    segment files                         *
+ ************************************************************/
+
+static char *
+segmentName (WalLog *log, int segment)
+{
+	char *fileName = (char *) malloc(strlen(log->name) + 16);
+	sprintf(fileName, "%s.%d", log->name, segment);
+	return fileName;
+}
+
+/* File descriptor of a segment, which is created and preallocated if create is set */
+static int
+segmentFd (WalLog *log, int segment, bool create)
+{
+	char *fileName;
+
+	if (log->fd >= 0 && log->fdSegment == segment)
+		return log->fd;
+
+	// A segment is complete once writing moves on
+	if (log->fd >= 0) {
+		if (create)
+			fdatasync(log->fd);
+		close(log->fd);
+		log->fd = -1;
+	}
+
+	fileName = segmentName(log, segment);
+	log->fd = open(fileName, create ? O_RDWR | O_CREAT : O_RDWR, 0644);
+	free(fileName);
+	if (log->fd < 0)
+		return -1;
+	log->fdSegment = segment;
+
+	// Allocating the blocks up front keeps the syncs of later appends from updating the file size
+	if (create && lseek(log->fd, 0, SEEK_END) < WAL_SEGMENT_SIZE)
+		posix_fallocate(log->fd, 0, WAL_SEGMENT_SIZE);
+	return log->fd;
+}
+
+static bool
+readBytes (WalLog *log, WalLsn pos, char *data, int length)
+{
+	while (length > 0) {
+		int offset = (int) (pos % WAL_SEGMENT_SIZE);
+		int n = (length < WAL_SEGMENT_SIZE - offset) ? length : WAL_SEGMENT_SIZE - offset;
+		int fd = segmentFd(log, (int) (pos / WAL_SEGMENT_SIZE), FALSE);
+
+		if (fd < 0 || pread(fd, data, n, offset) != n)
+			return FALSE;
+		pos += n;
+		data += n;
+		length -= n;
+	}
+	return TRUE;
+}
+
+/* Writes log bytes and waits until they are on disk */
+static RC
+writeBytes (WalLog *log, WalLsn pos, const char *data, int length)
+{
+	int fd = -1;
+
+	while (length > 0) {
+		int offset = (int) (pos % WAL_SEGMENT_SIZE);
+		int n = (length < WAL_SEGMENT_SIZE - offset) ? length : WAL_SEGMENT_SIZE - offset;
+
+		fd = segmentFd(log, (int) (pos / WAL_SEGMENT_SIZE), TRUE);
+		if (fd < 0 || pwrite(fd, data, n, offset) != n)
+			return RC_WRITE_FAILED;
+		pos += n;
+		data += n;
+		length -= n;
+	}
+	if (fd >= 0 && fdatasync(fd) != 0)
+		return RC_WRITE_FAILED;
+	return RC_OK;
+}
+
+/* Stores the start of the log and the checkpoint, replacing the control file atomically */
+static RC
+writeControl (WalLog *log, WalLsn startLsn, bool hasCheckpoint, WalLsn checkpointPos)
+{
+	char *tmpName = (char *) malloc(strlen(log->name) + 8);
+	FILE *file;
+	RC rc = RC_OK;
+
+	sprintf(tmpName, "%s.tmp", log->name);
+	if ((file = fopen(tmpName, "w")) == NULL) {
+		free(tmpName);
+		return RC_WRITE_FAILED;
+	}
+	if (hasCheckpoint)
+		fprintf(file, "%llu %llu\n", (unsigned long long) startLsn, (unsigned long long) checkpointPos);
+	else
+		fprintf(file, "%llu\n", (unsigned long long) startLsn);
+	if (fflush(file) != 0 || fsync(fileno(file)) != 0)
+		rc = RC_WRITE_FAILED;
+	fclose(file);
+	if (rc == RC_OK && rename(tmpName, log->name) != 0)
+		rc = RC_WRITE_FAILED;
+	free(tmpName);
+	return rc;
+}
+
+static bool
+readControl (char *name, WalLsn *startLsn, bool *hasCheckpoint, WalLsn *checkpointPos)
+{
+	unsigned long long start, checkpoint;
+	FILE *file = fopen(name, "r");
+	int found;
+
+	if (file == NULL)
+		return FALSE;
+	found = fscanf(file, "%llu %llu", &start, &checkpoint);
+	fclose(file);
+	*startLsn = (WalLsn) start;
+	*hasCheckpoint = (found == 2);
+	*checkpointPos = (found == 2) ? (WalLsn) checkpoint : 0;
+	return found >= 1;
+}
+
+/* Deletes the segments that end before a position */
+static void
+removeSegments (WalLog *log, WalLsn from, WalLsn to)
+{
+	for (int segment = (int) (from / WAL_SEGMENT_SIZE); segment < (int) (to / WAL_SEGMENT_SIZE); segment++) {
+		char *fileName = segmentName(log, segment);
+		if (log->fd >= 0 && log->fdSegment == segment) {
+			close(log->fd);
+			log->fd = -1;
+		}
+		unlink(fileName);
+		free(fileName);
+	}
+}
+
+/************************************************************
+ *                    log records                           *
+ ************************************************************/
+
+/* FNV-1a */
+static uint32_t
+checksum (const char *bytes, int length)
+{
+	uint32_t hash = 2166136261u;
+
+	for (int i = 0; i < length; i++) {
+		hash ^= (unsigned char) bytes[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static uint32_t
+recordChecksum (const char *record, int length)
+{
+	int skip = offsetof(WalRecord, lsn);
+	return checksum(record + skip, length - skip);
+}
+
+/* Reads the record at pos; FALSE if there is none, which ends the log */
+static bool
+readRecordAt (WalLog *log, WalLsn pos, WalRecord *header, char **data)
+{
+	char *record;
+
+	if (!readBytes(log, pos, (char *) header, sizeof(WalRecord)))
+		return FALSE;
+	if (header->length < sizeof(WalRecord) || header->length > sizeof(WalRecord) + PAGE_SIZE
+			|| header->lsn != pos + header->length)
+		return FALSE;
+
+	record = (char *) malloc(header->length);
+	if (!readBytes(log, pos, record, header->length)
+			|| recordChecksum(record, header->length) != header->checksum) {
+		free(record);
+		return FALSE;
+	}
+	*data = (char *) malloc(header->length - sizeof(WalRecord) + 1);
+	memcpy(*data, record + sizeof(WalRecord), header->length - sizeof(WalRecord));
+	free(record);
+	return TRUE;
+}
+
+/************************************************************
+ *                    interface                             *
+ ************************************************************/
+
+/**
+ * Function: openWal
+ * ----------------
+ * Opens the log with the given control file name, creating an empty log if
+ * there is none. Appending continues after the last complete record.
+ *
+ * @param log       Set to the open log
+ * @param name      Name of the control file
+ * @return
+ *  -   RC_OK if the log was opened
+ *  -   RC_WRITE_FAILED if a new control file cannot be written
+ */
+RC
+openWal (WalLog **log, char *name)
+{
+	WalLog *wal = (WalLog *) calloc(1, sizeof(WalLog));
+	WalRecord header;
+	char *data;
+	WalLsn pos;
+	RC rc;
+
+	wal->name = strdup(name);
+	wal->fd = -1;
+	if (!readControl(name, &wal->startLsn, &wal->hasCheckpoint, &wal->checkpointPos)
+			&& (rc = writeControl(wal, 0, FALSE, 0)) != RC_OK) {
+		free(wal->name);
+		free(wal);
+		return rc;
+	}
+
+	// Find the end of the log
+	pos = wal->startLsn;
+	while (readRecordAt(wal, pos, &header, &data)) {
+		free(data);
+		pos = header.lsn;
+	}
+	wal->appendLsn = pos;
+	wal->flushedLsn = pos;
+
+	wal->bufferSize = WAL_INITIAL_BUFFER;
+	wal->buffer = (char *) malloc(wal->bufferSize);
+	wal->spareSize = WAL_INITIAL_BUFFER;
+	wal->spare = (char *) malloc(wal->spareSize);
+	pthread_mutex_init(&wal->lock, NULL);
+	pthread_cond_init(&wal->flushed, NULL);
+
+	*log = wal;
+	return RC_OK;
+}
+
+/**
+ * Function: closeWal
+ * -----------------
+ * Closes a log. Records that were not flushed are lost.
+ *
+ * @param log       Log to close
+ * @return
+ *  -   RC_OK
+ */
+RC
+closeWal (WalLog *log)
+{
+	if (log->fd >= 0)
+		close(log->fd);
+	pthread_cond_destroy(&log->flushed);
+	pthread_mutex_destroy(&log->lock);
+	free(log->spare);
+	free(log->buffer);
+	free(log->name);
+	free(log);
+	return RC_OK;
+}
+
+/**
+ * Function: deleteWal
+ * ------------------
+ * Deletes the control file and the segments of a (closed) log.
+ *
+ * @param name      Name of the control file
+ * @return
+ *  -   RC_OK if the log was deleted
+ *  -   RC_FILE_NOT_FOUND if there is no such log
+ */
+RC
+deleteWal (char *name)
+{
+	WalLog log;
+	WalLsn start, checkpoint;
+	bool hasCheckpoint;
+
+	if (!readControl(name, &start, &hasCheckpoint, &checkpoint))
+		return RC_FILE_NOT_FOUND;
+
+	log.name = name;
+	for (int segment = (int) (start / WAL_SEGMENT_SIZE); ; segment++) {
+		char *fileName = segmentName(&log, segment);
+		int removed = unlink(fileName);
+		free(fileName);
+		if (removed != 0)
+			break;
+	}
+	return (unlink(name) == 0) ? RC_OK : RC_FILE_NOT_FOUND;
+}
+
+/**
+ * Function: walAppend
+ * ------------------
+ * Appends a record to the log buffer. The record is not durable before a
+ * walFlush up to its LSN returns.
+ *
+ * @param log       Log to append to
+ * @param type      Kind of change
+ * @param rid       Slot that changed
+ * @param data      Record data for inserts and updates, NULL otherwise
+ * @param length    Number of bytes of data, at most PAGE_SIZE
+ * @param lsn       Set to the LSN of the record
+ * @return
+ *  -   RC_OK if the record was appended
+ *  -   RC_INVALID_PARAM if the data is too long
+ */
+RC
+walAppend (WalLog *log, WalRecordType type, RID rid, const char *data, int length, WalLsn *lsn)
+{
+	int total = sizeof(WalRecord) + length;
+	WalRecord header;
+	char *record;
+
+	if (length < 0 || length > PAGE_SIZE)
+		return RC_INVALID_PARAM;
+
+	pthread_mutex_lock(&log->lock);
+	while (log->bufferLength + total > log->bufferSize) {
+		log->bufferSize *= 2;
+		log->buffer = (char *) realloc(log->buffer, log->bufferSize);
+	}
+
+	// Records are packed back to back, so the header is built aside and copied into place
+	record = log->buffer + log->bufferLength;
+	memset(&header, 0, sizeof(WalRecord));
+	header.length = total;
+	header.lsn = log->appendLsn + total;
+	header.type = type;
+	header.rid = rid;
+	memcpy(record, &header, sizeof(WalRecord));
+	if (length > 0)
+		memcpy(record + sizeof(WalRecord), data, length);
+	header.checksum = recordChecksum(record, total);
+	memcpy(record + offsetof(WalRecord, checksum), &header.checksum, sizeof(header.checksum));
+
+	log->bufferLength += total;
+	log->appendLsn += total;
+	*lsn = log->appendLsn;
+	pthread_mutex_unlock(&log->lock);
+	return RC_OK;
+}
+
+/**
+ * Function: walFlush
+ * -----------------
+ * Waits until the records up to an LSN are on disk, syncing the log unless a
+ * concurrent flush covers them (see above).
+ *
+ * @param log       Log to flush
+ * @param lsn       LSN of the last record that has to be durable
+ * @return
+ *  -   RC_OK if the records are durable
+ *  -   RC_WRITE_FAILED if the log cannot be written
+ */
+RC
+walFlush (WalLog *log, WalLsn lsn)
+{
+	RC rc = RC_OK;
+
+	pthread_mutex_lock(&log->lock);
+	if (lsn > log->appendLsn)
+		lsn = log->appendLsn;
+	while (rc == RC_OK && log->flushedLsn < lsn) {
+		if (log->flushing) {
+			pthread_cond_wait(&log->flushed, &log->lock);
+			continue;
+		}
+
+		// Take all buffered records, new ones go to the spare buffer meanwhile
+		char *chunk = log->buffer;
+		int length = log->bufferLength, size = log->bufferSize;
+		WalLsn end = log->appendLsn;
+
+		log->buffer = log->spare;
+		log->bufferSize = log->spareSize;
+		log->bufferLength = 0;
+		log->flushing = TRUE;
+		pthread_mutex_unlock(&log->lock);
+
+		rc = writeBytes(log, end - length, chunk, length);
+
+		pthread_mutex_lock(&log->lock);
+		log->spare = chunk;
+		log->spareSize = size;
+		log->flushing = FALSE;
+		if (rc == RC_OK) {
+			log->flushedLsn = end;
+			log->numSyncs++;
+		}
+		pthread_cond_broadcast(&log->flushed);
+	}
+	pthread_mutex_unlock(&log->lock);
+	return rc;
+}
+
+WalLsn
+walAppendedLsn (WalLog *log)
+{
+	WalLsn lsn;
+
+	pthread_mutex_lock(&log->lock);
+	lsn = log->appendLsn;
+	pthread_mutex_unlock(&log->lock);
+	return lsn;
+}
+
+int
+getWalSyncs (WalLog *log)
+{
+	return log->numSyncs;
+}
+
+/**
+ * Function: walSetCheckpoint
+ * -------------------------
+ * Makes a checkpoint record the starting point of recovery and drops the
+ * segments before keepFrom. The checkpoint record must have been flushed.
+ *
+ * @param log           Log of the checkpoint
+ * @param checkpointPos Position of the checkpoint record
+ * @param keepFrom      Position of the first record recovery needs
+ * @return
+ *  -   RC_OK if the checkpoint was stored
+ *  -   RC_INVALID_PARAM if the positions are not in the log
+ *  -   RC_WRITE_FAILED if the control file cannot be written
+ */
+RC
+walSetCheckpoint (WalLog *log, WalLsn checkpointPos, WalLsn keepFrom)
+{
+	RC rc;
+
+	pthread_mutex_lock(&log->lock);
+	if (keepFrom < log->startLsn || keepFrom > checkpointPos || checkpointPos >= log->flushedLsn) {
+		pthread_mutex_unlock(&log->lock);
+		return RC_INVALID_PARAM;
+	}
+	if ((rc = writeControl(log, keepFrom, TRUE, checkpointPos)) == RC_OK) {
+		removeSegments(log, log->startLsn, keepFrom);
+		log->startLsn = keepFrom;
+		log->hasCheckpoint = TRUE;
+		log->checkpointPos = checkpointPos;
+	}
+	pthread_mutex_unlock(&log->lock);
+	return rc;
+}
+
+/* Position of the last checkpoint record; FALSE if there is none */
+bool
+walLastCheckpoint (WalLog *log, WalLsn *checkpointPos)
+{
+	*checkpointPos = log->checkpointPos;
+	return log->hasCheckpoint;
+}
+
+/**
+ * Function: walReadRecord
+ * ----------------------
+ * Reads the log record at a position.
+ *
+ * @param log       Log to read
+ * @param pos       Position of the record
+ * @param record    Set to the header of the record
+ * @param data      Set to the data of the record, to be freed by the caller
+ * @return
+ *  -   RC_OK if there is a complete record at pos
+ *  -   RC_READ_NON_EXISTING_PAGE otherwise
+ */
+RC
+walReadRecord (WalLog *log, WalLsn pos, WalRecord *record, char **data)
+{
+	return readRecordAt(log, pos, record, data) ? RC_OK : RC_READ_NON_EXISTING_PAGE;
+}
+
+/**
+ * Function: walReplay
+ * ------------------
+ * Calls redo for every record of the log from a position on, oldest first.
+ * Must be called before anything is appended.
+ *
+ * @param log           Log to replay
+ * @param from          Position of the first record to replay
+ * @param redo          Function applying a record
+ * @param context       Passed to redo
+ * @param numRecords    Set to the number of records replayed
+ * @return
+ *  -   RC_OK if all records were applied
+ *  -   The first error returned by redo
+ */
+RC
+walReplay (WalLog *log, WalLsn from, WalRedoFunction redo, void *context, int *numRecords)
+{
+	WalRecord header;
+	char *data;
+	WalLsn pos = (from > log->startLsn) ? from : log->startLsn;
+	RC rc = RC_OK;
+
+	*numRecords = 0;
+	while (rc == RC_OK && pos < log->appendLsn && readRecordAt(log, pos, &header, &data)) {
+		rc = redo(&header, data, context);
+		free(data);
+		pos = header.lsn;
+		(*numRecords)++;
+	}
+	return rc;
+}
+
+/**
+ * Function: walReset
+ * -----------------
+ * Drops all records, once the changes they describe are on disk. The log
+ * continues at the next segment, so LSNs keep growing.
+ *
+ * @param log       Log to reset
+ * @return
+ *  -   RC_OK if the log is empty
+ *  -   RC_WRITE_FAILED if the control file cannot be written
+ */
+RC
+walReset (WalLog *log)
+{
+	WalLsn start;
+	RC rc = RC_OK;
+
+	pthread_mutex_lock(&log->lock);
+	if (log->appendLsn > log->startLsn) {
+		start = (log->appendLsn + WAL_SEGMENT_SIZE - 1) / WAL_SEGMENT_SIZE * WAL_SEGMENT_SIZE;
+		if ((rc = writeControl(log, start, FALSE, 0)) == RC_OK) {
+			removeSegments(log, log->startLsn, start);
+			log->startLsn = start;
+			log->hasCheckpoint = FALSE;
+			log->appendLsn = start;
+			log->flushedLsn = start;
+			log->bufferLength = 0;
+		}
+	}
+	pthread_mutex_unlock(&log->lock);
+	return rc;
+}
@@ -0,0 +1,74 @@
+#ifndef RM_WAL_H
+#define RM_WAL_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+#include "dberror.h"
+#include "tables.h"
+
+// the log is stored in segment files of this size, preallocated when first written
+#define WAL_SEGMENT_SIZE (1 << 20)
+
+// position in the log; the LSN of a log record is the position just past it
+typedef uint64_t WalLsn;
+
+typedef enum WalRecordType {
+	WAL_INSERT = 1,  // record data written to a free slot
+	WAL_UPDATE = 2,  // record data overwritten
+	WAL_DELETE = 3,  // slot freed
+	WAL_TRUNCATE = 4,  // pages after rid.page released by a vacuum
+	WAL_CHECKPOINT = 5 // state needed to start recovery here, see walSetCheckpoint
+} WalRecordType;
+
+// header of a log record, followed by the record data for inserts and updates
+typedef struct WalRecord {
+	uint32_t length;   // bytes of header and data
+	uint32_t checksum; // of the bytes after this field
+	WalLsn lsn;
+	int32_t type;
+	RID rid;
+} WalRecord;
+
+// applies a log record during replay
+typedef RC (*WalRedoFunction) (WalRecord *record, char *data, void *context);
+
+typedef struct WalLog {
+	char *name;         // control file, segment n is <name>.<n>
+	WalLsn startLsn;    // first position holding records
+	bool hasCheckpoint;
+	WalLsn checkpointPos; // position of the last checkpoint record, if hasCheckpoint
+	WalLsn appendLsn;   // end of the appended records
+	WalLsn flushedLsn;  // end of the durable records
+	char *buffer;       // records after flushedLsn not taken by a flush yet
+	int bufferLength;
+	int bufferSize;
+	char *spare;        // second buffer, swapped in while a flush writes the first
+	int spareSize;
+	bool flushing;      // a thread is writing and syncing the log
+	int fd;             // open segment file, -1 if none
+	int fdSegment;
+	int numSyncs;       // completed group commits
+	pthread_mutex_t lock;
+	pthread_cond_t flushed;
+} WalLog;
+
+// log handling
+extern RC openWal (WalLog **log, char *name);
+extern RC closeWal (WalLog *log);
+extern RC deleteWal (char *name);
+
+// appending and group commit
+extern RC walAppend (WalLog *log, WalRecordType type, RID rid, const char *data, int length, WalLsn *lsn);
+extern RC walFlush (WalLog *log, WalLsn lsn);
+extern WalLsn walAppendedLsn (WalLog *log);
+extern int getWalSyncs (WalLog *log);
+
+// checkpoints and recovery
+extern RC walSetCheckpoint (WalLog *log, WalLsn checkpointPos, WalLsn keepFrom);
+extern bool walLastCheckpoint (WalLog *log, WalLsn *checkpointPos);
+extern RC walReadRecord (WalLog *log, WalLsn pos, WalRecord *record, char **data);
+extern RC walReplay (WalLog *log, WalLsn from, WalRedoFunction redo, void *context, int *numRecords);
+extern RC walReset (WalLog *log);
+
+#endif // RM_WAL_H
@@ -0,0 +1,327 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "rm_zonemap.h"
+
+// outcome of comparing a bound with a constant; prefix-equal strings and NaN are UNORDERED
+typedef enum ZoneOrder {
+	ZONE_LESS,
+	ZONE_EQUAL,
+	ZONE_GREATER,
+	ZONE_UNORDERED
+} ZoneOrder;
+
+static int
+prefixLength (Schema *schema, int attrNum)
+{
+	int len = schema->typeLength[attrNum];
+	return (len < ZONE_STRING_PREFIX) ? len : ZONE_STRING_PREFIX;
+}
+
+static ZoneRange *
+rangesOf (ZoneMap *map, int page)
+{
+	return map->ranges + (long) page * map->schema->numAttr;
+}
+
+/**
+ * Function: createZoneMap
+ * ----------------------
+ * Creates an empty zone map for a table; every page starts out unknown.
+ *
+ * @param schema    Schema of the table (must have attribute offsets)
+ * @return
+ *  -   The new zone map
+ */
+ZoneMap *
+createZoneMap (Schema *schema)
+{
+	ZoneMap *map = (ZoneMap *) malloc(sizeof(ZoneMap));
+
+	map->schema = schema;
+	map->capacity = 0;
+	map->state = NULL;
+	map->ranges = NULL;
+	return map;
+}
+
+void
+freeZoneMap (ZoneMap *map)
+{
+	if (map == NULL)
+		return;
+	free(map->state);
+	free(map->ranges);
+	free(map);
+}
+
+/**
+ * Function: zoneReserve
+ * --------------------
+ * Makes room for the summaries of all pages up to page. Scans reserve their
+ * page range up front, so that concurrent workers only write to existing
+ * entries of distinct pages.
+ *
+ * @param map       Zone map
+ * @param page      Highest page to cover
+ */
+void
+zoneReserve (ZoneMap *map, int page)
+{
+	int capacity = (map->capacity > 0) ? map->capacity : 16;
+
+	if (page < map->capacity)
+		return;
+	while (capacity <= page)
+		capacity *= 2;
+
+	map->state = (char *) realloc(map->state, capacity);
+	map->ranges = (ZoneRange *) realloc(map->ranges, sizeof(ZoneRange) * (long) capacity * map->schema->numAttr);
+	memset(map->state + map->capacity, ZONE_UNKNOWN, capacity - map->capacity);
+	map->capacity = capacity;
+}
+
+ZoneState
+zoneState (ZoneMap *map, int page)
+{
+	return (page < map->capacity) ? (ZoneState) map->state[page] : ZONE_UNKNOWN;
+}
+
+void
+zoneSetState (ZoneMap *map, int page, ZoneState state)
+{
+	zoneReserve(map, page);
+	map->state[page] = state;
+}
+
+/**
+ * Function: zoneAddRecord
+ * ----------------------
+ * Widens the ranges of a page so that they include a record. Unknown pages
+ * stay unknown (they are summarized when a scan reads them), the first record
+ * of an empty page sets the ranges.
+ *
+ * @param map       Zone map
+ * @param page      Page the record is stored on
+ * @param record    Record data
+ */
+void
+zoneAddRecord (ZoneMap *map, int page, const char *record)
+{
+	Schema *schema = map->schema;
+	ZoneState state = zoneState(map, page);
+	ZoneRange *ranges;
+
+	if (state == ZONE_UNKNOWN)
+		return;
+	ranges = rangesOf(map, page);
+
+	for (int i = 0; i < schema->numAttr; i++)
+	{
+		const char *attr = record + schema->attrOffsets[i];
+		ZoneRange *range = &ranges[i];
+
+		switch (schema->dataTypes[i])
+		{
+			case DT_INT:
+			{
+				int v = readIntAttr(attr);
+				if (state == ZONE_EMPTY || v < range->min.intV)
+					range->min.intV = v;
+				if (state == ZONE_EMPTY || v > range->max.intV)
+					range->max.intV = v;
+			}
+			break;
+			case DT_FLOAT:
+			{
+				float v = readFloatAttr(attr);
+				if (state == ZONE_EMPTY)
+				{
+					// start with an empty range, NaN never widens it
+					range->min.floatV = INFINITY;
+					range->max.floatV = -INFINITY;
+					range->hasNaN = FALSE;
+				}
+				if (isnan(v))
+					range->hasNaN = TRUE;
+				else
+				{
+					if (v < range->min.floatV)
+						range->min.floatV = v;
+					if (v > range->max.floatV)
+						range->max.floatV = v;
+				}
+			}
+			break;
+			case DT_STRING:
+			{
+				int n = prefixLength(schema, i);
+				if (state == ZONE_EMPTY || strncmp(attr, range->min.stringV, n) < 0)
+					memcpy(range->min.stringV, attr, n);
+				if (state == ZONE_EMPTY || strncmp(attr, range->max.stringV, n) > 0)
+					memcpy(range->max.stringV, attr, n);
+			}
+			break;
+			default:
+			break;
+		}
+	}
+	map->state[page] = ZONE_VALID;
+}
+
+// matches "attr op const", "const op attr" and NOT of either on an int, float or string attribute
+static bool
+zoneComparison (Expr *expr, Schema *schema, ZonePredicate *pred, bool negate)
+{
+	Operator *op;
+	Expr *attr, *cons;
+	bool attrLeft;
+	DataType dt;
+
+	if (expr->type != EXPR_OP)
+		return FALSE;
+	op = expr->expr.op;
+
+	if (op->type == OP_BOOL_NOT)
+		return zoneComparison(op->args[0], schema, pred, !negate);
+	if (op->type != OP_COMP_EQUAL && op->type != OP_COMP_SMALLER)
+		return FALSE;
+
+	attrLeft = (op->args[0]->type == EXPR_ATTRREF);
+	attr = attrLeft ? op->args[0] : op->args[1];
+	cons = attrLeft ? op->args[1] : op->args[0];
+	if (attr->type != EXPR_ATTRREF || cons->type != EXPR_CONST)
+		return FALSE;
+	if (attr->expr.attrRef < 0 || attr->expr.attrRef >= schema->numAttr)
+		return FALSE;
+
+	dt = schema->dataTypes[attr->expr.attrRef];
+	if ((dt != DT_INT && dt != DT_FLOAT && dt != DT_STRING) || cons->expr.cons->dt != dt)
+		return FALSE;
+
+	pred->attrNum = attr->expr.attrRef;
+	pred->cons = cons->expr.cons;
+	if (op->type == OP_COMP_EQUAL)
+		pred->cmp = KERNEL_CMP_EQ;
+	else
+		pred->cmp = attrLeft ? KERNEL_CMP_LT : KERNEL_CMP_GT;
+	pred->negate = negate;
+	return TRUE;
+}
+
+/**
+ * Function: extractZonePredicates
+ * ------------------------------
+ * Collects the conjuncts of a scan condition that can be checked against
+ * page ranges: comparisons of an int, float or string attribute with a
+ * constant, possibly negated. A page can be skipped if any of them cannot
+ * hold for the page.
+ *
+ * @param cond      Scan condition (may be NULL)
+ * @param schema    Schema of the scanned table
+ * @param preds     Filled with the predicates found
+ * @param maxPreds  Capacity of preds
+ * @return
+ *  -   Number of predicates found
+ */
+int
+extractZonePredicates (Expr *cond, Schema *schema, ZonePredicate *preds, int maxPreds)
+{
+	int n;
+
+	if (cond == NULL || maxPreds <= 0)
+		return 0;
+
+	if (zoneComparison(cond, schema, &preds[0], FALSE))
+		return 1;
+
+	if (cond->type == EXPR_OP && cond->expr.op->type == OP_BOOL_AND)
+	{
+		n = extractZonePredicates(cond->expr.op->args[0], schema, preds, maxPreds);
+		return n + extractZonePredicates(cond->expr.op->args[1], schema, preds + n, maxPreds - n);
+	}
+
+	return 0;
+}
+
+static ZoneOrder
+compareBound (Schema *schema, int attrNum, ZoneValue *bound, Value *cons)
+{
+	switch (schema->dataTypes[attrNum])
+	{
+		case DT_INT:
+			return (bound->intV < cons->v.intV) ? ZONE_LESS
+					: (bound->intV > cons->v.intV) ? ZONE_GREATER : ZONE_EQUAL;
+		case DT_FLOAT:
+			return (bound->floatV < cons->v.floatV) ? ZONE_LESS
+					: (bound->floatV > cons->v.floatV) ? ZONE_GREATER
+					: (bound->floatV == cons->v.floatV) ? ZONE_EQUAL : ZONE_UNORDERED;
+		case DT_STRING:
+		{
+			// the bound is a prefix, so only a difference within it is conclusive
+			int cmp = strncmp(bound->stringV, cons->v.stringV, prefixLength(schema, attrNum));
+			return (cmp < 0) ? ZONE_LESS : (cmp > 0) ? ZONE_GREATER : ZONE_UNORDERED;
+		}
+		default:
+			return ZONE_UNORDERED;
+	}
+}
+
+// FALSE if no value within the range can satisfy the predicate
+static bool
+rangeMayMatch (Schema *schema, ZoneRange *range, ZonePredicate *pred)
+{
+	ZoneOrder min = compareBound(schema, pred->attrNum, &range->min, pred->cons);
+	ZoneOrder max = compareBound(schema, pred->attrNum, &range->max, pred->cons);
+
+	// NaN fails every comparison, so it only satisfies negated predicates
+	if (pred->negate && schema->dataTypes[pred->attrNum] == DT_FLOAT && range->hasNaN)
+		return TRUE;
+
+	switch (pred->cmp)
+	{
+		case KERNEL_CMP_EQ:
+			if (pred->negate)
+				return !(min == ZONE_EQUAL && max == ZONE_EQUAL);
+			return !(min == ZONE_GREATER || max == ZONE_LESS);
+		case KERNEL_CMP_LT:
+			if (pred->negate)
+				return max != ZONE_LESS;
+			return !(min == ZONE_GREATER || min == ZONE_EQUAL);
+		case KERNEL_CMP_GT:
+			if (pred->negate)
+				return min != ZONE_GREATER;
+			return !(max == ZONE_LESS || max == ZONE_EQUAL);
+	}
+	return TRUE;
+}
+
+/**
+ * Function: zoneMayMatch
+ * ---------------------
+ * Checks whether a page can hold a record satisfying all predicates.
+ * Unknown pages always may; empty pages never do.
+ *
+ * @param map       Zone map
+ * @param page      Page to check
+ * @param preds     Predicates from extractZonePredicates
+ * @param numPreds  Number of predicates
+ * @return
+ *  -   FALSE if the page can be skipped
+ */
+bool
+zoneMayMatch (ZoneMap *map, int page, ZonePredicate *preds, int numPreds)
+{
+	ZoneState state = zoneState(map, page);
+	ZoneRange *ranges;
+
+	if (state != ZONE_VALID)
+		return state == ZONE_UNKNOWN;
+
+	ranges = rangesOf(map, page);
+	for (int i = 0; i < numPreds; i++)
+		if (!rangeMayMatch(map->schema, &ranges[preds[i].attrNum], &preds[i]))
+			return FALSE;
+	return TRUE;
+}
@@ -0,0 +1,61 @@
+#ifndef RM_ZONEMAP_H
+#define RM_ZONEMAP_H
+
+#include "dberror.h"
+#include "expr.h"
+#include "tables.h"
+#include "rm_kernels.h"
+
+// string bounds keep only this many leading bytes
+#define ZONE_STRING_PREFIX 16
+// conjuncts of a scan condition checked against the zone map
+#define ZONE_MAX_PREDICATES 8
+
+// what is known about the live records of a page
+typedef enum ZoneState {
+	ZONE_UNKNOWN = 0, // not summarized yet, the page has to be read
+	ZONE_EMPTY = 1,   // no live records
+	ZONE_VALID = 2    // the ranges bound every live record
+} ZoneState;
+
+typedef union ZoneValue {
+	int intV;
+	float floatV;
+	char stringV[ZONE_STRING_PREFIX];
+} ZoneValue;
+
+// min/max of one attribute on one page (NaN floats are only flagged)
+typedef struct ZoneRange {
+	ZoneValue min;
+	ZoneValue max;
+	bool hasNaN;
+} ZoneRange;
+
+typedef struct ZoneMap {
+	Schema *schema;
+	int capacity;      // number of pages covered by state and ranges
+	char *state;       // ZoneState of every page
+	ZoneRange *ranges; // numAttr ranges per page
+} ZoneMap;
+
+// a conjunct "attr <cmp> constant" (optionally negated) of a scan condition
+typedef struct ZonePredicate {
+	int attrNum;
+	KernelCmp cmp;
+	bool negate;
+	Value *cons;
+} ZonePredicate;
+
+// zone map handling
+extern ZoneMap *createZoneMap (Schema *schema);
+extern void freeZoneMap (ZoneMap *map);
+extern void zoneReserve (ZoneMap *map, int page);
+extern ZoneState zoneState (ZoneMap *map, int page);
+extern void zoneSetState (ZoneMap *map, int page, ZoneState state);
+extern void zoneAddRecord (ZoneMap *map, int page, const char *record);
+
+// pruning
+extern int extractZonePredicates (Expr *cond, Schema *schema, ZonePredicate *preds, int maxPreds);
+extern bool zoneMayMatch (ZoneMap *map, int page, ZonePredicate *preds, int numPreds);
+
+#endif // RM_ZONEMAP_H
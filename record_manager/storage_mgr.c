@@ -1,6 +1,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <memory.h>
+#include <unistd.h>
+#include <fcntl.h>
 #include "storage_mgr.h"
 
 #define CHECK_FILE_VALIDITY(fileHandle)  \
@@ -498,4 +500,93 @@ RC ensureCapacity(int numberOfPages, SM_FileHandle *fHandle) {
 	while (fHandle->totalNumPages < numberOfPages)
 		appendEmptyBlock(fHandle);
 	return RC_OK;
-}
\ No newline at end of file
+}
+
+/*
+ * Function: truncatePageFile
+ * --------------------------
+ *   Shrinks the file to the specified number of pages, giving the space of
+ *   the pages beyond them back to the file system.
+ *
+ * Parameters:
+ *   numberOfPages - The number of pages to keep.
+ *   fHandle       - The file handle structure.
+ *
+ * Returns:
+ *   RC_FILE_HANDLE_NOT_INIT - If the file handle is not correctly initialized.
+ *   RC_WRITE_FAILED         - If the file cannot be truncated.
+ *   RC_OK                   - Operation was successful (or the file was not larger).
+ */
+RC truncatePageFile(int numberOfPages, SM_FileHandle *fHandle) {
+	CHECK_FILE_VALIDITY(fHandle);
+
+	if (numberOfPages < 0)
+		return RC_INVALID_PARAM;
+	if (fHandle->totalNumPages <= numberOfPages)
+		return RC_OK;
+
+	// Cut the file after the last page kept (the header page comes first)
+	fflush(fHandle->mgmtInfo);
+	if (ftruncate(fileno(fHandle->mgmtInfo), (long) (numberOfPages + 1) * PAGE_SIZE * PAGE_ELEMENT_SIZE) != 0)
+		return RC_WRITE_FAILED;
+	fHandle->totalNumPages = numberOfPages;
+	if (fHandle->curPagePos >= numberOfPages)
+		fHandle->curPagePos = (numberOfPages > 0) ? numberOfPages - 1 : 0;
+
+	// Update the page count in the file header
+	if (fseek(fHandle->mgmtInfo, 0, SEEK_SET) != 0)
+		return RC_WRITE_FAILED;
+	fprintf(fHandle->mgmtInfo, "%d\n", fHandle->totalNumPages);
+	fflush(fHandle->mgmtInfo);
+
+	return RC_OK;
+}
+
+/*
+ * Function: syncPageFile
+ * ----------------------
+ *   Waits until all pages written so far are on disk.
+ *
+ * Parameters:
+ *   fHandle - The file handle structure.
+ *
+ * Returns:
+ *   RC_FILE_HANDLE_NOT_INIT - If the file handle is not correctly initialized.
+ *   RC_WRITE_FAILED         - If the file cannot be synced.
+ *   RC_OK                   - Operation was successful.
+ */
+RC syncPageFile(SM_FileHandle *fHandle) {
+	CHECK_FILE_VALIDITY(fHandle);
+
+	if (fflush(fHandle->mgmtInfo) != 0 || fsync(fileno(fHandle->mgmtInfo)) != 0)
+		return RC_WRITE_FAILED;
+	return RC_OK;
+}
+
+/*
+ * Function: prefetchBlocks
+ * ------------------------
+ *   Tells the operating system that pages will be read soon, so that it can
+ *   start reading them in the background. This is only a hint: nothing is
+ *   read into memory of the caller, and the call does not wait.
+ *
+ * Parameters:
+ *   pageNum  - The first page to prefetch.
+ *   numPages - The number of pages from pageNum on.
+ *   fHandle  - The file handle structure.
+ *
+ * Returns:
+ *   RC_FILE_HANDLE_NOT_INIT - If the file handle is not correctly initialized.
+ *   RC_OK                   - Operation was successful, or the hint is not supported.
+ */
+RC prefetchBlocks(int pageNum, int numPages, SM_FileHandle *fHandle) {
+	CHECK_FILE_VALIDITY(fHandle);
+
+	if (pageNum < 0 || numPages <= 0 || pageNum >= fHandle->totalNumPages)
+		return RC_OK;
+#ifdef POSIX_FADV_WILLNEED
+	posix_fadvise(fileno(fHandle->mgmtInfo), (off_t) pageNum * PAGE_SIZE, (off_t) numPages * PAGE_SIZE,
+			POSIX_FADV_WILLNEED);
+#endif
+	return RC_OK;
+}
@@ -1,6 +1,7 @@
 #ifndef TABLES_H
 #define TABLES_H
 
+#include <string.h>
 #include "dt.h"
 
 // Data Types, Records, and Schemas
@@ -41,6 +42,7 @@ typedef struct Schema
 	int *typeLength;
 	int *keyAttrs;
 	int keySize;
+	int *attrOffsets; // byte offset of each attribute; attrOffsets[numAttr] is the record size; set by createSchema, never NULL
 } Schema;
 
 // TableData: Management Structure for a Record Manager to handle one relation
@@ -51,6 +53,14 @@ typedef struct RM_TableData
 	void *mgmtData;
 } RM_TableData;
 
+// typed accessors for fixed-width attributes in raw record data (attributes are not aligned)
+static inline int readIntAttr (const char *data) { int v; memcpy(&v, data, sizeof(int)); return v; }
+static inline float readFloatAttr (const char *data) { float v; memcpy(&v, data, sizeof(float)); return v; }
+static inline bool readBoolAttr (const char *data) { bool v; memcpy(&v, data, sizeof(bool)); return v; }
+static inline void writeIntAttr (char *data, int v) { memcpy(data, &v, sizeof(int)); }
+static inline void writeFloatAttr (char *data, float v) { memcpy(data, &v, sizeof(float)); }
+static inline void writeBoolAttr (char *data, bool v) { memcpy(data, &v, sizeof(bool)); }
+
 #define MAKE_STRING_VALUE(result, value)				\
 		do {									\
 			(result) = (Value *) malloc(sizeof(Value));				\
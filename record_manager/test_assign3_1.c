@@ -1,9 +1,14 @@
 #include <stdlib.h>
+#include <math.h>
+#include <unistd.h>
+#include <pthread.h>
 #include "dberror.h"
 #include "expr.h"
 #include "record_mgr.h"
 #include "tables.h"
 #include "test_helper.h"
+#include "rm_kernels.h"
+#include "storage_mgr.h"
 
 
 #define ASSERT_EQUALS_RECORDS(_l,_r, schema, message)			\
@@ -55,6 +60,30 @@ static void testScans (void);
 static void testScansTwo (void);
 static void testInsertManyRecords(void);
 static void testMultipleScans(void);
+static void testScanKernels(void);
+static void testKernelVariants(void);
+static void testPaxLayout(void);
+static void testParallelScan(void);
+static void testZoneMaps(void);
+static void testIndexes(void);
+static void testHashIndexes(void);
+static void testIndexScans(void);
+static void testVacuum(void);
+static void testLoggedTables(void);
+static void testCheckpoints(void);
+static void testTransactions(void);
+static void testLocks(void);
+static void testCatalog(void);
+static void testTableCache(void);
+static void testPoolOptions(void);
+static void testArena(void);
+static void testAttrAccessors(void);
+static void testMultiGet(void);
+static void testChangeWhere(void);
+static void testProjection(void);
+static void testAggregation(void);
+static void testExternalSort(void);
+static void testJoins(void);
 
 // struct for test records
 typedef struct TestRecord {
@@ -67,6 +96,7 @@ typedef struct TestRecord {
 Record *testRecord(Schema *schema, int a, char *b, int c);
 Schema *testSchema (void);
 Record *fromTestRecord (Schema *schema, TestRecord in);
+static int intAttr (Record *r, Schema *schema, int attrNum);
 
 // test name
 char *testName;
@@ -84,6 +114,30 @@ main (void)
   testScans();
   testScansTwo();
   testMultipleScans();
+  testScanKernels();
+  testKernelVariants();
+  testPaxLayout();
+  testParallelScan();
+  testZoneMaps();
+  testIndexes();
+  testHashIndexes();
+  testIndexScans();
+  testVacuum();
+  testLoggedTables();
+  testCheckpoints();
+  testTransactions();
+  testLocks();
+  testCatalog();
+  testTableCache();
+  testPoolOptions();
+  testArena();
+  testAttrAccessors();
+  testMultiGet();
+  testChangeWhere();
+  testProjection();
+  testAggregation();
+  testExternalSort();
+  testJoins();
 
   return 0;
 }
@@ -294,7 +348,7 @@ testUpdateTable (void)
           {4, "dddd", 3},
           {5, "eeee", 5},
   };
-  int numInserts = 10, numUpdates = 3, numDeletes = 5, numFinal = 5, i;
+  int numInserts = 10, numUpdates = 3, numDeletes = 5, numFinal = 5, i, rc;
   Record *r;
   RID *rids;
   Schema *schema;
@@ -328,6 +382,13 @@ testUpdateTable (void)
     TEST_CHECK(updateRecord(table,r));
   }
 
+  // an update of a deleted record fails and does not bring it back
+  r->id = rids[deletes[0]];
+  rc = updateRecord(table, r);
+  ASSERT_EQUALS_INT(RC_TUPLE_WIT_RID_ON_EXISTING, rc, "update of a deleted record");
+  rc = getRecord(table, rids[deletes[0]], r);
+  ASSERT_EQUALS_INT(RC_TUPLE_WIT_RID_ON_EXISTING, rc, "deleted record stays deleted");
+
   TEST_CHECK(closeTable(table));
   TEST_CHECK(openTable(table, "test_table_r"));
 
@@ -616,38 +677,2927 @@ void testScansTwo (void)
 }
 
 
-Schema *
-testSchema (void)
+// counts the tuples returned by a scan and checks each of them against evalExpr
+static int
+countScan (RM_TableData *table, Schema *schema, Expr *cond)
 {
-  Schema *result;
-  char *names[] = { "a", "b", "c" };
-  DataType dt[] = { DT_INT, DT_STRING, DT_INT };
-  int sizes[] = { 0, 4, 0 };
-  int keys[] = {0};
-  int i;
-  char **cpNames = (char **) malloc(sizeof(char*) * 3);
-  DataType *cpDt = (DataType *) malloc(sizeof(DataType) * 3);
-  int *cpSizes = (int *) malloc(sizeof(int) * 3);
-  int *cpKeys = (int *) malloc(sizeof(int));
+  RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+  Record *r;
+  Value *res;
+  int rc, count = 0;
 
-  for(i = 0; i < 3; i++)
+  createRecord(&r, schema);
+  TEST_CHECK(startScan(table, sc, cond));
+  while((rc = next(sc, r)) == RC_OK)
   {
-    cpNames[i] = (char *) malloc(2);
-    strcpy(cpNames[i], names[i]);
+    if (cond != NULL)
+    {
+      evalExpr(r, schema, cond, &res);
+      if (!res->v.boolV)
+        ASSERT_TRUE(FALSE, "scan returned only matching tuples");
+      freeVal(res);
+    }
+    count++;
   }
-  memcpy(cpDt, dt, sizeof(DataType) * 3);
-  memcpy(cpSizes, sizes, sizeof(int) * 3);
-  memcpy(cpKeys, keys, sizeof(int));
+  if (rc != RC_RM_NO_MORE_TUPLES)
+    TEST_CHECK(rc);
+  TEST_CHECK(closeScan(sc));
 
-  result = createSchema(3, cpNames, cpDt, cpSizes, 1, cpKeys);
+  freeRecord(r);
+  free(sc);
+  return count;
+}
 
-  return result;
+void
+testScanKernels (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  int numInserts = 3000, i;
+  int expLess = 0, expNotLess = 0, expEqual = 0, expGreater = 0;
+  Record *r;
+  RID *rids;
+  Schema *schema;
+  Expr *sel, *left, *right, *inner, *first;
+  testName = "test page-at-a-time scans with vectorized predicates";
+  schema = testSchema();
+  rids = (RID *) malloc(sizeof(RID) * numInserts);
+
+  TEST_CHECK(initRecordManager(NULL));
+  TEST_CHECK(createTable("test_table_k",schema));
+  TEST_CHECK(openTable(table, "test_table_k"));
+
+  for(i = 0; i < numInserts; i++)
+  {
+    r = testRecord(schema, i, (i % 2) ? "bbbb" : "cccc", i % 10);
+    TEST_CHECK(insertRecord(table,r));
+    rids[i] = r->id;
+    freeRecord(r);
+  }
+
+  // delete every 7th tuple, scans must skip the tombstones
+  for(i = 0; i < numInserts; i += 7)
+    TEST_CHECK(deleteRecord(table, rids[i]));
+
+  for(i = 0; i < numInserts; i++)
+  {
+    if (i % 7 == 0)
+      continue;
+    expLess += (i % 10 < 3);
+    expNotLess += (i >= 1500);
+    expEqual += (i % 10 == 5);
+    expGreater += (i % 10 > 2 && i % 2 == 1);
+  }
+
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(openTable(table, "test_table_k"));
+
+  // c < 3
+  MAKE_ATTRREF(left, 2);
+  MAKE_CONS(right, stringToValue("i3"));
+  MAKE_BINOP_EXPR(sel, left, right, OP_COMP_SMALLER);
+  ASSERT_EQUALS_INT(expLess, countScan(table, schema, sel), "attr < const");
+  freeExpr(sel);
+
+  // NOT (a < 1500)
+  MAKE_ATTRREF(left, 0);
+  MAKE_CONS(right, stringToValue("i1500"));
+  MAKE_BINOP_EXPR(inner, left, right, OP_COMP_SMALLER);
+  MAKE_UNOP_EXPR(sel, inner, OP_BOOL_NOT);
+  ASSERT_EQUALS_INT(expNotLess, countScan(table, schema, sel), "NOT (attr < const)");
+  freeExpr(sel);
+
+  // 5 = c
+  MAKE_CONS(left, stringToValue("i5"));
+  MAKE_ATTRREF(right, 2);
+  MAKE_BINOP_EXPR(sel, left, right, OP_COMP_EQUAL);
+  ASSERT_EQUALS_INT(expEqual, countScan(table, schema, sel), "const = attr");
+  freeExpr(sel);
+
+  // 2 < c AND b = 'bbbb'
+  MAKE_CONS(left, stringToValue("i2"));
+  MAKE_ATTRREF(right, 2);
+  MAKE_BINOP_EXPR(inner, left, right, OP_COMP_SMALLER);
+  MAKE_ATTRREF(left, 1);
+  MAKE_CONS(right, stringToValue("sbbbb"));
+  MAKE_BINOP_EXPR(first, left, right, OP_COMP_EQUAL);
+  MAKE_BINOP_EXPR(sel, inner, first, OP_BOOL_AND);
+  ASSERT_EQUALS_INT(expGreater, countScan(table, schema, sel), "const < attr AND string equality");
+  freeExpr(sel);
+
+  ASSERT_EQUALS_INT(numInserts - (numInserts + 6) / 7, countScan(table, schema, NULL), "full scan skips deleted tuples");
+
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(deleteTable("test_table_k"));
+  TEST_CHECK(shutdownRecordManager());
+
+  free(rids);
+  free(table);
+  TEST_DONE();
 }
 
-Record *
-fromTestRecord (Schema *schema, TestRecord in)
+// every instruction set the CPU has must filter like the scalar kernels
+void
+testKernelVariants (void)
 {
-  return testRecord(schema, in.a, in.b, in.c);
+  const char *names[] = {"sse2", "avx2"};
+  int counts[] = {1, 3, 7, 8, 13, 64, 100, 259};
+  int strides[] = {4, 9};
+  KernelCmp cmps[] = {KERNEL_CMP_EQ, KERNEL_CMP_LT, KERNEL_CMP_GT};
+  KernelFilterIntFn scalarInt, filterInt;
+  KernelFilterFloatFn scalarFloat, filterFloat;
+  uint64_t expected[KERNEL_MASK_WORDS], actual[KERNEL_MASK_WORDS];
+  char *data = (char *) calloc(300, 9);
+  int i, v, c, s, n, negate, intDiffs, floatDiffs, nanDiffs;
+  testName = "test vectorized kernels against the scalar ones";
+
+  ASSERT_TRUE(kernelVariant("scalar", &scalarInt, &scalarFloat), "scalar kernels always exist");
+  for(v = 0; v < 2; v++)
+  {
+    if (!kernelVariant(names[v], &filterInt, &filterFloat))
+      continue;
+    intDiffs = floatDiffs = nanDiffs = 0;
+    for(s = 0; s < 2; s++)
+    {
+      // ints around the constant, floats with NaNs and signed zeros
+      for(i = 0; i < 300; i++)
+      {
+        int iv = i % 7 - 3;
+        float fv = (i % 5 == 0) ? NAN : (i % 5 == 1) ? -0.0f : (float) (i % 9) - 4.5f;
+        memcpy(data + i * strides[s], (i % 2) ? (char *) &iv : (char *) &fv, sizeof(int));
+      }
+      for(n = 0; n < 8; n++)
+        for(c = 0; c < 3; c++)
+          for(negate = 0; negate < 2; negate++)
+          {
+            int words = (counts[n] + 63) / 64;
+
+            scalarInt(data, strides[s], counts[n], cmps[c], negate, 0, expected);
+            filterInt(data, strides[s], counts[n], cmps[c], negate, 0, actual);
+            intDiffs += (memcmp(expected, actual, words * sizeof(uint64_t)) != 0);
+
+            scalarFloat(data, strides[s], counts[n], cmps[c], negate, -0.5f, expected);
+            filterFloat(data, strides[s], counts[n], cmps[c], negate, -0.5f, actual);
+            floatDiffs += (memcmp(expected, actual, words * sizeof(uint64_t)) != 0);
+
+            scalarFloat(data, strides[s], counts[n], cmps[c], negate, NAN, expected);
+            filterFloat(data, strides[s], counts[n], cmps[c], negate, NAN, actual);
+            nanDiffs += (memcmp(expected, actual, words * sizeof(uint64_t)) != 0);
+          }
+    }
+    ASSERT_EQUALS_INT(0, intDiffs, "int kernel matches scalar");
+    ASSERT_EQUALS_INT(0, floatDiffs, "float kernel matches scalar");
+    ASSERT_EQUALS_INT(0, nanDiffs, "float kernel matches scalar on a NaN constant");
+  }
+
+  free(data);
+  TEST_DONE();
+}
+
+void
+testPaxLayout (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  RM_TableOptions options = { 0 };
+  int numInserts = 2000, i, expected = 0;
+  Record *r, *expect;
+  RID *rids;
+  Schema *schema;
+  Expr *sel, *left, *right;
+  testName = "test tables with PAX page layout";
+  schema = testSchema();
+  rids = (RID *) malloc(sizeof(RID) * numInserts);
+  options.layout = RM_LAYOUT_PAX;
+
+  TEST_CHECK(initRecordManager(NULL));
+  TEST_CHECK(createTableWithOptions("test_table_p", schema, &options));
+  TEST_CHECK(openTable(table, "test_table_p"));
+
+  for(i = 0; i < numInserts; i++)
+  {
+    r = testRecord(schema, i, "aaaa", i % 10);
+    TEST_CHECK(insertRecord(table,r));
+    rids[i] = r->id;
+    freeRecord(r);
+  }
+
+  // update every 3rd record, delete every 5th
+  for(i = 0; i < numInserts; i += 3)
+  {
+    r = testRecord(schema, i, "uuuu", 42);
+    r->id = rids[i];
+    TEST_CHECK(updateRecord(table,r));
+    freeRecord(r);
+  }
+  for(i = 0; i < numInserts; i += 5)
+    TEST_CHECK(deleteRecord(table, rids[i]));
+
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(openTable(table, "test_table_p"));
+
+  createRecord(&r, schema);
+  for(i = 0; i < numInserts; i++)
+  {
+    if (i % 5 == 0)
+    {
+      ASSERT_ERROR(getRecord(table, rids[i], r), "deleted record is gone");
+      continue;
+    }
+    expect = (i % 3 == 0) ? testRecord(schema, i, "uuuu", 42) : testRecord(schema, i, "aaaa", i % 10);
+    TEST_CHECK(getRecord(table, rids[i], r));
+    ASSERT_TRUE(memcmp(expect->data, r->data, getRecordSize(schema)) == 0, "record reassembled from minipages");
+    freeRecord(expect);
+    expected += (i % 3 == 0);
+  }
+  freeRecord(r);
+
+  // c = 42 runs on the c minipage only, b = 'uuuu' on assembled records
+  MAKE_ATTRREF(left, 2);
+  MAKE_CONS(right, stringToValue("i42"));
+  MAKE_BINOP_EXPR(sel, left, right, OP_COMP_EQUAL);
+  ASSERT_EQUALS_INT(expected, countScan(table, schema, sel), "kernel scan on PAX pages");
+  freeExpr(sel);
+
+  MAKE_ATTRREF(left, 1);
+  MAKE_CONS(right, stringToValue("suuuu"));
+  MAKE_BINOP_EXPR(sel, left, right, OP_COMP_EQUAL);
+  ASSERT_EQUALS_INT(expected, countScan(table, schema, sel), "string scan on PAX pages");
+  freeExpr(sel);
+
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(deleteTable("test_table_p"));
+  TEST_CHECK(shutdownRecordManager());
+
+  free(rids);
+  free(table);
+  TEST_DONE();
+}
+
+#define PARALLEL_THREADS 4
+
+// per-worker results of a parallel scan, merged after the scan
+typedef struct ParallelResult {
+  int count[PARALLEL_THREADS];
+  long sum[PARALLEL_THREADS];
+  int stopAt;
+} ParallelResult;
+
+static RC
+collectParallel (Record *record, int worker, void *context)
+{
+  ParallelResult *result = (ParallelResult *) context;
+  int a;
+
+  memcpy(&a, record->data, sizeof(int));
+  if (a == result->stopAt)
+    return RC_WRITE_FAILED;
+  result->count[worker]++;
+  result->sum[worker] += a;
+  return RC_OK;
+}
+
+static int
+mergeParallel (ParallelResult *result, long *sum)
+{
+  int i, count = 0;
+
+  *sum = 0;
+  for(i = 0; i < PARALLEL_THREADS; i++)
+  {
+    count += result->count[i];
+    *sum += result->sum[i];
+  }
+  return count;
+}
+
+void
+testParallelScan (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  ParallelResult result;
+  int numInserts = 10000, i, expCount = 0, count;
+  long expSum = 0, sum;
+  Record *r;
+  RID *rids;
+  Schema *schema;
+  RM_Transaction *tx;
+  Expr *sel, *left, *right;
+  testName = "test parallel scans";
+  schema = testSchema();
+  rids = (RID *) malloc(sizeof(RID) * numInserts);
+
+  TEST_CHECK(initRecordManager(NULL));
+  TEST_CHECK(createTable("test_table_ps", schema));
+  TEST_CHECK(openTable(table, "test_table_ps"));
+
+  for(i = 0; i < numInserts; i++)
+  {
+    r = testRecord(schema, i, "pppp", i % 10);
+    TEST_CHECK(insertRecord(table,r));
+    rids[i] = r->id;
+    freeRecord(r);
+  }
+  for(i = 0; i < numInserts; i += 9)
+    TEST_CHECK(deleteRecord(table, rids[i]));
+  for(i = 0; i < numInserts; i++)
+    if (i % 9 != 0 && i % 10 < 3)
+    {
+      expCount++;
+      expSum += i;
+    }
+
+  // c < 3 on four workers, results merged from the per-worker batches
+  MAKE_ATTRREF(left, 2);
+  MAKE_CONS(right, stringToValue("i3"));
+  MAKE_BINOP_EXPR(sel, left, right, OP_COMP_SMALLER);
+  memset(&result, 0, sizeof(result));
+  result.stopAt = -1;
+  TEST_CHECK(parallelScan(table, sel, PARALLEL_THREADS, collectParallel, &result));
+  count = mergeParallel(&result, &sum);
+  ASSERT_EQUALS_INT(expCount, count, "parallel scan finds every match once");
+  ASSERT_TRUE(sum == expSum, "parallel scan returns the matching records");
+  ASSERT_EQUALS_INT(countScan(table, schema, sel), count, "parallel and sequential scans agree");
+
+  // a consumer error stops the scan and is reported
+  memset(&result, 0, sizeof(result));
+  result.stopAt = 5001;
+  ASSERT_TRUE(parallelScan(table, sel, PARALLEL_THREADS, collectParallel, &result) == RC_WRITE_FAILED, "consumer error stops the scan");
+  freeExpr(sel);
+
+  // full scan with a single worker
+  memset(&result, 0, sizeof(result));
+  result.stopAt = -1;
+  TEST_CHECK(parallelScan(table, NULL, 1, collectParallel, &result));
+  ASSERT_EQUALS_INT(getNumTuples(table), mergeParallel(&result, &sum), "single worker full scan");
+
+  // the scan locks the table shared, so it waits for a transaction that has written to it
+  setLockTimeout(50);
+  TEST_CHECK(beginTransaction(&tx));
+  r = testRecord(schema, numInserts, "part", 1);
+  TEST_CHECK(insertRecordTx(table, tx, r));
+  freeRecord(r);
+  memset(&result, 0, sizeof(result));
+  result.stopAt = -1;
+  count = parallelScan(table, NULL, PARALLEL_THREADS, collectParallel, &result);
+  ASSERT_EQUALS_INT(RC_RM_LOCK_TIMEOUT, count, "scan waits for writers");
+  TEST_CHECK(abortTransaction(tx));
+  setLockTimeout(0);
+
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(deleteTable("test_table_ps"));
+  TEST_CHECK(shutdownRecordManager());
+
+  free(rids);
+  free(table);
+  TEST_DONE();
+}
+
+// scans with cond, returns the number of matches and the pages skipped by the zone map
+static int
+skippingScan (RM_TableData *table, Schema *schema, Expr *cond, int *skipped)
+{
+  RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+  Record *r;
+  int rc, count = 0;
+
+  createRecord(&r, schema);
+  TEST_CHECK(startScan(table, sc, cond));
+  while((rc = next(sc, r)) == RC_OK)
+    count++;
+  if (rc != RC_RM_NO_MORE_TUPLES)
+    TEST_CHECK(rc);
+  *skipped = getScanSkippedPages(sc);
+  TEST_CHECK(closeScan(sc));
+
+  freeRecord(r);
+  free(sc);
+  return count;
+}
+
+void
+testZoneMaps (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  int numInserts = 10000, i, skipped, count;
+  char b[5];
+  Record *r;
+  RID *rids;
+  Schema *schema;
+  Expr *sel, *left, *right, *inner, *isThree;
+  testName = "test zone map page skipping";
+  schema = testSchema();
+  rids = (RID *) malloc(sizeof(RID) * numInserts);
+
+  TEST_CHECK(initRecordManager(NULL));
+  TEST_CHECK(createTable("test_table_z", schema));
+  TEST_CHECK(openTable(table, "test_table_z"));
+
+  // time-ordered inserts: a and b grow with the insertion order
+  for(i = 0; i < numInserts; i++)
+  {
+    sprintf(b, "%04d", i);
+    r = testRecord(schema, i, b, i % 10);
+    TEST_CHECK(insertRecord(table,r));
+    rids[i] = r->id;
+    freeRecord(r);
+  }
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(openTable(table, "test_table_z"));
+
+  // a = 5000: the first scan summarizes the pages, the second one skips them
+  MAKE_ATTRREF(left, 0);
+  MAKE_CONS(right, stringToValue("i5000"));
+  MAKE_BINOP_EXPR(sel, left, right, OP_COMP_EQUAL);
+  count = skippingScan(table, schema, sel, &skipped);
+  ASSERT_EQUALS_INT(1, count, "a = 5000 on unsummarized pages");
+  ASSERT_EQUALS_INT(0, skipped, "pages without a summary are read");
+  count = skippingScan(table, schema, sel, &skipped);
+  ASSERT_EQUALS_INT(1, count, "a = 5000 on summarized pages");
+  ASSERT_TRUE(skipped >= 30, "all pages but one skipped");
+
+  // deleting keeps the ranges, the scan still has to be correct
+  TEST_CHECK(deleteRecord(table, rids[5000]));
+  count = skippingScan(table, schema, sel, &skipped);
+  ASSERT_EQUALS_INT(0, count, "deleted record not found");
+  freeExpr(sel);
+
+  // a < 100
+  MAKE_ATTRREF(left, 0);
+  MAKE_CONS(right, stringToValue("i100"));
+  MAKE_BINOP_EXPR(sel, left, right, OP_COMP_SMALLER);
+  count = skippingScan(table, schema, sel, &skipped);
+  ASSERT_EQUALS_INT(100, count, "a < 100");
+  ASSERT_TRUE(skipped >= 30, "a < 100 skips later pages");
+  freeExpr(sel);
+
+  // b < '0100' on the string prefixes
+  MAKE_ATTRREF(left, 1);
+  MAKE_CONS(right, stringToValue("s0100"));
+  MAKE_BINOP_EXPR(sel, left, right, OP_COMP_SMALLER);
+  count = skippingScan(table, schema, sel, &skipped);
+  ASSERT_EQUALS_INT(100, count, "b < '0100'");
+  ASSERT_TRUE(skipped >= 30, "b < '0100' skips later pages");
+  freeExpr(sel);
+
+  // an update widens the range of its page
+  r = testRecord(schema, 99999, "zzzz", 0);
+  r->id = rids[5];
+  TEST_CHECK(updateRecord(table, r));
+  freeRecord(r);
+  MAKE_ATTRREF(left, 0);
+  MAKE_CONS(right, stringToValue("i99999"));
+  MAKE_BINOP_EXPR(sel, left, right, OP_COMP_EQUAL);
+  count = skippingScan(table, schema, sel, &skipped);
+  ASSERT_EQUALS_INT(1, count, "updated record found");
+
+  // so does an insert into a new page
+  r = testRecord(schema, 99999, "yyyy", 1);
+  TEST_CHECK(insertRecord(table, r));
+  freeRecord(r);
+  count = skippingScan(table, schema, sel, &skipped);
+  ASSERT_EQUALS_INT(2, count, "inserted record found");
+  freeExpr(sel);
+
+  // NOT (a < 9900) AND c = 3
+  MAKE_ATTRREF(left, 0);
+  MAKE_CONS(right, stringToValue("i9900"));
+  MAKE_BINOP_EXPR(inner, left, right, OP_COMP_SMALLER);
+  MAKE_UNOP_EXPR(left, inner, OP_BOOL_NOT);
+  MAKE_ATTRREF(inner, 2);
+  MAKE_CONS(right, stringToValue("i3"));
+  MAKE_BINOP_EXPR(isThree, inner, right, OP_COMP_EQUAL);
+  MAKE_BINOP_EXPR(sel, left, isThree, OP_BOOL_AND);
+  count = skippingScan(table, schema, sel, &skipped);
+  ASSERT_EQUALS_INT(countScan(table, schema, sel), count, "negated conjunct");
+  count = skippingScan(table, schema, sel, &skipped);
+  ASSERT_EQUALS_INT(10, count, "NOT (a < 9900) AND c = 3");
+  ASSERT_TRUE(skipped >= 29, "negated conjunct skips earlier pages");
+  freeExpr(sel);
+
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(deleteTable("test_table_z"));
+  TEST_CHECK(shutdownRecordManager());
+
+  free(rids);
+  free(table);
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testIndexes (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  int numInserts = 3000, i, rc, numIds;
+  char b[5];
+  Record *r, *found;
+  RID *rids, *ids;
+  Schema *schema;
+  Value *key;
+  testName = "test secondary indexes";
+  schema = testSchema();
+  rids = (RID *) malloc(sizeof(RID) * numInserts);
+
+  TEST_CHECK(initRecordManager(NULL));
+  TEST_CHECK(createTable("test_table_i", schema));
+  TEST_CHECK(openTable(table, "test_table_i"));
+  TEST_CHECK(createRecord(&found, schema));
+
+  for(i = 0; i < numInserts; i++)
+  {
+    sprintf(b, "%04d", i);
+    r = testRecord(schema, i, b, i % 10);
+    TEST_CHECK(insertRecord(table,r));
+    rids[i] = r->id;
+    freeRecord(r);
+  }
+
+  // a unique index built from the existing records, c has duplicates
+  TEST_CHECK(createIndex(table, 0, RM_INDEX_BTREE, TRUE));
+  rc = createIndex(table, 2, RM_INDEX_BTREE, TRUE);
+  ASSERT_EQUALS_INT(RC_IM_KEY_ALREADY_EXISTS, rc, "unique index on duplicate values fails");
+  TEST_CHECK(createIndex(table, 2, RM_INDEX_BTREE, FALSE));
+  rc = createIndex(table, 2, RM_INDEX_BTREE, FALSE);
+  ASSERT_EQUALS_INT(RC_INVALID_PARAM, rc, "attribute is already indexed");
+
+  // the indexes are reopened with the table
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(openTable(table, "test_table_i"));
+
+  MAKE_VALUE(key, DT_INT, 1234);
+  TEST_CHECK(lookupRecord(table, 0, key, found));
+  ASSERT_TRUE(found->id.page == rids[1234].page && found->id.slot == rids[1234].slot, "lookup finds the record");
+  freeVal(key);
+
+  // inserting an existing key of the unique index fails and leaves the table unchanged
+  r = testRecord(schema, 1234, "dupl", 4);
+  rc = insertRecord(table, r);
+  ASSERT_EQUALS_INT(RC_IM_KEY_ALREADY_EXISTS, rc, "duplicate key rejected");
+  ASSERT_EQUALS_INT(numInserts, getNumTuples(table), "no record inserted");
+  freeRecord(r);
+
+  // deletes and updates are reflected in the indexes
+  TEST_CHECK(deleteRecord(table, rids[1234]));
+  rc = deleteRecord(table, rids[1234]);
+  ASSERT_EQUALS_INT(RC_RM_RECORD_NOT_FOUND, rc, "deleted record cannot be deleted again");
+  MAKE_VALUE(key, DT_INT, 1234);
+  rc = lookupRecord(table, 0, key, found);
+  ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, rc, "deleted key not found");
+  freeVal(key);
+
+  r = testRecord(schema, 1234, "upd1", 3);
+  r->id = rids[5];
+  TEST_CHECK(updateRecord(table, r));
+  freeRecord(r);
+  r = testRecord(schema, 6, "upd2", 3);
+  r->id = rids[7];
+  rc = updateRecord(table, r);
+  ASSERT_EQUALS_INT(RC_IM_KEY_ALREADY_EXISTS, rc, "update to an existing key rejected");
+  freeRecord(r);
+
+  MAKE_VALUE(key, DT_INT, 1234);
+  TEST_CHECK(lookupRecord(table, 0, key, found));
+  ASSERT_TRUE(found->id.page == rids[5].page && found->id.slot == rids[5].slot, "updated key found");
+  freeVal(key);
+  MAKE_VALUE(key, DT_INT, 5);
+  rc = lookupRecord(table, 0, key, found);
+  ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, rc, "old key gone after update");
+  freeVal(key);
+
+  // c = 3 now also matches the updated record
+  MAKE_VALUE(key, DT_INT, 3);
+  TEST_CHECK(lookupRecord(table, 2, key, found));
+  ASSERT_TRUE(found->id.page == rids[3].page && found->id.slot == rids[3].slot, "smallest rid of a duplicate key");
+  freeVal(key);
+  MAKE_STRING_VALUE(key, "3");
+  rc = lookupRecords(table, 2, key, &ids, &numIds);
+  ASSERT_EQUALS_INT(RC_RM_WRONG_DATATYPE, rc, "key type is checked like by the attribute accessors");
+  freeVal(key);
+
+  TEST_CHECK(dropIndex(table, 2));
+  MAKE_VALUE(key, DT_INT, 3);
+  rc = lookupRecord(table, 2, key, found);
+  ASSERT_EQUALS_INT(RC_INVALID_PARAM, rc, "dropped index");
+  freeVal(key);
+
+  freeRecord(found);
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(deleteTable("test_table_i"));
+  ASSERT_TRUE(fopen("test_table_i.idx0", "r") == NULL, "index files deleted with the table");
+  TEST_CHECK(shutdownRecordManager());
+
+  free(rids);
+  free(table);
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testHashIndexes (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  int numInserts = 5000, i, rc;
+  char b[5];
+  Record *r, *found;
+  RID *rids;
+  Schema *schema;
+  Value *key;
+  testName = "test hash indexes on the primary key";
+  schema = testSchema();
+  rids = (RID *) malloc(sizeof(RID) * numInserts);
+
+  TEST_CHECK(initRecordManager(NULL));
+  TEST_CHECK(createTable("test_table_h", schema));
+  TEST_CHECK(openTable(table, "test_table_h"));
+  TEST_CHECK(createRecord(&found, schema));
+
+  // the key index exists before the inserts, the one on b is built afterwards
+  TEST_CHECK(createIndex(table, RM_PRIMARY_KEY, RM_INDEX_HASH, TRUE));
+  for(i = 0; i < numInserts; i++)
+  {
+    sprintf(b, "%04d", i % 100);
+    r = testRecord(schema, i, b, i % 10);
+    TEST_CHECK(insertRecord(table,r));
+    rids[i] = r->id;
+    freeRecord(r);
+  }
+  TEST_CHECK(createIndex(table, 1, RM_INDEX_HASH, FALSE));
+
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(openTable(table, "test_table_h"));
+
+  for(i = 0; i < numInserts; i += 7)
+  {
+    MAKE_VALUE(key, DT_INT, i);
+    TEST_CHECK(lookupRecord(table, RM_PRIMARY_KEY, key, found));
+    if (found->id.page != rids[i].page || found->id.slot != rids[i].slot)
+      ASSERT_TRUE(FALSE, "primary key lookup finds the record");
+    freeVal(key);
+  }
+  MAKE_STRING_VALUE(key, "0042");
+  TEST_CHECK(lookupRecord(table, 1, key, found));
+  ASSERT_TRUE(found->id.page == rids[42].page && found->id.slot == rids[42].slot, "first record with b = '0042'");
+  freeVal(key);
+
+  // duplicate primary keys are rejected, deletes and updates move the entries
+  r = testRecord(schema, 17, "dupl", 0);
+  rc = insertRecord(table, r);
+  ASSERT_EQUALS_INT(RC_IM_KEY_ALREADY_EXISTS, rc, "duplicate primary key rejected");
+  freeRecord(r);
+
+  TEST_CHECK(deleteRecord(table, rids[42]));
+  MAKE_STRING_VALUE(key, "0042");
+  TEST_CHECK(lookupRecord(table, 1, key, found));
+  ASSERT_TRUE(found->id.page != rids[42].page || found->id.slot != rids[42].slot, "deleted record left the index on b");
+  freeVal(key);
+
+  r = testRecord(schema, 30000, "new!", 0);
+  r->id = rids[17];
+  TEST_CHECK(updateRecord(table, r));
+  freeRecord(r);
+  MAKE_VALUE(key, DT_INT, 17);
+  rc = lookupRecord(table, RM_PRIMARY_KEY, key, found);
+  ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, rc, "old primary key gone");
+  freeVal(key);
+  MAKE_VALUE(key, DT_INT, 30000);
+  TEST_CHECK(lookupRecord(table, RM_PRIMARY_KEY, key, found));
+  ASSERT_TRUE(found->id.page == rids[17].page && found->id.slot == rids[17].slot, "new primary key found");
+  freeVal(key);
+
+  MAKE_STRING_VALUE(key, "0017");
+  rc = lookupRecord(table, RM_PRIMARY_KEY, key, found);
+  ASSERT_EQUALS_INT(RC_RM_WRONG_DATATYPE, rc, "key type is checked");
+  freeVal(key);
+
+  freeRecord(found);
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(deleteTable("test_table_h"));
+  ASSERT_TRUE(fopen("test_table_h.idxpk", "r") == NULL, "index files deleted with the table");
+  TEST_CHECK(shutdownRecordManager());
+
+  free(rids);
+  free(table);
+  TEST_DONE();
+}
+
+// ************************************************************
+// scans with cond twice on the same handle, returns the number of matches and the access path
+static int
+pathScan (RM_TableData *table, Schema *schema, Expr *cond, RM_AccessPath *path)
+{
+  RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+  Record *r;
+  Value *res;
+  int rc, round, count[2] = {0, 0};
+
+  createRecord(&r, schema);
+  TEST_CHECK(startScan(table, sc, cond));
+  *path = getScanAccessPath(sc);
+  for(round = 0; round < 2; round++)
+  {
+    while((rc = next(sc, r)) == RC_OK)
+    {
+      evalExpr(r, schema, cond, &res);
+      if (!res->v.boolV)
+        ASSERT_TRUE(FALSE, "scan returned only matching tuples");
+      freeVal(res);
+      count[round]++;
+    }
+    if (rc != RC_RM_NO_MORE_TUPLES)
+      TEST_CHECK(rc);
+  }
+  ASSERT_EQUALS_INT(count[0], count[1], "scan starts over after the last tuple");
+  TEST_CHECK(closeScan(sc));
+
+  freeRecord(r);
+  free(sc);
+  return count[0];
+}
+
+void
+testIndexScans (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  int numInserts = 10000, i, count, seqCount;
+  char b[5];
+  Record *r;
+  Schema *schema;
+  RM_AccessPath path;
+  RM_Transaction *tx;
+  RID deleted, moved;
+  Value *value;
+  Expr *sel, *left, *right, *aEq, *cEq;
+  testName = "test scans choosing an index";
+  schema = testSchema();
+
+  TEST_CHECK(initRecordManager(NULL));
+  TEST_CHECK(createTable("test_table_s", schema));
+  TEST_CHECK(openTable(table, "test_table_s"));
+  for(i = 0; i < numInserts; i++)
+  {
+    sprintf(b, "%04d", i % 1000);
+    r = testRecord(schema, (i * 7) % numInserts, b, i % 10);
+    TEST_CHECK(insertRecord(table,r));
+    freeRecord(r);
+  }
+  TEST_CHECK(createIndex(table, 0, RM_INDEX_BTREE, TRUE));
+  TEST_CHECK(createIndex(table, 2, RM_INDEX_HASH, FALSE));
+
+  // a = 5000 is answered by the b-tree
+  MAKE_ATTRREF(left, 0);
+  MAKE_CONS(right, stringToValue("i5000"));
+  MAKE_BINOP_EXPR(sel, left, right, OP_COMP_EQUAL);
+  count = pathScan(table, schema, sel, &path);
+  ASSERT_EQUALS_INT(1, count, "a = 5000");
+  ASSERT_EQUALS_INT(RM_PATH_INDEX, path, "a = 5000 uses the index");
+
+  // unless the scan is forced to read the pages
+  TEST_CHECK(setAccessPath(table, RM_PATH_SEQUENTIAL));
+  count = pathScan(table, schema, sel, &path);
+  ASSERT_EQUALS_INT(1, count, "a = 5000, sequential");
+  ASSERT_EQUALS_INT(RM_PATH_SEQUENTIAL, path, "forced sequential scan");
+  TEST_CHECK(setAccessPath(table, RM_PATH_AUTO));
+  freeExpr(sel);
+
+  // small ranges use the index, large ones the pages
+  MAKE_ATTRREF(left, 0);
+  MAKE_CONS(right, stringToValue("i3"));
+  MAKE_BINOP_EXPR(sel, left, right, OP_COMP_SMALLER);
+  count = pathScan(table, schema, sel, &path);
+  ASSERT_EQUALS_INT(3, count, "a < 3");
+  ASSERT_EQUALS_INT(RM_PATH_INDEX, path, "a < 3 uses the index");
+  freeExpr(sel);
+
+  MAKE_ATTRREF(left, 0);
+  MAKE_CONS(right, stringToValue("i5000"));
+  MAKE_BINOP_EXPR(sel, right, left, OP_COMP_SMALLER);
+  count = pathScan(table, schema, sel, &path);
+  ASSERT_EQUALS_INT(4999, count, "5000 < a");
+  ASSERT_EQUALS_INT(RM_PATH_SEQUENTIAL, path, "5000 < a reads the pages");
+  TEST_CHECK(setAccessPath(table, RM_PATH_INDEX));
+  count = pathScan(table, schema, sel, &path);
+  ASSERT_EQUALS_INT(4999, count, "5000 < a, forced index");
+  ASSERT_EQUALS_INT(RM_PATH_INDEX, path, "forced index scan");
+  TEST_CHECK(setAccessPath(table, RM_PATH_AUTO));
+  freeExpr(sel);
+
+  // c = 3 matches a tenth of the table: the hash index is only used when forced
+  MAKE_ATTRREF(left, 2);
+  MAKE_CONS(right, stringToValue("i3"));
+  MAKE_BINOP_EXPR(sel, left, right, OP_COMP_EQUAL);
+  seqCount = pathScan(table, schema, sel, &path);
+  ASSERT_EQUALS_INT(1000, seqCount, "c = 3");
+  ASSERT_EQUALS_INT(RM_PATH_SEQUENTIAL, path, "c = 3 reads the pages");
+  TEST_CHECK(setAccessPath(table, RM_PATH_INDEX));
+  count = pathScan(table, schema, sel, &path);
+  ASSERT_EQUALS_INT(seqCount, count, "c = 3 through the hash index");
+  ASSERT_EQUALS_INT(RM_PATH_INDEX, path, "forced hash index scan");
+  TEST_CHECK(setAccessPath(table, RM_PATH_AUTO));
+  freeExpr(sel);
+
+  // a = 21 AND c = 3: the index on a, with c = 3 checked afterwards
+  MAKE_ATTRREF(left, 0);
+  MAKE_CONS(right, stringToValue("i21"));
+  MAKE_BINOP_EXPR(aEq, left, right, OP_COMP_EQUAL);
+  MAKE_ATTRREF(left, 2);
+  MAKE_CONS(right, stringToValue("i3"));
+  MAKE_BINOP_EXPR(cEq, left, right, OP_COMP_EQUAL);
+  MAKE_BINOP_EXPR(sel, aEq, cEq, OP_BOOL_AND);
+  count = pathScan(table, schema, sel, &path);
+  ASSERT_EQUALS_INT(1, count, "a = 21 AND c = 3");
+  ASSERT_EQUALS_INT(RM_PATH_INDEX, path, "conjunct uses the index");
+  freeExpr(sel);
+
+  MAKE_ATTRREF(left, 0);
+  MAKE_CONS(right, stringToValue("i21"));
+  MAKE_BINOP_EXPR(aEq, left, right, OP_COMP_EQUAL);
+  MAKE_ATTRREF(left, 2);
+  MAKE_CONS(right, stringToValue("i4"));
+  MAKE_BINOP_EXPR(cEq, left, right, OP_COMP_EQUAL);
+  MAKE_BINOP_EXPR(sel, aEq, cEq, OP_BOOL_AND);
+  count = pathScan(table, schema, sel, &path);
+  ASSERT_EQUALS_INT(0, count, "residual predicate filters the index match");
+  freeExpr(sel);
+
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(deleteTable("test_table_s"));
+
+  // index entries of records a transaction has not committed yet
+  TEST_CHECK(createTable("test_table_s", schema));
+  TEST_CHECK(openTable(table, "test_table_s"));
+  for(i = 0; i < 200; i++)
+  {
+    r = testRecord(schema, i % 10, "aaaa", i);
+    TEST_CHECK(insertRecord(table,r));
+    if (i == 5)
+      deleted = r->id;
+    if (i == 15)
+      moved = r->id;
+    freeRecord(r);
+  }
+  TEST_CHECK(createIndex(table, 0, RM_INDEX_BTREE, FALSE));
+  TEST_CHECK(beginTransaction(&tx));
+  r = testRecord(schema, 5, "bbbb", 200);
+  TEST_CHECK(insertRecordTx(table, tx, r));
+  freeRecord(r);
+
+  MAKE_ATTRREF(left, 0);
+  MAKE_CONS(right, stringToValue("i5"));
+  MAKE_BINOP_EXPR(sel, left, right, OP_COMP_EQUAL);
+  TEST_CHECK(setAccessPath(table, RM_PATH_SEQUENTIAL));
+  seqCount = pathScan(table, schema, sel, &path);
+  ASSERT_EQUALS_INT(20, seqCount, "uncommitted insert is not scanned");
+  TEST_CHECK(setAccessPath(table, RM_PATH_INDEX));
+  count = pathScan(table, schema, sel, &path);
+  ASSERT_EQUALS_INT(seqCount, count, "index scan skips the uncommitted insert");
+  ASSERT_EQUALS_INT(RM_PATH_INDEX, path, "forced index scan");
+
+  // the committed keys of records deleted or changed by the transaction stay in the index
+  TEST_CHECK(deleteRecordTx(table, tx, deleted));
+  createRecord(&r, schema);
+  MAKE_VALUE(value, DT_INT, 5);
+  TEST_CHECK(lookupRecord(table, 0, value, r));
+  ASSERT_TRUE(r->id.page == deleted.page && r->id.slot == deleted.slot, "lookup finds the uncommitted delete");
+  TEST_CHECK(getRecord(table, moved, r));
+  value->v.intV = 6;
+  TEST_CHECK(setAttr(r, schema, 0, value));
+  TEST_CHECK(updateRecordTx(table, tx, r));
+  TEST_CHECK(getRecord(table, moved, r));
+  ASSERT_EQUALS_INT(5, intAttr(r, schema, 0), "last committed version");
+  TEST_CHECK(setAccessPath(table, RM_PATH_SEQUENTIAL));
+  seqCount = pathScan(table, schema, sel, &path);
+  ASSERT_EQUALS_INT(20, seqCount, "uncommitted delete and update are not scanned");
+  TEST_CHECK(setAccessPath(table, RM_PATH_INDEX));
+  count = pathScan(table, schema, sel, &path);
+  ASSERT_EQUALS_INT(seqCount, count, "index scan returns the last committed keys");
+  freeExpr(sel);
+
+  // a record with an uncommitted key in the same range is returned once
+  MAKE_ATTRREF(left, 0);
+  MAKE_CONS(right, stringToValue("i7"));
+  MAKE_BINOP_EXPR(sel, left, right, OP_COMP_SMALLER);
+  TEST_CHECK(setAccessPath(table, RM_PATH_SEQUENTIAL));
+  seqCount = pathScan(table, schema, sel, &path);
+  ASSERT_EQUALS_INT(140, seqCount, "a < 7, sequential");
+  TEST_CHECK(setAccessPath(table, RM_PATH_INDEX));
+  count = pathScan(table, schema, sel, &path);
+  ASSERT_EQUALS_INT(seqCount, count, "a < 7 through the index");
+  freeExpr(sel);
+  TEST_CHECK(commitTransaction(tx));
+
+  MAKE_ATTRREF(left, 0);
+  MAKE_CONS(right, stringToValue("i5"));
+  MAKE_BINOP_EXPR(sel, left, right, OP_COMP_EQUAL);
+  count = pathScan(table, schema, sel, &path);
+  ASSERT_EQUALS_INT(19, count, "index after the commit");
+  freeExpr(sel);
+
+  // an abort leaves the entries as they were
+  TEST_CHECK(beginTransaction(&tx));
+  TEST_CHECK(getRecord(table, moved, r));
+  value->v.intV = 7;
+  TEST_CHECK(setAttr(r, schema, 0, value));
+  TEST_CHECK(updateRecordTx(table, tx, r));
+  TEST_CHECK(deleteRecordTx(table, tx, moved));
+  TEST_CHECK(abortTransaction(tx));
+  MAKE_ATTRREF(left, 0);
+  MAKE_CONS(right, stringToValue("i6"));
+  MAKE_BINOP_EXPR(sel, left, right, OP_COMP_EQUAL);
+  count = pathScan(table, schema, sel, &path);
+  ASSERT_EQUALS_INT(21, count, "index after the abort");
+  freeExpr(sel);
+  MAKE_ATTRREF(left, 0);
+  MAKE_CONS(right, stringToValue("i7"));
+  MAKE_BINOP_EXPR(sel, left, right, OP_COMP_EQUAL);
+  count = pathScan(table, schema, sel, &path);
+  ASSERT_EQUALS_INT(20, count, "no entry of the aborted key");
+  freeExpr(sel);
+  freeVal(value);
+  freeRecord(r);
+
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(deleteTable("test_table_s"));
+  TEST_CHECK(shutdownRecordManager());
+
+  free(table);
+  TEST_DONE();
+}
+
+// ************************************************************
+// number of pages of a table's page file, the table must be closed
+static int
+tablePages (char *name)
+{
+  SM_FileHandle fh;
+  int pages;
+
+  TEST_CHECK(openPageFile(name, &fh));
+  pages = fh.totalNumPages;
+  TEST_CHECK(closePageFile(&fh));
+  return pages;
+}
+
+void
+testVacuum (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+  int numInserts = 3000, i, rc, count, pagesBefore, pagesAfter, lastPage;
+  char b[5];
+  Record *r, *found;
+  RID *rids;
+  Schema *schema;
+  Value *key;
+  testName = "test vacuuming tables";
+  schema = testSchema();
+  rids = (RID *) malloc(sizeof(RID) * numInserts);
+
+  TEST_CHECK(initRecordManager(NULL));
+  TEST_CHECK(createTable("test_table_v", schema));
+  TEST_CHECK(openTable(table, "test_table_v"));
+  TEST_CHECK(createRecord(&found, schema));
+  TEST_CHECK(createIndex(table, 0, RM_INDEX_BTREE, TRUE));
+  TEST_CHECK(createIndex(table, 1, RM_INDEX_HASH, FALSE));
+  for(i = 0; i < numInserts; i++)
+  {
+    sprintf(b, "%04d", i);
+    r = testRecord(schema, i, b, i % 10);
+    TEST_CHECK(insertRecord(table,r));
+    rids[i] = r->id;
+    freeRecord(r);
+  }
+
+  // keep every fourth record
+  for(i = 0; i < numInserts; i++)
+    if (i % 4 != 0)
+      TEST_CHECK(deleteRecord(table, rids[i]));
+  rc = deleteRecord(table, rids[1]);
+  ASSERT_EQUALS_INT(RC_RM_RECORD_NOT_FOUND, rc, "deleted slot holds no record");
+  TEST_CHECK(closeTable(table));
+  pagesBefore = tablePages("test_table_v");
+  TEST_CHECK(openTable(table, "test_table_v"));
+
+  // records must not move under an open scan
+  TEST_CHECK(startScan(table, sc, NULL));
+  rc = vacuumTable(table);
+  ASSERT_EQUALS_INT(RC_RM_TABLE_IN_USE, rc, "no vacuum during a scan");
+  TEST_CHECK(closeScan(sc));
+
+  TEST_CHECK(vacuumTable(table));
+  ASSERT_EQUALS_INT(numInserts / 4, getNumTuples(table), "vacuum keeps all records");
+  for(i = 0; i < numInserts; i += 4)
+  {
+    MAKE_VALUE(key, DT_INT, i);
+    TEST_CHECK(lookupRecord(table, 0, key, found));
+    freeVal(key);
+    getAttr(found, schema, 2, &key);
+    if (key->v.intV != i % 10)
+      ASSERT_TRUE(FALSE, "moved record found by its key");
+    freeVal(key);
+  }
+  sprintf(b, "%04d", numInserts - 4);
+  MAKE_STRING_VALUE(key, b);
+  TEST_CHECK(lookupRecord(table, 1, key, found));
+  ASSERT_TRUE(found->id.page < rids[numInserts - 4].page, "last record moved to the front");
+  freeVal(key);
+
+  count = 0;
+  TEST_CHECK(startScan(table, sc, NULL));
+  while((rc = next(sc, found)) == RC_OK)
+    count++;
+  ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, rc, "scan ends");
+  ASSERT_EQUALS_INT(numInserts / 4, count, "scan returns the records left");
+  TEST_CHECK(closeScan(sc));
+
+  TEST_CHECK(closeTable(table));
+  pagesAfter = tablePages("test_table_v");
+  ASSERT_TRUE(pagesAfter < pagesBefore, "trailing pages released");
+  TEST_CHECK(openTable(table, "test_table_v"));
+
+  // inserts reuse the free slots of the last page
+  r = testRecord(schema, 1, "0001", 1);
+  TEST_CHECK(insertRecord(table, r));
+  ASSERT_TRUE(r->id.page == pagesAfter - 1, "insert on the last page");
+  freeRecord(r);
+
+  // the background vacuum compacts the table once a page can be released
+  for(i = 0; i < numInserts; i += 4)
+    if (i % 8 != 0)
+    {
+      MAKE_VALUE(key, DT_INT, i);
+      TEST_CHECK(lookupRecord(table, 0, key, found));
+      TEST_CHECK(deleteRecord(table, found->id));
+      freeVal(key);
+    }
+  MAKE_VALUE(key, DT_INT, 1);
+  TEST_CHECK(lookupRecord(table, 0, key, found));
+  lastPage = found->id.page;
+  TEST_CHECK(startVacuumDaemon(table, 10, 1));
+  for(i = 0; i < 200 && found->id.page == lastPage; i++)
+  {
+    usleep(10000);
+    TEST_CHECK(lookupRecord(table, 0, key, found));
+  }
+  ASSERT_TRUE(found->id.page < lastPage, "background vacuum moved the record");
+  freeVal(key);
+  TEST_CHECK(stopVacuumDaemon(table));
+
+  freeRecord(found);
+  TEST_CHECK(closeTable(table));
+  ASSERT_TRUE(tablePages("test_table_v") < pagesAfter, "background vacuum released pages");
+  TEST_CHECK(deleteTable("test_table_v"));
+  TEST_CHECK(shutdownRecordManager());
+
+  free(rids);
+  free(sc);
+  free(table);
+  TEST_DONE();
+}
+
+// ************************************************************
+// inserts numInserts records with keys from base on, from a separate thread
+typedef struct LoggedInserts {
+  RM_TableData *table;
+  Schema *schema;
+  int base;
+  int numInserts;
+} LoggedInserts;
+
+static void *
+insertLogged (void *arg)
+{
+  LoggedInserts *work = (LoggedInserts *) arg;
+  Record *r;
+
+  for(int i = 0; i < work->numInserts; i++)
+  {
+    r = testRecord(work->schema, work->base + i, "logd", (work->base + i) % 10);
+    TEST_CHECK(insertRecord(work->table, r));
+    freeRecord(r);
+  }
+  return NULL;
+}
+
+void
+testLoggedTables (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  RM_TableData *crashed;
+  RM_TableOptions options = { RM_LAYOUT_ROW, TRUE };
+  int numThreads = 4, perThread = 250, numInserts = numThreads * perThread, i, rc, syncs, count;
+  LoggedInserts work[4];
+  pthread_t threads[4];
+  Record *r, *found;
+  Schema *schema;
+  Value *key;
+  testName = "test logged tables";
+  schema = testSchema();
+
+  TEST_CHECK(initRecordManager(NULL));
+  TEST_CHECK(createTableWithOptions("test_table_l", schema, &options));
+  TEST_CHECK(openTable(table, "test_table_l"));
+  TEST_CHECK(createIndex(table, 0, RM_INDEX_BTREE, TRUE));
+  TEST_CHECK(createRecord(&found, schema));
+
+  // every insert is committed, concurrent commits share log syncs
+  for(i = 0; i < numThreads; i++)
+  {
+    work[i].table = table;
+    work[i].schema = schema;
+    work[i].base = i * perThread;
+    work[i].numInserts = perThread;
+    pthread_create(&threads[i], NULL, insertLogged, &work[i]);
+  }
+  for(i = 0; i < numThreads; i++)
+    pthread_join(threads[i], NULL);
+  ASSERT_EQUALS_INT(numInserts, getNumTuples(table), "all inserts done");
+  syncs = getNumLogSyncs(table);
+  ASSERT_TRUE(syncs > 0 && syncs <= numInserts, "commits synced the log");
+
+  // change records, then drop the table handle without closing it
+  for(i = 0; i < numInserts; i += 3)
+  {
+    MAKE_VALUE(key, DT_INT, i);
+    TEST_CHECK(lookupRecord(table, 0, key, found));
+    freeVal(key);
+    if (i % 2 == 0)
+    {
+      TEST_CHECK(deleteRecord(table, found->id));
+    }
+    else
+    {
+      r = testRecord(schema, i, "updt", 7);
+      r->id = found->id;
+      TEST_CHECK(updateRecord(table, r));
+      freeRecord(r);
+    }
+  }
+  crashed = table;
+  table = (RM_TableData *) malloc(sizeof(RM_TableData));
+
+  // reopening redoes the logged changes and rebuilds the index
+  TEST_CHECK(openTable(table, "test_table_l"));
+  ASSERT_EQUALS_INT(numInserts - (numInserts + 5) / 6, getNumTuples(table), "tuple count recovered");
+  count = 0;
+  for(i = 0; i < numInserts; i++)
+  {
+    MAKE_VALUE(key, DT_INT, i);
+    rc = lookupRecord(table, 0, key, found);
+    freeVal(key);
+    if (i % 6 == 0)
+    {
+      if (rc != RC_IM_KEY_NOT_FOUND)
+        ASSERT_TRUE(FALSE, "deleted record stays deleted");
+      continue;
+    }
+    TEST_CHECK(rc);
+    getAttr(found, schema, 2, &key);
+    if (key->v.intV != ((i % 3 == 0) ? 7 : i % 10))
+      ASSERT_TRUE(FALSE, "record recovered with its last update");
+    freeVal(key);
+    count++;
+  }
+  ASSERT_EQUALS_INT(numInserts - (numInserts + 5) / 6, count, "records found by key");
+
+  // after a clean close the log is empty
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(openTable(table, "test_table_l"));
+  ASSERT_EQUALS_INT(count, getNumTuples(table), "tuple count kept");
+  TEST_CHECK(closeTable(table));
+
+  freeRecord(found);
+  TEST_CHECK(deleteTable("test_table_l"));
+  ASSERT_TRUE(fopen("test_table_l.wal", "r") == NULL, "log deleted with the table");
+  TEST_CHECK(shutdownRecordManager());
+
+  free(crashed);
+  free(table);
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testCheckpoints (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  RM_TableData *crashed;
+  RM_TableOptions options = { RM_LAYOUT_ROW, TRUE };
+  int numThreads = 4, perThread = 250, numInserts = numThreads * perThread, numMore = 50, i;
+  LoggedInserts work[4];
+  pthread_t threads[4];
+  RID rids[50];
+  Record *r, *found;
+  Schema *schema;
+  testName = "test checkpoints of logged tables";
+  schema = testSchema();
+
+  TEST_CHECK(initRecordManager(NULL));
+  TEST_CHECK(createTableWithOptions("test_table_c", schema, &options));
+  TEST_CHECK(openTable(table, "test_table_c"));
+  TEST_CHECK(createRecord(&found, schema));
+  for(i = 0; i < numThreads; i++)
+  {
+    work[i].table = table;
+    work[i].schema = schema;
+    work[i].base = i * perThread;
+    work[i].numInserts = perThread;
+    pthread_create(&threads[i], NULL, insertLogged, &work[i]);
+  }
+  for(i = 0; i < numThreads; i++)
+    pthread_join(threads[i], NULL);
+
+  // the second checkpoint writes the pages dirty since the first, recovery starts after it
+  TEST_CHECK(checkpointTable(table));
+  TEST_CHECK(checkpointTable(table));
+  for(i = 0; i < numMore; i++)
+  {
+    r = testRecord(schema, numInserts + i, "ckpt", i % 10);
+    TEST_CHECK(insertRecord(table, r));
+    rids[i] = r->id;
+    freeRecord(r);
+  }
+  crashed = table;
+  table = (RM_TableData *) malloc(sizeof(RM_TableData));
+
+  TEST_CHECK(openTable(table, "test_table_c"));
+  ASSERT_EQUALS_INT(numMore + 1, getNumRecoveredChanges(table), "recovery read the log since the checkpoint");
+  ASSERT_EQUALS_INT(numInserts + numMore, getNumTuples(table), "tuple count recovered");
+  for(i = 0; i < numMore; i++)
+  {
+    TEST_CHECK(getRecord(table, rids[i], found));
+    r = testRecord(schema, numInserts + i, "ckpt", i % 10);
+    if (memcmp(r->data, found->data, getRecordSize(schema)) != 0)
+      ASSERT_TRUE(FALSE, "record after the checkpoint recovered");
+    freeRecord(r);
+  }
+  TEST_CHECK(closeTable(table));
+
+  TEST_CHECK(openTable(table, "test_table_c"));
+  ASSERT_EQUALS_INT(0, getNumRecoveredChanges(table), "nothing to recover after a close");
+  ASSERT_EQUALS_INT(numInserts + numMore, getNumTuples(table), "tuple count kept");
+  TEST_CHECK(closeTable(table));
+
+  freeRecord(found);
+  TEST_CHECK(deleteTable("test_table_c"));
+  TEST_CHECK(shutdownRecordManager());
+
+  free(crashed);
+  free(table);
+  TEST_DONE();
+}
+
+// ************************************************************
+// transactions moving 1 between the c values of two records, or snapshot scans summing them
+typedef struct Transfers {
+  RM_TableData *table;
+  Schema *schema;
+  RID *rids;
+  int numRecords;
+  int numTuples;
+  int rounds;
+  unsigned int seed;
+  int expectedSum;
+  int committed;
+  int badSnapshots;
+} Transfers;
+
+static int
+intAttr (Record *r, Schema *schema, int attrNum)
+{
+  Value *value;
+  int result;
+
+  getAttr(r, schema, attrNum, &value);
+  result = value->v.intV;
+  freeVal(value);
+  return result;
+}
+
+// sums c over the snapshot of tx, setting *count to the number of records
+static int
+snapshotSum (RM_TableData *table, Schema *schema, RM_Transaction *tx, int *count)
+{
+  RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+  Record *r;
+  int sum = 0;
+
+  TEST_CHECK(createRecord(&r, schema));
+  TEST_CHECK(startScanTx(table, tx, sc, NULL));
+  *count = 0;
+  while (next(sc, r) == RC_OK)
+  {
+    sum += intAttr(r, schema, 2);
+    (*count)++;
+  }
+  TEST_CHECK(closeScan(sc));
+  freeRecord(r);
+  free(sc);
+  return sum;
+}
+
+static void
+addToAttr (Record *r, Schema *schema, int attrNum, int delta)
+{
+  Value *value;
+
+  MAKE_VALUE(value, DT_INT, intAttr(r, schema, attrNum) + delta);
+  setAttr(r, schema, attrNum, value);
+  freeVal(value);
+}
+
+static void *
+transfer (void *arg)
+{
+  Transfers *work = (Transfers *) arg;
+  RM_Transaction *tx;
+  Record *from, *to;
+  int rc;
+
+  TEST_CHECK(createRecord(&from, work->schema));
+  TEST_CHECK(createRecord(&to, work->schema));
+  for(int i = 0; i < work->rounds; i++)
+  {
+    int f = rand_r(&work->seed) % work->numRecords, t = (f + 1 + rand_r(&work->seed) % (work->numRecords - 1)) % work->numRecords;
+
+    TEST_CHECK(beginTransaction(&tx));
+    TEST_CHECK(getRecordTx(work->table, tx, work->rids[f], from));
+    TEST_CHECK(getRecordTx(work->table, tx, work->rids[t], to));
+    addToAttr(from, work->schema, 2, -1);
+    addToAttr(to, work->schema, 2, 1);
+    if ((rc = updateRecordTx(work->table, tx, from)) == RC_OK)
+      rc = updateRecordTx(work->table, tx, to);
+    if (rc == RC_OK)
+    {
+      TEST_CHECK(commitTransaction(tx));
+      work->committed++;
+    }
+    else
+    {
+      ASSERT_TRUE(rc == RC_RM_WRITE_CONFLICT || rc == RC_RM_DEADLOCK, "only write conflicts and deadlocks fail");
+      TEST_CHECK(abortTransaction(tx));
+    }
+  }
+  freeRecord(from);
+  freeRecord(to);
+  return NULL;
+}
+
+static void *
+sumSnapshots (void *arg)
+{
+  Transfers *work = (Transfers *) arg;
+  RM_Transaction *tx;
+  int count;
+
+  for(int i = 0; i < work->rounds; i++)
+  {
+    TEST_CHECK(beginTransaction(&tx));
+    if (snapshotSum(work->table, work->schema, tx, &count) != work->expectedSum || count != work->numTuples)
+      work->badSnapshots++;
+    TEST_CHECK(commitTransaction(tx));
+  }
+  return NULL;
+}
+
+void
+testTransactions (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  int numInserts = 100, i, count, total, sum = 0;
+  RM_Transaction *reader, *writer, *late, *aborted;
+  Transfers work[4];
+  pthread_t threads[4];
+  RID rids[100];
+  Record *r, *found;
+  Schema *schema;
+  testName = "test transactions with snapshot reads";
+  schema = testSchema();
+
+  TEST_CHECK(initRecordManager(NULL));
+  TEST_CHECK(createTable("test_table_t", schema));
+  TEST_CHECK(openTable(table, "test_table_t"));
+  TEST_CHECK(createRecord(&found, schema));
+  for(i = 0; i < numInserts; i++)
+  {
+    r = testRecord(schema, i, "tran", i % 10);
+    TEST_CHECK(insertRecord(table, r));
+    rids[i] = r->id;
+    sum += i % 10;
+    freeRecord(r);
+  }
+
+  // a writer's changes are invisible to others until it commits, and to older snapshots after
+  TEST_CHECK(beginTransaction(&reader));
+  TEST_CHECK(beginTransaction(&writer));
+  TEST_CHECK(beginTransaction(&late));
+  for(i = 0; i < 10; i++)
+  {
+    r = testRecord(schema, i, "tran", 99);
+    r->id = rids[i];
+    TEST_CHECK(updateRecordTx(table, writer, r));
+    freeRecord(r);
+    TEST_CHECK(deleteRecordTx(table, writer, rids[10 + i]));
+  }
+  r = testRecord(schema, numInserts, "tran", 99);
+  TEST_CHECK(insertRecordTx(table, writer, r));
+  freeRecord(r);
+  TEST_CHECK(getRecord(table, rids[0], found));
+  ASSERT_EQUALS_INT(0, intAttr(found, schema, 2), "uncommitted update not seen");
+  TEST_CHECK(getRecordTx(table, writer, rids[0], found));
+  ASSERT_EQUALS_INT(99, intAttr(found, schema, 2), "own update seen");
+  ASSERT_EQUALS_INT(sum - 45 + 10 * 99 - 45 + 99, snapshotSum(table, schema, writer, &count), "own snapshot");
+  ASSERT_EQUALS_INT(numInserts - 10 + 1, count, "own changes in own scan");
+  TEST_CHECK(commitTransaction(writer));
+
+  ASSERT_EQUALS_INT(sum, snapshotSum(table, schema, reader, &count), "old snapshot keeps its values");
+  ASSERT_EQUALS_INT(numInserts, count, "old snapshot keeps deleted records");
+  TEST_CHECK(getRecordTx(table, reader, rids[10], found));
+  ASSERT_TRUE(getRecord(table, rids[10], found) != RC_OK, "delete committed");
+  TEST_CHECK(getRecord(table, rids[0], found));
+  ASSERT_EQUALS_INT(99, intAttr(found, schema, 2), "update committed");
+  ASSERT_EQUALS_INT(numInserts - 10 + 1, getNumTuples(table), "tuple count after commit");
+
+  // first writer wins against snapshots that do not see its change
+  r = testRecord(schema, 0, "tran", 5);
+  r->id = rids[0];
+  ASSERT_EQUALS_INT(RC_RM_WRITE_CONFLICT, updateRecordTx(table, late, r), "write conflict");
+  freeRecord(r);
+  TEST_CHECK(abortTransaction(late));
+
+  // aborting restores records and index entries
+  TEST_CHECK(beginTransaction(&aborted));
+  r = testRecord(schema, 50, "tran", 77);
+  r->id = rids[50];
+  TEST_CHECK(updateRecordTx(table, aborted, r));
+  freeRecord(r);
+  TEST_CHECK(deleteRecordTx(table, aborted, rids[51]));
+  r = testRecord(schema, numInserts + 1, "tran", 77);
+  TEST_CHECK(insertRecordTx(table, aborted, r));
+  freeRecord(r);
+  TEST_CHECK(abortTransaction(aborted));
+  TEST_CHECK(getRecord(table, rids[50], found));
+  ASSERT_EQUALS_INT(0, intAttr(found, schema, 2), "aborted update undone");
+  TEST_CHECK(getRecord(table, rids[51], found));
+  ASSERT_EQUALS_INT(numInserts - 10 + 1, getNumTuples(table), "tuple count after abort");
+
+  TEST_CHECK(commitTransaction(reader));
+  ASSERT_EQUALS_INT(0, getNumRecordVersions(table), "versions collected");
+
+  // snapshot scans see a constant sum while transfers commit concurrently
+  count = 0;
+  for(i = 0; i < numInserts; i++)
+    if (getRecord(table, rids[i], found) == RC_OK)
+      rids[count++] = rids[i];
+  sum = snapshotSum(table, schema, NULL, &total);
+  for(i = 0; i < 4; i++)
+  {
+    work[i].table = table;
+    work[i].schema = schema;
+    work[i].rids = rids;
+    work[i].numRecords = count;
+    work[i].numTuples = total;
+    work[i].rounds = (i < 2) ? 300 : 30;
+    work[i].seed = i + 1;
+    work[i].expectedSum = sum;
+    work[i].committed = 0;
+    work[i].badSnapshots = 0;
+    pthread_create(&threads[i], NULL, (i < 2) ? transfer : sumSnapshots, &work[i]);
+  }
+  for(i = 0; i < 4; i++)
+    pthread_join(threads[i], NULL);
+  ASSERT_TRUE(work[0].committed + work[1].committed > 0, "transfers committed");
+  ASSERT_EQUALS_INT(0, work[2].badSnapshots + work[3].badSnapshots, "snapshots consistent");
+  ASSERT_EQUALS_INT(sum, snapshotSum(table, schema, NULL, &count), "sum kept");
+  ASSERT_EQUALS_INT(0, getNumRecordVersions(table), "versions collected after the transfers");
+
+  freeRecord(found);
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(deleteTable("test_table_t"));
+  TEST_CHECK(shutdownRecordManager());
+  free(table);
+  TEST_DONE();
+}
+
+Schema *
+testSchema (void)
+{
+  Schema *result;
+  char *names[] = { "a", "b", "c" };
+  DataType dt[] = { DT_INT, DT_STRING, DT_INT };
+  int sizes[] = { 0, 4, 0 };
+  int keys[] = {0};
+  int i;
+  char **cpNames = (char **) malloc(sizeof(char*) * 3);
+  DataType *cpDt = (DataType *) malloc(sizeof(DataType) * 3);
+  int *cpSizes = (int *) malloc(sizeof(int) * 3);
+  int *cpKeys = (int *) malloc(sizeof(int));
+
+  for(i = 0; i < 3; i++)
+  {
+    cpNames[i] = (char *) malloc(2);
+    strcpy(cpNames[i], names[i]);
+  }
+  memcpy(cpDt, dt, sizeof(DataType) * 3);
+  memcpy(cpSizes, sizes, sizeof(int) * 3);
+  memcpy(cpKeys, keys, sizeof(int));
+
+  result = createSchema(3, cpNames, cpDt, cpSizes, 1, cpKeys);
+
+  return result;
+}
+
+Record *
+fromTestRecord (Schema *schema, TestRecord in)
+{
+  return testRecord(schema, in.a, in.b, in.c);
+}
+
+// ************************************************************
+typedef struct LockedWrite {
+  RM_TableData *table;
+  Schema *schema;
+  RM_Transaction *tx;
+  RID rid;
+  int key;
+  int value;
+  int rc;
+} LockedWrite;
+
+static void *
+writeLocked (void *arg)
+{
+  LockedWrite *w = (LockedWrite *) arg;
+  Record *r = testRecord(w->schema, w->key, "lock", w->value);
+
+  r->id = w->rid;
+  w->rc = updateRecordTx(w->table, w->tx, r);
+  freeRecord(r);
+  return NULL;
+}
+
+typedef struct DisjointWrites {
+  RM_TableData *table;
+  Schema *schema;
+  RID *rids;
+  int rounds;
+  int committed;
+} DisjointWrites;
+
+static void *
+writeDisjoint (void *arg)
+{
+  DisjointWrites *work = (DisjointWrites *) arg;
+  RM_Transaction *tx;
+  Record *r;
+
+  TEST_CHECK(createRecord(&r, work->schema));
+  for(int i = 0; i < work->rounds; i++)
+  {
+    int rc = RC_OK;
+
+    TEST_CHECK(beginTransaction(&tx));
+    for(int j = 0; j < 5 && rc == RC_OK; j++)
+    {
+      TEST_CHECK(getRecordTx(work->table, tx, work->rids[j], r));
+      addToAttr(r, work->schema, 2, 1);
+      rc = updateRecordTx(work->table, tx, r);
+    }
+    if (rc == RC_OK)
+    {
+      TEST_CHECK(commitTransaction(tx));
+      work->committed++;
+    }
+    else
+    {
+      TEST_CHECK(abortTransaction(tx));
+    }
+  }
+  freeRecord(r);
+  return NULL;
+}
+
+void
+testLocks (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  int numInserts = 40, i, count, sum;
+  RM_Transaction *t1, *t2;
+  DisjointWrites work[4];
+  LockedWrite waiting;
+  pthread_t threads[4];
+  RID rids[40];
+  Record *r, *found;
+  Schema *schema;
+  testName = "test record locks and deadlock detection";
+  schema = testSchema();
+
+  TEST_CHECK(initRecordManager(NULL));
+  TEST_CHECK(createTable("test_table_l", schema));
+  TEST_CHECK(openTable(table, "test_table_l"));
+  TEST_CHECK(createRecord(&found, schema));
+  for(i = 0; i < numInserts; i++)
+  {
+    r = testRecord(schema, i, "lock", 0);
+    TEST_CHECK(insertRecord(table, r));
+    rids[i] = r->id;
+    freeRecord(r);
+  }
+  waiting.table = table;
+  waiting.schema = schema;
+
+  // a writer waits for the record lock of an uncommitted change instead of failing
+  TEST_CHECK(beginTransaction(&t1));
+  TEST_CHECK(beginTransaction(&t2));
+  r = testRecord(schema, 0, "lock", 1);
+  r->id = rids[0];
+  TEST_CHECK(updateRecordTx(table, t1, r));
+  freeRecord(r);
+  waiting.tx = t2;
+  waiting.rid = rids[0];
+  waiting.key = 0;
+  waiting.value = 2;
+  pthread_create(&threads[0], NULL, writeLocked, &waiting);
+  usleep(50000);
+  TEST_CHECK(abortTransaction(t1));
+  pthread_join(threads[0], NULL);
+  ASSERT_EQUALS_INT(RC_OK, waiting.rc, "waiting writer proceeds after abort");
+  TEST_CHECK(commitTransaction(t2));
+  TEST_CHECK(getRecord(table, rids[0], found));
+  ASSERT_EQUALS_INT(2, intAttr(found, schema, 2), "waiting write committed");
+
+  // two writers locking each other's records: the one closing the cycle fails
+  TEST_CHECK(beginTransaction(&t1));
+  TEST_CHECK(beginTransaction(&t2));
+  r = testRecord(schema, 1, "lock", 1);
+  r->id = rids[1];
+  TEST_CHECK(updateRecordTx(table, t1, r));
+  freeRecord(r);
+  r = testRecord(schema, 2, "lock", 2);
+  r->id = rids[2];
+  TEST_CHECK(updateRecordTx(table, t2, r));
+  freeRecord(r);
+  waiting.tx = t1;
+  waiting.rid = rids[2];
+  waiting.key = 2;
+  waiting.value = 1;
+  pthread_create(&threads[0], NULL, writeLocked, &waiting);
+  usleep(50000);
+  r = testRecord(schema, 1, "lock", 2);
+  r->id = rids[1];
+  ASSERT_EQUALS_INT(RC_RM_DEADLOCK, updateRecordTx(table, t2, r), "deadlock detected");
+  freeRecord(r);
+  TEST_CHECK(abortTransaction(t2));
+  pthread_join(threads[0], NULL);
+  ASSERT_EQUALS_INT(RC_OK, waiting.rc, "survivor proceeds");
+  TEST_CHECK(commitTransaction(t1));
+  TEST_CHECK(getRecord(table, rids[2], found));
+  ASSERT_EQUALS_INT(1, intAttr(found, schema, 2), "survivor's write committed");
+
+  // with a timeout, waits end without deadlock detection; table locks block writers
+  setLockTimeout(50);
+  TEST_CHECK(beginTransaction(&t1));
+  TEST_CHECK(beginTransaction(&t2));
+  r = testRecord(schema, 3, "lock", 1);
+  r->id = rids[3];
+  TEST_CHECK(updateRecordTx(table, t1, r));
+  r->id = rids[3];
+  ASSERT_EQUALS_INT(RC_RM_LOCK_TIMEOUT, updateRecordTx(table, t2, r), "lock wait timed out");
+  ASSERT_EQUALS_INT(RC_RM_LOCK_TIMEOUT, lockTableTx(table, t2, TRUE), "exclusive table lock waits for writers");
+  TEST_CHECK(abortTransaction(t1));
+  TEST_CHECK(lockTableTx(table, t2, FALSE));
+  r->id = rids[4];
+  ASSERT_EQUALS_INT(RC_RM_LOCK_TIMEOUT, updateRecord(table, r), "shared table lock blocks writers");
+  freeRecord(r);
+  TEST_CHECK(abortTransaction(t2));
+  setLockTimeout(0);
+
+  // writers of different records do not fail each other
+  for(i = 0; i < 4; i++)
+  {
+    work[i].table = table;
+    work[i].schema = schema;
+    work[i].rids = rids + 10 * i;
+    work[i].rounds = 50;
+    work[i].committed = 0;
+    pthread_create(&threads[i], NULL, writeDisjoint, &work[i]);
+  }
+  for(i = 0; i < 4; i++)
+    pthread_join(threads[i], NULL);
+  for(i = 0, count = 0; i < 4; i++)
+    count += work[i].committed;
+  ASSERT_EQUALS_INT(4 * 50, count, "all disjoint writers committed");
+  for(i = 0, sum = 0; i < numInserts; i++)
+  {
+    TEST_CHECK(getRecord(table, rids[i], found));
+    sum += intAttr(found, schema, 2);
+  }
+  ASSERT_EQUALS_INT(2 + 1 + 1 + 4 * 50 * 5, sum, "disjoint writes kept");
+
+  freeRecord(found);
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(deleteTable("test_table_l"));
+  TEST_CHECK(shutdownRecordManager());
+  free(table);
+  TEST_DONE();
+}
+
+// ************************************************************
+static bool
+catalogHasTable (char *name)
+{
+  char **names;
+  int numTables, i;
+  bool found = FALSE;
+
+  TEST_CHECK(listTables(&names, &numTables));
+  for(i = 0; i < numTables; i++)
+  {
+    found |= (strcmp(names[i], name) == 0);
+    free(names[i]);
+  }
+  free(names);
+  return found;
+}
+
+void
+testCatalog (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  int numAttr = 200, numInserts = 100, numIndexes, i;
+  char **names = (char **) malloc(numAttr * sizeof(char *));
+  DataType *dataTypes = (DataType *) malloc(numAttr * sizeof(DataType));
+  int *typeLength = (int *) malloc(numAttr * sizeof(int));
+  int *keys = (int *) malloc(sizeof(int));
+  RM_IndexInfo *indexes;
+  RM_TableStats stats;
+  Schema *wide, *schema, *stored;
+  Record *r;
+  testName = "test catalog with cached schemas";
+  schema = testSchema();
+
+  // a schema whose column entries fill several catalog pages
+  for(i = 0; i < numAttr; i++)
+  {
+    names[i] = (char *) malloc(40);
+    sprintf(names[i], "a_column_name_longer_than_twenty_%03d", i);
+    dataTypes[i] = DT_INT;
+    typeLength[i] = 0;
+  }
+  keys[0] = 0;
+  wide = createSchema(numAttr, names, dataTypes, typeLength, 1, keys);
+
+  TEST_CHECK(initRecordManager(NULL));
+  TEST_CHECK(createTable("test_table_k", schema));
+  TEST_CHECK(createTable("test_table_w", wide));
+  ASSERT_TRUE(catalogHasTable("test_table_k") && catalogHasTable("test_table_w"), "tables listed");
+
+  // indexes and statistics are entries of the catalog
+  TEST_CHECK(openTable(table, "test_table_k"));
+  for(i = 0; i < numInserts; i++)
+  {
+    r = testRecord(schema, i, "catl", i % 10);
+    TEST_CHECK(insertRecord(table, r));
+    freeRecord(r);
+  }
+  TEST_CHECK(createIndex(table, 0, RM_INDEX_BTREE, TRUE));
+  TEST_CHECK(getTableIndexes("test_table_k", &indexes, &numIndexes));
+  ASSERT_EQUALS_INT(1, numIndexes, "index listed");
+  ASSERT_TRUE(indexes[0].attrNum == 0 && indexes[0].type == RM_INDEX_BTREE && indexes[0].unique, "index entry");
+  free(indexes);
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(getTableStats("test_table_k", &stats));
+  ASSERT_EQUALS_INT(numInserts, stats.numTuples, "tuple count in the statistics");
+  ASSERT_TRUE(stats.numPages >= 1, "pages in the statistics");
+
+  // the cached entry opens the table without reading a page
+  TEST_CHECK(openTable(table, "test_table_k"));
+  ASSERT_EQUALS_INT(0, getNumPageReads(table), "open from the catalog cache reads no page");
+  ASSERT_EQUALS_INT(numInserts, getNumTuples(table), "tuple count from the cache");
+  TEST_CHECK(closeTable(table));
+
+  // after a restart the catalog file holds everything, wide schema included
+  TEST_CHECK(shutdownRecordManager());
+  TEST_CHECK(initRecordManager(NULL));
+  TEST_CHECK(getTableSchema("test_table_w", &stored));
+  ASSERT_EQUALS_INT(numAttr, stored->numAttr, "wide schema stored");
+  ASSERT_TRUE(strcmp(stored->attrNames[numAttr - 1], names[numAttr - 1]) == 0, "long names kept");
+  ASSERT_EQUALS_INT(getRecordSize(wide), getRecordSize(stored), "record size of the wide schema");
+  freeSchema(stored);
+  TEST_CHECK(openTable(table, "test_table_k"));
+  ASSERT_TRUE(getNumPageReads(table) > 0, "counts read from the metadata page after a restart");
+  ASSERT_EQUALS_INT(numInserts, getNumTuples(table), "tuple count kept");
+  TEST_CHECK(dropIndex(table, 0));
+  TEST_CHECK(getTableIndexes("test_table_k", &indexes, &numIndexes));
+  ASSERT_EQUALS_INT(0, numIndexes, "dropped index removed");
+  free(indexes);
+  TEST_CHECK(closeTable(table));
+
+  TEST_CHECK(deleteTable("test_table_k"));
+  TEST_CHECK(deleteTable("test_table_w"));
+  ASSERT_TRUE(!catalogHasTable("test_table_k"), "deleted table removed");
+  ASSERT_EQUALS_INT(RC_RM_UNKNOWN_TABLE, openTable(table, "test_table_k"), "deleted table cannot be opened");
+  TEST_CHECK(shutdownRecordManager());
+
+  freeSchema(wide);
+  free(table);
+  TEST_DONE();
+}
+
+/* Waits up to two seconds for the handle cache to hold a number of tables */
+static bool
+cachedTablesReach (int count)
+{
+  for (int i = 0; i < 200 && getNumCachedTables() != count; i++)
+    usleep(10000);
+  return getNumCachedTables() == count;
+}
+
+void
+testTableCache (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  RM_TableData *other = (RM_TableData *) malloc(sizeof(RM_TableData));
+  int numInserts = 200, reads, i;
+  Schema *schema;
+  Record *r;
+  RID *rids = (RID *) malloc(numInserts * sizeof(RID));
+  testName = "test table handle cache";
+  schema = testSchema();
+
+  TEST_CHECK(initRecordManager(NULL));
+  TEST_CHECK(createTable("test_table_h1", schema));
+  TEST_CHECK(createTable("test_table_h2", schema));
+  TEST_CHECK(createTable("test_table_h3", schema));
+  TEST_CHECK(setTableCache(1, 0));
+  ASSERT_EQUALS_INT(RC_INVALID_PARAM, setTableCache(-1, 0), "negative limit rejected");
+
+  TEST_CHECK(openTable(table, "test_table_h1"));
+  for(i = 0; i < numInserts; i++)
+  {
+    r = testRecord(schema, i, "hot", i);
+    TEST_CHECK(insertRecord(table, r));
+    rids[i] = r->id;
+    freeRecord(r);
+  }
+  Schema *opened = table->schema;
+  TEST_CHECK(closeTable(table));
+  ASSERT_EQUALS_INT(1, getNumCachedTables(), "closed table stays idle in the cache");
+
+  // reopening returns the cached table with its pages and schema
+  TEST_CHECK(openTable(table, "test_table_h1"));
+  ASSERT_TRUE(table->schema == opened, "schema shared with the cached table");
+  reads = getNumPageReads(table);
+  TEST_CHECK(createRecord(&r, schema));
+  TEST_CHECK(getRecord(table, rids[numInserts - 1], r));
+  ASSERT_EQUALS_INT(reads, getNumPageReads(table), "pages still in the buffer pool");
+
+  // two handles share the table, which cannot be deleted while open
+  TEST_CHECK(openTable(other, "test_table_h1"));
+  ASSERT_TRUE(other->mgmtData == table->mgmtData, "handles share the table");
+  TEST_CHECK(getRecord(other, rids[0], r));
+  ASSERT_EQUALS_INT(numInserts, getNumTuples(other), "tuples seen through the second handle");
+  ASSERT_EQUALS_INT(RC_RM_TABLE_IN_USE, deleteTable("test_table_h1"), "open table not deleted");
+  TEST_CHECK(closeTable(other));
+  TEST_CHECK(getRecord(table, rids[1], r));
+  TEST_CHECK(closeTable(table));
+  freeRecord(r);
+
+  // beyond the limit the least recently used idle table is closed in the background
+  TEST_CHECK(openTable(table, "test_table_h2"));
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(openTable(table, "test_table_h3"));
+  TEST_CHECK(closeTable(table));
+  ASSERT_TRUE(cachedTablesReach(1), "idle tables beyond the limit closed");
+
+  // and tables idle for too long are closed as well
+  TEST_CHECK(setTableCache(2, 50));
+  TEST_CHECK(openTable(table, "test_table_h2"));
+  TEST_CHECK(closeTable(table));
+  ASSERT_TRUE(cachedTablesReach(0), "idle tables closed after the timeout");
+
+  // the idle table closed first is the least recently used one, not the first opened
+  TEST_CHECK(setTableCache(2, 0));
+  TEST_CHECK(createRecord(&r, schema));
+  TEST_CHECK(openTable(table, "test_table_h1"));
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(openTable(table, "test_table_h2"));
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(openTable(table, "test_table_h1"));
+  TEST_CHECK(getRecord(table, rids[0], r));
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(openTable(table, "test_table_h3"));
+  TEST_CHECK(closeTable(table));
+  ASSERT_TRUE(cachedTablesReach(2), "one idle table beyond the limit closed");
+  TEST_CHECK(openTable(table, "test_table_h1"));
+  reads = getNumPageReads(table);
+  TEST_CHECK(getRecord(table, rids[0], r));
+  ASSERT_EQUALS_INT(reads, getNumPageReads(table), "recently used table still cached");
+  TEST_CHECK(closeTable(table));
+  freeRecord(r);
+
+  // what was written through the cache is on disk after a restart
+  TEST_CHECK(setTableCache(4, 0));
+  TEST_CHECK(openTable(table, "test_table_h1"));
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(shutdownRecordManager());
+  ASSERT_EQUALS_INT(0, getNumCachedTables(), "shutdown closes the idle tables");
+  TEST_CHECK(initRecordManager(NULL));
+  TEST_CHECK(openTable(table, "test_table_h1"));
+  ASSERT_EQUALS_INT(numInserts, getNumTuples(table), "tuples kept");
+  TEST_CHECK(createRecord(&r, schema));
+  TEST_CHECK(getRecord(table, rids[numInserts - 1], r));
+  ASSERT_EQUALS_INT(numInserts - 1, *(int *) r->data, "record kept");
+  freeRecord(r);
+  TEST_CHECK(closeTable(table));
+
+  TEST_CHECK(deleteTable("test_table_h1"));
+  TEST_CHECK(deleteTable("test_table_h2"));
+  TEST_CHECK(deleteTable("test_table_h3"));
+  TEST_CHECK(shutdownRecordManager());
+
+  free(rids);
+  free(other);
+  free(table);
+  TEST_DONE();
+}
+
+/* Page replaced when page 4 is read after pages 1, 2, 3 and 1 again were pinned into 3 frames */
+static PageNumber
+replacedPage (ReplacementStrategy strategy)
+{
+  BM_BufferPool pool;
+  BM_PageHandle page;
+  PageNumber pages[] = { 1, 2, 3, 1, 4 }, *frames, replaced = NO_PAGE;
+  bool seen[5] = { FALSE };
+
+  TEST_CHECK(initBufferPool(&pool, "test_table_bp", 3, strategy, NULL));
+  for (int i = 0; i < 5; i++)
+  {
+    TEST_CHECK(pinPage(&pool, &page, pages[i]));
+    TEST_CHECK(unpinPage(&pool, &page));
+  }
+  frames = getFrameContents(&pool);
+  for (int i = 0; i < 3; i++)
+    seen[frames[i]] = TRUE;
+  for (PageNumber p = 1; p <= 3; p++)
+    if (!seen[p])
+      replaced = p;
+  TEST_CHECK(shutdownBufferPool(&pool));
+  return replaced;
+}
+
+void
+testPoolOptions (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  RM_TableData *other = (RM_TableData *) malloc(sizeof(RM_TableData));
+  RM_TableOptions options = { RM_LAYOUT_ROW, FALSE, { RM_POOL_AUTO, RS_CLOCK, 0 } };
+  RM_PoolOptions pool, lruK = { 3, RS_LRU_K, 0 }, fifo = { 5, RS_FIFO, 0 }, invalid = { 2, 9, 0 };
+  RM_TableStats stats;
+  RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+  int numInserts = 2000, count = 0, i;
+  Schema *schema;
+  Record *r;
+  testName = "test buffer pool options";
+  schema = testSchema();
+
+  // each strategy picks its own victim
+  TEST_CHECK(createPageFile("test_table_bp"));
+  ASSERT_EQUALS_INT(2, replacedPage(RS_LRU), "LRU replaces the least recently used page");
+  ASSERT_EQUALS_INT(1, replacedPage(RS_FIFO), "FIFO replaces the first page read");
+  ASSERT_EQUALS_INT(1, replacedPage(RS_CLOCK), "CLOCK replaces the page under the hand after a full turn");
+  ASSERT_EQUALS_INT(2, replacedPage(RS_LFU), "LFU replaces a page pinned once");
+  ASSERT_EQUALS_INT(2, replacedPage(RS_LRU_K), "LRU-2 replaces a page without a second pin");
+  TEST_CHECK(destroyPageFile("test_table_bp"));
+
+  TEST_CHECK(initRecordManager(NULL));
+  TEST_CHECK(createTableWithOptions("test_table_p", schema, &options));
+  TEST_CHECK(createTable("test_table_q", schema));
+  ASSERT_EQUALS_INT(RC_INVALID_PARAM, openTableWithOptions(table, "test_table_p", &invalid), "unknown strategy rejected");
+
+  // an automatic pool grows with the table
+  TEST_CHECK(openTable(table, "test_table_p"));
+  TEST_CHECK(getPoolOptions(table, &pool));
+  ASSERT_TRUE(pool.numPages == RM_POOL_MIN_PAGES && pool.strategy == RS_CLOCK, "automatic pool of an empty table");
+  for(i = 0; i < numInserts; i++)
+  {
+    r = testRecord(schema, i, "pool", i);
+    TEST_CHECK(insertRecord(table, r));
+    freeRecord(r);
+  }
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(getTableStats("test_table_p", &stats));
+  TEST_CHECK(openTable(table, "test_table_p"));
+  TEST_CHECK(getPoolOptions(table, &pool));
+  ASSERT_EQUALS_INT(stats.numPages + 1, pool.numPages, "automatic pool holds the whole table");
+  TEST_CHECK(closeTable(table));
+
+  // within the buffer memory left by the other open tables
+  TEST_CHECK(setBufferMemory(12));
+  TEST_CHECK(openTable(other, "test_table_q"));
+  TEST_CHECK(getPoolOptions(other, &pool));
+  ASSERT_TRUE(pool.numPages == 10 && pool.strategy == RS_LRU, "default pool");
+  TEST_CHECK(openTable(table, "test_table_p"));
+  TEST_CHECK(getPoolOptions(table, &pool));
+  ASSERT_EQUALS_INT(RM_POOL_MIN_PAGES, pool.numPages, "automatic pool limited by the buffer memory");
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(closeTable(other));
+  TEST_CHECK(setBufferMemory(RM_BUFFER_MEMORY));
+
+  // options of one open, with a pool smaller than the table
+  TEST_CHECK(openTableWithOptions(table, "test_table_p", &lruK));
+  TEST_CHECK(getPoolOptions(table, &pool));
+  ASSERT_TRUE(pool.numPages == 3 && pool.strategy == RS_LRU_K && pool.strategyParam == 2, "pool of one open");
+  TEST_CHECK(startScan(table, sc, NULL));
+  TEST_CHECK(createRecord(&r, schema));
+  while (next(sc, r) == RC_OK)
+    count++;
+  TEST_CHECK(closeScan(sc));
+  freeRecord(r);
+  ASSERT_EQUALS_INT(numInserts, count, "table scanned through a small pool");
+  TEST_CHECK(closeTable(table));
+
+  // new defaults are kept in the catalog
+  TEST_CHECK(setTablePoolOptions("test_table_p", &fifo));
+  TEST_CHECK(shutdownRecordManager());
+  TEST_CHECK(initRecordManager(NULL));
+  TEST_CHECK(openTable(table, "test_table_p"));
+  TEST_CHECK(getPoolOptions(table, &pool));
+  ASSERT_TRUE(pool.numPages == 5 && pool.strategy == RS_FIFO, "default pool from the catalog");
+  ASSERT_EQUALS_INT(numInserts, getNumTuples(table), "tuples kept");
+  TEST_CHECK(closeTable(table));
+
+  TEST_CHECK(deleteTable("test_table_p"));
+  TEST_CHECK(deleteTable("test_table_q"));
+  TEST_CHECK(shutdownRecordManager());
+
+  free(sc);
+  free(other);
+  free(table);
+  TEST_DONE();
+}
+
+/* a = 0 OR a = 2 OR ... OR a = 2 * (n - 1), too large to compile */
+static Expr *
+manyEqualities (int n)
+{
+  Expr *cond = NULL, *eq, *left, *right, *or;
+  Value *c;
+
+  for (int i = 0; i < n; i++)
+  {
+    MAKE_VALUE(c, DT_INT, 2 * i);
+    MAKE_CONS(right, c);
+    MAKE_ATTRREF(left, 0);
+    MAKE_BINOP_EXPR(eq, left, right, OP_COMP_EQUAL);
+    if (cond == NULL)
+      cond = eq;
+    else
+    {
+      MAKE_BINOP_EXPR(or, cond, eq, OP_BOOL_OR);
+      cond = or;
+    }
+  }
+  return cond;
+}
+
+void
+testArena (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+  RM_Arena *arena = createArena(256), *scanArena;
+  int numInserts = 300, numTerms = 40, count = 0, i;
+  Record **kept = (Record **) malloc(numInserts * sizeof(Record *));
+  Value **names = (Value **) malloc(numInserts * sizeof(Value *));
+  ArenaMark mark;
+  Schema *schema;
+  Record *r;
+  Value *v;
+  Expr *cond;
+  char *first, *p;
+  testName = "test arena allocation";
+  schema = testSchema();
+
+  // allocations are aligned, reuse their blocks after a reset and may exceed a block
+  first = (char *) arenaAlloc(arena, 3);
+  p = (char *) arenaAlloc(arena, 5);
+  ASSERT_TRUE(((size_t) p) % 16 == 0, "allocations aligned");
+  for (i = 0; i < 100; i++)
+    arenaAlloc(arena, 40);
+  ASSERT_TRUE(arenaAlloc(arena, 4000) != NULL, "allocation larger than a block");
+  mark = arenaMark(arena);
+  strcpy(arenaAlloc(arena, 8), "later");
+  arenaRelease(arena, mark);
+  ASSERT_EQUALS_INT((int) arenaBytesUsed(arena), (int) mark.bytesUsed, "allocations after the mark released");
+  arenaReset(arena);
+  ASSERT_EQUALS_INT(0, (int) arenaBytesUsed(arena), "reset releases everything");
+  ASSERT_TRUE(arenaAlloc(arena, 3) == first, "first block reused after a reset");
+  ASSERT_TRUE(strcmp(arenaStrndup(arena, "abcdef", 3), "abc") == 0, "bounded string copy");
+  arenaReset(arena);
+
+  TEST_CHECK(initRecordManager(NULL));
+  TEST_CHECK(createTable("test_table_a", schema));
+  TEST_CHECK(openTable(table, "test_table_a"));
+  for(i = 0; i < numInserts; i++)
+  {
+    TEST_CHECK(createRecordIn(arena, &r, schema));
+    MAKE_VALUE(v, DT_INT, i);
+    TEST_CHECK(setAttr(r, schema, 0, v));
+    freeVal(v);
+    MAKE_STRING_VALUE(v, "aren");
+    TEST_CHECK(setAttr(r, schema, 1, v));
+    freeVal(v);
+    MAKE_VALUE(v, DT_INT, i % 7);
+    TEST_CHECK(setAttr(r, schema, 2, v));
+    freeVal(v);
+    TEST_CHECK(insertRecord(table, r));
+  }
+  arenaReset(arena);
+
+  // a condition evaluated value by value draws its temporaries from the scan's arena
+  cond = manyEqualities(numTerms);
+  TEST_CHECK(evalExprIn(arena, r, schema, cond, &v));
+  ASSERT_TRUE(v->dt == DT_BOOL, "condition evaluated in the arena");
+  arenaReset(arena);
+  TEST_CHECK(startScan(table, sc, cond));
+  scanArena = getScanArena(sc);
+  TEST_CHECK(createRecordIn(scanArena, &r, schema));
+  while (next(sc, r) == RC_OK)
+  {
+    TEST_CHECK(getAttrIn(scanArena, r, schema, 1, &names[count]));
+    TEST_CHECK(createRecordIn(scanArena, &kept[count], schema));
+    memcpy(kept[count]->data, r->data, getRecordSize(schema));
+    count++;
+  }
+  ASSERT_EQUALS_INT(numTerms, count, "records matching the uncompiled condition");
+  for (i = 0; i < count; i++)
+  {
+    TEST_CHECK(getAttrIn(arena, kept[i], schema, 0, &v));
+    ASSERT_TRUE(v->v.intV % 2 == 0 && v->v.intV < 2 * numTerms, "records kept in the scan's arena");
+    ASSERT_TRUE(strcmp(names[i]->v.stringV, "aren") == 0, "strings kept in the scan's arena");
+  }
+  TEST_CHECK(closeScan(sc));
+
+  freeExpr(cond);
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(deleteTable("test_table_a"));
+  TEST_CHECK(shutdownRecordManager());
+
+  freeArena(arena);
+  free(names);
+  free(kept);
+  free(sc);
+  free(table);
+  TEST_DONE();
+}
+
+void
+testAttrAccessors (void)
+{
+  int numRecords = 50, ints[50], i, len, intV;
+  Record *records = (Record *) malloc(numRecords * sizeof(Record));
+  char strings[50 * 5], buf[5];
+  const char *str;
+  float f;
+  Schema *schema;
+  Record *r;
+  Value value;
+  testName = "test attribute accessors without allocation";
+  schema = testSchema();
+
+  for (i = 0; i < numRecords; i++)
+  {
+    r = testRecord(schema, i, (i % 2) ? "ab" : "wxyz", 100 + i);
+    records[i] = *r;
+    free(r);
+  }
+
+  // single attributes into storage of the caller
+  TEST_CHECK(getIntAttr(&records[3], schema, 0, &intV));
+  ASSERT_EQUALS_INT(3, intV, "int attribute");
+  TEST_CHECK(getStringAttr(&records[3], schema, 1, &str, &len));
+  ASSERT_TRUE(len == 2 && strncmp(str, "ab", len) == 0, "short string as pointer and length");
+  ASSERT_TRUE(str == records[3].data + schema->attrOffsets[1], "string points into the record");
+  TEST_CHECK(getStringAttr(&records[4], schema, 1, &str, &len));
+  ASSERT_TRUE(len == 4 && strncmp(str, "wxyz", len) == 0, "string filling the attribute");
+  TEST_CHECK(getAttrInto(&records[4], schema, 1, &value, buf));
+  ASSERT_TRUE(value.dt == DT_STRING && value.v.stringV == buf && strcmp(buf, "wxyz") == 0, "string copied to the buffer");
+  TEST_CHECK(getAttrInto(&records[4], schema, 2, &value, NULL));
+  ASSERT_TRUE(value.dt == DT_INT && value.v.intV == 104, "value of the caller");
+  ASSERT_EQUALS_INT(RC_RM_WRONG_DATATYPE, getFloatAttr(&records[0], schema, 0, &f), "type checked");
+  ASSERT_EQUALS_INT(RC_INVALID_PARAM, getIntAttr(&records[0], schema, 3, &intV), "attribute number checked");
+  ASSERT_EQUALS_INT(RC_INVALID_PARAM, getAttrInto(&records[0], schema, 1, &value, NULL), "string needs a buffer");
+
+  // one attribute of all records into an array
+  TEST_CHECK(getIntColumn(records, numRecords, schema, 2, ints));
+  for (i = 0; i < numRecords && ints[i] == 100 + i; i++)
+    ;
+  ASSERT_EQUALS_INT(numRecords, i, "int column extracted");
+  TEST_CHECK(getStringColumn(records, numRecords, schema, 1, strings));
+  ASSERT_TRUE(strcmp(strings, "wxyz") == 0 && strcmp(strings + 5, "ab") == 0, "string column extracted");
+  ASSERT_EQUALS_INT(RC_RM_WRONG_DATATYPE, getStringColumn(records, numRecords, schema, 0, strings), "column type checked");
+
+  for (i = 0; i < numRecords; i++)
+    free(records[i].data);
+  free(records);
+  freeSchema(schema);
+  TEST_DONE();
+}
+
+void
+testMultiGet (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  RM_PoolOptions small = { 3, RS_LRU, 0 };
+  int numInserts = 1000, numIds = 600, reads, i, j, ok;
+  RM_TableStats stats;
+  RC rc;
+  RID *rids = (RID *) malloc(numInserts * sizeof(RID));
+  RID *ids = (RID *) malloc(numIds * sizeof(RID));
+  Record **records = (Record **) malloc(numIds * sizeof(Record *));
+  Schema *schema;
+  Record *r;
+  testName = "test multi-get by RID";
+  schema = testSchema();
+
+  TEST_CHECK(initRecordManager(NULL));
+  TEST_CHECK(createTable("test_table_m", schema));
+  TEST_CHECK(openTable(table, "test_table_m"));
+  for(i = 0; i < numInserts; i++)
+  {
+    r = testRecord(schema, i, "mget", i % 10);
+    TEST_CHECK(insertRecord(table, r));
+    rids[i] = r->id;
+    freeRecord(r);
+  }
+  TEST_CHECK(deleteRecord(table, rids[7]));
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(getTableStats("test_table_m", &stats));
+
+  // RIDs in scattered order, with repeats, a deleted record and one past the table
+  for (i = 0; i < numIds; i++)
+  {
+    ids[i] = rids[(i * 397) % numInserts];
+    TEST_CHECK(createRecord(&records[i], schema));
+  }
+  ids[10] = ids[20];
+  ids[30] = rids[7];
+  ids[40].page = 100000;
+  ids[40].slot = 0;
+
+  // each page is read once into a pool much smaller than the table
+  TEST_CHECK(openTableWithOptions(table, "test_table_m", &small));
+  reads = getNumPageReads(table);
+  rc = getRecords(table, ids, numIds, records);
+  ASSERT_EQUALS_INT(RC_TUPLE_WIT_RID_ON_EXISTING, rc, "missing records reported");
+  ASSERT_TRUE(getNumPageReads(table) - reads <= stats.numPages, "each page read once");
+  ok = 0;
+  for (i = 0; i < numIds; i++)
+  {
+    if (i == 30 || i == 40)
+      continue;
+    j = (i == 10) ? (20 * 397) % numInserts : (i * 397) % numInserts;
+    if (j == 7)
+      ok += (records[i]->id.page == -1);
+    else
+      ok += (records[i]->id.page == rids[j].page && records[i]->id.slot == rids[j].slot
+             && *(int *) records[i]->data == j);
+  }
+  ASSERT_EQUALS_INT(numIds - 2, ok, "records returned in the caller's order");
+  ASSERT_TRUE(records[30]->id.page == -1 && records[40]->id.page == -1, "missing records marked");
+
+  // one at a time, the same RIDs read pages again and again
+  reads = getNumPageReads(table);
+  for (i = 0; i < numIds; i++)
+    getRecord(table, ids[i], records[i]);
+  ASSERT_TRUE(getNumPageReads(table) - reads > stats.numPages, "getRecord rereads pages");
+  TEST_CHECK(closeTable(table));
+
+  TEST_CHECK(deleteTable("test_table_m"));
+  TEST_CHECK(shutdownRecordManager());
+
+  for (i = 0; i < numIds; i++)
+    freeRecord(records[i]);
+  free(records);
+  free(ids);
+  free(rids);
+  free(table);
+  TEST_DONE();
+}
+
+void
+testChangeWhere (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  RM_PoolOptions small = { 3, RS_LRU, 0 };
+  int numInserts = 1000, reads, changed, i;
+  RM_Transaction *reader;
+  RM_TableStats stats;
+  RID *rids = (RID *) malloc(numInserts * sizeof(RID));
+  RM_Assignment set[2];
+  Value *key;
+  Record *r;
+  Schema *schema;
+  Expr *sel, *left, *right;
+  RC rc;
+  testName = "test deleteWhere and updateWhere";
+  schema = testSchema();
+
+  TEST_CHECK(initRecordManager(NULL));
+  TEST_CHECK(createTable("test_table_w", schema));
+  TEST_CHECK(openTable(table, "test_table_w"));
+  TEST_CHECK(createIndex(table, 0, RM_INDEX_BTREE, TRUE));
+  for(i = 0; i < numInserts; i++)
+  {
+    r = testRecord(schema, i, "when", i % 10);
+    TEST_CHECK(insertRecord(table, r));
+    rids[i] = r->id;
+    freeRecord(r);
+  }
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(getTableStats("test_table_w", &stats));
+  TEST_CHECK(openTableWithOptions(table, "test_table_w", &small));
+  TEST_CHECK(createRecord(&r, schema));
+
+  // c = 3 becomes c = 33, b = 'upd', each page read once; a snapshot keeps the old values
+  TEST_CHECK(beginTransaction(&reader));
+  MAKE_ATTRREF(left, 2);
+  MAKE_CONS(right, stringToValue("i3"));
+  MAKE_BINOP_EXPR(sel, left, right, OP_COMP_EQUAL);
+  set[0].attrNum = 2;
+  set[0].value = stringToValue("i33");
+  set[1].attrNum = 1;
+  set[1].value = stringToValue("supd");
+  reads = getNumPageReads(table);
+  TEST_CHECK(updateWhere(table, sel, set, 2, &changed));
+  ASSERT_TRUE(getNumPageReads(table) - reads <= stats.numPages, "each page read once");
+  ASSERT_EQUALS_INT(numInserts / 10, changed, "updated records counted");
+  ASSERT_EQUALS_INT(0, countScan(table, schema, sel), "no record left to update");
+  freeExpr(sel);
+  MAKE_ATTRREF(left, 2);
+  MAKE_CONS(right, stringToValue("i33"));
+  MAKE_BINOP_EXPR(sel, left, right, OP_COMP_EQUAL);
+  ASSERT_EQUALS_INT(numInserts / 10, countScan(table, schema, sel), "records updated");
+  freeExpr(sel);
+  TEST_CHECK(getRecord(table, rids[13], r));
+  ASSERT_EQUALS_INT(33, intAttr(r, schema, 2), "update seen");
+  ASSERT_TRUE(strncmp(r->data + sizeof(int), "upd", 3) == 0, "string attribute set");
+  TEST_CHECK(getRecordTx(table, reader, rids[13], r));
+  ASSERT_EQUALS_INT(3, intAttr(r, schema, 2), "snapshot sees the records before the update");
+  TEST_CHECK(commitTransaction(reader));
+  freeVal(set[0].value);
+  freeVal(set[1].value);
+
+  // a < 100 are deleted, with their index entries
+  MAKE_ATTRREF(left, 0);
+  MAKE_CONS(right, stringToValue("i100"));
+  MAKE_BINOP_EXPR(sel, left, right, OP_COMP_SMALLER);
+  TEST_CHECK(deleteWhere(table, sel, &changed));
+  ASSERT_EQUALS_INT(100, changed, "deleted records counted");
+  ASSERT_EQUALS_INT(numInserts - 100, getNumTuples(table), "tuple count after delete");
+  ASSERT_EQUALS_INT(0, countScan(table, schema, sel), "records deleted");
+  TEST_CHECK(deleteWhere(table, sel, &changed));
+  ASSERT_EQUALS_INT(0, changed, "nothing left to delete");
+  freeExpr(sel);
+  key = stringToValue("i50");
+  ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, lookupRecord(table, 0, key, r), "index entry removed");
+  freeVal(key);
+
+  // assignments are checked against the schema; a unique index stops the pass at a duplicate key
+  set[0].attrNum = 2;
+  set[0].value = stringToValue("sxx");
+  ASSERT_EQUALS_INT(RC_RM_WRONG_DATATYPE, updateWhere(table, NULL, set, 1, &changed), "assignment type checked");
+  freeVal(set[0].value);
+  set[0].attrNum = 0;
+  set[0].value = stringToValue("i5000");
+  rc = updateWhere(table, NULL, set, 1, &changed);
+  ASSERT_EQUALS_INT(RC_IM_KEY_ALREADY_EXISTS, rc, "unique key checked");
+  ASSERT_EQUALS_INT(1, changed, "records changed before the error counted");
+  TEST_CHECK(lookupRecord(table, 0, set[0].value, r));
+  freeVal(set[0].value);
+
+  // without a condition every record is deleted
+  TEST_CHECK(deleteWhere(table, NULL, &changed));
+  ASSERT_EQUALS_INT(numInserts - 100, changed, "all records deleted");
+  ASSERT_EQUALS_INT(0, getNumTuples(table), "table empty");
+
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(deleteTable("test_table_w"));
+  TEST_CHECK(shutdownRecordManager());
+
+  freeRecord(r);
+  free(rids);
+  free(table);
+  TEST_DONE();
+}
+
+void
+testProjection (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  RM_TableOptions options = { 0 };
+  RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+  int numInserts = 500, attrs[2] = { 2, 0 }, bad[1] = { 3 }, name[1] = { 1 };
+  int layout, i, n, total, ok, a, c, len;
+  char *tuples = (char *) malloc(64 * 8);
+  const char *str;
+  RID ids[64];
+  Record *r, *tuple;
+  Schema *schema, *projected;
+  Expr *sel, *left, *right;
+  RC rc;
+  testName = "test projected scans";
+  schema = testSchema();
+
+  TEST_CHECK(initRecordManager(NULL));
+  for (layout = 0; layout < 2; layout++)
+  {
+    options.layout = layout ? RM_LAYOUT_PAX : RM_LAYOUT_ROW;
+    TEST_CHECK(createTableWithOptions("test_table_j", schema, &options));
+    TEST_CHECK(openTable(table, "test_table_j"));
+    for(i = 0; i < numInserts; i++)
+    {
+      r = testRecord(schema, i, "proj", i % 10);
+      TEST_CHECK(insertRecord(table, r));
+      freeRecord(r);
+    }
+
+    // c, a of the records with c < 3, as compact tuples
+    MAKE_ATTRREF(left, 2);
+    MAKE_CONS(right, stringToValue("i3"));
+    MAKE_BINOP_EXPR(sel, left, right, OP_COMP_SMALLER);
+    TEST_CHECK(startScanProjected(table, sc, sel, attrs, 2));
+    projected = getScanSchema(sc);
+    ASSERT_EQUALS_INT(2, projected->numAttr, "projected attributes");
+    ASSERT_EQUALS_INT(8, getRecordSize(projected), "compact tuples");
+    TEST_CHECK(createRecord(&tuple, projected));
+    total = ok = 0;
+    while ((rc = next(sc, tuple)) == RC_OK)
+    {
+      TEST_CHECK(getIntAttr(tuple, projected, 0, &c));
+      TEST_CHECK(getIntAttr(tuple, projected, 1, &a));
+      ok += (c < 3 && a % 10 == c);
+      total++;
+    }
+    ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, rc, "scan ends");
+    ASSERT_EQUALS_INT(numInserts * 3 / 10, total, "projected tuples returned");
+    ASSERT_EQUALS_INT(total, ok, "projected values");
+
+    // the same in batches; the end is reported after the last batch, then the scan starts over
+    total = ok = 0;
+    while ((rc = nextBatch(sc, tuples, ids, 64, &n)) == RC_OK)
+    {
+      ASSERT_TRUE(n > 0 && n <= 64, "batch size");
+      for (i = 0; i < n; i++)
+      {
+        tuple->data = tuples + i * 8;
+        TEST_CHECK(getIntAttr(tuple, projected, 0, &c));
+        TEST_CHECK(getIntAttr(tuple, projected, 1, &a));
+        ok += (c < 3 && a % 10 == c && ids[i].page >= 2);
+      }
+      total += n;
+    }
+    tuple->data = NULL;
+    ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, rc, "batches end");
+    ASSERT_EQUALS_INT(numInserts * 3 / 10, total, "tuples returned in batches");
+    ASSERT_EQUALS_INT(total, ok, "batched values");
+    TEST_CHECK(nextBatch(sc, tuples, NULL, 64, &n));
+    ASSERT_EQUALS_INT(64, n, "scan started over");
+    TEST_CHECK(closeScan(sc));
+    freeExpr(sel);
+    freeRecord(tuple);
+
+    // records read through an index are projected as well
+    TEST_CHECK(createIndex(table, 0, RM_INDEX_BTREE, TRUE));
+    TEST_CHECK(setAccessPath(table, RM_PATH_INDEX));
+    MAKE_ATTRREF(left, 0);
+    MAKE_CONS(right, stringToValue("i7"));
+    MAKE_BINOP_EXPR(sel, left, right, OP_COMP_EQUAL);
+    TEST_CHECK(startScanProjected(table, sc, sel, name, 1));
+    ASSERT_EQUALS_INT(RM_PATH_INDEX, getScanAccessPath(sc), "index scan");
+    TEST_CHECK(createRecord(&tuple, getScanSchema(sc)));
+    TEST_CHECK(next(sc, tuple));
+    TEST_CHECK(getStringAttr(tuple, getScanSchema(sc), 0, &str, &len));
+    ASSERT_TRUE(len == 4 && strncmp(str, "proj", 4) == 0, "projected from the index scan");
+    ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, next(sc, tuple), "one match");
+    TEST_CHECK(closeScan(sc));
+    freeExpr(sel);
+    freeRecord(tuple);
+
+    ASSERT_EQUALS_INT(RC_INVALID_PARAM, startScanProjected(table, sc, NULL, bad, 1), "attribute checked");
+    TEST_CHECK(closeTable(table));
+    TEST_CHECK(deleteTable("test_table_j"));
+  }
+  TEST_CHECK(shutdownRecordManager());
+
+  free(tuples);
+  free(sc);
+  free(table);
+  freeSchema(schema);
+  TEST_DONE();
+}
+
+static RM_AggResult *
+aggregate (RM_TableData *table, Expr *cond, int *groupBy, int numGroupBy, RM_Aggregate *aggs, int numAggs)
+{
+  RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+  RM_AggResult *result = NULL;
+
+  TEST_CHECK(startScan(table, sc, cond));
+  TEST_CHECK(aggregateScan(sc, groupBy, numGroupBy, aggs, numAggs, &result));
+  TEST_CHECK(closeScan(sc));
+  free(sc);
+  return result;
+}
+
+static int
+resultInt (RM_AggResult *result, int group, int attrNum)
+{
+  Record row;
+  int v = -1;
+
+  row.data = result->rows + group * getRecordSize(result->schema);
+  getIntAttr(&row, result->schema, attrNum, &v);
+  return v;
+}
+
+void
+testAggregation (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+  char *names[] = { "x", "yy", "zzz" };
+  int numInserts = 1000, i, g, ok, sum = 0, seen = 0, len;
+  int byC[1] = { 2 }, byB[1] = { 1 }, byA[1] = { 0 }, projected[1] = { 2 }, byFirst[1] = { 0 };
+  RM_Aggregate all[5] = { { RM_AGG_COUNT, -1 }, { RM_AGG_SUM, 0 }, { RM_AGG_MIN, 0 }, { RM_AGG_MAX, 0 }, { RM_AGG_AVG, 2 } };
+  RM_Aggregate perGroup[3] = { { RM_AGG_COUNT, -1 }, { RM_AGG_SUM, 0 }, { RM_AGG_MAX, 1 } };
+  RM_Aggregate bad[1] = { { RM_AGG_SUM, 1 } };
+  RM_AggResult *result;
+  Record row, *r;
+  const char *str;
+  float avg;
+  Schema *schema;
+  Expr *sel, *left, *right;
+  testName = "test aggregation";
+  schema = testSchema();
+
+  TEST_CHECK(initRecordManager(NULL));
+  TEST_CHECK(createTable("test_table_g", schema));
+  TEST_CHECK(openTable(table, "test_table_g"));
+  for(i = 0; i < numInserts; i++)
+  {
+    r = testRecord(schema, i, names[i % 3], i % 10);
+    TEST_CHECK(insertRecord(table, r));
+    freeRecord(r);
+    if (i % 10 < 5)
+      sum += i;
+  }
+
+  // COUNT, SUM, MIN, MAX, AVG of the records with c < 5, in one group
+  MAKE_ATTRREF(left, 2);
+  MAKE_CONS(right, stringToValue("i5"));
+  MAKE_BINOP_EXPR(sel, left, right, OP_COMP_SMALLER);
+  result = aggregate(table, sel, NULL, 0, all, 5);
+  freeExpr(sel);
+  ASSERT_EQUALS_INT(1, result->numGroups, "one group without group-by");
+  ASSERT_EQUALS_INT(5, result->schema->numAttr, "one attribute per aggregate");
+  ASSERT_EQUALS_STRING("sum(a)", result->schema->attrNames[1], "aggregate named");
+  ASSERT_EQUALS_INT(numInserts / 2, resultInt(result, 0, 0), "count");
+  ASSERT_EQUALS_INT(sum, resultInt(result, 0, 1), "sum");
+  ASSERT_EQUALS_INT(0, resultInt(result, 0, 2), "min");
+  ASSERT_EQUALS_INT(994, resultInt(result, 0, 3), "max");
+  row.data = result->rows;
+  TEST_CHECK(getFloatAttr(&row, result->schema, 4, &avg));
+  ASSERT_TRUE(avg == 2.0f, "avg");
+  freeAggResult(result);
+
+  // counting alone, over no records
+  result = aggregate(table, NULL, NULL, 0, all, 1);
+  ASSERT_EQUALS_INT(numInserts, resultInt(result, 0, 0), "count of all records");
+  freeAggResult(result);
+  MAKE_ATTRREF(left, 0);
+  MAKE_CONS(right, stringToValue("i0"));
+  MAKE_BINOP_EXPR(sel, left, right, OP_COMP_SMALLER);
+  result = aggregate(table, sel, NULL, 0, all, 5);
+  freeExpr(sel);
+  ASSERT_TRUE(result->numGroups == 1 && resultInt(result, 0, 0) == 0 && resultInt(result, 0, 1) == 0, "no records");
+  freeAggResult(result);
+
+  // GROUP BY c
+  result = aggregate(table, NULL, byC, 1, perGroup, 3);
+  ASSERT_EQUALS_INT(10, result->numGroups, "groups of c");
+  ok = 0;
+  for (g = 0; g < result->numGroups; g++)
+  {
+    int c = resultInt(result, g, 0);
+    seen |= 1 << c;
+    row.data = result->rows + g * getRecordSize(result->schema);
+    TEST_CHECK(getStringAttr(&row, result->schema, 3, &str, &len));
+    ok += (resultInt(result, g, 1) == numInserts / 10 && resultInt(result, g, 2) == 100 * c + 49500
+           && len == 3 && strncmp(str, "zzz", 3) == 0);
+  }
+  ASSERT_TRUE(ok == 10 && seen == 0x3ff, "count, sum and max per group");
+  freeAggResult(result);
+
+  // GROUP BY a string, and by a key with as many groups as records
+  result = aggregate(table, NULL, byB, 1, perGroup, 1);
+  ASSERT_EQUALS_INT(3, result->numGroups, "groups of strings");
+  ok = 0;
+  for (g = 0; g < result->numGroups; g++)
+  {
+    row.data = result->rows + g * getRecordSize(result->schema);
+    TEST_CHECK(getStringAttr(&row, result->schema, 0, &str, &len));
+    ok += (len == 1 && resultInt(result, g, 1) == 334) || (len > 1 && resultInt(result, g, 1) == 333);
+  }
+  ASSERT_EQUALS_INT(3, ok, "count per string");
+  freeAggResult(result);
+  result = aggregate(table, NULL, byA, 1, perGroup, 2);
+  ASSERT_EQUALS_INT(numInserts, result->numGroups, "hash table grows");
+  ok = 0;
+  for (g = 0; g < result->numGroups; g++)
+    ok += (resultInt(result, g, 1) == 1 && resultInt(result, g, 2) == resultInt(result, g, 0));
+  ASSERT_EQUALS_INT(numInserts, ok, "one record per group");
+  freeAggResult(result);
+
+  // attributes of a projected scan, and records from an index
+  TEST_CHECK(startScanProjected(table, sc, NULL, projected, 1));
+  TEST_CHECK(aggregateScan(sc, byFirst, 1, perGroup, 1, &result));
+  TEST_CHECK(closeScan(sc));
+  ASSERT_EQUALS_INT(10, result->numGroups, "groups of a projected scan");
+  freeAggResult(result);
+  TEST_CHECK(createIndex(table, 0, RM_INDEX_BTREE, TRUE));
+  TEST_CHECK(setAccessPath(table, RM_PATH_INDEX));
+  MAKE_ATTRREF(left, 0);
+  MAKE_CONS(right, stringToValue("i7"));
+  MAKE_BINOP_EXPR(sel, left, right, OP_COMP_EQUAL);
+  result = aggregate(table, sel, NULL, 0, all, 2);
+  freeExpr(sel);
+  ASSERT_TRUE(resultInt(result, 0, 0) == 1 && resultInt(result, 0, 1) == 7, "aggregate of an index scan");
+  freeAggResult(result);
+
+  // SUM and AVG need numbers
+  TEST_CHECK(startScan(table, sc, NULL));
+  ASSERT_EQUALS_INT(RC_RM_WRONG_DATATYPE, aggregateScan(sc, NULL, 0, bad, 1, &result), "sum of a string");
+  TEST_CHECK(closeScan(sc));
+
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(deleteTable("test_table_g"));
+  TEST_CHECK(shutdownRecordManager());
+
+  free(sc);
+  free(table);
+  freeSchema(schema);
+  TEST_DONE();
+}
+
+// sorts the records of table by int keys and counts the neighbours out of order, ties by RID
+static int
+sortViolations (RM_TableData *table, Schema *schema, RM_SortKey *keys, int numKeys, RM_SortOptions *options,
+                int *numTuples, int *numRuns)
+{
+  RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+  RM_SortHandle *sort;
+  Record *prev, *r, *t;
+  int rc, k, bad = 0;
+
+  createRecord(&prev, schema);
+  createRecord(&r, schema);
+  TEST_CHECK(startScan(table, sc, NULL));
+  TEST_CHECK(startSort(sc, keys, numKeys, options, &sort));
+  TEST_CHECK(closeScan(sc));
+  *numTuples = 0;
+  while((rc = nextSorted(sort, r)) == RC_OK)
+  {
+    if ((*numTuples)++ > 0)
+    {
+      int cmp = 0;
+      for (k = 0; k < numKeys && cmp == 0; k++)
+      {
+        int x = intAttr(prev, schema, keys[k].attrNum), y = intAttr(r, schema, keys[k].attrNum);
+        cmp = (x > y) - (x < y);
+        if (keys[k].descending)
+          cmp = -cmp;
+      }
+      if (cmp == 0)
+        cmp = (prev->id.page != r->id.page) ? prev->id.page - r->id.page : prev->id.slot - r->id.slot;
+      bad += (cmp > 0);
+    }
+    t = prev;
+    prev = r;
+    r = t;
+  }
+  ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, rc, "sort ends");
+  *numRuns = getSortNumRuns(sort);
+  TEST_CHECK(closeSort(sort));
+  freeRecord(prev);
+  freeRecord(r);
+  free(sc);
+  return bad;
+}
+
+void
+testExternalSort (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+  int numInserts = 20000, i, bad, numTuples, numRuns;
+  RM_SortKey byA[1] = { { 0, FALSE } }, byCThenA[2] = { { 2, FALSE }, { 0, TRUE } }, byC[1] = { { 2, FALSE } };
+  RM_SortKey noAttr[1] = { { 3, FALSE } };
+  RM_SortOptions small = { 8, 0 }, tooSmall = { 2, 0 }, parallel = { 512, 4 };
+  RM_SortHandle *sort;
+  Record *r;
+  Schema *schema;
+  testName = "test external sort";
+  schema = testSchema();
+
+  TEST_CHECK(initRecordManager(NULL));
+  TEST_CHECK(createTable("test_table_o", schema));
+  TEST_CHECK(openTable(table, "test_table_o"));
+  for(i = 0; i < numInserts; i++)
+  {
+    r = testRecord(schema, (int) ((i * 7919L) % numInserts), "aaaa", i % 10);
+    TEST_CHECK(insertRecord(table, r));
+    freeRecord(r);
+  }
+
+  // in memory
+  bad = sortViolations(table, schema, byA, 1, NULL, &numTuples, &numRuns);
+  ASSERT_TRUE(bad == 0 && numTuples == numInserts, "sorted in memory");
+  ASSERT_EQUALS_INT(0, numRuns, "nothing spilled");
+
+  // spilled runs, merged in more than one pass; equal keys stay in scan order
+  bad = sortViolations(table, schema, byCThenA, 2, &small, &numTuples, &numRuns);
+  ASSERT_TRUE(bad == 0 && numTuples == numInserts, "sorted by two keys through runs");
+  ASSERT_TRUE(numRuns > numInserts / (7 * PAGE_SIZE / 44), "runs spilled and merged");
+  bad = sortViolations(table, schema, byC, 1, &small, &numTuples, &numRuns);
+  ASSERT_TRUE(bad == 0 && numTuples == numInserts, "stable through runs");
+
+  // pieces sorted by several threads
+  bad = sortViolations(table, schema, byC, 1, &parallel, &numTuples, &numRuns);
+  ASSERT_TRUE(bad == 0 && numTuples == numInserts && numRuns == 0, "sorted in parallel");
+
+  // budget and keys are checked
+  TEST_CHECK(startScan(table, sc, NULL));
+  ASSERT_EQUALS_INT(RC_INVALID_PARAM, startSort(sc, byA, 1, &tooSmall, &sort), "budget below the minimum");
+  ASSERT_EQUALS_INT(RC_INVALID_PARAM, startSort(sc, noAttr, 1, NULL, &sort), "key not an attribute");
+  TEST_CHECK(closeScan(sc));
+
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(deleteTable("test_table_o"));
+  TEST_CHECK(shutdownRecordManager());
+
+  free(sc);
+  free(table);
+  freeSchema(schema);
+  TEST_DONE();
+}
+
+// pairs of the join tables with left a < lmax and right a < rmax: their number and the sum of 3 * left a + right a
+static int
+expectedJoin (int numLeft, int numRight, int lmax, int rmax, long *sum)
+{
+  int i, j, count = 0;
+
+  *sum = 0;
+  for (i = 0; i < numLeft && i < lmax; i++)
+    for (j = 0; j < numRight && j < rmax; j++)
+      if (i % 50 == j % 100)
+      {
+        count++;
+        *sum += 3 * i + j;
+      }
+  return count;
+}
+
+// runs a join of (a, b, c) tables on c in batches, checking every pair; returns the number of pairs
+static int
+runJoin (RM_TableData *left, Expr *leftCond, RM_TableData *right, Expr *rightCond, RM_JoinOptions *options,
+         RM_JoinMethod *method, long *sum)
+{
+  RM_JoinHandle *join;
+  Schema *schema;
+  Record row;
+  RID leftIds[64], rightIds[64];
+  char *tuples;
+  int rc, i, n, count = 0, bad = 0, la, lc, ra, rc2;
+
+  TEST_CHECK(startJoin(left, leftCond, 2, right, rightCond, 2, options, &join));
+  *method = getJoinMethod(join);
+  schema = getJoinSchema(join);
+  tuples = (char *) malloc(64 * getRecordSize(schema));
+  *sum = 0;
+  while ((rc = nextJoinBatch(join, tuples, leftIds, rightIds, 64, &n)) == RC_OK)
+  {
+    for (i = 0; i < n; i++)
+    {
+      row.data = tuples + i * getRecordSize(schema);
+      getIntAttr(&row, schema, 0, &la);
+      getIntAttr(&row, schema, 2, &lc);
+      getIntAttr(&row, schema, 3, &ra);
+      getIntAttr(&row, schema, 5, &rc2);
+      bad += (lc != rc2 || leftIds[i].page < 0 || rightIds[i].page < 0);
+      *sum += 3 * la + ra;
+    }
+    count += n;
+  }
+  ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, rc, "join ends");
+  ASSERT_EQUALS_INT(0, bad, "joined records have equal keys");
+  free(tuples);
+  TEST_CHECK(closeJoin(join));
+  return count;
+}
+
+void
+testJoins (void)
+{
+  RM_TableData *left = (RM_TableData *) malloc(sizeof(RM_TableData));
+  RM_TableData *right = (RM_TableData *) malloc(sizeof(RM_TableData));
+  char *names[] = { "x", "yy", "zzz" };
+  int numLeft = 1000, numRight = 2000, i, count, expected;
+  long sum, expectedSum;
+  RM_JoinOptions hash = { RM_JOIN_HASH, 0 }, spilled = { RM_JOIN_HASH, 3 };
+  RM_JoinOptions merge = { RM_JOIN_SORT_MERGE, 3 }, indexNL = { RM_JOIN_INDEX_NL, 0 };
+  RM_JoinMethod method;
+  RM_JoinHandle *join;
+  Expr *lsel, *rsel, *attr, *cons;
+  Record *r;
+  Schema *schema;
+  testName = "test joins";
+  schema = testSchema();
+
+  TEST_CHECK(initRecordManager(NULL));
+  TEST_CHECK(createTable("test_table_jl", schema));
+  TEST_CHECK(createTable("test_table_jr", schema));
+  TEST_CHECK(openTable(left, "test_table_jl"));
+  TEST_CHECK(openTable(right, "test_table_jr"));
+  for(i = 0; i < numRight; i++)
+  {
+    if (i < numLeft)
+    {
+      r = testRecord(schema, i, names[i % 3], i % 50);
+      TEST_CHECK(insertRecord(left, r));
+      freeRecord(r);
+    }
+    r = testRecord(schema, i, names[i % 3], i % 100);
+    TEST_CHECK(insertRecord(right, r));
+    freeRecord(r);
+  }
+  MAKE_ATTRREF(attr, 0);
+  MAKE_CONS(cons, stringToValue("i100"));
+  MAKE_BINOP_EXPR(lsel, attr, cons, OP_COMP_SMALLER);
+  MAKE_ATTRREF(attr, 0);
+  MAKE_CONS(cons, stringToValue("i1000"));
+  MAKE_BINOP_EXPR(rsel, attr, cons, OP_COMP_SMALLER);
+
+  // hash join, in memory and through partitions loaded in chunks
+  expected = expectedJoin(numLeft, numRight, numLeft, numRight, &expectedSum);
+  count = runJoin(left, NULL, right, NULL, NULL, &method, &sum);
+  ASSERT_TRUE(method == RM_JOIN_HASH && count == expected && sum == expectedSum, "hash join");
+  count = runJoin(left, NULL, right, NULL, &spilled, &method, &sum);
+  ASSERT_TRUE(count == expected && sum == expectedSum, "hash join through partitions");
+  count = runJoin(right, NULL, left, NULL, &spilled, &method, &sum);
+  ASSERT_EQUALS_INT(expected, count, "building on the left input");
+
+  // sort-merge join with spilled sorts
+  count = runJoin(left, NULL, right, NULL, &merge, &method, &sum);
+  ASSERT_TRUE(count == expected && sum == expectedSum, "sort-merge join");
+
+  // conditions on both inputs
+  expected = expectedJoin(numLeft, numRight, 100, 1000, &expectedSum);
+  count = runJoin(left, lsel, right, rsel, &hash, &method, &sum);
+  ASSERT_TRUE(count == expected && sum == expectedSum, "hash join with conditions");
+  count = runJoin(left, lsel, right, rsel, &merge, &method, &sum);
+  ASSERT_TRUE(count == expected && sum == expectedSum, "sort-merge join with conditions");
+
+  // index nested loops once the right attribute has an index
+  ASSERT_EQUALS_INT(RC_INVALID_PARAM, startJoin(left, NULL, 2, right, NULL, 2, &indexNL, &join), "no index to look up");
+  TEST_CHECK(createIndex(right, 2, RM_INDEX_BTREE, FALSE));
+  count = runJoin(left, lsel, right, rsel, NULL, &method, &sum);
+  ASSERT_TRUE(method == RM_JOIN_INDEX_NL && count == expected && sum == expectedSum, "index nested loop join");
+  expected = expectedJoin(numLeft, numRight, numLeft, numRight, &expectedSum);
+  count = runJoin(left, NULL, right, NULL, &indexNL, &method, &sum);
+  ASSERT_TRUE(count == expected && sum == expectedSum, "index nested loop join of all records");
+
+  // layout of the joined tuples, and keys of different types
+  TEST_CHECK(startJoin(left, NULL, 2, right, NULL, 2, &hash, &join));
+  ASSERT_EQUALS_INT(6, getJoinSchema(join)->numAttr, "attributes of both tables");
+  ASSERT_EQUALS_STRING("test_table_jr.c", getJoinSchema(join)->attrNames[5], "attribute named by its table");
+  TEST_CHECK(closeJoin(join));
+  ASSERT_EQUALS_INT(RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE, startJoin(left, NULL, 1, right, NULL, 2, NULL, &join),
+                    "string joined with int");
+
+  freeExpr(lsel);
+  freeExpr(rsel);
+  TEST_CHECK(closeTable(left));
+  TEST_CHECK(closeTable(right));
+  TEST_CHECK(deleteTable("test_table_jl"));
+  TEST_CHECK(deleteTable("test_table_jr"));
+  TEST_CHECK(shutdownRecordManager());
+
+  free(left);
+  free(right);
+  freeSchema(schema);
+  TEST_DONE();
 }
 
 Record *
@@ -0,0 +1,375 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include "dberror.h"
+#include "expr.h"
+#include "btree_mgr.h"
+#include "hash_mgr.h"
+#include "tables.h"
+#include "test_helper.h"
+
+// test methods
+static void testInsertAndFind (void);
+static void testDuplicatesAndRanges (void);
+static void testUniqueKeys (void);
+static void testStringKeys (void);
+static void testHashIndex (void);
+static void testHashDuplicates (void);
+
+// helper methods
+static Value *intKey (int v);
+static int countRange (BTreeHandle *tree, Value *low, Value *high, bool ordered);
+
+char *testName;
+
+// main method
+int
+main (void)
+{
+  testName = "";
+
+  testInsertAndFind();
+  testDuplicatesAndRanges();
+  testUniqueKeys();
+  testStringKeys();
+  testHashIndex();
+  testHashDuplicates();
+
+  return 0;
+}
+
+// ************************************************************
+void
+testInsertAndFind (void)
+{
+  BTreeHandle *tree;
+  int n = 2000, i, result;
+  RID rid;
+  Value *key;
+  testName = "test b-tree inserting and finding keys";
+
+  TEST_CHECK(initIndexManager(NULL));
+  // 4 keys per node, so the tree gets several levels
+  TEST_CHECK(createBtree("test_btree_1.idx", DT_INT, 0, 4, TRUE));
+  TEST_CHECK(openBtree(&tree, "test_btree_1.idx"));
+
+  for(i = 0; i < n; i++)
+  {
+    int k = (i * 7919) % n;
+    key = intKey(k);
+    rid.page = k;
+    rid.slot = k % 7;
+    TEST_CHECK(insertKey(tree, key, rid));
+    freeVal(key);
+  }
+  TEST_CHECK(getNumEntries(tree, &result));
+  ASSERT_EQUALS_INT(n, result, "number of entries");
+  TEST_CHECK(getNumNodes(tree, &result));
+  ASSERT_TRUE(result > n / 4, "nodes were split");
+
+  // reopen, then look up every key
+  TEST_CHECK(closeBtree(tree));
+  TEST_CHECK(openBtree(&tree, "test_btree_1.idx"));
+  for(i = 0; i < n; i++)
+  {
+    key = intKey(i);
+    TEST_CHECK(findKey(tree, key, &rid));
+    if (rid.page != i || rid.slot != i % 7)
+      ASSERT_TRUE(FALSE, "found the right rid");
+    freeVal(key);
+  }
+  key = intKey(n);
+  ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, findKey(tree, key, &rid), "missing key not found");
+  freeVal(key);
+
+  ASSERT_EQUALS_INT(n, countRange(tree, NULL, NULL, TRUE), "full scan in key order");
+
+  TEST_CHECK(closeBtree(tree));
+  TEST_CHECK(deleteBtree("test_btree_1.idx"));
+  TEST_CHECK(shutdownIndexManager());
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testDuplicatesAndRanges (void)
+{
+  BTreeHandle *tree;
+  int n = 3000, i, result;
+  RID rid;
+  Value *key, *low, *high;
+  testName = "test b-tree duplicate keys, deletes and range scans";
+
+  TEST_CHECK(initIndexManager(NULL));
+  TEST_CHECK(createBtree("test_btree_2.idx", DT_INT, 0, 5, FALSE));
+  TEST_CHECK(openBtree(&tree, "test_btree_2.idx"));
+
+  // 60 distinct keys, 50 entries each
+  for(i = 0; i < n; i++)
+  {
+    key = intKey(i % 60);
+    rid.page = i % 60;
+    rid.slot = i;
+    TEST_CHECK(insertKey(tree, key, rid));
+    ASSERT_EQUALS_INT(RC_IM_KEY_ALREADY_EXISTS, insertKey(tree, key, rid), "same entry is rejected");
+    freeVal(key);
+  }
+
+  low = intKey(10);
+  high = intKey(12);
+  ASSERT_EQUALS_INT(150, countRange(tree, low, high, TRUE), "range [10, 12]");
+
+  // delete every other entry of the keys below 30
+  for(i = 0; i < n; i += 2)
+  {
+    if (i % 60 >= 30)
+      continue;
+    key = intKey(i % 60);
+    rid.page = i % 60;
+    rid.slot = i;
+    TEST_CHECK(deleteKey(tree, key, rid));
+    ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, deleteKey(tree, key, rid), "entry is gone");
+    freeVal(key);
+  }
+  TEST_CHECK(getNumEntries(tree, &result));
+  ASSERT_EQUALS_INT(n - 750, result, "number of entries after deletes");
+  ASSERT_EQUALS_INT(50, countRange(tree, low, high, TRUE), "range [10, 12] after deletes");
+  ASSERT_EQUALS_INT(n - 750, countRange(tree, NULL, NULL, TRUE), "full scan after deletes");
+  freeVal(low);
+  freeVal(high);
+
+  low = intKey(55);
+  ASSERT_EQUALS_INT(250, countRange(tree, low, NULL, TRUE), "range [55, ...)");
+  freeVal(low);
+  high = intKey(-1);
+  ASSERT_EQUALS_INT(0, countRange(tree, NULL, high, TRUE), "empty range");
+  freeVal(high);
+
+  TEST_CHECK(closeBtree(tree));
+  TEST_CHECK(deleteBtree("test_btree_2.idx"));
+  TEST_CHECK(shutdownIndexManager());
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testUniqueKeys (void)
+{
+  BTreeHandle *tree;
+  RID rid = {1, 1}, other = {2, 2}, result;
+  Value *key;
+  testName = "test unique b-tree";
+
+  TEST_CHECK(initIndexManager(NULL));
+  TEST_CHECK(createBtree("test_btree_3.idx", DT_INT, 0, 0, TRUE));
+  TEST_CHECK(openBtree(&tree, "test_btree_3.idx"));
+
+  key = intKey(42);
+  TEST_CHECK(insertKey(tree, key, rid));
+  ASSERT_EQUALS_INT(RC_IM_KEY_ALREADY_EXISTS, insertKey(tree, key, other), "duplicate key is rejected");
+  TEST_CHECK(deleteKey(tree, key, rid));
+  TEST_CHECK(insertKey(tree, key, other));
+  TEST_CHECK(findKey(tree, key, &result));
+  ASSERT_TRUE(result.page == 2 && result.slot == 2, "key can be reused after delete");
+  freeVal(key);
+
+  ASSERT_EQUALS_INT(RC_INVALID_PARAM, createBtree("test_btree_4.idx", DT_INT, 0, 1, TRUE), "fanout must be at least 2");
+
+  TEST_CHECK(closeBtree(tree));
+  TEST_CHECK(deleteBtree("test_btree_3.idx"));
+  TEST_CHECK(shutdownIndexManager());
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testStringKeys (void)
+{
+  BTreeHandle *tree;
+  int n = 500, i;
+  char buf[16];
+  RID rid;
+  Value *key, *low, *high;
+  testName = "test b-tree with string keys";
+
+  TEST_CHECK(initIndexManager(NULL));
+  TEST_CHECK(createBtree("test_btree_5.idx", DT_STRING, 6, 8, FALSE));
+  TEST_CHECK(openBtree(&tree, "test_btree_5.idx"));
+
+  for(i = 0; i < n; i++)
+  {
+    sprintf(buf, "k%04d", (i * 263) % n);
+    MAKE_STRING_VALUE(key, buf);
+    rid.page = (i * 263) % n;
+    rid.slot = 0;
+    TEST_CHECK(insertKey(tree, key, rid));
+    freeVal(key);
+  }
+
+  MAKE_STRING_VALUE(key, "k0123");
+  TEST_CHECK(findKey(tree, key, &rid));
+  ASSERT_EQUALS_INT(123, rid.page, "string key found");
+  freeVal(key);
+
+  MAKE_STRING_VALUE(low, "k01");
+  MAKE_STRING_VALUE(high, "k02");
+  ASSERT_EQUALS_INT(100, countRange(tree, low, high, TRUE), "string range");
+  freeVal(low);
+  freeVal(high);
+
+  key = intKey(1);
+  ASSERT_EQUALS_INT(RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE, findKey(tree, key, &rid), "key type is checked");
+  freeVal(key);
+
+  TEST_CHECK(closeBtree(tree));
+  TEST_CHECK(deleteBtree("test_btree_5.idx"));
+  TEST_CHECK(shutdownIndexManager());
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testHashIndex (void)
+{
+  HashHandle *index;
+  int n = 20000, i, k, result;
+  RID rid;
+  testName = "test linear hash index";
+
+  TEST_CHECK(createHashIndex("test_hash_1.idx", sizeof(int), TRUE));
+  TEST_CHECK(openHashIndex(&index, "test_hash_1.idx"));
+
+  for(i = 0; i < n; i++)
+  {
+    k = i * 3;
+    rid.page = i;
+    rid.slot = i % 11;
+    TEST_CHECK(hashInsertKey(index, (char *) &k, rid));
+  }
+  TEST_CHECK(getHashNumEntries(index, &result));
+  ASSERT_EQUALS_INT(n, result, "number of entries");
+  TEST_CHECK(getHashNumBuckets(index, &result));
+  ASSERT_TRUE(result > 4, "buckets were split");
+
+  k = 30;
+  ASSERT_EQUALS_INT(RC_IM_KEY_ALREADY_EXISTS, hashInsertKey(index, (char *) &k, rid), "duplicate key is rejected");
+
+  // reopen, then look up every key
+  TEST_CHECK(closeHashIndex(index));
+  TEST_CHECK(openHashIndex(&index, "test_hash_1.idx"));
+  for(i = 0; i < n; i++)
+  {
+    k = i * 3;
+    TEST_CHECK(hashFindKey(index, (char *) &k, &rid));
+    if (rid.page != i || rid.slot != i % 11)
+      ASSERT_TRUE(FALSE, "found the right rid");
+  }
+  k = 1;
+  ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, hashFindKey(index, (char *) &k, &rid), "missing key not found");
+
+  // delete the even entries
+  for(i = 0; i < n; i += 2)
+  {
+    k = i * 3;
+    rid.page = i;
+    rid.slot = i % 11;
+    TEST_CHECK(hashDeleteKey(index, (char *) &k, rid));
+  }
+  ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, hashDeleteKey(index, (char *) &k, rid), "entry is gone");
+  for(i = 0; i < n; i++)
+  {
+    k = i * 3;
+    if ((hashFindKey(index, (char *) &k, &rid) == RC_OK) != (i % 2 == 1))
+      ASSERT_TRUE(FALSE, "only odd entries remain");
+  }
+  TEST_CHECK(getHashNumEntries(index, &result));
+  ASSERT_EQUALS_INT(n / 2, result, "number of entries after deletes");
+
+  TEST_CHECK(closeHashIndex(index));
+  TEST_CHECK(deleteHashIndex("test_hash_1.idx"));
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testHashDuplicates (void)
+{
+  HashHandle *index;
+  HT_ScanHandle *sc;
+  int n = 3000, i, k, count, pages, before, rc;
+  RID rid;
+  testName = "test hash index with duplicate keys and overflow chains";
+
+  TEST_CHECK(createHashIndex("test_hash_2.idx", sizeof(int), FALSE));
+  TEST_CHECK(openHashIndex(&index, "test_hash_2.idx"));
+
+  // one key with many entries needs an overflow chain
+  k = 7;
+  for(i = 0; i < n; i++)
+  {
+    rid.page = i;
+    rid.slot = 0;
+    TEST_CHECK(hashInsertKey(index, (char *) &k, rid));
+  }
+  ASSERT_EQUALS_INT(RC_IM_KEY_ALREADY_EXISTS, hashInsertKey(index, (char *) &k, rid), "same entry is rejected");
+
+  count = 0;
+  TEST_CHECK(openHashScan(index, (char *) &k, &sc));
+  while((rc = nextHashEntry(sc, &rid)) == RC_OK)
+    count++;
+  ASSERT_EQUALS_INT(RC_IM_NO_MORE_ENTRIES, rc, "scan ends");
+  TEST_CHECK(closeHashScan(sc));
+  ASSERT_EQUALS_INT(n, count, "all entries of the key");
+
+  // emptied overflow pages are reused
+  TEST_CHECK(getHashNumPages(index, &before));
+  for(i = 0; i < n; i++)
+  {
+    rid.page = i;
+    rid.slot = 0;
+    TEST_CHECK(hashDeleteKey(index, (char *) &k, rid));
+  }
+  ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, hashFindKey(index, (char *) &k, &rid), "all entries deleted");
+  for(i = 0; i < n; i++)
+  {
+    rid.page = i;
+    rid.slot = 1;
+    TEST_CHECK(hashInsertKey(index, (char *) &k, rid));
+  }
+  TEST_CHECK(getHashNumPages(index, &pages));
+  ASSERT_EQUALS_INT(before, pages, "no pages added");
+
+  TEST_CHECK(closeHashIndex(index));
+  TEST_CHECK(deleteHashIndex("test_hash_2.idx"));
+  TEST_DONE();
+}
+
+// ************************************************************
+Value *
+intKey (int v)
+{
+  Value *key;
+  MAKE_VALUE(key, DT_INT, v);
+  return key;
+}
+
+// counts the entries in [low, high]; the tests store the key in rid.page, so the order can be checked
+int
+countRange (BTreeHandle *tree, Value *low, Value *high, bool ordered)
+{
+  BT_ScanHandle *sc;
+  RID rid;
+  int rc, count = 0, last = -1;
+
+  TEST_CHECK(openTreeRangeScan(tree, low, high, &sc));
+  while((rc = nextEntry(sc, &rid)) == RC_OK)
+  {
+    if (ordered && rid.page < last)
+      ASSERT_TRUE(FALSE, "entries are returned in key order");
+    last = rid.page;
+    count++;
+  }
+  if (rc != RC_IM_NO_MORE_ENTRIES)
+    TEST_CHECK(rc);
+  TEST_CHECK(closeTreeScan(sc));
+  return count;
+}
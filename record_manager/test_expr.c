@@ -29,6 +29,7 @@
 static void testValueSerialize (void);
 static void testOperators (void);
 static void testExpressions (void);
+static void testCompiledExpressions (void);
 
 char *testName;
 
@@ -41,6 +42,7 @@ main (void)
 	testValueSerialize();
 	testOperators();
 	testExpressions();
+	testCompiledExpressions();
 
 	return 0;
 }
@@ -78,6 +80,8 @@ testOperators (void)
 	// smaller
 	OP_TRUE(stringToValue("i3"),stringToValue("i10"), valueSmaller, "3 < 10");
 	OP_TRUE(stringToValue("f5.0"),stringToValue("f6.5"), valueSmaller, "5.0 < 6.5");
+	OP_TRUE(stringToValue("bf"),stringToValue("bt"), valueSmaller, "f < t");
+	OP_FALSE(stringToValue("bt"),stringToValue("bt"), valueSmaller, "t < t is false");
 
 	// boolean
 	OP_TRUE(stringToValue("bt"),stringToValue("bt"), boolAnd, "t AND t = t");
@@ -123,3 +127,116 @@ testExpressions (void)
 
 	TEST_DONE();
 }
+
+// ************************************************************
+void
+testCompiledExpressions (void)
+{
+	char *names[] = { "a", "b", "c" };
+	DataType dt[] = { DT_INT, DT_STRING, DT_FLOAT };
+	int sizes[] = { 0, 4, 0 };
+	int keys[] = {0};
+	char **cpNames = (char **) malloc(sizeof(char*) * 3);
+	DataType *cpDt = (DataType *) malloc(sizeof(DataType) * 3);
+	int *cpSizes = (int *) malloc(sizeof(int) * 3);
+	int *cpKeys = (int *) malloc(sizeof(int));
+	Schema *schema;
+	Record *r;
+	Expr *a, *b, *c, *cmp1, *cmp2, *cmp3, *both, *sel, *boolSel;
+	CompiledExpr *prog, *boolProg, *bad;
+	Value *v, *res;
+	int i, rounds = 200000;
+	clock_t start;
+	double interpreted, compiled;
+	testName = "test compiled expressions against evalExpr";
+
+	for (i = 0; i < 3; i++)
+		cpNames[i] = strdup(names[i]);
+	memcpy(cpDt, dt, sizeof(DataType) * 3);
+	memcpy(cpSizes, sizes, sizeof(int) * 3);
+	memcpy(cpKeys, keys, sizeof(int));
+	schema = createSchema(3, cpNames, cpDt, cpSizes, 1, cpKeys);
+	TEST_CHECK(createRecord(&r, schema));
+
+	// NOT (a < 50) AND (b = 'abcd' OR c < 2.5)
+	MAKE_ATTRREF(a, 0);
+	MAKE_CONS(c, stringToValue("i50"));
+	MAKE_BINOP_EXPR(both, a, c, OP_COMP_SMALLER);
+	MAKE_UNOP_EXPR(cmp1, both, OP_BOOL_NOT);
+	MAKE_ATTRREF(b, 1);
+	MAKE_CONS(c, stringToValue("sabcd"));
+	MAKE_BINOP_EXPR(cmp2, b, c, OP_COMP_EQUAL);
+	MAKE_ATTRREF(c, 2);
+	MAKE_CONS(b, stringToValue("f2.5"));
+	MAKE_BINOP_EXPR(cmp3, c, b, OP_COMP_SMALLER);
+	MAKE_BINOP_EXPR(both, cmp2, cmp3, OP_BOOL_OR);
+	MAKE_BINOP_EXPR(sel, cmp1, both, OP_BOOL_AND);
+
+	TEST_CHECK(compileExpr(sel, schema, &prog));
+
+	// (a < 50) < (c < 2.5) compares booleans
+	MAKE_ATTRREF(a, 0);
+	MAKE_CONS(c, stringToValue("i50"));
+	MAKE_BINOP_EXPR(cmp1, a, c, OP_COMP_SMALLER);
+	MAKE_ATTRREF(c, 2);
+	MAKE_CONS(b, stringToValue("f2.5"));
+	MAKE_BINOP_EXPR(cmp2, c, b, OP_COMP_SMALLER);
+	MAKE_BINOP_EXPR(boolSel, cmp1, cmp2, OP_COMP_SMALLER);
+	TEST_CHECK(compileExpr(boolSel, schema, &boolProg));
+
+	// both evaluators have to agree on every record
+	for (i = 0; i < 1000; i++)
+	{
+		MAKE_VALUE(v, DT_INT, i % 100);
+		setAttr(r, schema, 0, v);
+		freeVal(v);
+		MAKE_STRING_VALUE(v, (i % 3 == 0) ? "abcd" : "abc");
+		setAttr(r, schema, 1, v);
+		freeVal(v);
+		MAKE_VALUE(v, DT_FLOAT, (i % 7) * 0.5);
+		setAttr(r, schema, 2, v);
+		freeVal(v);
+
+		evalExpr(r, schema, sel, &res);
+		if (res->v.boolV != evalCompiledExpr(prog, r->data))
+			ASSERT_TRUE(FALSE, "compiled result equals evalExpr");
+		freeVal(res);
+
+		evalExpr(r, schema, boolSel, &res);
+		if (res->v.boolV != evalCompiledExpr(boolProg, r->data))
+			ASSERT_TRUE(FALSE, "compiled boolean comparison equals evalExpr");
+		freeVal(res);
+	}
+	ASSERT_TRUE(TRUE, "compiled result equals evalExpr for 1000 records");
+
+	// type errors are detected at compile time
+	MAKE_ATTRREF(a, 0);
+	MAKE_CONS(c, stringToValue("f1.0"));
+	MAKE_BINOP_EXPR(cmp1, a, c, OP_COMP_EQUAL);
+	ASSERT_ERROR(compileExpr(cmp1, schema, &bad), "compare int with float");
+	freeExpr(cmp1);
+
+	start = clock();
+	for (i = 0; i < rounds; i++)
+	{
+		evalExpr(r, schema, sel, &res);
+		freeVal(res);
+	}
+	interpreted = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+	start = clock();
+	for (i = 0; i < rounds; i++)
+		evalCompiledExpr(prog, r->data);
+	compiled = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+	// Timings depend on the machine and its load, so they are reported, not asserted
+	printf("evalExpr: %.3fs, evalCompiledExpr: %.3fs for %i evaluations\n", interpreted, compiled, rounds);
+
+	freeCompiledExpr(prog);
+	freeCompiledExpr(boolProg);
+	freeExpr(sel);
+	freeExpr(boolSel);
+	freeRecord(r);
+	freeSchema(schema);
+	TEST_DONE();
+}